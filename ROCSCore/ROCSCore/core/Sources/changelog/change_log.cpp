@@ -5,6 +5,9 @@ using namespace std;
 namespace CL
 {
 
+// The first version checksummed in sections.
+static const cmn::FileVersion checksummedVersion(2, 1);
+
 ROCS_CORE_API
 std::string GetNewLogNameFromVersion(
     const std::string &existingName, 
@@ -56,10 +59,26 @@ ChangeLog::ChangeLog(std::istream &is)
     this->LoadIstream(is);
 }
 
+ChangeLog::ChangeLog(ex::BinaryReader &reader)
+{
+    this->LoadBinaryReader(reader);
+}
+
 void ChangeLog::LoadIstream(std::istream &is)
 {
-    cmn::FileVersion fileVersion; 
     is.exceptions(istream::failbit|istream::badbit);
+    this->read_binary(is);
+}
+
+void ChangeLog::LoadBinaryReader(ex::BinaryReader &reader)
+{
+    this->read_binary(reader);
+}
+
+template<class InputT>
+void ChangeLog::read_binary(InputT &is)
+{
+    cmn::FileVersion fileVersion; 
     if (!cmn::check_file_header(
         is,
         "ROCS",
@@ -71,6 +90,51 @@ void ChangeLog::LoadIstream(std::istream &is)
         throw ChangeLogVersionError("Unsupported ShowData Version");
     }
 
+    if (fileVersion < checksummedVersion)
+    {
+        UInt16 log_count = this->read_head(is, fileVersion);
+        SongLogPtrT log;
+        for (; log_count > 0; log_count--)
+        {
+            log = SongLogPtrT(new SongLog(is, fileVersion));
+            this->song_logs_[log->GetSongNumber()] = log;
+            log.reset();
+        }
+
+        return;
+    }
+
+    ex::BinaryReader head = cmn::read_section(
+        is,
+        "The ChangeLog header",
+        cmn::header_checksum("ROCS", "CHLG", fileVersion));
+
+    UInt16 log_count = this->read_head(head, fileVersion);
+    if (head.GetAvailable())
+    {
+        throw ChangeLogException("The ChangeLog header is longer than its fields");
+    }
+
+    for (UInt16 i = 0; i < log_count; i++)
+    {
+        ex::BinaryReader section = cmn::read_section(
+            is,
+            ex::format("Song log %u of %u", i + 1, log_count));
+
+        SongLogPtrT log(new SongLog(section, fileVersion));
+        if (section.GetAvailable())
+        {
+            throw ChangeLogException(
+                "The song log for " + log->GetSongNumber() + " is longer than its events");
+        }
+
+        this->song_logs_[log->GetSongNumber()] = log;
+    }
+}
+
+template<class InputT>
+UInt16 ChangeLog::read_head(InputT &is, const cmn::FileVersion &fileVersion)
+{
     this->show_name_ = ex::ReadString(is);
     this->customer_name_ = ex::ReadString(is);
     this->license_id_ = ex::UUID(is);
@@ -78,14 +142,7 @@ void ChangeLog::LoadIstream(std::istream &is)
 
     UInt16 log_count;
     is.read(reinterpret_cast<char *>(&log_count), sizeof(log_count));
-
-    SongLogPtrT log;
-    for (; log_count > 0; log_count--)
-    {
-        log = SongLogPtrT(new SongLog(is, fileVersion));
-        this->song_logs_[log->GetSongNumber()] = log;
-        log.reset();
-    }
+    return log_count;
 }
 
 void ChangeLog::DummyLoader()
@@ -101,6 +158,17 @@ void ChangeLog::DummyLoader()
 }
 
 void ChangeLog::WriteBinary(std::ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void ChangeLog::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void ChangeLog::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
 {
     cmn::ROCSFileHeader hdr(
         "ROCS",
@@ -108,6 +176,31 @@ void ChangeLog::WriteBinary(std::ostream &os, const cmn::FileVersion &fileVersio
         fileVersion.GetMajorVersion(),
         fileVersion.GetMinorVersion());
     os.write((char *)&hdr, sizeof(hdr));
+    if (fileVersion < checksummedVersion)
+    {
+        this->write_head(os, fileVersion);
+        for (auto it: this->song_logs_)
+        {
+            it.second->WriteBinary(os, fileVersion);
+        }
+
+        return;
+    }
+
+    ex::BinaryWriter section;
+    this->write_head(section, fileVersion);
+    cmn::write_section(os, section, cmn::header_checksum("ROCS", "CHLG", fileVersion));
+    for (auto it: this->song_logs_)
+    {
+        section.clear();
+        it.second->WriteBinary(section, fileVersion);
+        cmn::write_section(os, section);
+    }
+}
+
+template<class OutputT>
+void ChangeLog::write_head(OutputT &os, const cmn::FileVersion &fileVersion) const
+{
     ex::WriteString(os, this->GetShowName());
     ex::WriteString(os, this->GetCustomerName());
 
@@ -116,13 +209,6 @@ void ChangeLog::WriteBinary(std::ostream &os, const cmn::FileVersion &fileVersio
 
     UInt16 log_count = song_logs_.size();
     os.write((char *)&log_count, sizeof(log_count));
-
-    // SongLogMapT::const_iterator it;
-
-    for (auto it: this->song_logs_)
-    {
-        it.second->WriteBinary(os, fileVersion);
-    }
 }
 
 void ChangeLog::WriteString(ostream &os) const
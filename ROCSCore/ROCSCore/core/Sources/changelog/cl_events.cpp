@@ -75,19 +75,40 @@ bool CustomBar::operator==(const ROCSEvent &other) const
         && (this->value() == other.value()));
 }
 
-Marker::Marker(istream& is, const cmn::FileVersion &)
+template<class InputT>
+void Marker::read_binary(InputT& is, const cmn::FileVersion &)
 {
     is.read((char *)&this->abs_time_, sizeof(this->abs_time_));
     this->value_ = ex::ReadString(is);
 }
 
-
-void Marker::WriteBinary(ostream& os, const cmn::FileVersion &) const
+template<class OutputT>
+void Marker::write_binary(OutputT& os, const cmn::FileVersion &) const
 {
     os.write((char *)&abs_time_, sizeof(abs_time_));
     ex::WriteString(os, value_);
 }
 
+Marker::Marker(istream& is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+Marker::Marker(ex::BinaryReader& reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+void Marker::WriteBinary(ostream& os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void Marker::WriteBinary(ex::BinaryWriter& writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
 
 void Marker::value(const string& val)
 {
@@ -122,7 +143,8 @@ void Marker::WriteString(ostream& os) const
         << ")";
 }
 
-Caesura::Caesura(istream &is, const cmn::FileVersion &fileVersion)
+template<class InputT>
+void Caesura::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     this->abs_time_ = ex::read<UInt32>(is);
 
@@ -136,7 +158,8 @@ Caesura::Caesura(istream &is, const cmn::FileVersion &fileVersion)
     }
 }
 
-void Caesura::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion ) const
+template<class OutputT>
+void Caesura::write_binary(OutputT &os, const cmn::FileVersion &fileVersion ) const
 {
     ex::write(os, this->abs_time_);
 
@@ -147,6 +170,26 @@ void Caesura::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion ) con
     }
 }
 
+Caesura::Caesura(istream &is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+Caesura::Caesura(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+void Caesura::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void Caesura::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
 void Caesura::WriteString(ostream& os) const
 {
     os  << "Caesura("
@@ -155,20 +198,42 @@ void Caesura::WriteString(ostream& os) const
         << ")";
 }
 
-PairedEvent::PairedEvent(istream &is, const cmn::FileVersion &)
+template<class InputT>
+void PairedEvent::read_binary(InputT &is, const cmn::FileVersion &)
 {
     start_ = ex::read<UInt32>(is);
     end_ = ex::read<UInt32>(is);
     int_value_ = ex::read<SInt32>(is);
 }
 
-void PairedEvent::WriteBinary(ostream& os, const cmn::FileVersion &) const
+template<class OutputT>
+void PairedEvent::write_binary(OutputT& os, const cmn::FileVersion &) const
 {
     ex::write(os, start_);
     ex::write(os, end_);
     ex::write(os, int_value_);
 }
 
+PairedEvent::PairedEvent(istream &is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+PairedEvent::PairedEvent(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+void PairedEvent::WriteBinary(ostream& os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void PairedEvent::WriteBinary(ex::BinaryWriter& writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
 void PairedEvent::WriteString(ostream& os) const
 {
     os  << codes::code_names[code()]
@@ -4,28 +4,51 @@ using namespace std;
 
 namespace CL {
 
-MarkerSequence::MarkerSequence(std::istream &is, const cmn::FileVersion &fileVersion)
+template<class InputT>
+void MarkerSequence::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     UInt8 event_type = is.get();
     if (event_type != this->code()) throw logic_error("event_type does not match container type.");
     UInt32 obj_count;
     is.read((char *)&obj_count, sizeof(obj_count));
+    this->events_.reserve(obj_count);
     while (obj_count > 0) {
-        this->events_.push_back(Marker(is, fileVersion));
+        this->events_.emplace_back(is, fileVersion);
         obj_count--;
     }
 }
 
-void MarkerSequence::WriteBinary(ostream &os, const cmn::FileVersion& fileVersion) const
+template<class OutputT>
+void MarkerSequence::write_binary(OutputT &os, const cmn::FileVersion& fileVersion) const
 {
     os.put(this->code());
     UInt32 obj_count = this->events_.size();
     os.write((char *)&obj_count, sizeof(obj_count));
     
-    for (auto it: this->events_)
+    for (auto &it: this->events_)
     {
         it.WriteBinary(os, fileVersion);
     }
 }
 
+MarkerSequence::MarkerSequence(std::istream &is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+MarkerSequence::MarkerSequence(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+void MarkerSequence::WriteBinary(ostream &os, const cmn::FileVersion& fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void MarkerSequence::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion& fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
 } // namespace CL
@@ -15,6 +15,7 @@ Editor::Editor(ChangeLog &changeLog, const rocs_midi::ShowData &showData)
 {
     std::lock_guard<std::recursive_mutex> lock(this->GetActiveSongLog().GetLock());
     this->CreateBeatTickIndices_();
+    this->CreateTempoMap_();
 }
 
 void Editor::SelectSongLogForEditing(const std::string &songNumber)
@@ -29,6 +30,7 @@ void Editor::SelectSongLogForEditing(const std::string &songNumber)
 
     std::lock_guard<std::recursive_mutex> lock(this->GetActiveSongLog().GetLock());
     this->CreateBeatTickIndices_();
+    this->CreateTempoMap_();
 }
 
 const cmn::ROCSEvent & Editor::AddEvent(const cmn::ROCSEvent &evt)
@@ -239,6 +241,7 @@ EditorHistory::HistoryActionT Editor::Undo()
     }
 
     this->CreateBeatTickIndices_();
+    this->tempoMap_.SetTempoScales(this->GetActiveSongLog().GetTempoScales());
     return action;
 }
  
@@ -272,6 +275,7 @@ EditorHistory::HistoryActionT Editor::Redo()
     }
     
     this->CreateBeatTickIndices_();
+    this->tempoMap_.SetTempoScales(this->GetActiveSongLog().GetTempoScales());
     return action;
 }
     
@@ -347,13 +351,19 @@ void Editor::AlignEventWithBeat_(cmn::ROCSEvent &event)
 void Editor::CreateBeatTickIndices_()
 {
     this->beatTickIndices_.clear();
-    auto& barsBeats = this->GetActiveTimeline().GetBarsBeats(); 
+    auto& timeline = this->GetActiveTimeline();
     auto& clicks = this->GetActiveSongLog().GetClicks();
-    auto& meters = this->GetActiveTimeline().GetMeters();
-    
-    for (auto it: barsBeats)
+    auto& meters = timeline.GetMeters();
+
+    if (!timeline.GetBarGrid().empty())
+    {
+        timeline.GetBarGrid().ExpandBeatTicks(this->beatTickIndices_);
+    } else
     {
-        this->beatTickIndices_.push_back(it.abs_time());
+        for (auto &it: timeline.GetBarsBeats())
+        {
+            this->beatTickIndices_.push_back(it.abs_time());
+        }
     }
 
     for (auto it: clicks)
@@ -399,7 +409,22 @@ void Editor::CreateBeatTickIndices_()
         }
     }
 
-    this->beatTickIndices_.sort();
+    std::sort(this->beatTickIndices_.begin(), this->beatTickIndices_.end());
+}
+
+void Editor::CreateTempoMap_()
+{
+    auto &songLog = this->GetActiveSongLog();
+    if (!songLog.GetPulsesPerQuarterNote())
+    {
+        this->tempoMap_ = TL::TempoMap();
+        return;
+    }
+
+    this->tempoMap_ = TL::TempoMap(
+        this->GetActiveTimeline(),
+        songLog.GetTempoScales(),
+        songLog.GetPulsesPerQuarterNote());
 }
 
 
@@ -455,6 +480,10 @@ void Editor::FinishEdit_(const cmn::ROCSEvent &evt)
     if (evt.code() == codes::click)
     {
         this->CreateBeatTickIndices_();
+    } else if (evt.code() == codes::tempo_scale)
+    {
+        // Only the part of the song after the edit is recomputed.
+        this->tempoMap_.SetTempoScales(this->GetActiveSongLog().GetTempoScales());
     }
 }
 
@@ -129,6 +129,17 @@ SongLog & SongLog::operator=(const SongLog &other)
 }
 
 SongLog::SongLog(istream &is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+SongLog::SongLog(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void SongLog::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     this->song_number_ = ex::ReadString(is);
     this->song_name_ = ex::ReadString(is);
@@ -174,7 +185,7 @@ SongLog::SongLog(istream &is, const cmn::FileVersion &fileVersion)
                 throw UnknownSequenceType(ex::format(
                     "SongLog found unknown event code: %#X at %u",
                     is.peek(),
-                    is.tellg()));
+                    static_cast<unsigned>(is.tellg())));
         }
     }
 
@@ -222,21 +233,17 @@ SongLog::SongLog(const std_midi::MIDIFile &midiFile):
     Fermata prev_fermata;
     FermataPtrT curr_fermata;
     std::list<cmn::ROCSEvtPtrT> evts;
-    std_midi::MarkerPtrT mkr_ptr;
 
-    std_midi::MIDIPacketVecT packets = midiFile.GetTracks().at(0).GetPackets();
     UInt32 abs_time = 0;
 
-    for (auto p_it: midiFile.GetConductorPackets())
+    for (auto &p_it: midiFile.GetConductorPackets())
     {
         abs_time += p_it.delta_time();
-        auto meta_ptr = p_it.meta_filter(std_midi::sb::marker);
-        if (!meta_ptr)
+        auto mkr_ptr = dynamic_cast<const std_midi::Marker *>(
+            p_it.find_meta(std_midi::sb::marker));
+        if (!mkr_ptr)
         {
             continue;
-        } else
-        {
-            mkr_ptr = dynamic_pointer_cast<std_midi::Marker>(meta_ptr);
         }
         
         evts = read_marker(abs_time, *mkr_ptr);
@@ -428,6 +435,17 @@ void SongLog::WriteStringDetailed(ostream &os, int indent) const
 
 
 void SongLog::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void SongLog::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void SongLog::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
 {
     ex::WriteString(os, this->GetSongNumber());
     ex::WriteString(os, this->GetSongName());
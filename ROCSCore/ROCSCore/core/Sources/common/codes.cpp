@@ -27,6 +27,7 @@ CodeMapT create_names()
     code_map[key] = "Key";
     code_map[page_num] = "PageNum";
     code_map[meter] = "Meter";
+    code_map[bar_grid] = "BarGrid";
 
     code_map[inPoint] = "inPoint";
     code_map[outPoint] = "outPoint";
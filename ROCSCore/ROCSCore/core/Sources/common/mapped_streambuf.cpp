@@ -0,0 +1,56 @@
+#include "core/common/mapped_streambuf.h"
+
+using namespace std;
+
+namespace cmn
+{
+
+MappedStreamBuf::MappedStreamBuf(shared_ptr<const void> owner, const char *begin, const char *end)
+    :
+    owner_(owner)
+{
+    // streambuf wants char *, but nothing here writes through it.
+    char *first = const_cast<char *>(begin);
+    this->setg(first, first, const_cast<char *>(end));
+}
+
+bool MappedStreamBuf::Skip(size_t count)
+{
+    if (count > this->GetAvailable()) return false;
+    // gbump takes an int, which a large track could overflow.
+    this->setg(this->eback(), this->gptr() + count, this->egptr());
+    return true;
+}
+
+MappedStreamBuf::pos_type MappedStreamBuf::seekoff(
+    off_type off,
+    ios_base::seekdir way,
+    ios_base::openmode which)
+{
+    if (!(which & ios_base::in)) return pos_type(off_type(-1));
+
+    off_type base = 0;
+    if (way == ios_base::cur)
+    {
+        base = this->gptr() - this->eback();
+    } else if (way == ios_base::end)
+    {
+        base = this->egptr() - this->eback();
+    }
+
+    return this->seekpos(pos_type(base + off), which);
+}
+
+MappedStreamBuf::pos_type MappedStreamBuf::seekpos(pos_type sp, ios_base::openmode which)
+{
+    off_type pos = sp;
+    if (!(which & ios_base::in) || pos < 0 || pos > this->egptr() - this->eback())
+    {
+        return pos_type(off_type(-1));
+    }
+
+    this->setg(this->eback(), this->eback() + pos, this->egptr());
+    return sp;
+}
+
+} // end namespace cmn
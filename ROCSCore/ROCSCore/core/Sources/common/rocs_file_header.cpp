@@ -1,9 +1,15 @@
 #include "core/common/rocs_file_header.h"
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "exlib/crc32c.h"
+
 namespace cmn {
 
-ROCS_CORE_API bool check_file_header(
-    std::istream &is,
+template<class InputT>
+static bool check_header(
+    InputT &is,
     const std::string &vendorId,
     const std::string &fileType,
     const FileVersion &minimumFileVersion,
@@ -26,4 +32,112 @@ ROCS_CORE_API bool check_file_header(
     return !(hdr.GetFileVersion() < minimumFileVersion);
 }
 
+ROCS_CORE_API bool check_file_header(
+    std::istream &is,
+    const std::string &vendorId,
+    const std::string &fileType,
+    const FileVersion &minimumFileVersion,
+    FileVersion &streamFileVersion)
+{
+    return check_header(is, vendorId, fileType, minimumFileVersion, streamFileVersion);
+}
+
+ROCS_CORE_API bool check_file_header(
+    ex::BinaryReader &reader,
+    const std::string &vendorId,
+    const std::string &fileType,
+    const FileVersion &minimumFileVersion,
+    FileVersion &streamFileVersion)
+{
+    return check_header(reader, vendorId, fileType, minimumFileVersion, streamFileVersion);
+}
+
+}
+
+namespace cmn {
+
+ROCS_CORE_API UInt32 header_checksum(
+    const std::string &vendorId,
+    const std::string &fileType,
+    const FileVersion &fileVersion)
+{
+    ROCSFileHeader hdr(vendorId, fileType, fileVersion.GetMajorVersion(), fileVersion.GetMinorVersion());
+    return ex::crc32c(&hdr, sizeof(hdr));
+}
+
+template<class OutputT>
+static void write_checksummed(OutputT &os, const ex::BinaryWriter &section, UInt32 seed)
+{
+    if (section.size() > MAX_UINT32)
+    {
+        throw ChecksumError("A section is too long to checksum.");
+    }
+
+    UInt32 length = static_cast<UInt32>(section.size());
+    UInt32 checksum = ex::crc32c(section.GetData(), section.size(), seed);
+    os.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    os.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    os.write(section.GetData(), section.size());
+}
+
+ROCS_CORE_API void write_section(std::ostream &os, const ex::BinaryWriter &section, UInt32 seed)
+{
+    write_checksummed(os, section, seed);
+}
+
+ROCS_CORE_API void write_section(ex::BinaryWriter &writer, const ex::BinaryWriter &section, UInt32 seed)
+{
+    write_checksummed(writer, section, seed);
+}
+
+static void check_section(const ex::BinaryReader &section, UInt32 checksum, const std::string &what, UInt32 seed)
+{
+    if (ex::crc32c(section.GetData(), section.size(), seed) != checksum)
+    {
+        throw ChecksumError(what + " is damaged: its checksum does not match.");
+    }
+}
+
+ROCS_CORE_API ex::BinaryReader read_section(std::istream &is, const std::string &what, UInt32 seed)
+{
+    // Read in pieces, so that a damaged length runs into the end of the
+    // stream rather than asking for all of it at once.
+    const size_t piece = 1 << 20;
+    UInt32 length = 0;
+    UInt32 checksum = 0;
+    std::shared_ptr<std::vector<char>> bytes(new std::vector<char>);
+    try
+    {
+        is.read(reinterpret_cast<char *>(&length), sizeof(length));
+        is.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+        while (is && bytes->size() < length)
+        {
+            size_t at = bytes->size();
+            bytes->resize(at + std::min<size_t>(piece, length - at));
+            is.read(bytes->data() + at, bytes->size() - at);
+        }
+    } catch (std::ios_base::failure &)
+    {
+        throw ChecksumError(what + " is cut short.");
+    }
+
+    if (!is) throw ChecksumError(what + " is cut short.");
+
+    ex::BinaryReader section(bytes->data(), bytes->size(), bytes);
+    check_section(section, checksum, what, seed);
+    return section;
+}
+
+ROCS_CORE_API ex::BinaryReader read_section(ex::BinaryReader &reader, const std::string &what, UInt32 seed)
+{
+    if (reader.GetAvailable() < 2 * sizeof(UInt32)) throw ChecksumError(what + " is cut short.");
+    UInt32 length = reader.Read<UInt32>();
+    UInt32 checksum = reader.Read<UInt32>();
+    if (reader.GetAvailable() < length) throw ChecksumError(what + " is cut short.");
+
+    ex::BinaryReader section(reader.Skip(length), length, reader.GetOwner());
+    check_section(section, checksum, what, seed);
+    return section;
+}
+
 }
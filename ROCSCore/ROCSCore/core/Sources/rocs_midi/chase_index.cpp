@@ -0,0 +1,163 @@
+#include "core/rocs_midi/chase_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+const UInt8 ChaseState::unset;
+const UInt16 ChaseState::unset_pitch_wheel;
+
+void ChaseState::Reset()
+{
+    memset(this->controllers, unset, sizeof(this->controllers));
+    memset(this->velocities, 0, sizeof(this->velocities));
+    this->program = unset;
+    this->channel_pressure = unset;
+    this->pitch_wheel = unset_pitch_wheel;
+}
+
+void ChaseState::Apply(const VoiceEvent &voiceEvent)
+{
+    UInt8 data1 = voiceEvent.GetData1() & 0x7F;
+    UInt8 data2 = voiceEvent.GetData2() & 0x7F;
+    switch (voiceEvent.GetStatusType())
+    {
+    case std_midi::sb::note_off:
+        this->velocities[data1] = 0;
+        break;
+    case std_midi::sb::note_on:
+        this->velocities[data1] = data2;
+        break;
+    case std_midi::sb::control_change:
+        this->controllers[data1] = data2;
+        break;
+    case std_midi::sb::program_change:
+        this->program = data1;
+        break;
+    case std_midi::sb::channel_pressure:
+        this->channel_pressure = data1;
+        break;
+    case std_midi::sb::pitch_wheel:
+        this->pitch_wheel = static_cast<UInt16>(data1 | (data2 << 7));
+        break;
+    default:
+        break;
+    }
+}
+
+ROCS_CORE_API bool operator==(const ChaseState &lhs, const ChaseState &rhs)
+{
+    return !memcmp(lhs.controllers, rhs.controllers, sizeof(lhs.controllers))
+        && !memcmp(lhs.velocities, rhs.velocities, sizeof(lhs.velocities))
+        && lhs.program == rhs.program
+        && lhs.channel_pressure == rhs.channel_pressure
+        && lhs.pitch_wheel == rhs.pitch_wheel;
+}
+
+ChaseIndex::ChaseIndex(const VoiceData &voiceData, const vector<UInt32> &ticks)
+    :
+    voiceData_(voiceData),
+    ticks_(ticks)
+{
+    if (!is_sorted(this->ticks_.begin(), this->ticks_.end()))
+    {
+        throw invalid_argument("ChaseIndex checkpoint ticks must be sorted");
+    }
+}
+
+ChaseIndex::ChaseIndex(const VoiceData &voiceData, UInt32 interval)
+    :
+    voiceData_(voiceData)
+{
+    if (!interval)
+    {
+        throw invalid_argument("ChaseIndex interval must be more than 0");
+    }
+
+    UInt32 last = 0;
+    for (auto &it: voiceData.GetTracks())
+    {
+        const VoiceTrack &track = *it.second;
+        if (track.GetEventCount())
+        {
+            last = max(last, track.GetEventData()[track.GetEventCount() - 1].GetAbsTime());
+        }
+    }
+
+    for (UInt64 tick = interval; tick <= last; tick += interval)
+    {
+        this->ticks_.push_back(static_cast<UInt32>(tick));
+    }
+}
+
+void ChaseIndex::ChaseStateAt(UInt16 trackId, UInt32 tick, ChaseState &state)
+{
+    const VoiceTrack &track = this->voiceData_.GetTrack(trackId);
+    auto found = this->tracks_.find(trackId);
+    if (found == this->tracks_.end())
+    {
+        found = this->tracks_.insert(make_pair(trackId, TrackCheckpoints())).first;
+        this->build(track, found->second);
+    } else if (found->second.revision != track.GetRevision())
+    {
+        this->build(track, found->second);
+    }
+
+    const TrackCheckpoints &checkpoints = found->second;
+    size_t checkpoint = upper_bound(this->ticks_.begin(), this->ticks_.end(), tick)
+        - this->ticks_.begin();
+
+    size_t index = 0;
+    if (checkpoint)
+    {
+        state = checkpoints.states[checkpoint - 1];
+        index = checkpoints.indices[checkpoint - 1];
+    } else
+    {
+        state.Reset();
+    }
+
+    const VoiceEvent *events = track.GetEventData();
+    size_t count = track.GetEventCount();
+    for (; index < count && events[index].GetAbsTime() < tick; index++)
+    {
+        state.Apply(events[index]);
+    }
+}
+
+void ChaseIndex::ChaseStateAt(UInt32 tick, ChaseStateByTrackIdT &states)
+{
+    for (auto &it: this->voiceData_.GetTracks())
+    {
+        this->ChaseStateAt(it.first, tick, states[it.first]);
+    }
+}
+
+void ChaseIndex::build(const VoiceTrack &track, TrackCheckpoints &checkpoints) const
+{
+    checkpoints.revision = track.GetRevision();
+    checkpoints.indices.resize(this->ticks_.size());
+    checkpoints.states.resize(this->ticks_.size());
+
+    const VoiceEvent *events = track.GetEventData();
+    size_t count = track.GetEventCount();
+    ChaseState state;
+    size_t index = 0;
+    for (size_t i = 0; i < this->ticks_.size(); i++)
+    {
+        for (; index < count && events[index].GetAbsTime() < this->ticks_[i]; index++)
+        {
+            state.Apply(events[index]);
+        }
+
+        checkpoints.indices[i] = index;
+        checkpoints.states[i] = state;
+    }
+}
+
+} // end namespace rocs_midi
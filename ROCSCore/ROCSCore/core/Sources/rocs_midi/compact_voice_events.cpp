@@ -0,0 +1,394 @@
+#include "core/rocs_midi/compact_voice_events.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ROCS_DECODE_SSE2 1
+#endif
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+/* Events are decoded straight into memory as two 32 bit words, the time and
+ * then status, data1, data2 and padding from the low byte up, as
+ * transpose_voice_events reads them. */
+static_assert(sizeof(VoiceEvent) == 8, "VoiceEvent must be 8 bytes for decode_voice_events");
+
+static const Byte dictionaryCode = 0xF0;
+
+// A message must occur this often to earn a dictionary entry, which costs
+// 3 bytes and saves 1 or 2 each time it is used.
+static const size_t dictionaryMinimum = 4;
+
+static UInt32 message_word(Byte status, Byte data1, Byte data2)
+{
+    return status | (data1 << 8) | (data2 << 16);
+}
+
+static UInt32 message_word(const VoiceEvent &event)
+{
+    return message_word(event.GetStatus(), event.GetData1(), event.GetData2());
+}
+
+static void put_event(VoiceEvent *event, UInt32 time, UInt32 message)
+{
+    UInt64 words = time | (static_cast<UInt64>(message) << 32);
+    memcpy(event, &words, sizeof(words));
+}
+
+static void write_varint(vector<char> &out, UInt32 value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.push_back(static_cast<char>(value));
+}
+
+static bool is_note(Byte status)
+{
+    return (status & 0xE0) == 0x80;
+}
+
+/* Only a message that needs its status written is worth an entry, and only
+ * there is the dictionary used, so that runs of one status stay in the form
+ * the decoder's fast path reads.  Nor is it used for a note after a note:
+ * notes alternate on and off, and coding the few that repeat, at random
+ * among the rest, costs the decoder more in mispredicted branches than it
+ * saves in bytes. */
+static bool may_use_dictionary(const VoiceEvent *events, size_t i)
+{
+    if (!i) return true;
+    Byte status = events[i].GetStatus();
+    Byte previous = events[i - 1].GetStatus();
+    return status != previous && !(is_note(status) && is_note(previous));
+}
+
+bool encode_voice_events(const VoiceEvent *events, size_t count, vector<char> &out)
+{
+    unordered_map<UInt32, size_t> counts;
+    for (size_t i = 0; i < count; i++)
+    {
+        Byte status = events[i].GetStatus();
+        if (status < 0x80 || status >= dictionaryCode) return false;
+        if (i && events[i].GetAbsTime() < events[i - 1].GetAbsTime()) return false;
+        if (may_use_dictionary(events, i)) counts[message_word(events[i])]++;
+    }
+
+    // The most frequent messages, ties broken by the message so that the
+    // same events always encode the same way.
+    vector<pair<size_t, UInt32>> frequent;
+    for (auto &it: counts)
+    {
+        if (it.second >= dictionaryMinimum) frequent.push_back(make_pair(it.second, it.first));
+    }
+
+    sort(
+        frequent.begin(),
+        frequent.end(),
+        [](const pair<size_t, UInt32> &lhs, const pair<size_t, UInt32> &rhs)->bool
+        {
+            return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+        });
+
+    if (frequent.size() > compact_dictionary_size) frequent.resize(compact_dictionary_size);
+
+    unordered_map<UInt32, Byte> dictionary;
+    out.reserve(out.size() + 1 + 3 * frequent.size() + 3 * count);
+    out.push_back(static_cast<char>(frequent.size()));
+    for (auto &it: frequent)
+    {
+        Byte code = static_cast<Byte>(dictionaryCode + dictionary.size());
+        dictionary[it.second] = code;
+        out.push_back(static_cast<char>(it.second));
+        out.push_back(static_cast<char>(it.second >> 8));
+        out.push_back(static_cast<char>(it.second >> 16));
+    }
+
+    UInt32 time = 0;
+    Byte runningStatus = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        const VoiceEvent &event = events[i];
+        write_varint(out, event.GetAbsTime() - time);
+        time = event.GetAbsTime();
+
+        if (event.GetStatus() != runningStatus || event.GetData1() >= 0x80)
+        {
+            auto entry = dictionary.empty() || !may_use_dictionary(events, i)
+                ? dictionary.end()
+                : dictionary.find(message_word(event));
+            if (entry != dictionary.end())
+            {
+                out.push_back(static_cast<char>(entry->second));
+                continue;
+            }
+
+            runningStatus = event.GetStatus();
+            out.push_back(static_cast<char>(runningStatus));
+        }
+
+        out.push_back(static_cast<char>(event.GetData1()));
+        out.push_back(static_cast<char>(event.GetData2()));
+    }
+
+    return true;
+}
+
+/* Reads the dictionary, leaving data after it. */
+static bool read_dictionary(const Byte *&data, const Byte *end, UInt32 *dictionary, size_t &size)
+{
+    if (data == end) return false;
+    size = *data++;
+    if (size > compact_dictionary_size || static_cast<size_t>(end - data) < 3 * size) return false;
+    for (size_t i = 0; i < size; i++, data += 3)
+    {
+        if (data[0] < 0x80 || data[0] >= dictionaryCode) return false;
+        dictionary[i] = message_word(data[0], data[1], data[2]);
+    }
+
+    return true;
+}
+
+/* Decodes the event at data, checking every byte. */
+static bool decode_event(
+    const Byte *&data,
+    const Byte *end,
+    const UInt32 *dictionary,
+    size_t dictionarySize,
+    UInt32 &time,
+    Byte &runningStatus,
+    VoiceEvent *event)
+{
+    UInt32 delta = 0;
+    for (unsigned shift = 0;; shift += 7)
+    {
+        if (data == end || shift > 28) return false;
+        Byte b = *data++;
+        delta |= static_cast<UInt32>(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+
+    time += delta;
+    if (data == end) return false;
+    Byte b = *data++;
+    UInt32 message;
+    if (b >= dictionaryCode)
+    {
+        if (static_cast<size_t>(b - dictionaryCode) >= dictionarySize) return false;
+        message = dictionary[b - dictionaryCode];
+    } else if (b >= 0x80)
+    {
+        if (end - data < 2) return false;
+        runningStatus = b;
+        message = message_word(b, data[0], data[1]);
+        data += 2;
+    } else
+    {
+        if (!runningStatus || data == end) return false;
+        message = message_word(runningStatus, b, data[0]);
+        data += 1;
+    }
+
+    put_event(event, time, message);
+    return true;
+}
+
+bool decode_voice_events_scalar(const char *data, size_t size, VoiceEvent *events, size_t count)
+{
+    const Byte *p = reinterpret_cast<const Byte *>(data);
+    const Byte *end = p + size;
+    UInt32 dictionary[compact_dictionary_size];
+    size_t dictionarySize;
+    if (!read_dictionary(p, end, dictionary, dictionarySize)) return false;
+
+    UInt32 time = 0;
+    Byte runningStatus = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!decode_event(p, end, dictionary, dictionarySize, time, runningStatus, events + i))
+        {
+            return false;
+        }
+    }
+
+    return p == end;
+}
+
+#if defined(ROCS_DECODE_SSE2)
+/* Puts 4 events of the messages in messages, each a delta in deltas after the
+ * one before and the first after the time in every lane of times, which is
+ * left holding the last event's time. */
+static void put_events(VoiceEvent *events, __m128i &times, __m128i deltas, __m128i messages)
+{
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 4));
+    deltas = _mm_add_epi32(deltas, _mm_slli_si128(deltas, 8));
+    times = _mm_add_epi32(times, deltas);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(events), _mm_unpacklo_epi32(times, messages));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(events + 2), _mm_unpackhi_epi32(times, messages));
+    times = _mm_shuffle_epi32(times, _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
+bool decode_voice_events(const char *data, size_t size, VoiceEvent *events, size_t count)
+{
+    const Byte *begin = reinterpret_cast<const Byte *>(data);
+    const Byte *end = begin + size;
+
+    // Entries past the dictionary's size are left zero, which no message is,
+    // so that a code for one is caught by checking every message at the end.
+    UInt32 dictionary[compact_dictionary_size] = {};
+    size_t dictionarySize;
+    if (!read_dictionary(begin, end, dictionary, dictionarySize)) return false;
+
+    // p and time are only copied into decode_event, never passed to it, so
+    // that they can stay in registers.
+    const Byte *p = begin;
+    VoiceEvent *event = events;
+    VoiceEvent *last = events + count;
+    UInt32 time = 0;
+    UInt32 runningStatus = 0;
+
+    // Messages from codes and the running status are checked together at
+    // the end: each has its top bit set unless the bytes are damaged.
+    UInt32 valid = 0x80;
+    for (;;)
+    {
+        // No event is longer than 8 bytes, so this many are decoded without
+        // looking for the end.
+        VoiceEvent *stop = event + min(
+            static_cast<size_t>(last - event),
+            static_cast<size_t>(end - p) / 8);
+        if (event == stop) break;
+        while (event != stop)
+        {
+            UInt64 bytes;
+            memcpy(&bytes, p, sizeof(bytes));
+            UInt32 delta = bytes & 0x7F;
+            if (bytes & 0x80)
+            {
+                if (bytes & 0x8000)
+                {
+                    // A delta of more than 2 bytes is rare.
+                    const Byte *q = p;
+                    UInt32 t = time;
+                    Byte status = static_cast<Byte>(runningStatus);
+                    if (!decode_event(q, end, dictionary, dictionarySize, t, status, event++)) return false;
+                    p = q;
+                    time = t;
+                    runningStatus = status;
+                    continue;
+                }
+
+                delta |= (bytes >> 1) & 0x3F80;
+                bytes >>= 8;
+                p += 1;
+            }
+
+            time += delta;
+            UInt32 first = (bytes >> 8) & 0xFF;
+            if (first >= dictionaryCode)
+            {
+                UInt32 message = dictionary[first & 0x0F];
+                valid &= message;
+                put_event(event++, time, message);
+                p += 2;
+                continue;
+            }
+
+            if (first >= 0x80)
+            {
+                runningStatus = first;
+                put_event(event++, time, (bytes >> 8) & 0xFFFFFF);
+                p += 4;
+
+#if defined(ROCS_DECODE_SSE2)
+                // After a status event of a one byte delta, as in notes, if
+                // the next 16 bytes are 4 more in that form, a one byte delta
+                // and a status that is not a code in every 4, they are
+                // decoded at once.
+                if (delta >= 0x80 || stop - event < 4) continue;
+                __m128i times = _mm_set1_epi32(time);
+                while (stop - event >= 4)
+                {
+                    __m128i run = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                    __m128i high = _mm_and_si128(run, _mm_set1_epi8(static_cast<char>(0xF0)));
+                    __m128i codes = _mm_cmpeq_epi8(high, _mm_set1_epi8(static_cast<char>(0xF0)));
+                    if ((_mm_movemask_epi8(run) & 0x3333) != 0x2222
+                        || (_mm_movemask_epi8(codes) & 0x2222))
+                    {
+                        break;
+                    }
+
+                    put_events(
+                        event,
+                        times,
+                        _mm_and_si128(run, _mm_set1_epi32(0xFF)),
+                        _mm_srli_epi32(run, 8));
+                    runningStatus = p[13];
+                    event += 4;
+                    p += 16;
+                }
+
+                time = _mm_cvtsi128_si32(times);
+#endif
+                continue;
+            }
+
+            // Before any status, runningStatus is zero.
+            valid &= runningStatus;
+            put_event(event++, time, (bytes & 0xFFFF00) | runningStatus);
+            p += 3;
+
+#if defined(ROCS_DECODE_SSE2)
+            // After an event of a one byte delta with the running status, as
+            // in dense controller data, if none of the next 12 bytes has its
+            // top bit set they are 4 more events in that form.
+            if (delta >= 0x80 || stop - event < 4) continue;
+            __m128i status = _mm_set1_epi32(runningStatus);
+            __m128i times = _mm_set1_epi32(time);
+            while (stop - event >= 4)
+            {
+                __m128i run = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+                if (_mm_movemask_epi8(run) & 0x0FFF) break;
+
+                // Each event's 3 bytes, and the delta of the next, in a lane.
+                __m128i words = _mm_unpacklo_epi64(
+                    _mm_unpacklo_epi32(run, _mm_srli_si128(run, 3)),
+                    _mm_unpacklo_epi32(_mm_srli_si128(run, 6), _mm_srli_si128(run, 9)));
+                put_events(
+                    event,
+                    times,
+                    _mm_and_si128(words, _mm_set1_epi32(0xFF)),
+                    _mm_or_si128(_mm_and_si128(words, _mm_set1_epi32(0xFFFF00)), status));
+                event += 4;
+                p += 12;
+            }
+
+            time = _mm_cvtsi128_si32(times);
+#endif
+        }
+    }
+
+    if (!(valid & 0x80)) return false;
+
+    // The last few events, checking every byte.
+    const Byte *q = p;
+    UInt32 t = time;
+    Byte status = static_cast<Byte>(runningStatus);
+    for (; event != last; event++)
+    {
+        if (!decode_event(q, end, dictionary, dictionarySize, t, status, event)) return false;
+    }
+
+    return q == end;
+}
+
+} // end namespace rocs_midi
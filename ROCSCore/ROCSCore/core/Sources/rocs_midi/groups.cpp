@@ -1,11 +1,32 @@
 #include "core/rocs_midi/groups.h"
 
+#include <atomic>
+
 using namespace std;
 
 namespace rocs_midi
 {
 
-Groups::Groups(istream &is, const cmn::FileVersion &)
+Groups::Groups(istream &is, const cmn::FileVersion &fileVersion)
+    :
+    lastGroupId_(0),
+    revision_(next_revision()),
+    masksCurrent_(true)
+{
+    this->read_binary(is, fileVersion);
+}
+
+Groups::Groups(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    :
+    lastGroupId_(0),
+    revision_(next_revision()),
+    masksCurrent_(true)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void Groups::read_binary(InputT &is, const cmn::FileVersion &)
 {
     UInt8 groupId;
     string gname;
@@ -19,15 +40,31 @@ Groups::Groups(istream &is, const cmn::FileVersion &)
         gname = ex::ReadString(is);
         this->groupNameByGroupId_[groupId] = gname;
         this->groupIdByGroupName_[gname] = groupId;
+        this->lastGroupId_ = max(this->lastGroupId_, groupId);
         is.read((char *)&track_id_count, sizeof(track_id_count));
         track_ids.resize(track_id_count);
         is.read((char *)&track_ids[0], sizeof(UInt16) * track_id_count);
-        this->groups_[groupId].insert(track_ids.begin(), track_ids.end());
+        for (auto trackId: track_ids)
+        {
+            this->insert(groupId, trackId);
+        }
+
         grp_count--;
     }
 }
 
-void Groups::WriteBinary(ostream &os, const cmn::FileVersion &) const
+void Groups::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void Groups::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void Groups::write_binary(OutputT &os, const cmn::FileVersion &) const
 {
     UInt16 track_id_count;
     vector<UInt16> track_ids;
@@ -81,14 +118,14 @@ void Groups::AddTrack(VoiceTrackPtrT voiceTrackPtr)
             {
                 groupId = this->groupIdByGroupName_[groupName];
                 voiceTrackPtr->SetGroupId(groupId);
-                this->groups_[groupId].insert(voiceTrackPtr->GetTrackId());
+                this->insert(groupId, voiceTrackPtr->GetTrackId());
             } else
             {
                 this->lastGroupId_ += 1;
                 this->groupNameByGroupId_[this->lastGroupId_] = groupName;
                 this->groupIdByGroupName_[groupName] = this->lastGroupId_;
                 voiceTrackPtr->SetGroupId(this->lastGroupId_);
-                this->groups_[this->lastGroupId_].insert(voiceTrackPtr->GetTrackId());
+                this->insert(this->lastGroupId_, voiceTrackPtr->GetTrackId());
             }
         } else if (trackNameParts.front() == "@p")
         {
@@ -212,6 +249,56 @@ void Groups::clear()
     this->groupNameByGroupId_.clear();
     this->groupIdByGroupName_.clear();
     this->groups_.clear();
+    this->masks_.clear();
+    this->revision_ = next_revision();
+    this->masksCurrent_ = true;
+}
+
+bool Groups::IsMember(UInt8 groupId, UInt16 trackId) const
+{
+    this->update_masks();
+    if (groupId >= this->masks_.size()) return false;
+    const TrackMaskT &mask = this->masks_[groupId];
+    size_t word = trackId / 64;
+    return word < mask.size() && ((mask[word] >> (trackId % 64)) & 1);
+}
+
+UInt64 Groups::next_revision()
+{
+    static atomic<UInt64> revision(0);
+    return ++revision;
+}
+
+void Groups::insert(UInt8 groupId, UInt16 trackId)
+{
+    this->update_masks();
+    this->groups_[groupId].insert(trackId);
+    this->set_mask(groupId, trackId);
+    this->revision_ = next_revision();
+}
+
+void Groups::update_masks() const
+{
+    if (this->masksCurrent_) return;
+    this->masks_.clear();
+    for (auto &it: this->groups_)
+    {
+        for (auto trackId: it.second)
+        {
+            this->set_mask(it.first, trackId);
+        }
+    }
+
+    this->masksCurrent_ = true;
+}
+
+void Groups::set_mask(UInt8 groupId, UInt16 trackId) const
+{
+    if (groupId >= this->masks_.size()) this->masks_.resize(groupId + 1);
+    TrackMaskT &mask = this->masks_[groupId];
+    size_t word = trackId / 64;
+    if (word >= mask.size()) mask.resize(word + 1, 0);
+    mask[word] |= UInt64(1) << (trackId % 64);
 }
 
 } // namespace rocs_midi
@@ -0,0 +1,290 @@
+#include "core/rocs_midi/merged_voice_stream.h"
+
+#include <algorithm>
+#include <queue>
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+static_assert(sizeof(MergedVoiceEvent) == 12, "MergedVoiceEvent should pack into 12 bytes");
+
+static bool earlier(const MergedVoiceEvent &lhs, const MergedVoiceEvent &rhs)
+{
+    if (lhs.abs_time != rhs.abs_time) return lhs.abs_time < rhs.abs_time;
+    return lhs.track_id < rhs.track_id;
+}
+
+MergedVoiceStream::MergedVoiceStream(const VoiceData &voiceData)
+    :
+    voiceData_(voiceData),
+    lastUpdateCount_(0),
+    revision_(0)
+{}
+
+const MergedVoiceEvtVecT& MergedVoiceStream::GetEvents()
+{
+    this->update();
+    return this->events_;
+}
+
+void MergedVoiceStream::update()
+{
+    // Tracks are known by the id the VoiceData keeps them under, which is
+    // the id their events are merged under.
+    vector<UInt16> changedIds;
+    TrackVecT changedTracks;
+    size_t trackCount = 0;
+    for (auto &it: this->voiceData_.GetTracks())
+    {
+        const VoiceTrack &track = *it.second;
+        trackCount++;
+        auto found = this->tracks_.find(it.first);
+        if (found != this->tracks_.end()
+            && found->second.revision == track.GetRevision()
+            && found->second.group_id == track.GetGroupId())
+        {
+            continue;
+        }
+
+        changedIds.push_back(it.first);
+        changedTracks.push_back(make_pair(it.first, &track));
+    }
+
+    for (auto &it: this->tracks_)
+    {
+        if (!this->voiceData_.GetTracks().count(it.first))
+        {
+            changedIds.push_back(it.first);
+        }
+    }
+
+    this->lastUpdateCount_ = changedIds.size();
+    if (changedIds.empty()) return;
+    this->revision_++;
+
+    if (changedTracks.size() == trackCount)
+    {
+        this->merge(changedTracks, this->events_);
+    } else
+    {
+        // Take out the changed tracks' events and merge their new ones back
+        // in.  Events of different tracks never compare equal, so the result
+        // is the same as merging every track again.
+        sort(changedIds.begin(), changedIds.end());
+        this->events_.erase(
+            remove_if(
+                this->events_.begin(),
+                this->events_.end(),
+                [&changedIds](const MergedVoiceEvent &voiceEvent)->bool
+                {
+                    return binary_search(changedIds.begin(), changedIds.end(), voiceEvent.track_id);
+                }),
+            this->events_.end());
+
+        this->merge(changedTracks, this->scratch_);
+        size_t middle = this->events_.size();
+        this->events_.insert(this->events_.end(), this->scratch_.begin(), this->scratch_.end());
+        inplace_merge(
+            this->events_.begin(),
+            this->events_.begin() + middle,
+            this->events_.end(),
+            earlier);
+    }
+
+    this->tracks_.clear();
+    for (auto &it: this->voiceData_.GetTracks())
+    {
+        TrackState state;
+        state.revision = it.second->GetRevision();
+        state.group_id = it.second->GetGroupId();
+        this->tracks_[it.first] = state;
+    }
+}
+
+void MergedVoiceStream::merge(const TrackVecT &tracks, MergedVoiceEvtVecT &out) const
+{
+    struct Head
+    {
+        const VoiceEvent *it;
+        const VoiceEvent *end;
+        UInt16 track_id;
+        UInt8 group_id;
+    };
+
+    auto later = [](const Head &lhs, const Head &rhs)->bool
+    {
+        if (lhs.it->GetAbsTime() != rhs.it->GetAbsTime())
+        {
+            return lhs.it->GetAbsTime() > rhs.it->GetAbsTime();
+        }
+
+        return lhs.track_id > rhs.track_id;
+    };
+
+    size_t total = 0;
+    vector<Head> heads;
+    heads.reserve(tracks.size());
+    for (auto &it: tracks)
+    {
+        const VoiceTrack *track = it.second;
+        const VoiceEvent *events = track->GetEventData();
+        size_t count = track->GetEventCount();
+        total += count;
+        if (!count) continue;
+        Head head = {events, events + count, it.first, track->GetGroupId()};
+        heads.push_back(head);
+    }
+
+    out.clear();
+    out.reserve(total);
+    priority_queue<Head, vector<Head>, decltype(later)> queue(later, std::move(heads));
+    while (!queue.empty())
+    {
+        Head head = queue.top();
+        queue.pop();
+
+        // Take the whole run of this track that comes before any other
+        // track's next event.
+        UInt32 stop = queue.empty() ? MAX_UINT32 : queue.top().it->GetAbsTime();
+        bool stopInclusive = !queue.empty() && head.track_id < queue.top().track_id;
+        do
+        {
+            MergedVoiceEvent merged;
+            merged.abs_time = head.it->GetAbsTime();
+            merged.message = head.it->GetVoiceMessage();
+            merged.track_id = head.track_id;
+            merged.group_id = head.group_id;
+            merged.padding = 0;
+            out.push_back(merged);
+            ++head.it;
+        } while (
+            head.it != head.end
+            && (head.it->GetAbsTime() < stop
+                || (stopInclusive && head.it->GetAbsTime() == stop)));
+
+        if (head.it != head.end) queue.push(head);
+    }
+}
+
+MergedVoiceCursor::MergedVoiceCursor(MergedVoiceStream &stream)
+    :
+    stream_(stream),
+    first_(nullptr),
+    it_(nullptr),
+    end_(nullptr),
+    filtered_(false),
+    streamRevision_(0),
+    groupsRevision_(0),
+    next_(0)
+{
+    this->groups_.set();
+    this->Seek(0);
+}
+
+void MergedVoiceCursor::SetGroups(const set<UInt8> &groupIds)
+{
+    GroupFilterT groups;
+    for (auto groupId: groupIds)
+    {
+        groups.set(groupId);
+    }
+
+    this->SetGroups(groups);
+}
+
+void MergedVoiceCursor::SetGroups(const GroupFilterT &groups)
+{
+    size_t at = this->position();
+    this->groups_ = groups;
+    this->filtered_ = true;
+    this->update_positions(at);
+}
+
+void MergedVoiceCursor::Seek(UInt32 tick)
+{
+    const MergedVoiceEvtVecT &events = this->stream_.GetEvents();
+    this->first_ = events.data();
+    this->end_ = this->first_ + events.size();
+    this->it_ = lower_bound(
+        this->first_,
+        this->end_,
+        tick,
+        [](const MergedVoiceEvent &voiceEvent, UInt32 tick)->bool
+        {
+            return voiceEvent.abs_time < tick;
+        });
+
+    if (!this->filtered_) return;
+    size_t at = this->it_ - this->first_;
+    if (this->streamRevision_ != this->stream_.GetRevision()
+        || this->groupsRevision_ != this->stream_.GetVoiceData().GetGroups().GetRevision())
+    {
+        this->update_positions(at);
+        return;
+    }
+
+    this->next_ = lower_bound(this->positions_.begin(), this->positions_.end(), at)
+        - this->positions_.begin();
+}
+
+const MergedVoiceEvent* MergedVoiceCursor::Next()
+{
+    if (!this->filtered_)
+    {
+        if (this->it_ == this->end_) return nullptr;
+        return this->it_++;
+    }
+
+    if (this->next_ == this->positions_.size()) return nullptr;
+    return this->first_ + this->positions_[this->next_++];
+}
+
+const MergedVoiceEvent* MergedVoiceCursor::NextBefore(UInt32 tick)
+{
+    const MergedVoiceEvent *next = this->first_ + this->position();
+    if (next == this->end_ || next->abs_time >= tick) return nullptr;
+    return this->Next();
+}
+
+size_t MergedVoiceCursor::position() const
+{
+    if (!this->filtered_) return this->it_ - this->first_;
+    if (this->next_ == this->positions_.size()) return this->end_ - this->first_;
+    return this->positions_[this->next_];
+}
+
+void MergedVoiceCursor::update_positions(size_t position)
+{
+    const VoiceData &voiceData = this->stream_.GetVoiceData();
+    const Groups &groups = voiceData.GetGroups();
+    this->tracks_.reset();
+    for (auto &it: voiceData.GetTracks())
+    {
+        for (size_t groupId = 0; groupId < this->groups_.size(); groupId++)
+        {
+            if (this->groups_[groupId] && groups.IsMember(static_cast<UInt8>(groupId), it.first))
+            {
+                this->tracks_.set(it.first);
+                break;
+            }
+        }
+    }
+
+    this->positions_.clear();
+    for (const MergedVoiceEvent *it = this->first_; it != this->end_; ++it)
+    {
+        if (this->tracks_[it->track_id])
+        {
+            this->positions_.push_back(static_cast<UInt32>(it - this->first_));
+        }
+    }
+
+    this->streamRevision_ = this->stream_.GetRevision();
+    this->groupsRevision_ = groups.GetRevision();
+    this->next_ = lower_bound(this->positions_.begin(), this->positions_.end(), position)
+        - this->positions_.begin();
+}
+
+} // end namespace rocs_midi
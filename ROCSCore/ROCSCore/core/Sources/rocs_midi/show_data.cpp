@@ -1,14 +1,414 @@
 #include "core/rocs_midi/show_data.h"
 
+#include "exlib/crc32c.h"
+#include "exlib/mapped_file.h"
+#include "exlib/parallel_for.h"
+#include "core/common/mapped_streambuf.h"
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <mutex>
+#include <chrono>
+
 using namespace std;
 
 namespace rocs_midi
 {
 
-ShowData::ShowData(istream &is)
+// The first version with a song table.
+static const cmn::FileVersion songTableVersion(2, 3);
+
+// From this version each song starts on a multiple of 8 bytes, as do the
+// events of each VoiceTrack, so that a mapped file can be read in place.
+static const cmn::FileVersion alignedSongsVersion(2, 4);
+
+static const UInt64 songAlignment = 8;
+
+// From this version the show name and song table are a checksummed section,
+// and the table gives each song's CRC32C.
+static const cmn::FileVersion checksummedVersion(2, 6);
+
+static UInt64 align_song(UInt64 offset)
+{
+    return (offset + songAlignment - 1) / songAlignment * songAlignment;
+}
+
+/* Reads a song out of song, which holds exactly the bytes the song table
+ * gives songNumber, and must be that song. */
+static SongDataPtrT parse_song(
+    ex::BinaryReader &song,
+    const string &songNumber,
+    const cmn::FileVersion &fileVersion)
+{
+    SongDataPtrT songData;
+    try
+    {
+        songData.reset(new SongData(song, fileVersion));
+    } catch (ex::BinaryReaderError &)
+    {
+    }
+
+    if (!songData || song.GetAvailable())
+    {
+        throw ShowDataError(ex::format(
+            "Song %s does not end where the song table says",
+            songNumber.c_str()));
+    }
+
+    if (songData->GetSongNumber() != songNumber)
+    {
+        throw ShowDataError("Song " + songData->GetSongNumber() + " is not where the song table says");
+    }
+
+    return songData;
+}
+
+static void check_song(const ex::BinaryReader &song, UInt32 checksum, const string &songNumber)
+{
+    if (ex::crc32c(song.GetData(), song.size()) != checksum)
+    {
+        throw cmn::ChecksumError("Song " + songNumber + " is damaged: its checksum does not match.");
+    }
+}
+
+/* Moves past the next length bytes and returns a reader of just those. */
+static ex::BinaryReader take_song(ex::BinaryReader &reader, UInt64 length)
+{
+    size_t size = static_cast<size_t>(length);
+    return ex::BinaryReader(reader.Skip(size), size, reader.GetOwner());
+}
+
+/* Out of memory the song is read where it is, keeping reader's owner. */
+static ex::BinaryReader take_song(ex::BinaryReader &reader, UInt64 length, vector<char> &)
+{
+    return take_song(reader, length);
+}
+
+/* Reads the next length bytes into buffer, in one read instead of one per
+ * field.  The reader has no owner, so the tracks copy their events out of
+ * buffer, which need only last until the song is parsed. */
+static ex::BinaryReader take_song(istream &is, UInt64 length, vector<char> &buffer)
+{
+    // Before 2.6 the table has no checksum, so length may be anything.
+    if (length > ex::remaining(is))
+    {
+        throw ShowDataError("A song is longer than the rest of the file");
+    }
+
+    buffer.resize(static_cast<size_t>(length));
+    is.read(buffer.data(), buffer.size());
+    return ex::BinaryReader(buffer.data(), buffer.size());
+}
+
+/* Parses songs[i] as song songNumbers[i] on up to threads threads, first
+ * checking it against checksums[i] unless checksums is empty. */
+static vector<SongDataPtrT> parse_songs(
+    vector<ex::BinaryReader> &songs,
+    const vector<string> &songNumbers,
+    const vector<UInt32> &checksums,
+    const cmn::FileVersion &fileVersion,
+    unsigned threads)
+{
+    vector<SongDataPtrT> parsed(songs.size());
+    ex::parallel_for(
+        songs.size(),
+        [&](size_t i)
+        {
+            if (!checksums.empty()) check_song(songs[i], checksums[i], songNumbers[i]);
+            parsed[i] = parse_song(songs[i], songNumbers[i], fileVersion);
+        },
+        threads);
+
+    return parsed;
+}
+
+class SongSource
+{
+public:
+    struct Entry
+    {
+        UInt64 offset;
+        UInt64 length;
+        UInt32 checksum;
+    };
+
+    /* verifyPerSong checks each song's checksum as it is read. */
+    SongSource(
+        shared_ptr<istream> is,
+        const cmn::FileVersion &fileVersion,
+        streamoff base,
+        bool verifyPerSong)
+        :
+        is_(is),
+        fileVersion_(fileVersion),
+        base_(base),
+        verifyPerSong_(verifyPerSong),
+        cancelled_(false)
+    {}
+
+    ~SongSource()
+    {
+        this->cancelled_ = true;
+        this->Wait();
+    }
+
+    void Add(const string &songNumber, const Entry &entry) { this->entries_[songNumber] = entry; }
+
+    const map<string, Entry>& GetEntries() const { return this->entries_; }
+
+    bool IsLoaded(const string &songNumber)
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        return this->loaded_.count(songNumber) != 0;
+    }
+
+    SongDataPtrT Get(const string &songNumber)
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        return this->load(songNumber);
+    }
+
+    /* Reads every song not read yet, taking their bytes in turn and
+     * parsing them on up to threads threads. */
+    void LoadAll(unsigned threads)
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        vector<string> songNumbers;
+        vector<ex::BinaryReader> songs;
+        vector<UInt32> checksums;
+        // songs point into these, so they are never moved.
+        vector<vector<char>> buffers(this->entries_.size());
+        for (auto &it: this->entries_)
+        {
+            if (this->loaded_.count(it.first)) continue;
+            songNumbers.push_back(it.first);
+            songs.push_back(this->take(it.second, buffers[songs.size()]));
+            if (this->verifyPerSong_) checksums.push_back(it.second.checksum);
+        }
+
+        vector<SongDataPtrT> parsed = parse_songs(
+            songs,
+            songNumbers,
+            checksums,
+            this->fileVersion_,
+            threads);
+        for (size_t i = 0; i < parsed.size(); i++)
+        {
+            this->loaded_[songNumbers[i]] = parsed[i];
+        }
+    }
+
+    /* Checks every song's checksum, reading the songs in file order one at
+     * a time.  crc32c keeps up with memory, so one thread is enough. */
+    void VerifyAll()
+    {
+        lock_guard<mutex> lock(this->mutex_);
+        vector<pair<const string, Entry> *> inOrder;
+        for (auto &it: this->entries_)
+        {
+            inOrder.push_back(&it);
+        }
+
+        sort(
+            inOrder.begin(),
+            inOrder.end(),
+            [](pair<const string, Entry> *lhs, pair<const string, Entry> *rhs)->bool
+            {
+                return lhs->second.offset < rhs->second.offset;
+            });
+
+        vector<char> buffer;
+        for (auto it: inOrder)
+        {
+            check_song(this->take(it->second, buffer), it->second.checksum, it->first);
+        }
+    }
+
+    void Prefetch(const vector<string> &songNumbers)
+    {
+        this->prefetches_.remove_if(
+            [](future<void> &prefetch)->bool
+            {
+                return prefetch.wait_for(chrono::seconds(0)) == future_status::ready;
+            });
+
+        // The thread reads through this rather than a shared_ptr, which the
+        // future would keep alive; ~SongSource waits for it instead.
+        SongSource *source = this;
+        this->prefetches_.push_back(async(
+            launch::async,
+            [source, songNumbers]()
+            {
+                for (auto &songNumber: songNumbers)
+                {
+                    if (source->cancelled_) return;
+                    lock_guard<mutex> lock(source->mutex_);
+                    try
+                    {
+                        source->load(songNumber);
+                    } catch (exception &)
+                    {
+                        // GetSongData tries again and reports the error.
+                    }
+                }
+            }));
+    }
+
+    void Wait()
+    {
+        for (auto &prefetch: this->prefetches_)
+        {
+            prefetch.wait();
+        }
+
+        this->prefetches_.clear();
+    }
+
+private:
+    // The caller holds mutex_.
+    SongDataPtrT load(const string &songNumber)
+    {
+        auto loaded = this->loaded_.find(songNumber);
+        if (loaded != this->loaded_.end()) return loaded->second;
+
+        const Entry &entry = this->entries_.at(songNumber);
+        vector<char> buffer;
+        ex::BinaryReader reader = this->take(entry, buffer);
+        if (this->verifyPerSong_) check_song(reader, entry.checksum, songNumber);
+        SongDataPtrT song = parse_song(reader, songNumber, this->fileVersion_);
+        this->loaded_[songNumber] = song;
+        return song;
+    }
+
+    /* Reads the song in place if the stream is mapped, or else into
+     * buffer.  The caller holds mutex_. */
+    ex::BinaryReader take(const Entry &entry, vector<char> &buffer)
+    {
+        istream &is = *this->is_;
+        is.clear();
+        is.seekg(this->base_ + static_cast<streamoff>(entry.offset));
+
+        // A mapped song is read where it is.
+        cmn::MappedStreamBuf *mapped = dynamic_cast<cmn::MappedStreamBuf *>(is.rdbuf());
+        if (mapped && entry.length <= mapped->GetAvailable())
+        {
+            ex::BinaryReader reader(
+                mapped->GetPosition(),
+                mapped->GetAvailable(),
+                mapped->GetOwner());
+            return take_song(reader, entry.length);
+        }
+
+        return take_song(is, entry.length, buffer);
+    }
+
+    shared_ptr<istream> is_;
+    cmn::FileVersion fileVersion_;
+    streamoff base_;
+    bool verifyPerSong_;
+    map<string, Entry> entries_;
+    map<string, SongDataPtrT> loaded_;
+    mutex mutex_;
+    atomic<bool> cancelled_;
+    list<future<void>> prefetches_;
+};
+
+ShowData::ShowData(istream &is, unsigned threads, ShowDataVerification verify)
+    :
+    threads_(threads)
 {
-    cmn::FileVersion fileVersion;
     is.exceptions(istream::failbit|istream::badbit);
+    this->read_binary(is, nullptr, verify);
+}
+
+ShowData::ShowData(shared_ptr<istream> is, unsigned threads, ShowDataVerification verify)
+    :
+    threads_(threads)
+{
+    is->exceptions(istream::failbit|istream::badbit);
+    this->read_binary(*is, is, verify);
+}
+
+ShowData::ShowData(ex::BinaryReader &reader, unsigned threads, ShowDataVerification verify)
+    :
+    threads_(threads)
+{
+    this->read_binary(reader, nullptr, verify);
+}
+
+shared_ptr<ShowData> ShowData::OpenMapped(
+    const string &path,
+    unsigned threads,
+    ShowDataVerification verify)
+{
+    shared_ptr<ex::MappedFile> mapped(new ex::MappedFile(path));
+    const char *data = reinterpret_cast<const char *>(mapped->data());
+    shared_ptr<istream> is(new cmn::MappedIStream(mapped, data, data + mapped->size()));
+    return shared_ptr<ShowData>(new ShowData(is, threads, verify));
+}
+
+/* Reads the show name and the song table. */
+template<class InputT>
+static void read_song_table(
+    InputT &is,
+    bool checksummed,
+    string &showName,
+    SongNameBySongNumberT &songNames,
+    vector<string> &songNumbers,
+    vector<SongSource::Entry> &entries)
+{
+    showName = ex::ReadString(is);
+    UInt16 song_count;
+    is.read((char *)&song_count, 2);
+    for (; song_count > 0; song_count--)
+    {
+        string songNumber = ex::ReadString(is);
+        songNames[songNumber] = ex::ReadString(is);
+        SongSource::Entry entry;
+        is.read((char *)&entry.offset, sizeof(entry.offset));
+        is.read((char *)&entry.length, sizeof(entry.length));
+        entry.checksum = 0;
+        if (checksummed) is.read((char *)&entry.checksum, sizeof(entry.checksum));
+        songNumbers.push_back(songNumber);
+        entries.push_back(entry);
+    }
+}
+
+template<class OutputT>
+static void write_song_table(
+    OutputT &os,
+    const string &showName,
+    const SongDataBySongNumberT &songData,
+    const vector<ex::BinaryWriter> &songs,
+    const vector<UInt32> &checksums,
+    bool aligned,
+    vector<UInt64> &offsets)
+{
+    ex::WriteString(os, showName);
+    UInt16 song_count = songData.size();
+    os.write((char *)&song_count, sizeof(song_count));
+
+    UInt64 offset = 0;
+    size_t i = 0;
+    for (auto &it: songData)
+    {
+        UInt64 length = songs[i].size();
+        ex::WriteString(os, it.first);
+        ex::WriteString(os, it.second->GetSongName());
+        os.write((char *)&offset, sizeof(offset));
+        os.write((char *)&length, sizeof(length));
+        if (!checksums.empty()) os.write((char *)&checksums[i], sizeof(checksums[i]));
+        offsets.push_back(offset);
+        offset = aligned ? align_song(offset + length) : offset + length;
+        i++;
+    }
+}
+
+template<class InputT>
+void ShowData::read_binary(InputT &is, shared_ptr<istream> source, ShowDataVerification verify)
+{
+    cmn::FileVersion fileVersion;
     if (!cmn::check_file_header(
         is,
         "ROCS",
@@ -20,24 +420,136 @@ ShowData::ShowData(istream &is)
         throw ShowDataVersionError("Unsupported ShowData Version");
     }
 
-    this->show_name_ = ex::ReadString(is);
-    UInt16 song_count;
-    is.read((char *)&song_count, 2);
+    if (fileVersion < songTableVersion)
+    {
+        this->show_name_ = ex::ReadString(is);
+        UInt16 song_count;
+        is.read((char *)&song_count, 2);
+        for (; song_count > 0; song_count--)
+        {
+            SongDataPtrT song(new SongData(is, fileVersion));
+            this->songDataBySongNumber_.insert(song->GetSongNumber(), song);
+            this->songNameBySongNumber_[song->GetSongNumber()] = song->GetSongName();
+        }
 
-    SongDataPtrT song;
+        return;
+    }
 
-    for (; song_count > 0; song_count--)
+    vector<string> songNumbers;
+    vector<SongSource::Entry> entries;
+    bool checksummed = !(fileVersion < checksummedVersion);
+    if (checksummed)
     {
-        song = SongDataPtrT(new SongData(is, fileVersion));
-        this->songDataBySongNumber_.insert(song->GetSongNumber(), song);
-        this->songNameBySongNumber_[song->GetSongNumber()] = song->GetSongName();
-        song.reset();
+        // The table is always checked, since nothing else can be trusted
+        // without it, and its checksum covers the header too.
+        ex::BinaryReader table = cmn::read_section(
+            is,
+            "The song table",
+            cmn::header_checksum("ROCS", "SDAT", fileVersion));
+
+        read_song_table(
+            table,
+            true,
+            this->show_name_,
+            this->songNameBySongNumber_,
+            songNumbers,
+            entries);
+
+        if (table.GetAvailable()) throw ShowDataError("The song table is longer than its songs");
+    } else
+    {
+        read_song_table(
+            is,
+            false,
+            this->show_name_,
+            this->songNameBySongNumber_,
+            songNumbers,
+            entries);
     }
-}
 
+    if (!checksummed) verify = verify_none;
+
+    if (!(fileVersion < alignedSongsVersion))
+    {
+        is.ignore(is.get());
+    }
+
+    if (!source)
+    {
+        // The songs follow the table in its order, perhaps with padding
+        // between them.  Their bytes are taken in that order, then parsed
+        // together.
+        vector<ex::BinaryReader> songs;
+        vector<vector<char>> buffers(songNumbers.size());
+        vector<UInt32> checksums;
+        songs.reserve(songNumbers.size());
+        UInt64 position = 0;
+        for (size_t i = 0; i < songNumbers.size(); i++)
+        {
+            if (entries[i].offset < position)
+            {
+                throw ShowDataError("Song " + songNumbers[i] + " is not where the song table says");
+            }
+
+            is.ignore(static_cast<streamsize>(entries[i].offset - position));
+            position = entries[i].offset + entries[i].length;
+            songs.push_back(take_song(is, entries[i].length, buffers[i]));
+            if (verify != verify_none) checksums.push_back(entries[i].checksum);
+        }
+
+        vector<SongDataPtrT> parsed = parse_songs(
+            songs,
+            songNumbers,
+            checksums,
+            fileVersion,
+            this->threads_);
+        for (size_t i = 0; i < parsed.size(); i++)
+        {
+            this->songDataBySongNumber_.insert(songNumbers[i], parsed[i]);
+        }
+
+        return;
+    }
+
+    streamoff base = is.tellg();
+    if (base < 0)
+    {
+        throw ShowDataError("ShowData can only read songs lazily from a seekable stream");
+    }
+
+    this->source_ = make_shared<SongSource>(source, fileVersion, base, verify == verify_per_song);
+    for (size_t i = 0; i < songNumbers.size(); i++)
+    {
+        this->source_->Add(songNumbers[i], entries[i]);
+    }
+
+    if (verify == verify_on_open) this->source_->VerifyAll();
+}
 
 void ShowData::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
 {
+    this->write_binary(os, fileVersion);
+}
+
+void ShowData::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+/* Makes room for the songs, which are written after the table, so that
+ * a BinaryWriter grows once rather than doubling its way there.  An
+ * ostream is left to itself. */
+static void reserve_songs(ostream &, UInt64) {}
+
+static void reserve_songs(ex::BinaryWriter &writer, UInt64 size)
+{
+    writer.reserve(writer.size() + static_cast<size_t>(size));
+}
+
+template<class OutputT>
+void ShowData::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
+{
+    this->load_all();
     cmn::ROCSFileHeader hdr(
         "ROCS",
         "SDAT",
@@ -45,13 +557,87 @@ void ShowData::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) con
         fileVersion.GetMinorVersion());
 
     os.write((char *)&hdr, sizeof(hdr));
-    ex::WriteString(os, this->show_name_);
-    UInt16 song_count = this->songDataBySongNumber_.size();
-    os.write((char *)&song_count, sizeof(song_count));
-    
-    for (auto it: this->songDataBySongNumber_)
+    if (fileVersion < songTableVersion)
+    {
+        ex::WriteString(os, this->show_name_);
+        UInt16 song_count = this->songDataBySongNumber_.size();
+        os.write((char *)&song_count, sizeof(song_count));
+        for (auto it: this->songDataBySongNumber_)
+        {
+            it.second->WriteBinary(os, fileVersion);
+        }
+
+        return;
+    }
+
+    // The table needs each song's length, so the songs are written out
+    // before the table is, each into its own buffer.
+    vector<const SongData *> songData;
+    for (auto &it: this->songDataBySongNumber_)
     {
-        it.second->WriteBinary(os, fileVersion);
+        songData.push_back(it.second.get());
+    }
+
+    bool checksummed = !(fileVersion < checksummedVersion);
+    vector<ex::BinaryWriter> songs(songData.size());
+    vector<UInt32> checksums(checksummed ? songData.size() : 0);
+    ex::parallel_for(
+        songData.size(),
+        [&](size_t i)
+        {
+            songData[i]->WriteBinary(songs[i], fileVersion);
+            if (checksummed) checksums[i] = ex::crc32c(songs[i].GetData(), songs[i].size());
+        },
+        this->threads_);
+
+    bool aligned = !(fileVersion < alignedSongsVersion);
+    vector<UInt64> offsets;
+    if (checksummed)
+    {
+        ex::BinaryWriter table;
+        write_song_table(
+            table,
+            this->show_name_,
+            this->songDataBySongNumber_,
+            songs,
+            checksums,
+            aligned,
+            offsets);
+
+        cmn::write_section(os, table, cmn::header_checksum("ROCS", "SDAT", fileVersion));
+    } else
+    {
+        write_song_table(
+            os,
+            this->show_name_,
+            this->songDataBySongNumber_,
+            songs,
+            checksums,
+            aligned,
+            offsets);
+    }
+
+    if (!songs.empty()) reserve_songs(os, songAlignment + offsets.back() + songs.back().size());
+
+    const char zeros[songAlignment] = {};
+    if (aligned)
+    {
+        // One byte for the count, then enough zeros to align the first song.
+        // A stream that cannot tell its position gets no padding.
+        streamoff position = os.tellp();
+        UInt64 padding = position < 0
+            ? 0
+            : align_song(static_cast<UInt64>(position) + 1) - (position + 1);
+        os.put(static_cast<char>(padding));
+        os.write(zeros, padding);
+    }
+
+    UInt64 position = 0;
+    for (size_t i = 0; i < songs.size(); i++)
+    {
+        os.write(zeros, offsets[i] - position);
+        os.write(songs[i].GetData(), songs[i].size());
+        position = offsets[i] + songs[i].size();
     }
 }
 
@@ -65,9 +651,55 @@ void ShowData::WriteString(ostream& o) const
 
 const SongData& ShowData::GetSongData(const string& song_num) const
 {
+    if (this->source_ && !this->songDataBySongNumber_.count(song_num))
+    {
+        return *this->source_->Get(song_num);
+    }
+
     return this->songDataBySongNumber_.at(song_num);
 }
 
+bool ShowData::IsSongLoaded(const string &song_num) const
+{
+    if (this->songDataBySongNumber_.count(song_num)) return true;
+    return this->source_ && this->source_->IsLoaded(song_num);
+}
+
+void ShowData::Prefetch(const string &song_num, size_t count) const
+{
+    if (!this->source_) return;
+
+    vector<string> songNumbers;
+    auto it = this->songNameBySongNumber_.upper_bound(song_num);
+    for (; it != this->songNameBySongNumber_.end() && songNumbers.size() < count; it++)
+    {
+        if (!this->IsSongLoaded(it->first)) songNumbers.push_back(it->first);
+    }
+
+    if (!songNumbers.empty()) this->source_->Prefetch(songNumbers);
+}
+
+void ShowData::WaitForPrefetch() const
+{
+    if (this->source_) this->source_->Wait();
+}
+
+void ShowData::load_all() const
+{
+    if (!this->source_) return;
+
+    this->source_->LoadAll(this->threads_);
+    for (auto &it: this->source_->GetEntries())
+    {
+        if (!this->songDataBySongNumber_.count(it.first))
+        {
+            this->songDataBySongNumber_.insert(it.first, this->source_->Get(it.first));
+        }
+    }
+
+    this->source_.reset();
+}
+
 void ShowData::AddSongData(SongDataPtrT song_data_ptr)
 {
     /*  If GetSongName() already exists in the map, remove it first so that the insert
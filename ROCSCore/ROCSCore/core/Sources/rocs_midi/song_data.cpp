@@ -40,6 +40,17 @@ SongData& SongData::operator=(const SongData& other)
 }
 
 SongData::SongData(istream& is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+SongData::SongData(ex::BinaryReader& reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void SongData::read_binary(InputT& is, const cmn::FileVersion &fileVersion)
 {
     this->song_number_ = ex::ReadString(is);
     this->song_name_ = ex::ReadString(is);
@@ -79,6 +90,17 @@ SongData::SongData(const std_midi::MIDIFile& midiFile)
 
 
 void SongData::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void SongData::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void SongData::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
 {
     ex::WriteString(os, this->GetSongNumber());
     ex::WriteString(os, this->GetSongName());
@@ -0,0 +1,175 @@
+#include "core/rocs_midi/transpose_voice_events.h"
+
+#include <algorithm>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ROCS_TRANSPOSE_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ROCS_TRANSPOSE_SSE2 1
+#endif
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+/* The vector code reads each event as two 32 bit lanes, the time and then
+ * status, data1, data2 and padding from the low byte up. */
+static_assert(sizeof(VoiceEvent) == 8, "VoiceEvent must be 8 bytes for transpose_voice_events");
+
+void transpose_voice_events_scalar(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        VoiceEvent voiceEvent(in[i]);
+        transpose_voice_event(voiceEvent, transpose, range);
+        out[i] = voiceEvent;
+    }
+}
+
+#if defined(ROCS_TRANSPOSE_AVX2)
+
+static size_t transpose_vector(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range)
+{
+    const __m256i messages = _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i data1Mask = _mm256_set1_epi32(0xFF00);
+    const __m256i statusTypeMask = _mm256_set1_epi32(0xF0);
+    const __m256i noteOff = _mm256_set1_epi32(std_midi::sb::note_off);
+    const __m256i noteOn = _mm256_set1_epi32(std_midi::sb::note_on);
+    const __m256i aftertouch = _mm256_set1_epi32(std_midi::sb::aftertouch);
+    const __m256i low = _mm256_set1_epi32(range.first);
+    const __m256i high = _mm256_set1_epi32(range.second);
+    const __m256i shift = _mm256_set1_epi32(transpose);
+    const __m256i octave = _mm256_set1_epi32(12);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+
+        __m256i statusType = _mm256_and_si256(v, statusTypeMask);
+        __m256i isNote = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi32(statusType, noteOff),
+                _mm256_cmpeq_epi32(statusType, noteOn)),
+            _mm256_cmpeq_epi32(statusType, aftertouch));
+
+        __m256i data1 = _mm256_and_si256(_mm256_srli_epi32(v, 8), byteMask);
+        __m256i outside = _mm256_or_si256(
+            _mm256_cmpgt_epi32(low, data1),
+            _mm256_cmpgt_epi32(data1, high));
+        __m256i mask = _mm256_andnot_si256(outside, _mm256_and_si256(isNote, messages));
+
+        __m256i note = _mm256_and_si256(_mm256_add_epi32(data1, shift), byteMask);
+        __m256i below = _mm256_cmpgt_epi32(low, note);
+        __m256i above = _mm256_andnot_si256(below, _mm256_cmpgt_epi32(note, high));
+        note = _mm256_add_epi32(note, _mm256_and_si256(below, octave));
+        note = _mm256_sub_epi32(note, _mm256_and_si256(above, octave));
+        note = _mm256_and_si256(note, byteMask);
+
+        __m256i moved = _mm256_or_si256(
+            _mm256_andnot_si256(data1Mask, v),
+            _mm256_slli_epi32(note, 8));
+        v = _mm256_or_si256(_mm256_and_si256(mask, moved), _mm256_andnot_si256(mask, v));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    }
+
+    return i;
+}
+
+#elif defined(ROCS_TRANSPOSE_SSE2)
+
+static size_t transpose_vector(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range)
+{
+    const __m128i messages = _mm_set_epi32(-1, 0, -1, 0);
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128i data1Mask = _mm_set1_epi32(0xFF00);
+    const __m128i statusTypeMask = _mm_set1_epi32(0xF0);
+    const __m128i noteOff = _mm_set1_epi32(std_midi::sb::note_off);
+    const __m128i noteOn = _mm_set1_epi32(std_midi::sb::note_on);
+    const __m128i aftertouch = _mm_set1_epi32(std_midi::sb::aftertouch);
+    const __m128i low = _mm_set1_epi32(range.first);
+    const __m128i high = _mm_set1_epi32(range.second);
+    const __m128i shift = _mm_set1_epi32(transpose);
+    const __m128i octave = _mm_set1_epi32(12);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+
+        __m128i statusType = _mm_and_si128(v, statusTypeMask);
+        __m128i isNote = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpeq_epi32(statusType, noteOff),
+                _mm_cmpeq_epi32(statusType, noteOn)),
+            _mm_cmpeq_epi32(statusType, aftertouch));
+
+        __m128i data1 = _mm_and_si128(_mm_srli_epi32(v, 8), byteMask);
+        __m128i outside = _mm_or_si128(
+            _mm_cmpgt_epi32(low, data1),
+            _mm_cmpgt_epi32(data1, high));
+        __m128i mask = _mm_andnot_si128(outside, _mm_and_si128(isNote, messages));
+
+        __m128i note = _mm_and_si128(_mm_add_epi32(data1, shift), byteMask);
+        __m128i below = _mm_cmpgt_epi32(low, note);
+        __m128i above = _mm_andnot_si128(below, _mm_cmpgt_epi32(note, high));
+        note = _mm_add_epi32(note, _mm_and_si128(below, octave));
+        note = _mm_sub_epi32(note, _mm_and_si128(above, octave));
+        note = _mm_and_si128(note, byteMask);
+
+        __m128i moved = _mm_or_si128(
+            _mm_andnot_si128(data1Mask, v),
+            _mm_slli_epi32(note, 8));
+        v = _mm_or_si128(_mm_and_si128(mask, moved), _mm_andnot_si128(mask, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+    }
+
+    return i;
+}
+
+#else
+
+static size_t transpose_vector(const VoiceEvent*, VoiceEvent*, size_t, SInt8, const VoiceRangeT&)
+{
+    return 0;
+}
+
+#endif
+
+void transpose_voice_events(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range)
+{
+    if (!transpose)
+    {
+        if (in != out) copy(in, in + count, out);
+        return;
+    }
+
+    size_t done = transpose_vector(in, out, count, transpose, range);
+    transpose_voice_events_scalar(in + done, out + done, count - done, transpose, range);
+}
+
+} // end namespace rocs_midi
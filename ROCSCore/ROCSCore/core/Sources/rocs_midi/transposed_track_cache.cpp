@@ -0,0 +1,119 @@
+#include "core/rocs_midi/transposed_track_cache.h"
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+TransposedTrackCache::TransposedTrackCache(size_t budget)
+    :
+    budget_(budget),
+    bytes_(0)
+{}
+
+VoiceEventSpan TransposedTrackCache::Get(const VoiceTrack &track, SInt8 transpose)
+{
+    return this->get(track, track.Slice(-1, -1, transpose));
+}
+
+VoiceEventSlice TransposedTrackCache::Slice(
+    const VoiceTrack &track,
+    SInt64 start,
+    SInt64 end,
+    SInt8 transpose)
+{
+    VoiceEventSlice slice = track.Slice(start, end, transpose);
+    if (!slice.GetTranspose()) return slice;
+
+    // Transposing does not move events, so the slice has the same indices in
+    // the rendering as in the track.
+    VoiceEventSpan events = this->get(track, track.Slice(-1, -1, transpose));
+    const VoiceEvent *first = events.data() + (slice.raw_begin() - track.GetEventData());
+    return VoiceEventSlice(first, first + slice.size(), 0, track.GetRange());
+}
+
+void TransposedTrackCache::Prepare(const VoiceData &voiceData, SInt8 transpose)
+{
+    for (auto it = voiceData.GetTracksBegin(); it != voiceData.GetTracksEnd(); ++it)
+    {
+        this->Get(*it, transpose);
+    }
+}
+
+bool TransposedTrackCache::Contains(const VoiceTrack &track, SInt8 transpose) const
+{
+    auto it = this->index_.find(make_pair(&track, transpose));
+    return it != this->index_.end() && it->second->revision == track.GetRevision();
+}
+
+void TransposedTrackCache::Invalidate(const VoiceTrack &track)
+{
+    auto it = this->index_.lower_bound(make_pair(&track, static_cast<SInt8>(-128)));
+    while (it != this->index_.end() && it->first.first == &track)
+    {
+        this->erase(it++);
+    }
+}
+
+void TransposedTrackCache::Clear()
+{
+    this->entries_.clear();
+    this->index_.clear();
+    this->bytes_ = 0;
+}
+
+void TransposedTrackCache::SetBudget(size_t budget)
+{
+    this->budget_ = budget;
+    this->evict();
+}
+
+VoiceEventSpan TransposedTrackCache::get(const VoiceTrack &track, const VoiceEventSlice &all)
+{
+    if (!all.GetTranspose()) return track.GetEvents();
+
+    KeyT key(&track, all.GetTranspose());
+    auto it = this->index_.find(key);
+    if (it != this->index_.end())
+    {
+        EntryListT::iterator entry = it->second;
+        this->entries_.splice(this->entries_.begin(), this->entries_, entry);
+        if (entry->revision == track.GetRevision()) return entry->events;
+
+        this->bytes_ -= bytes(*entry);
+        all.CopyTo(entry->events);
+        entry->revision = track.GetRevision();
+        this->bytes_ += bytes(*entry);
+    } else
+    {
+        Entry added;
+        added.track = &track;
+        added.transpose = all.GetTranspose();
+        added.revision = track.GetRevision();
+        this->entries_.push_front(added);
+        all.CopyTo(this->entries_.front().events);
+        this->bytes_ += bytes(this->entries_.front());
+        this->index_[key] = this->entries_.begin();
+    }
+
+    this->evict();
+    return this->entries_.front().events;
+}
+
+void TransposedTrackCache::erase(EntryIndexT::iterator it)
+{
+    this->bytes_ -= bytes(*it->second);
+    this->entries_.erase(it->second);
+    this->index_.erase(it);
+}
+
+void TransposedTrackCache::evict()
+{
+    while (this->bytes_ > this->budget_ && this->entries_.size() > 1)
+    {
+        const Entry &oldest = this->entries_.back();
+        this->erase(this->index_.find(make_pair(oldest.track, oldest.transpose)));
+    }
+}
+
+} // end namespace rocs_midi
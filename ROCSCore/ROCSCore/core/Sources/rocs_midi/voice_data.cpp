@@ -1,5 +1,6 @@
 #include <iostream>
 #include <iterator>
+#include <atomic>
 
 #include "core/rocs_midi/voice_data.h"
 
@@ -9,6 +10,8 @@ namespace rocs_midi
 {
 
 VoiceData::VoiceData(const std_midi::MIDIFile &midiFile)
+    :
+    tracksRevision_(next_revision())
 {
     // Read all tracks except the conductor track and the pdf track
     list<std_midi::MIDITrackPtrT> tracks(
@@ -17,7 +20,7 @@ VoiceData::VoiceData(const std_midi::MIDIFile &midiFile)
 
     // The tracks should be sorted already, but for good measure...
     tracks.sort(
-        [] (std_midi::MIDITrackPtrT first, std_midi::MIDITrackPtrT second)
+        [] (const std_midi::MIDITrackPtrT &first, const std_midi::MIDITrackPtrT &second)
         {
             return first->GetTrackId() < second->GetTrackId();
         });
@@ -28,7 +31,7 @@ VoiceData::VoiceData(const std_midi::MIDIFile &midiFile)
     auto it_end = remove_if(
         tracks.begin(),
         tracks.end(),
-        [](std_midi::MIDITrackPtrT t)
+        [](const std_midi::MIDITrackPtrT &t)
         {
             return ((t->GetTrackName() == "PDF") || (t->GetTrackName() == "pdf"));
         });
@@ -41,13 +44,27 @@ VoiceData::VoiceData(const std_midi::MIDIFile &midiFile)
         voiceTrackPtr = VoiceTrackPtrT(new VoiceTrack(**it));
         voiceTrackPtr->SetTrackId(trackId);
         this->groups_.AddTrack(voiceTrackPtr);
-        this->voiceTracksByTrackId_.insert(trackId, voiceTrackPtr);
-        voiceTrackPtr.reset();
+        this->voiceTracksByTrackId_.insert(trackId, std::move(voiceTrackPtr));
         trackId++;
     }
 }
 
 VoiceData::VoiceData(istream &is, const cmn::FileVersion &fileVersion)
+    :
+    tracksRevision_(next_revision())
+{
+    this->read_binary(is, fileVersion);
+}
+
+VoiceData::VoiceData(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    :
+    tracksRevision_(next_revision())
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void VoiceData::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     char vdat[4];
     is.read(&vdat[0], 4);
@@ -60,16 +77,29 @@ VoiceData::VoiceData(istream &is, const cmn::FileVersion &fileVersion)
     this->groups_ = Groups(is, fileVersion);
     UInt16 trackCount;
     is.read((char *)&trackCount, sizeof(trackCount));
+    this->voiceTracksByTrackId_.reserve(trackCount);
     VoiceTrackPtrT voiceTrackPtr;
     while (trackCount > 0) {
-        voiceTrackPtr = VoiceTrackPtrT(new VoiceTrack(is, fileVersion));
-        this->voiceTracksByTrackId_.insert(voiceTrackPtr->GetTrackId(), voiceTrackPtr);
-        voiceTrackPtr.reset();
+        // One allocation for the track and its count rather than two.
+        voiceTrackPtr = make_shared<VoiceTrack>(is, fileVersion);
+        UInt16 trackId = voiceTrackPtr->GetTrackId();
+        this->voiceTracksByTrackId_.insert(trackId, std::move(voiceTrackPtr));
         trackCount--;
     }
 }
 
 void VoiceData::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void VoiceData::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void VoiceData::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
 {
     string vdat("VDat");
     os.write(vdat.c_str(), 4);
@@ -77,7 +107,7 @@ void VoiceData::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) co
     UInt16 trackCount = this->GetTrackCount();
     os.write((char *)&trackCount, sizeof(trackCount));
     
-    for (auto it: this->voiceTracksByTrackId_)
+    for (auto &it: this->voiceTracksByTrackId_)
     {
         it.second->WriteBinary(os, fileVersion);
     }
@@ -96,7 +126,7 @@ void VoiceData::WriteStringTracks(ostream &os, int indent) const
     this->WriteString(os);
     os << endl;
     string indentString(indent + 1, '\t');
-    for (auto it: this->voiceTracksByTrackId_)
+    for (auto &it: this->voiceTracksByTrackId_)
     {
         os << indentString;
         it.second->WriteString(os);
@@ -109,29 +139,20 @@ void VoiceData::WriteStringTracksEvents(ostream &os, int indent) const
     os << string(indent, '\t');
     this->WriteString(os);
     os << endl;
-    for (auto it: this->voiceTracksByTrackId_)
+    for (auto &it: this->voiceTracksByTrackId_)
     {
         it.second->WriteStringEvents(os, indent + 1);
     }
 }
 
-#ifndef NDEBUG
-    #define CHECK_TRACK_ID(trackId) \
-        if (!this->voiceTracksByTrackId_.count(trackId)) \
-            throw out_of_range(ex::format("%u not found!", trackId))
-#else
-    #define CHECK_TRACK_ID(trackId)
-#endif
-
+// VoiceTrackTable::at throws out_of_range if there is no such track.
 VoiceTrack& VoiceData::GetTrack(UInt16 trackID)
 {
-    CHECK_TRACK_ID(trackID);
     return this->voiceTracksByTrackId_.at(trackID);
 }
 
 const VoiceTrack& VoiceData::GetTrack(UInt16 trackID) const
 {
-    CHECK_TRACK_ID(trackID);
     return this->voiceTracksByTrackId_.at(trackID);
 }
 
@@ -139,6 +160,7 @@ void VoiceData::AddTrack(VoiceTrackPtrT voiceTrackPtr)
 {
     this->voiceTracksByTrackId_.erase(voiceTrackPtr->GetTrackId());
     this->voiceTracksByTrackId_.insert(voiceTrackPtr->GetTrackId(), voiceTrackPtr);
+    this->tracksRevision_ = next_revision();
 }
 
 VoiceTrackPtrVecT VoiceData::GetGroup(UInt8 group_id)
@@ -146,11 +168,8 @@ VoiceTrackPtrVecT VoiceData::GetGroup(UInt8 group_id)
     VoiceTrackPtrVecT group_v;
     for (auto it: groups_.GetGroup(group_id))
     {
-        /** Use find rather than operator[] so that the shared_ptr to the track can
-            be retrieved. operator[] on a ptr_map returns the reference. **/
-        CHECK_TRACK_ID(it);
-        auto found = this->voiceTracksByTrackId_.find(it);
-        group_v.push_back(found->second);
+        // pat returns the shared_ptr to the track rather than the reference.
+        group_v.push_back(this->voiceTracksByTrackId_.pat(it));
     }
     return group_v;
 }
@@ -160,7 +179,79 @@ const VoiceTrackPtrVecT VoiceData::GetGroup(UInt8 groupId) const
     return const_cast<VoiceData *>(this)->GetGroup(groupId);
 }
 
-#undef CHECK_TRACK_ID
+GroupView VoiceData::GetGroupView(UInt8 groupId) const
+{
+    this->update_group_views();
+    const GroupViewCache &cache = this->groupViews_;
+    if (static_cast<size_t>(groupId) + 1 >= cache.offsets.size()) return GroupView();
+    const VoiceTrack* const* tracks = cache.tracks.data();
+    return GroupView(tracks + cache.offsets[groupId], tracks + cache.offsets[groupId + 1]);
+}
+
+UInt64 VoiceData::next_revision()
+{
+    static atomic<UInt64> revision(0);
+    return ++revision;
+}
+
+void VoiceData::update_group_views() const
+{
+    GroupViewCache &cache = this->groupViews_;
+    if (cache.tracksRevision == this->tracksRevision_
+        && cache.groupsRevision == this->groups_.GetRevision())
+    {
+        return;
+    }
+
+    cache.tracks.clear();
+    cache.offsets.clear();
+    for (auto &it: this->groups_)
+    {
+        // Groups missing from the map are left empty.
+        cache.offsets.resize(
+            static_cast<size_t>(it.first) + 1,
+            static_cast<UInt32>(cache.tracks.size()));
+        for (auto trackId: it.second)
+        {
+            auto found = this->voiceTracksByTrackId_.find(trackId);
+            if (found != this->voiceTracksByTrackId_.end())
+            {
+                cache.tracks.push_back(found->second.get());
+            }
+        }
+    }
+
+    cache.offsets.push_back(static_cast<UInt32>(cache.tracks.size()));
+    cache.tracksRevision = this->tracksRevision_;
+    cache.groupsRevision = this->groups_.GetRevision();
+}
+
+void VoiceData::BuildTimeIndexes(UInt32 bucketTicks)
+{
+    for (auto &it: this->voiceTracksByTrackId_)
+    {
+        it.second->BuildTimeIndex(bucketTicks);
+    }
+}
+
+void VoiceData::SetEncodings(VoiceEventEncoding encoding)
+{
+    for (auto &it: this->voiceTracksByTrackId_)
+    {
+        it.second->SetEncoding(encoding);
+    }
+}
+
+size_t VoiceData::GetTimeIndexBytes() const
+{
+    size_t bytes = 0;
+    for (auto &it: this->voiceTracksByTrackId_)
+    {
+        bytes += it.second->GetTimeIndexBytes();
+    }
+
+    return bytes;
+}
 
 ROCS_CORE_API bool operator==(const VoiceData& lhs, const VoiceData& rhs)
 {
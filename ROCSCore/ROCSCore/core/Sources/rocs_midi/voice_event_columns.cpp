@@ -0,0 +1,163 @@
+#include "core/rocs_midi/voice_event_columns.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ROCS_COLUMNS_SSE2 1
+#endif
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+VoiceEventColumns::VoiceEventColumns(const VoiceTrack &track)
+{
+    this->Assign(track);
+}
+
+VoiceEventColumns::VoiceEventColumns(const VoiceEvtVecT &events)
+{
+    this->Assign(events);
+}
+
+void VoiceEventColumns::Assign(const VoiceTrack &track)
+{
+    this->assign(track.GetEventData(), track.GetEventCount());
+    this->revision_ = track.GetRevision();
+}
+
+void VoiceEventColumns::Assign(const VoiceEvtVecT &events)
+{
+    this->assign(events.data(), events.size());
+    this->revision_ = 0;
+}
+
+void VoiceEventColumns::assign(const VoiceEvent *events, size_t count)
+{
+    this->times_.resize(count);
+    this->statuses_.resize(count);
+    this->data_.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const VoiceEvent &voiceEvent = events[i];
+        this->times_[i] = voiceEvent.GetAbsTime();
+        this->statuses_[i] = voiceEvent.GetStatus();
+        this->data_[i] = static_cast<UInt16>(voiceEvent.GetData1() | (voiceEvent.GetData2() << 8));
+    }
+}
+
+/* Branchless binary searches.  Each step halves n and moves base without a
+ * branch the processor has to guess, and both places the next step may look
+ * are fetched while this one compares. */
+
+static inline void prefetch(const UInt32 *p)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#elif defined(ROCS_COLUMNS_SSE2)
+    _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0);
+#endif
+}
+
+size_t VoiceEventColumns::LowerBound(UInt32 tick) const
+{
+    size_t n = this->times_.size();
+    if (!n) return 0;
+
+    const UInt32 *first = this->times_.data();
+    const UInt32 *base = first;
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        prefetch(base + half / 2);
+        prefetch(base + half + half / 2);
+        base = (base[half] < tick) ? base + half : base;
+        n -= half;
+    }
+
+    return (base - first) + (*base < tick);
+}
+
+size_t VoiceEventColumns::UpperBound(UInt32 tick) const
+{
+    size_t n = this->times_.size();
+    if (!n) return 0;
+
+    const UInt32 *first = this->times_.data();
+    const UInt32 *base = first;
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        prefetch(base + half / 2);
+        prefetch(base + half + half / 2);
+        base = (base[half] <= tick) ? base + half : base;
+        n -= half;
+    }
+
+    return (base - first) + (*base <= tick);
+}
+
+size_t VoiceEventColumns::CountStatusType(Byte statusType, size_t first, size_t last) const
+{
+    const Byte *statuses = this->statuses_.data();
+    size_t count = 0;
+
+#if defined(ROCS_COLUMNS_SSE2)
+    // 16 statuses per step.  Each byte lane counts at most 255 matches before
+    // the lanes are summed.
+    const __m128i typeMask = _mm_set1_epi8(static_cast<char>(0xF0));
+    const __m128i type = _mm_set1_epi8(static_cast<char>(statusType));
+    const __m128i zero = _mm_setzero_si128();
+    while (last - first >= 16)
+    {
+        size_t steps = min<size_t>((last - first) / 16, 255);
+        __m128i lanes = zero;
+        for (size_t i = 0; i < steps; i++, first += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(statuses + first));
+            lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(_mm_and_si128(v, typeMask), type));
+        }
+
+        __m128i sums = _mm_sad_epu8(lanes, zero);
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#endif
+
+    for (size_t i = first; i < last; i++)
+    {
+        count += (statuses[i] & 0xF0) == statusType;
+    }
+
+    return count;
+}
+
+void VoiceEventColumns::FilterChannel(UInt8 channel, vector<UInt32> &out) const
+{
+    // Every index is written and only the matching ones are kept, so the
+    // loop does not branch on the channel.
+    out.resize(this->statuses_.size());
+    const Byte *statuses = this->statuses_.data();
+    UInt32 *indices = out.data();
+    size_t count = 0;
+    for (size_t i = 0; i < this->statuses_.size(); i++)
+    {
+        indices[count] = static_cast<UInt32>(i);
+        count += (statuses[i] & 0x0F) == channel;
+    }
+
+    out.resize(count);
+}
+
+void VoiceEventColumns::CopyTo(VoiceEvtVecT &out, size_t first, size_t last) const
+{
+    out.clear();
+    out.reserve(last - first);
+    for (size_t i = first; i < last; i++)
+    {
+        out.push_back((*this)[i]);
+    }
+}
+
+} // end namespace rocs_midi
@@ -0,0 +1,26 @@
+#include "core/rocs_midi/voice_event_slice.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+void VoiceEventSlice::CopyTo(VoiceEvtVecT &out) const
+{
+    out.resize(this->size());
+    if (!out.empty())
+    {
+        transpose_voice_events(this->first_, &out[0], out.size(), this->transpose_, this->range_);
+    }
+}
+
+size_t VoiceEventSlice::CopyTo(VoiceEvent *out, size_t capacity) const
+{
+    size_t count = min(capacity, this->size());
+    transpose_voice_events(this->first_, out, count, this->transpose_, this->range_);
+    return count;
+}
+
+} // end namespace rocs_midi
@@ -1,5 +1,10 @@
 #include "core/rocs_midi/voice_track.h"
 
+#include <atomic>
+#include <cstdint>
+#include "core/common/mapped_streambuf.h"
+#include "core/rocs_midi/compact_voice_events.h"
+
 using namespace std;
 
 namespace rocs_midi
@@ -35,40 +40,90 @@ ROCS_CORE_API AllowedCCT create_allowed_ccs()
 
 ROCS_CORE_API AllowedCCT allowed_ccs(create_allowed_ccs());
 
-struct TransposeVoiceEvent
+// Events are read from a file in place, so their layout is the file's.
+compile_time_assert(sizeof(VoiceEvent) == 8, sizeof_VoiceEvent_must_be_8);
+
+// From this version the events are padded to start on a multiple of 8
+// bytes, so that a mapped file can be read in place.
+static const cmn::FileVersion alignedEventsVersion(2, 4);
+
+static const size_t eventAlignment = 8;
+
+// From this version each track says how its events are encoded.
+static const cmn::FileVersion eventEncodingVersion(2, 5);
+
+/* Where the next bytes of is are, if a track can point at its events there
+ * instead of copying them, moving past them and setting owner; otherwise
+ * nullptr. */
+static const VoiceEvent* map_events(istream &is, size_t bytes, shared_ptr<const void> &owner)
 {
-    TransposeVoiceEvent(SInt8 transpose, VoiceRangeT range)
-        :
-        transpose_(transpose),
-        range_(range)
+    cmn::MappedStreamBuf *mapped = dynamic_cast<cmn::MappedStreamBuf *>(is.rdbuf());
+    if (!mapped
+        || reinterpret_cast<size_t>(mapped->GetPosition()) % __alignof(VoiceEvent) != 0
+        || !mapped->Skip(bytes))
     {
-        if (abs(transpose_) > 6) {
-            throw std::range_error("transpose may be no more than + or - 6");
-        }
+        return nullptr;
     }
 
-    void operator()(VoiceEvent& voiceEvent)
+    owner = mapped->GetOwner();
+    return reinterpret_cast<const VoiceEvent *>(mapped->GetPosition() - bytes);
+}
+
+static const VoiceEvent* map_events(
+    ex::BinaryReader &reader,
+    size_t bytes,
+    shared_ptr<const void> &owner)
+{
+    if (!reader.GetOwner()
+        || reinterpret_cast<size_t>(reader.GetPosition()) % __alignof(VoiceEvent) != 0)
     {
-        if ((this->range_.first <= voiceEvent.GetData1())
-            && (voiceEvent.GetData1() <= this->range_.second))
-        {
-            voiceEvent.GetVoiceMessage().data1_ += this->transpose_;
-            if (voiceEvent.GetData1() < this->range_.first)
-            {
-                voiceEvent.GetVoiceMessage().data1_ += 12;
-            } else if (voiceEvent.GetData1() > range_.second)
-            {
-                voiceEvent.GetVoiceMessage().data1_ -= 12;
-            }
-        }
+        return nullptr;
     }
 
-private:
-    SInt8 transpose_;
-    VoiceRangeT range_;
-};
+    owner = reader.GetOwner();
+    return reinterpret_cast<const VoiceEvent *>(reader.Skip(bytes));
+}
+
+/* The next bytes of is.  A BinaryReader's are where they are; an istream's
+ * are read into buffer. */
+static const char* take_bytes(istream &is, size_t bytes, vector<char> &buffer)
+{
+    buffer.resize(bytes);
+    is.read(buffer.data(), bytes);
+    return buffer.data();
+}
 
-VoiceTrack::VoiceTrack(std::istream &is, const cmn::FileVersion &)
+static const char* take_bytes(ex::BinaryReader &reader, size_t bytes, vector<char> &)
+{
+    return reader.Skip(bytes);
+}
+
+VoiceTrack::VoiceTrack(std::istream &is, const cmn::FileVersion &fileVersion)
+    :
+    mapped_events_(nullptr),
+    mapped_count_(0),
+    revision_(next_revision()),
+    index_ticks_(0),
+    index_revision_(0),
+    encoding_(raw_events)
+{
+    this->read_binary(is, fileVersion);
+}
+
+VoiceTrack::VoiceTrack(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    :
+    mapped_events_(nullptr),
+    mapped_count_(0),
+    revision_(next_revision()),
+    index_ticks_(0),
+    index_revision_(0),
+    encoding_(raw_events)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void VoiceTrack::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     char vtrk[4];
     is.read(&vtrk[0], 4);
@@ -85,20 +140,127 @@ VoiceTrack::VoiceTrack(std::istream &is, const cmn::FileVersion &)
     
     UInt32 trackSize;
     is.read((char *)&trackSize, sizeof(trackSize));
-    if (!trackSize)
+    if (!(fileVersion < eventEncodingVersion))
+    {
+        this->encoding_ = static_cast<VoiceEventEncoding>(is.get());
+    }
+
+    if (this->encoding_ != raw_events && this->encoding_ != compact_events)
+    {
+        throw VoiceTrackException(ex::format(
+            "Unknown event encoding %u for track %u",
+            static_cast<unsigned>(this->encoding_),
+            this->track_id_));
+    }
+
+    if (this->encoding_ == compact_events)
+    {
+        // Every event takes at least 2 bytes, which bounds trackSize before
+        // anything is allocated for it.
+        UInt32 encodedSize;
+        is.read((char *)&encodedSize, sizeof(encodedSize));
+        if (ex::failed(is) || encodedSize > ex::remaining(is))
+        {
+            throw VoiceTrackException(ex::format(
+                "Invalid compact events for track %u",
+                this->track_id_));
+        }
+
+        vector<char> buffer;
+        const char *encoded = take_bytes(is, encodedSize, buffer);
+        if (ex::failed(is) || trackSize > encodedSize / 2)
+        {
+            throw VoiceTrackException(ex::format(
+                "Invalid compact events for track %u",
+                this->track_id_));
+        }
+
+        this->events_.resize(trackSize);
+        if (!decode_voice_events(encoded, encodedSize, this->events_.data(), trackSize))
+        {
+            throw VoiceTrackException(ex::format(
+                "Invalid compact events for track %u",
+                this->track_id_));
+        }
+    } else
+    {
+        if (!(fileVersion < alignedEventsVersion))
+        {
+            is.ignore(is.get());
+        }
+
+        size_t bytes = sizeof(VoiceEvent) * trackSize;
+        if (ex::failed(is) || bytes > ex::remaining(is))
+        {
+            throw VoiceTrackException(ex::format(
+                "Invalid event count %u for track %u",
+                trackSize,
+                this->track_id_));
+        }
+
+        const VoiceEvent *mapped = trackSize ? map_events(is, bytes, this->mapped_owner_) : nullptr;
+        if (mapped)
+        {
+            this->mapped_events_ = mapped;
+            this->mapped_count_ = trackSize;
+        } else if (trackSize)
+        {
+            this->events_.resize(trackSize);
+            is.read((char *)&events_[0], bytes);
+        }
+    }
+
+    if (fileVersion < cmn::FileVersion(2, 2))
     {
         return;
     }
 
-    this->events_.resize(trackSize);
-    is.read((char *)&events_[0], sizeof(VoiceEvent) * trackSize);
+    is.read((char *)&this->index_ticks_, sizeof(this->index_ticks_));
+    if (!this->index_ticks_)
+    {
+        return;
+    }
 
+    UInt32 indexSize;
+    is.read((char *)&indexSize, sizeof(indexSize));
+    const VoiceEvent *events = this->GetEventData();
+    size_t count = this->GetEventCount();
+    size_t buckets = !count ? 0 : events[count - 1].GetAbsTime() / this->index_ticks_ + 1;
+
+    // A tiny index_ticks_ makes buckets huge, so the size is checked against
+    // the bytes left too.
+    if (ex::failed(is)
+        || indexSize != buckets + 1
+        || sizeof(UInt32) * static_cast<size_t>(indexSize) > ex::remaining(is))
+    {
+        throw VoiceTrackException(ex::format(
+            "Invalid time index for track %u",
+            this->track_id_));
+    }
+
+    this->index_.resize(indexSize);
+    is.read((char *)&this->index_[0], sizeof(UInt32) * indexSize);
+    if (this->index_.back() != count
+        || !is_sorted(this->index_.begin(), this->index_.end()))
+    {
+        throw VoiceTrackException(ex::format(
+            "Invalid time index for track %u",
+            this->track_id_));
+    }
+
+    this->index_revision_ = this->revision_;
 }
 
 VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
     :
     range_(make_pair(255, 255)),
-    has_channel_number_(false)
+    mapped_events_(nullptr),
+    mapped_count_(0),
+    has_channel_number_(false),
+    revision_(next_revision()),
+    index_ticks_(0),
+    index_revision_(0),
+    encoding_(raw_events)
 {
     // Read the MetaMessages at time 0 first.  Meta messages in voice tracks
     // after time 0 will be ignored.
@@ -111,7 +273,7 @@ VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
     
     UInt32 absTime = 0;
 
-    auto meta_ptr = midiTrack.GetPackets().at(0).meta_filter(std_midi::sb::track_name);
+    auto meta_ptr = midiTrack.GetPackets().at(0).find_meta(std_midi::sb::track_name);
     if (meta_ptr)
     {
         this->track_name_ = meta_ptr->message();
@@ -122,8 +284,17 @@ VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
             midiTrack.GetTrackId()));
     }
 
-    auto zeroth_msgs = midiTrack.GetPackets().at(0).voice_messages();
-    for (auto it: zeroth_msgs)
+    // Every voice message becomes at most one event.
+    size_t voiceCount = 0;
+    for (auto &packet: midiTrack.GetPackets())
+    {
+        voiceCount += packet.voice_messages().size();
+    }
+
+    this->events_.reserve(voiceCount);
+
+    const std_midi::VoiceMsgVecT &zeroth_msgs = midiTrack.GetPackets().at(0).voice_messages();
+    for (auto &it: zeroth_msgs)
     {
         if (it.GetCode() == std_midi::sb::control_change)
         {
@@ -155,7 +326,7 @@ VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
             }
         }
         
-        this->events_.push_back(VoiceEvent(absTime, it));
+        this->events_.emplace_back(absTime, it);
     }
 
     if (this->GetRange() == make_pair<UInt8, UInt8>(0, 0))
@@ -173,7 +344,7 @@ VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
         p_it++)
     {
         absTime += p_it->delta_time();
-        for (auto voiceIt : p_it->voice_messages())
+        for (auto &voiceIt : p_it->voice_messages())
         {
             if (voiceIt.GetCode() == std_midi::sb::control_change)
             {
@@ -205,28 +376,39 @@ VoiceTrack::VoiceTrack(const std_midi::MIDITrack &midiTrack)
                             << " found at " << absTime << " in " << this->track_name_
                             << ". Replacing with 0." << endl;
                         
-                        events_.push_back(VoiceEvent(
+                        events_.emplace_back(
                             absTime,
                             std_midi::VoiceMessage(
                                 voiceIt.GetStatus(),
                                 voiceIt.GetData1(),
-                                0)));
+                                0));
 
                         continue;
                     }
                 }
             }
 
-            events_.push_back(VoiceEvent(absTime, voiceIt));
+            events_.emplace_back(absTime, voiceIt);
         }
     }
 
 }
 
 
-void VoiceTrack::WriteBinary(ostream &os, const cmn::FileVersion &) const
+void VoiceTrack::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
 {
-    UInt32 trackSize = events_.size();
+    this->write_binary(os, fileVersion);
+}
+
+void VoiceTrack::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void VoiceTrack::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
+{
+    UInt32 trackSize = this->GetEventCount();
     string vtrk("VTrk");
     os.write(vtrk.c_str(), 4);
     os.write((char *)&track_id_, sizeof(track_id_));
@@ -235,7 +417,53 @@ void VoiceTrack::WriteBinary(ostream &os, const cmn::FileVersion &) const
     os.put(this->GetGroupId());
     ex::WriteString(os, this->track_name_);
     os.write((char *)&trackSize, sizeof(trackSize));
-    os.write((char *)&events_[0], sizeof(VoiceEvent) * trackSize);
+
+    // Events that cannot be encoded compactly are written raw.
+    vector<char> encoded;
+    bool compact = !(fileVersion < eventEncodingVersion)
+        && this->encoding_ == compact_events
+        && encode_voice_events(this->GetEventData(), trackSize, encoded);
+    if (!(fileVersion < eventEncodingVersion))
+    {
+        os.put(static_cast<char>(compact ? compact_events : raw_events));
+    }
+
+    if (compact)
+    {
+        UInt32 encodedSize = encoded.size();
+        os.write((char *)&encodedSize, sizeof(encodedSize));
+        os.write(encoded.data(), encodedSize);
+    } else
+    {
+        if (!(fileVersion < alignedEventsVersion))
+        {
+            // One byte for the count, then enough zeros to align the events.
+            // A stream that cannot tell its position gets no padding.
+            streamoff position = os.tellp();
+            size_t padding = position < 0
+                ? 0
+                : (eventAlignment - (position + 1) % eventAlignment) % eventAlignment;
+            os.put(static_cast<char>(padding));
+            const char zeros[eventAlignment] = {};
+            os.write(zeros, padding);
+        }
+
+        os.write((char *)this->GetEventData(), sizeof(VoiceEvent) * trackSize);
+    }
+
+    if (fileVersion < cmn::FileVersion(2, 2))
+    {
+        return;
+    }
+
+    UInt32 indexTicks = this->HasTimeIndex() ? this->index_ticks_ : 0;
+    os.write((char *)&indexTicks, sizeof(indexTicks));
+    if (indexTicks)
+    {
+        UInt32 indexSize = this->index_.size();
+        os.write((char *)&indexSize, sizeof(indexSize));
+        os.write((char *)&this->index_[0], sizeof(UInt32) * indexSize);
+    }
 }
 
 
@@ -244,7 +472,7 @@ void VoiceTrack::WriteString(ostream &o) const
     o   << "ROCSVoiceTrack("
         << "track_name=" << track_name_
         << ", track_id=" << static_cast<UInt16>(track_id_)
-        << ", track_size=" << events_.size()
+        << ", track_size=" << this->GetEventCount()
         << ", range_low=" << static_cast<UInt16>(this->GetRangeLow())
         << ", range_high=" << static_cast<UInt16>(this->GetRangeHigh())
         << ")";
@@ -254,9 +482,10 @@ void VoiceTrack::WriteString(ostream &o) const
 void VoiceTrack::WriteStringEvents(ostream &os, int indent) const
 {
     map<UInt32, vector<VoiceEvent>> packets;
-    for (auto it: this->events_)
+    const VoiceEvent *events = this->GetEventData();
+    for (size_t i = 0; i < this->GetEventCount(); i++)
     {
-        packets[it.GetAbsTime()].push_back(it);
+        packets[events[i].GetAbsTime()].push_back(events[i]);
     }
     
     os << string(indent, '\t');
@@ -280,6 +509,7 @@ void VoiceTrack::WriteStringEvents(ostream &os, int indent) const
 
 void VoiceTrack::SetTrackId(UInt16 trackId)
 {
+    this->copy_mapped();
     for (auto &it : this->events_)
     {
         it.SetChannel(static_cast<UInt8>(trackId));
@@ -306,53 +536,131 @@ void VoiceTrack::SetTrackId(UInt16 trackId)
     }
     
     this->track_id_ = trackId;
+    this->touch();
 }
 
 
-VoiceEvtVecT VoiceTrack::EventSlice(SInt64 start, SInt64 end, SInt8 transpose) const
+UInt64 VoiceTrack::next_revision()
 {
-    VoiceEvtVecT subRange;
-    VoiceEvtVecT::const_iterator start_it, end_it;
+    static atomic<UInt64> revision(0);
+    return ++revision;
+}
+
+void VoiceTrack::copy_mapped()
+{
+    if (!this->mapped_events_) return;
+    this->events_.assign(this->mapped_events_, this->mapped_events_ + this->mapped_count_);
+    this->mapped_events_ = nullptr;
+    this->mapped_count_ = 0;
+    this->mapped_owner_.reset();
+}
 
-    if (start < 0)
+void VoiceTrack::BuildTimeIndex(UInt32 bucketTicks)
+{
+    this->index_ticks_ = bucketTicks;
+    this->index_.clear();
+    if (!bucketTicks)
     {
-        start_it = events_.begin();
-    } else
+        this->index_.shrink_to_fit();
+        return;
+    }
+
+    // index_[b] is the first event at or after bucket b, and the last entry
+    // is the end of the events.
+    const VoiceEvent *events = this->GetEventData();
+    size_t count = this->GetEventCount();
+    size_t buckets = !count ? 0 : events[count - 1].GetAbsTime() / bucketTicks + 1;
+
+    this->index_.reserve(buckets + 1);
+    size_t i = 0;
+    for (size_t bucket = 0; bucket <= buckets; bucket++)
     {
-        start_it = lower_bound(
-            this->events_.begin(),
-            this->events_.end(),
-            start,
-            [](const VoiceEvent& evt, SInt64 start)->bool
-            {
-                return evt.GetAbsTime() < start;
-            });
+        UInt64 bucketStart = static_cast<UInt64>(bucket) * bucketTicks;
+        while (i < count && events[i].GetAbsTime() < bucketStart)
+        {
+            i++;
+        }
+
+        this->index_.push_back(static_cast<UInt32>(i));
     }
 
-    if (end < 0)
+    this->index_revision_ = this->revision_;
+}
+
+void VoiceTrack::UpdateTimeIndex()
+{
+    if (this->index_ticks_ && !this->HasTimeIndex())
     {
-        end_it = this->events_.end();
-    } else
+        this->BuildTimeIndex(this->index_ticks_);
+    }
+}
+
+size_t VoiceTrack::find(SInt64 tick, bool after, size_t first) const
+{
+    const VoiceEvent *events = this->GetEventData();
+    const VoiceEvent *lo = events + first;
+    const VoiceEvent *hi = events + this->GetEventCount();
+    if (this->HasTimeIndex())
+    {
+        SInt64 bucket = tick / this->index_ticks_;
+        if (bucket + 1 >= static_cast<SInt64>(this->index_.size()))
+        {
+            return this->GetEventCount();
+        }
+
+        lo = events + max<size_t>(first, this->index_[bucket]);
+        hi = events + max<size_t>(first, this->index_[bucket + 1]);
+    }
+
+    if (after)
     {
-        end_it = upper_bound(
-            this->events_.begin(),
-            this->events_.end(),
-            end,
-            [](SInt64 end, const VoiceEvent& evt)->bool
+        return upper_bound(
+            lo,
+            hi,
+            tick,
+            [](SInt64 tick, const VoiceEvent& evt)->bool
             {
-                return (end < evt.GetAbsTime());
-            });
+                return (tick < evt.GetAbsTime());
+            }) - events;
     }
 
-    copy(start_it, end_it, back_inserter(subRange));
-    if (transpose && !(this->range_.first >= this->range_.second))
+    return lower_bound(
+        lo,
+        hi,
+        tick,
+        [](const VoiceEvent& evt, SInt64 tick)->bool
+        {
+            return evt.GetAbsTime() < tick;
+        }) - events;
+}
+
+VoiceEventSlice VoiceTrack::Slice(SInt64 start, SInt64 end, SInt8 transpose) const
+{
+    size_t first = start < 0 ? 0 : this->find(start, false, 0);
+    size_t last = end < 0 ? this->GetEventCount() : this->find(end, true, first);
+
+    bool transposes = transpose && !(this->range_.first >= this->range_.second);
+    if (transposes && abs(transpose) > 6)
     {
-        for_each(
-            subRange.begin(),
-            subRange.end(),
-            TransposeVoiceEvent(transpose, this->range_));
+        throw std::range_error("transpose may be no more than + or - 6");
     }
 
+    return VoiceEventSlice(
+        this->GetEventData() + first,
+        this->GetEventData() + last,
+        transposes ? transpose : 0,
+        this->range_);
+}
+
+void VoiceTrack::EventSlice(VoiceEvtVecT &out, SInt64 start, SInt64 end, SInt8 transpose) const
+{
+    this->Slice(start, end, transpose).CopyTo(out);
+}
+
+VoiceEvtVecT VoiceTrack::EventSlice(SInt64 start, SInt64 end, SInt8 transpose) const
+{
+    VoiceEvtVecT subRange;
+    this->EventSlice(subRange, start, end, transpose);
     return subRange;
 }
 
@@ -362,11 +670,11 @@ ROCS_CORE_API bool operator==(const VoiceTrack &lhs, const VoiceTrack &rhs)
     if (lhs.GetTrackName() != rhs.GetTrackName()) return false;
     if (lhs.GetRange() != rhs.GetRange()) return false;
     if (lhs.GetGroupId() != rhs.GetGroupId()) return false;
-    if (lhs.GetEvents().size() != rhs.GetEvents().size()) return false;
+    if (lhs.GetEventCount() != rhs.GetEventCount()) return false;
     return equal(
-        lhs.GetEvents().begin(),
-        lhs.GetEvents().end(),
-        rhs.GetEvents().begin(),
+        lhs.GetEventData(),
+        lhs.GetEventData() + lhs.GetEventCount(),
+        rhs.GetEventData(),
         [] (const rocs_midi::VoiceEvent& x, const rocs_midi::VoiceEvent& y)->bool
         {
             return x == y;
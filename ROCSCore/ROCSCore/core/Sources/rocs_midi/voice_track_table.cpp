@@ -0,0 +1,125 @@
+#include "core/rocs_midi/voice_track_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include "exlib/format.h"
+
+using namespace std;
+
+namespace rocs_midi
+{
+
+const UInt32 VoiceTrackTable::no_track;
+
+static bool before(const VoiceTrackTable::value_type &entry, UInt16 trackId)
+{
+    return entry.first < trackId;
+}
+
+void VoiceTrackTable::clear()
+{
+    this->entries_.clear();
+    this->slots_.clear();
+}
+
+void VoiceTrackTable::reserve(size_type count)
+{
+    this->entries_.reserve(count);
+    this->slots_.reserve(count);
+}
+
+pair<VoiceTrackTable::iterator, bool> VoiceTrackTable::insert(
+    UInt16 trackId,
+    VoiceTrackPtrT voiceTrackPtr)
+{
+    size_t found = this->position(trackId);
+    if (found != this->entries_.size())
+    {
+        return make_pair(this->entries_.begin() + found, false);
+    }
+
+    // Tracks are nearly always added in track id order, which appends.
+    size_t at = lower_bound(this->entries_.begin(), this->entries_.end(), trackId, before)
+        - this->entries_.begin();
+    this->entries_.insert(this->entries_.begin() + at, make_pair(trackId, move(voiceTrackPtr)));
+    this->update_slots(at);
+    return make_pair(this->entries_.begin() + at, true);
+}
+
+VoiceTrackTable::size_type VoiceTrackTable::erase(UInt16 trackId)
+{
+    size_t found = this->position(trackId);
+    if (found == this->entries_.size()) return 0;
+    this->erase(this->entries_.begin() + found);
+    return 1;
+}
+
+void VoiceTrackTable::erase(iterator position)
+{
+    size_t at = position - this->entries_.begin();
+    if (position->first < this->slots_.size())
+    {
+        this->slots_[position->first] = no_track;
+    }
+
+    this->entries_.erase(position);
+    this->update_slots(at);
+}
+
+VoiceTrack& VoiceTrackTable::at(UInt16 trackId)
+{
+    size_t found = this->position(trackId);
+    if (found == this->entries_.size())
+    {
+        throw out_of_range(ex::format("%u not found!", trackId));
+    }
+
+    return *this->entries_[found].second;
+}
+
+const VoiceTrack& VoiceTrackTable::at(UInt16 trackId) const
+{
+    return const_cast<VoiceTrackTable *>(this)->at(trackId);
+}
+
+VoiceTrackPtrT VoiceTrackTable::pat(UInt16 trackId) const
+{
+    size_t found = this->position(trackId);
+    if (found == this->entries_.size())
+    {
+        throw out_of_range(ex::format("%u not found!", trackId));
+    }
+
+    return this->entries_[found].second;
+}
+
+size_t VoiceTrackTable::search(UInt16 trackId) const
+{
+    auto found = lower_bound(this->entries_.begin(), this->entries_.end(), trackId, before);
+    if (found == this->entries_.end() || found->first != trackId) return this->entries_.size();
+    return found - this->entries_.begin();
+}
+
+void VoiceTrackTable::update_slots(size_t first)
+{
+    // Slots for ids up to four times the track count cost at most 16 bytes
+    // per track.  Past that, search instead.
+    size_t slotCount = this->entries_.empty()
+        ? 0
+        : static_cast<size_t>(this->entries_.back().first) + 1;
+    if (!slotCount || slotCount > 4 * this->entries_.size() + 64)
+    {
+        this->slots_.clear();
+        return;
+    }
+
+    // Without slots before, every entry needs one.
+    if (this->slots_.empty()) first = 0;
+    this->slots_.resize(slotCount, no_track);
+    for (size_t i = first; i < this->entries_.size(); i++)
+    {
+        this->slots_[this->entries_[i].first] = static_cast<UInt32>(i);
+    }
+}
+
+} // end namespace rocs_midi
@@ -0,0 +1,217 @@
+#include "core/std_midi/compact_track.h"
+#include "core/std_midi/midi_track.h"
+#include "core/std_midi/track_reader.h"
+
+using namespace std;
+
+namespace std_midi
+{
+
+string CompactMeta::message() const
+{
+    // These are the types that read_meta_message creates as StringMetaMessage.
+    if (status_ >= sb::text && status_ <= sb::device_port_name)
+    {
+        return string(bytes_, bytes_ + length_);
+    }
+
+    return string();
+}
+
+UInt32 CompactMeta::microseconds() const
+{
+    if (status_ != sb::tempo || length_ < 3) return 0;
+
+    // The tempo is stored as only 3 bytes, and they are big-endian!
+    return (UInt32(bytes_[0]) << 16) | (UInt32(bytes_[1]) << 8) | bytes_[2];
+}
+
+MetaMsgPtrT CompactMeta::ToMetaMessage() const
+{
+    vector<Byte> raw;
+    raw.reserve(length_ + 3);
+    raw.push_back(0xFF);
+    raw.push_back(status_);
+    raw.push_back(length_);
+    raw.insert(raw.end(), bytes_, bytes_ + length_);
+    ByteSpanReader reader(raw.data(), raw.size());
+    return read_meta_message(reader);
+}
+
+/* Sink for read_packets that appends to the arrays of a CompactTrack.  Events
+ * of a packet that is never closed are dropped, as MIDITrack drops them. */
+struct CompactTrackBuilder
+{
+    CompactTrackBuilder(
+        CompactEventVecT &events,
+        CompactPacketVecT &packets,
+        vector<Byte> &arena)
+        :
+        length(0),
+        events_(events),
+        packets_(packets),
+        arena_(arena),
+        closed_events_(0),
+        closed_arena_(0)
+    {
+
+    }
+
+    void open(UInt32 delta_time)
+    {
+        length += delta_time;
+        packet_.delta_time = delta_time;
+        packet_.first_event = static_cast<UInt32>(events_.size());
+    }
+
+    bool close()
+    {
+        packets_.push_back(packet_);
+        closed_events_ = events_.size();
+        closed_arena_ = arena_.size();
+        return true;
+    }
+
+    void add_message(const VoiceMessage &voice_msg)
+    {
+        CompactEvent event;
+        event.kind = compact_voice;
+        event.status = voice_msg.status_;
+        event.data1 = voice_msg.data1_;
+        event.data2 = voice_msg.data2_;
+        event.offset = 0;
+        events_.push_back(event);
+    }
+
+    template <class SourceT>
+    bool read_meta(SourceT &is)
+    {
+        is.get();
+        int status = is.peek();
+        if (status < 0 || !is_meta_status(static_cast<Byte>(status)))
+        {
+            throw MetaMessageError(ex::format(
+                "Invalid Meta Message Type: %#X at %u",
+                status,
+                (UInt32)is.tellg()));
+        }
+
+        CompactEvent event;
+        event.kind = compact_meta;
+        event.status = is.get();
+        event.data1 = is.get();
+        event.data2 = 0;
+        event.offset = static_cast<UInt32>(arena_.size());
+        if (event.data1)
+        {
+            arena_.resize(arena_.size() + event.data1);
+            is.read((char *)&arena_[event.offset], event.data1);
+        }
+
+        events_.push_back(event);
+        return event.status == sb::end_of_track;
+    }
+
+    void finish()
+    {
+        events_.resize(closed_events_);
+        arena_.resize(closed_arena_);
+    }
+
+    UInt32 length;
+
+private:
+    CompactEventVecT &events_;
+    CompactPacketVecT &packets_;
+    vector<Byte> &arena_;
+    CompactPacket packet_;
+    size_t closed_events_;
+    size_t closed_arena_;
+};
+
+CompactTrack::CompactTrack(istream &is, UInt16 trackId)
+    :
+    track_id_(trackId)
+{
+    this->read_track(is);
+}
+
+CompactTrack::CompactTrack(ByteSpanReader &is, UInt16 trackId)
+    :
+    track_id_(trackId)
+{
+    this->read_track(is);
+}
+
+template <class SourceT>
+void CompactTrack::read_track(SourceT &is)
+{
+    UInt32 end_g = read_track_header(is);
+    CompactTrackBuilder builder(events_, packets_, arena_);
+    read_packets(is, end_g, builder);
+    builder.finish();
+    length_ = builder.length;
+
+    events_.shrink_to_fit();
+    packets_.shrink_to_fit();
+    arena_.shrink_to_fit();
+
+    // Determine track name 
+    for (auto it = this->PacketBegin(0); it != this->PacketEnd(0); it++)
+    {
+        if (it->is_meta() && it->status == sb::track_name)
+        {
+            track_name_ = this->GetMeta(*it).message();
+            break;
+        }
+    }
+}
+
+MIDIPacket CompactTrack::ToMIDIPacket(size_t packetIndex) const
+{
+    MIDIPacket packet(this->packets_.at(packetIndex).delta_time);
+    auto end = this->PacketEnd(packetIndex);
+    for (auto it = this->PacketBegin(packetIndex); it != end; it++)
+    {
+        if (it->is_meta())
+        {
+            packet.add_message(this->GetMeta(*it).ToMetaMessage());
+        } else
+        {
+            packet.add_message(it->voice_message());
+        }
+    }
+
+    return packet;
+}
+
+size_t CompactTrack::MemoryUsage() const
+{
+    return this->events_.capacity() * sizeof(CompactEvent)
+        + this->packets_.capacity() * sizeof(CompactPacket)
+        + this->arena_.capacity();
+}
+
+void CompactTrack::WriteString(ostream& os) const
+{
+    os << dec;
+    os  << "CompactTrack("
+        << "track_id=" << static_cast<UInt16>(this->track_id_) << ", "
+        << "packet_count=" << this->packets_.size() << ", "
+        << "event_count=" << this->events_.size()
+        << ")";
+}
+
+void CompactTrack::WriteStringPackets(ostream &os, int indent) const
+{
+    os << string(indent, '\t');
+    this->WriteString(os);
+    os << endl;
+    for (size_t i = 0; i < this->packets_.size(); i++)
+    {
+        this->ToMIDIPacket(i).WriteString(os, indent + 1);
+        os << endl;
+    }
+}
+
+} // End namespace std_midi
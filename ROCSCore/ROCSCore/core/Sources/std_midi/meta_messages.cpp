@@ -5,7 +5,8 @@ using namespace std;
 
 namespace std_midi {
 
-ROCS_CORE_API MetaMsgPtrT read_meta_message(istream& s) // throw(MetaMessageError)
+template <class SourceT>
+static MetaMsgPtrT read_meta_message_(SourceT& s) // throw(MetaMessageError)
 {
 #ifdef DEBUG
     UInt8 byte1 = s.get();
@@ -56,6 +57,42 @@ ROCS_CORE_API MetaMsgPtrT read_meta_message(istream& s) // throw(MetaMessageErro
     }
 }
 
+ROCS_CORE_API MetaMsgPtrT read_meta_message(istream& s) // throw(MetaMessageError)
+{
+    return read_meta_message_(s);
+}
+
+ROCS_CORE_API MetaMsgPtrT read_meta_message(ByteSpanReader& s) // throw(MetaMessageError)
+{
+    return read_meta_message_(s);
+}
+
+ROCS_CORE_API bool is_meta_status(Byte status)
+{
+    switch (status) {
+        case sb::sequence_number:
+        case sb::text:
+        case sb::copyright:
+        case sb::track_name:
+        case sb::instrument:
+        case sb::lyric:
+        case sb::marker:
+        case sb::cue_point:
+        case sb::program_name:
+        case sb::device_port_name:
+        case sb::midi_channel_prefix:
+        case sb::end_of_track:
+        case sb::tempo:
+        case sb::smpte_offset:
+        case sb::time_signature:
+        case sb::key_signature:
+        case sb::proprietary_event:
+            return true;
+        default:
+            return false;
+    }
+}
+
 ROCS_CORE_API MetaMsgPtrT create_meta_message(Byte status) // throw(MetaMessageError)
 {
     switch (status) {
@@ -104,6 +141,14 @@ MetaMessage::MetaMessage(istream& is)
     if (length_) is.read((char *)&bytes_.at(0), length_);
 }
 
+MetaMessage::MetaMessage(ByteSpanReader& is)
+{
+    status_ = is.get();
+    length_ = is.get();
+    bytes_.resize(length_);
+    if (length_) is.read((char *)&bytes_.at(0), length_);
+}
+
 
 void MetaMessage::WriteString(ostream& o) const
 {
@@ -1,18 +1,123 @@
 #include "core/std_midi/midi_file.h"
+#include "exlib/parallel_for.h"
 
 using namespace std;
 
 namespace std_midi
 {
 
+ROCS_CORE_API MIDIChunkInfoVecT scan_midi_chunks(ByteSpanReader &is, UInt16 count)
+{
+    MIDIChunkInfoVecT chunks;
+    chunks.reserve(count);
+    for (UInt16 i = 0; i < count; i++)
+    {
+        MIDIChunkInfo chunk;
+        chunk.offset = static_cast<UInt32>(is.tellg());
+        is.read(chunk.chunk_id, 4);
+        is.read((char *)&chunk.size, sizeof(chunk.size));
+        ex::reverse_byte_order(chunk.size);
+        is.seekg(chunk.size, istream::cur);
+        chunks.push_back(chunk);
+    }
+
+    return chunks;
+}
+
 MIDIFile::MIDIFile(const string &midi_file_name)
     :
-    filename_(midi_file_name)
+    filename_(midi_file_name),
+    data_(nullptr),
+    size_(0),
+    fully_loaded_(true),
+    length_known_(false),
+    decode_threads_(1)
+{
+    this->read_stream();
+}
+
+MIDIFile::MIDIFile(
+    const string &midi_file_name,
+    MIDILoadMode mode,
+    unsigned decode_threads)
+    :
+    filename_(midi_file_name),
+    data_(nullptr),
+    size_(0),
+    fully_loaded_(true),
+    length_known_(false),
+    decode_threads_(decode_threads)
+{
+    shared_ptr<ex::MappedFile> mapped;
+    if (mode != load_stream)
+    {
+        try
+        {
+            mapped.reset(new ex::MappedFile(filename_));
+        } catch (ex::MappedFileError &)
+        {
+            // Let the stream reader report the problem, if there is one.
+        }
+    }
+
+    if (mode == load_lazy)
+    {
+        this->mapped_ = mapped;
+        this->read_lazy(decode_threads);
+    } else if (mapped)
+    {
+        this->read_span(
+            mapped->data(),
+            mapped->size(),
+            mode == load_parallel ? decode_threads : 1);
+    } else
+    {
+        this->read_stream();
+    }
+}
+
+MIDIFile::MIDIFile(
+    const Byte *data,
+    size_t size,
+    const string &midi_file_name,
+    unsigned decode_threads)
+    :
+    filename_(midi_file_name),
+    data_(nullptr),
+    size_(0),
+    fully_loaded_(true),
+    length_known_(false),
+    decode_threads_(decode_threads)
+{
+    this->read_span(data, size, decode_threads);
+}
+
+void MIDIFile::read_stream()
 {
     ifstream ifs;
     ifs.exceptions(ifstream::failbit | ifstream::badbit);
     ifs.open(filename_.c_str(), fstream::in | fstream::binary);
-    ifs.read((char *)&this->header_, MIDI_HEADER_SIZE);
+    this->read_header(ifs);
+    this->read_tracks(ifs);
+}
+
+void MIDIFile::read_span(const Byte *data, size_t size, unsigned decode_threads)
+{
+    ByteSpanReader reader(data, size);
+    this->read_header(reader);
+    if (decode_threads == 1)
+    {
+        this->read_tracks(reader);
+    } else
+    {
+        this->read_tracks_parallel(reader, decode_threads);
+    }
+}
+
+template <class SourceT>
+void MIDIFile::read_header(SourceT &is)
+{
+    is.read((char *)&this->header_, MIDI_HEADER_SIZE);
     
     if (this->header_.chunkType() != "MThd")
     {
@@ -32,27 +137,242 @@ MIDIFile::MIDIFile(const string &midi_file_name)
     if (!header_.ntrks)
     {
         throw MIDIFileError(
-            midi_file_name + 
+            filename_ + 
             " appears to be corrupted because track count is set to zero.");
     }
+}
 
+template <class SourceT>
+void MIDIFile::read_tracks(SourceT &is)
+{
     for (int i = 0; i < header_.ntrks; i++)
     {
         try
         {
-            tracks_.push_back(MIDITrackPtrT(new MIDITrack(ifs, i)));
+            tracks_.emplace_back(is, i);
         } catch (UnrecognizedTrackID &e)
         {
             warnings << e.what() << endl;
             continue;
         }
     }
+}
+
+/* Every chunk is length-prefixed, so once the chunk headers have been scanned
+ * each track can be decoded independently with its own reader.  Results are
+ * collected by chunk index and appended in that order, so tracks_ and the
+ * warnings for unrecognized chunks come out exactly as read_tracks would
+ * produce them.  The one difference is that each track starts at the offset
+ * recorded in the chunk headers, rather than wherever the previous track's
+ * end_of_track left the stream; the two only disagree for malformed files. */
+void MIDIFile::read_tracks_parallel(ByteSpanReader &is, unsigned decode_threads)
+{
+    auto chunks = scan_midi_chunks(is, header_.ntrks);
+    vector<MIDITrackPtrT> decoded(chunks.size());
+    vector<string> unrecognized(chunks.size());
+
+    ex::parallel_for(
+        chunks.size(),
+        [&](size_t i)
+        {
+            ByteSpanReader reader(is);
+            reader.seekg(chunks[i].offset);
+            try
+            {
+                decoded[i] = make_shared<MIDITrack>(reader, i);
+            } catch (UnrecognizedTrackID &e)
+            {
+                unrecognized[i] = e.what();
+            }
+        },
+        decode_threads);
+
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        if (decoded[i])
+        {
+            tracks_.push_back(std::move(decoded[i]));
+        } else
+        {
+            warnings << unrecognized[i] << endl;
+        }
+    }
+}
+
+/* Indexes the chunks and reads only the name of each track.  The file stays
+ * mapped, or buffered if it could not be mapped, so that materialize can
+ * decode tracks on demand. */
+void MIDIFile::read_lazy(unsigned decode_threads)
+{
+    if (this->mapped_)
+    {
+        this->data_ = this->mapped_->data();
+        this->size_ = this->mapped_->size();
+    } else
+    {
+        ifstream ifs;
+        ifs.exceptions(ifstream::failbit | ifstream::badbit);
+        ifs.open(filename_.c_str(), fstream::in | fstream::binary);
+        ifs.seekg(0, istream::end);
+        this->buffer_.reset(new vector<Byte>(static_cast<size_t>(ifs.tellg())));
+        ifs.seekg(0, istream::beg);
+        if (this->buffer_->size())
+        {
+            ifs.read((char *)&this->buffer_->at(0), this->buffer_->size());
+            this->data_ = &this->buffer_->at(0);
+        }
+
+        this->size_ = this->buffer_->size();
+    }
+
+    ByteSpanReader reader(this->data_, this->size_);
+    this->read_header(reader);
+    auto chunks = scan_midi_chunks(reader, header_.ntrks);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        reader.seekg(chunks[i].offset);
+        try
+        {
+            LazyTrack track;
+            track.track_name = scan_midi_track_name(reader);
+            track.offset = chunks[i].offset;
+            track.track_id = static_cast<UInt16>(i);
+            this->lazy_index_.push_back(track);
+        } catch (UnrecognizedTrackID &e)
+        {
+            warnings << e.what() << endl;
+        }
+    }
+
+    this->lazy_tracks_.resize(this->lazy_index_.size());
+    this->fully_loaded_ = false;
+    this->decode_threads_ = decode_threads;
+}
+
+/* Decodes the index'th recognized track if it has not been decoded yet. */
+const MIDITrack &MIDIFile::materialize(size_t index) const
+{
+    if (this->fully_loaded_)
+    {
+        return this->tracks_.at(index);
+    }
+
+    MIDITrackPtrT &track = this->lazy_tracks_.at(index);
+    if (!track)
+    {
+        ByteSpanReader reader(this->data_, this->size_);
+        reader.seekg(this->lazy_index_[index].offset);
+        track = make_shared<MIDITrack>(reader, this->lazy_index_[index].track_id);
+    }
 
+    return *track;
+}
+
+void MIDIFile::materialize_all() const
+{
+    if (this->fully_loaded_) return;
+
+    ex::parallel_for(
+        this->lazy_tracks_.size(),
+        [this](size_t i) { this->materialize(i); },
+        this->decode_threads_);
+
+    this->tracks_.reserve(this->lazy_tracks_.size());
+    for (auto &track: this->lazy_tracks_)
+    {
+        this->tracks_.push_back(std::move(track));
+    }
+
+    this->lazy_tracks_.clear();
+    this->fully_loaded_ = true;
+
+    // Every track has been decoded, so the file data is no longer needed.
+    this->mapped_.reset();
+    this->buffer_.reset();
+    this->data_ = nullptr;
+    this->size_ = 0;
+}
+
+void MIDIFile::compute_length() const
+{
     this->length_ = 0;
-    for (auto it: this->tracks_)
+    if (!this->fully_loaded_)
     {
-        this->length_ = max(this->length_, it.GetLength());
+        for (size_t i = 0; i < this->lazy_index_.size(); i++)
+        {
+            UInt32 length;
+            if (this->lazy_tracks_[i])
+            {
+                length = this->lazy_tracks_[i]->GetLength();
+            } else
+            {
+                ByteSpanReader reader(this->data_, this->size_);
+                reader.seekg(this->lazy_index_[i].offset);
+                length = scan_midi_track_length(reader);
+            }
+
+            this->length_ = max(this->length_, length);
+        }
+    } else
+    {
+        for (auto &it: this->tracks_)
+        {
+            this->length_ = max(this->length_, it.GetLength());
+        }
+    }
+
+    this->length_known_ = true;
+}
+
+UInt32 MIDIFile::GetLength() const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    if (!this->length_known_)
+    {
+        this->compute_length();
     }
+
+    return this->length_;
+}
+
+const MIDITrackVecT &MIDIFile::GetTracks() const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    this->materialize_all();
+    return this->tracks_;
+}
+
+const MIDIPacketVecT &MIDIFile::GetConductorPackets() const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    return this->materialize(0).GetPackets();
+}
+
+bool MIDIFile::IsFullyLoaded() const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    return this->fully_loaded_;
+}
+
+vector<string> MIDIFile::GetTrackNames() const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    vector<string> names;
+    if (!this->fully_loaded_)
+    {
+        for (auto &track: this->lazy_index_)
+        {
+            names.push_back(track.track_name);
+        }
+    } else
+    {
+        for (auto &track: this->tracks_)
+        {
+            names.push_back(track.GetTrackName());
+        }
+    }
+
+    return names;
 }
 
 void MIDIFile::WriteString(ostream &os) const
@@ -70,7 +390,7 @@ void MIDIFile::WriteStringTracks(ostream &os, int indent) const
     os << endl;
     string indent_(indent + 1, '\t');
     
-    for (auto it : tracks_)
+    for (auto &it : this->GetTracks())
     {
         os << indent_;
         it.WriteString(os);
@@ -85,7 +405,7 @@ void MIDIFile::WriteStringAll(ostream &os, int indent) const
     os << string(indent, '\t');
     this->WriteString(os);
     os << endl;
-    for (auto it : tracks_)
+    for (auto &it : this->GetTracks())
     {
         it.WriteStringPackets(os, indent+1);
         os << endl;
@@ -107,21 +427,41 @@ void MIDIFile::WriteBinary(ostream &os, const cmn::FileVersion &) const
  * does not exist. */
 const MIDITrack &MIDIFile::GetTrack(const std::string &trackName) const
 {
+    auto track = this->FindTrack(trackName);
+    if (track)
+    {
+        return *track;
+    } else
+    {
+        throw MIDIFileError(trackName + " does not exist.");
+    }
+}
+
+const MIDITrack *MIDIFile::FindTrack(const std::string &trackName) const
+{
+    lock_guard<mutex> lock(this->mutex_);
+    if (!this->fully_loaded_)
+    {
+        for (size_t i = 0; i < this->lazy_index_.size(); i++)
+        {
+            if (this->lazy_index_[i].track_name == trackName)
+            {
+                return &this->materialize(i);
+            }
+        }
+
+        return nullptr;
+    }
+
     auto it = find_if(
         this->tracks_.begin(),
         this->tracks_.end(),
-        [trackName] (const MIDITrack &track)
+        [&trackName] (const MIDITrack &track)
         {
             return track.GetTrackName() == trackName;
         });
     
-    if (it != this->tracks_.end())
-    {
-        return *it;
-    } else
-    {
-        throw MIDIFileError(trackName + " does not exist.");
-    }
+    return it != this->tracks_.end() ? &*it : nullptr;
 }
 
 
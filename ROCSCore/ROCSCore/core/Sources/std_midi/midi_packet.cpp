@@ -6,7 +6,7 @@ namespace std_midi
 
 void MIDIPacket::add_message(MetaMsgPtrT msg_ptr)
 {
-    meta_messages_.push_back(msg_ptr);
+    meta_messages_.push_back(std::move(msg_ptr));
 }
 
 void MIDIPacket::add_message(const VoiceMessage& voice_msg)
@@ -19,13 +19,13 @@ void MIDIPacket::WriteString(std::ostream& os, int indent) const
     os  << string(indent, '\t') << "MIDIPacket(delta_time="
         << delta_time() << ")" << endl;
     string indent_(indent + 1, '\t');
-    for (auto m_it : meta_messages_) {
+    for (auto &m_it : meta_messages_) {
         os << indent_;
         m_it->WriteString(os);
         os << endl;
     }
 
-    for (auto v_it : voice_messages_) {
+    for (auto &v_it : voice_messages_) {
         os << indent_;
         v_it.WriteString(os);
         os << endl;
@@ -34,38 +34,14 @@ void MIDIPacket::WriteString(std::ostream& os, int indent) const
 
 MetaMsgPtrT MIDIPacket::meta_filter(UInt8 status) const
 {
-    auto it = find_if(  meta_messages_.begin(),
-                        meta_messages_.end(),
-                        [status] (MetaMsgPtrT msg) { return msg->status() == status; } );
-    if (it != meta_messages_.end()) {
-        return *it;
-    } else {
-        return MetaMsgPtrT();
-    }
+    auto view = this->meta_view(status);
+    return view.empty() ? MetaMsgPtrT() : *view.begin();
 }
 
 VoiceMsgVecT MIDIPacket::voice_filter(UInt8 status) const
 {
-    VoiceMsgVecT ret;
-    auto it = this->voice_messages_.begin();
-    while (it != this->voice_messages_.end()) {
-
-        it = find_if(
-            it,
-            this->voice_messages_.end(),
-            [&status] (VoiceMessage msg)
-            {
-                return msg.GetStatus() == status;
-            });
-        
-        if (it != voice_messages_.end())
-        {
-            ret.push_back(*it);
-            it++;
-        }
-    }
-
-    return ret;
+    auto view = this->voice_view(status);
+    return VoiceMsgVecT(view.begin(), view.end());
 }
 
 } // end namespace std_midi
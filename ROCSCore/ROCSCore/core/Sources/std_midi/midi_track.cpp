@@ -1,135 +1,145 @@
 #include "core/std_midi/midi_track.h"
+#include "core/std_midi/track_reader.h"
 
 using namespace std;
 
 namespace std_midi
 {
 
-struct MIDITrackHeader
+/* Sink for read_packets that builds the packets of a MIDITrack. */
+struct PacketBuilder
 {
-    char chunk_id[4];
-    UInt32 size;
-};
+    PacketBuilder(MIDIPacketVecT &packets): length(0), packets_(packets) {}
 
+    void open(UInt32 delta_time)
+    {
+        length += delta_time;
+        packet_ = MIDIPacket(delta_time);
+    }
 
-/* ReadMessageFunctor is a function that gets called multiple times from the
- * MIDITrack constructor.  running_status and require_status are persistent
- * values between function calls. Other private variables only need to be
- * created on the stack once, when the functor is constructed. */
-struct ReadMessageFunctor
-{
-    ReadMessageFunctor(): require_status(true) {}
-    
-    bool operator()(istream& is, MIDIPacket *p)
+    // The packet is moved into the track; open() gives packet_ a fresh state
+    // before it is used again.
+    bool close()
     {
-        next_byte = is.peek();
-        next_status = next_byte & 0xF0;
-        if (next_byte == 0xFF)
-        {
-            require_status = true;
-            p->add_message(read_meta_message(is));
-            if (p->meta_messages().back()->status() == sb::end_of_track)
-            {
-                return true;
-            }
-
-        } else if ((next_byte == sb::sysex) || (next_byte == sb::sysex_escape))
-        {
-            // Ignore all sysex messages
-            require_status = true;
-            any_var_length = read_variable_int(is);
-            is.seekg(any_var_length, istream::cur);
-        } else if (sb::voice_status_bytes.count(next_status))
-        {
-            // This is a voice message.
-            running_status = next_status;
-            require_status = false;
-            p->add_message(VoiceMessage(is));
-        } else if (!(next_byte & 0x80) & !require_status)
-        {
-            // This is a value between 0 and 127
-            p->add_message(VoiceMessage(is, running_status));
-        } else
-        {
-            throw UnknownStatusByte(ex::format(
-                "Unknown status byte: %#X at %u",
-                next_byte,
-                is.tellg()));
-        }
+        packets_.push_back(std::move(packet_));
+        return true;
+    }
 
-        return false;
+    template <class SourceT>
+    bool read_meta(SourceT &is)
+    {
+        MetaMsgPtrT meta = read_meta_message(is);
+        bool end_of_track = meta->status() == sb::end_of_track;
+        packet_.add_message(std::move(meta));
+        return end_of_track;
     }
 
+    void add_message(const VoiceMessage &voice_msg) { packet_.add_message(voice_msg); }
+
+    UInt32 length;
+
 private:
-    bool require_status;
-    Byte running_status;
-    Byte next_byte, next_status;
-    UInt32 any_var_length;
+    MIDIPacketVecT &packets_;
+    MIDIPacket packet_;
 };
 
-MIDITrack::MIDITrack(istream &is, UInt16 trackId)
-    :
-    track_id_(trackId)
+/* Sink for read_packets that keeps nothing but the track name, which comes
+ * from the first packet, and the track length. */
+struct TrackScanner
 {
-    MIDITrackHeader hdr;
-    is.read((char *)&hdr, sizeof(hdr));
-    ex::reverse_byte_order(hdr.size);
-
-    if (string(hdr.chunk_id, 4) != "MTrk")
+    TrackScanner(bool first_packet_only)
+        :
+        length(0),
+        packet_count(0),
+        has_name(false),
+        first_packet_only_(first_packet_only)
     {
-        /*  According to MIDI specification, unrecognized chunks should be
-         *  skipped. Advance the get pointer on the istream to the end of this
-         *  unknown chunk, then throw the error to indicate that this is not a
-         *  MIDITrack. */
-        is.seekg(hdr.size, istream::cur);
-        throw UnrecognizedTrackID(ex::format(
-            "Unrecognized track_id " + string(hdr.chunk_id, 4) + "at %u",
-            is.tellg()));
-    }
 
-    UInt32 end_g = (UInt32)is.tellg() + hdr.size;
+    }
 
-    MIDIPacket *p;
-    ReadMessageFunctor read_message;
-    UInt32 delta_time;
+    void open(UInt32 delta_time) { length += delta_time; }
 
-    // The first delta time will always create a new packet.
-    p = new MIDIPacket(read_variable_int(is));
-    read_message(is, p);
-    length_ = p->delta_time();
-    while (static_cast<UInt32>(is.tellg()) < end_g)
+    bool close()
     {
-        delta_time = read_variable_int(is);
-
-        if (delta_time == 0)
-        {
-            if (read_message(is, p))
-            {
-                packets_.push_back(*p);
-                break;
-            }
+        packet_count++;
+        return !first_packet_only_;
+    }
 
-        } else
+    template <class SourceT>
+    bool read_meta(SourceT &is)
+    {
+        MetaMsgPtrT meta = read_meta_message(is);
+        if (!packet_count && !has_name && meta->status() == sb::track_name)
         {
-            // Create a new packet with the new delta time.
-            length_ += delta_time;
-            packets_.push_back(*p);
-            delete p;
-            p = new MIDIPacket(delta_time);
-            if (read_message(is, p)) {
-                packets_.push_back(*p);
-                break;
-            }
+            track_name = meta->message();
+            has_name = true;
         }
+
+        return meta->status() == sb::end_of_track;
     }
 
+    void add_message(const VoiceMessage &) {}
+
+    UInt32 length;
+    UInt32 packet_count;
+    bool has_name;
+    string track_name;
+
+private:
+    bool first_packet_only_;
+};
+
+MIDITrack::MIDITrack(istream &is, UInt16 trackId)
+    :
+    track_id_(trackId)
+{
+    this->read_track(is);
+}
+
+MIDITrack::MIDITrack(ByteSpanReader &is, UInt16 trackId)
+    :
+    track_id_(trackId)
+{
+    this->read_track(is);
+}
+
+template <class SourceT>
+void MIDITrack::read_track(SourceT &is)
+{
+    UInt32 end_g = read_track_header(is);
+    PacketBuilder builder(packets_);
+    read_packets(is, end_g, builder);
+    length_ = builder.length;
+
     // Determine track name 
-    auto tname = packets_.at(0).meta_filter(sb::track_name);
+    auto tname = packets_.at(0).find_meta(sb::track_name);
     if (tname)
     {
         track_name_ = tname->message();
     }
-};
+}
+
+ROCS_CORE_API string scan_midi_track_name(ByteSpanReader &is)
+{
+    UInt32 end_g = read_track_header(is);
+    TrackScanner scanner(true);
+    read_packets(is, end_g, scanner);
+    if (!scanner.packet_count)
+    {
+        throw MIDITrackError(ex::format(
+            "Track ending at %u has no complete packets", end_g));
+    }
+
+    return scanner.track_name;
+}
+
+ROCS_CORE_API UInt32 scan_midi_track_length(ByteSpanReader &is)
+{
+    UInt32 end_g = read_track_header(is);
+    TrackScanner scanner(false);
+    read_packets(is, end_g, scanner);
+    return scanner.length;
+}
 
 void MIDITrack::WriteString(ostream& os) const
 {
@@ -145,7 +155,7 @@ void MIDITrack::WriteStringPackets(ostream &os, int indent) const
     os << string(indent, '\t');
     this->WriteString(os);
     os << endl;
-    for (auto it: this->packets_)
+    for (auto &it: this->packets_)
     {
         it.WriteString(os, indent + 1);
         os << endl;
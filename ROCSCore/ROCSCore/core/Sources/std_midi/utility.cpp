@@ -4,9 +4,8 @@ using namespace std;
 
 namespace std_midi {
 
-/*  Reads numbers stored as a VARIABLE-LENGTH QUANTITY.
-    Each byte has bit 7 set, except for the last byte.  */
-ROCS_CORE_API UInt32 read_variable_int(istream& is) // throw(StdMIDIError)
+template <class SourceT>
+static UInt32 read_variable_int_(SourceT& is) // throw(StdMIDIError)
 {
     UInt32 ret = 0;
     int count = 0;
@@ -18,11 +17,23 @@ ROCS_CORE_API UInt32 read_variable_int(istream& is) // throw(StdMIDIError)
         if (++count > 3) {
             throw StdMIDIError(
                 ex::format( "VARIABLE-LENGTH QUANTITY has more than 4 bytes at %u",
-                            is.tellg() - static_cast<istream::pos_type>(4)         )
+                            (UInt32)is.tellg() - 4                                 )
             );
         }
     }
 
     return ret;
 }
+
+/*  Reads numbers stored as a VARIABLE-LENGTH QUANTITY.
+    Each byte has bit 7 set, except for the last byte.  */
+ROCS_CORE_API UInt32 read_variable_int(istream& is) // throw(StdMIDIError)
+{
+    return read_variable_int_(is);
+}
+
+ROCS_CORE_API UInt32 read_variable_int(ByteSpanReader& is) // throw(StdMIDIError)
+{
+    return read_variable_int_(is);
+}
 }
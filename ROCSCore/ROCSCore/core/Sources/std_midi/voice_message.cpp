@@ -38,7 +38,24 @@ VoiceMessage::VoiceMessage(istream &is, Byte status)
     this->read_message(is);
 }
 
-void VoiceMessage::read_message(istream &is)
+VoiceMessage::VoiceMessage(ByteSpanReader &is)
+    :
+    status_(is.get() & 0xF0),
+    data2_(0)
+{
+    this->read_message(is);
+}
+
+VoiceMessage::VoiceMessage(ByteSpanReader &is, Byte status)
+    :
+    status_(status),
+    data2_(0)
+{
+    this->read_message(is);
+}
+
+template <class SourceT>
+void VoiceMessage::read_message(SourceT &is)
 {
     this->data1_ = is.get();
     if (!((status_ == sb::program_change) || (status_ == sb::channel_pressure)))
@@ -0,0 +1,689 @@
+#include "core/timeline/bar_grid.h"
+#include "core/timeline/midi_loaders.h" // CustomBarError
+
+#include <cmath> // modf
+#include <cctype>
+#include <cstdint> // UINT32_MAX
+#include <cstdio> // snprintf
+#include <cstdlib> // strtol
+#include <cstring>
+#include <algorithm>
+#include "exlib/binary_reader.h"
+#include "exlib/format.h"
+#include "exlib/string_lib.h"
+
+using namespace std;
+
+namespace TL
+{
+
+/* Whether label is number written the way BarsBeats writes bar numbers, i.e.
+ * whether a bar called label continues the numbering of one called
+ * number - 1. */
+static bool is_bar_number(const char *label, SInt32 number)
+{
+    char text[12];
+    snprintf(text, sizeof(text), "%d", number);
+    return strcmp(label, text) == 0;
+}
+
+/* Reads label as ex::str_is_int and ex::str_to_num do, without copying it.
+ * Returns false if label is not an integer. */
+static bool parse_bar_number(const char *label, SInt32 &number)
+{
+    const char *first = label;
+    const char *last = label + strlen(label);
+    while (first != last && isspace(static_cast<unsigned char>(*first))) first++;
+    while (last != first && isspace(static_cast<unsigned char>(*(last - 1)))) last--;
+    for (const char *it = first; it != last; it++)
+    {
+        if (!isdigit(static_cast<unsigned char>(*it))
+            && !(it == first && (*it == '-' || *it == '+')))
+        {
+            return false;
+        }
+    }
+
+    number = static_cast<SInt32>(strtol(first, nullptr, 10));
+    return true;
+}
+
+BarGrid::BarGrid(const MeterSeqT &meters, UInt16 ppqn, UInt32 songLength)
+{
+    if (!meters.size())
+    {
+        return;
+    }
+
+    UInt32 current_time = meters.front().abs_time();
+    for (size_t i = 0; i < meters.size(); i++)
+    {
+        UInt32 next_time = (i + 1 < meters.size())
+            ? meters[i + 1].abs_time()
+            : songLength + 1;
+
+        if (current_time >= next_time)
+        {
+            continue;
+        }
+
+        const Meter &meter = meters[i];
+        double intpart = 0;
+        double remainder = modf(meter.beats_per_measure(), &intpart);
+
+        MeterSegment layout;
+        layout.start = current_time;
+        layout.ticks_per_beat = meter.ticks_per_beat(ppqn);
+        layout.whole_beats = static_cast<int>(intpart);
+        layout.remainder_ticks = static_cast<int>(remainder * ppqn);
+
+        UInt32 bar_ticks = layout.bar_ticks();
+        if (!bar_ticks)
+        {
+            throw BarGridError(ex::format(
+                "Meter at %u has bars of zero length.",
+                meter.abs_time()));
+        }
+
+        UInt32 bar_count = (next_time - current_time + bar_ticks - 1) / bar_ticks;
+        this->add_bars(layout, bar_count);
+        current_time += bar_count * bar_ticks;
+    }
+
+    this->names_.push_back(make_range(0, "0"));
+}
+
+BarGrid::BarGrid(const BarsBeatsSeqT &barsBeats)
+{
+    size_t count = barsBeats.size();
+    UInt32 bar = 0;
+    for (size_t i = 0; i < count; bar++)
+    {
+        // A bar is a beat 1 and the beats that follow it.
+        size_t j = i + 1;
+        while (j < count && barsBeats[j].beat_number() != 1) j++;
+
+        UInt32 start = barsBeats[i].abs_time();
+        UInt32 beats = static_cast<UInt32>(j - i);
+        MeterSegment layout = {start, 0, 0, 0, 0, 0};
+
+        auto fits = [&](const MeterSegment &candidate)
+        {
+            for (UInt32 k = 0; k < beats; k++)
+            {
+                if (barsBeats[i + k].abs_time() != start + k * candidate.ticks_per_beat
+                    || barsBeats[i + k].beat_number() != k + 1)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        const MeterSegment *previous = this->segments_.empty() ? nullptr : &this->segments_.back();
+        if (j == count && previous && previous->end() == start
+            && previous->beats_per_bar() == beats && fits(*previous))
+        {
+            // The length of the last bar is unknown, so keep the layout of
+            // the bars before it if its beats fit.
+            layout = *previous;
+            layout.start = start;
+        } else if (beats == 1)
+        {
+            layout.whole_beats = 1;
+            layout.ticks_per_beat = (j < count)
+                ? barsBeats[j].abs_time() - start
+                : (previous ? previous->ticks_per_beat : 1);
+        } else
+        {
+            layout.ticks_per_beat = barsBeats[i + 1].abs_time() - start;
+            UInt32 last_beat = barsBeats[j - 1].abs_time();
+            UInt32 last_ticks = (j < count)
+                ? barsBeats[j].abs_time() - last_beat
+                : layout.ticks_per_beat;
+
+            if (last_ticks == layout.ticks_per_beat)
+            {
+                layout.whole_beats = beats;
+            } else
+            {
+                layout.whole_beats = beats - 1;
+                layout.remainder_ticks = last_ticks;
+            }
+        }
+
+        if (!fits(layout) || !layout.bar_ticks())
+        {
+            throw BarGridError(ex::format(
+                "BarsBeats at %u do not form a regular bar.",
+                start));
+        }
+
+        this->add_bars(layout, 1);
+
+        string name = barsBeats[i].bar_number();
+        const BarNameRange *range = this->names_.empty() ? nullptr : &this->names_.back();
+        if (!range || !range->is_int
+            || !is_bar_number(name.c_str(), range->number + (bar - range->first_bar)))
+        {
+            this->names_.push_back(make_range(bar, name));
+        }
+
+        i = j;
+    }
+}
+
+BarGrid::BarGrid(istream &is, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(is, fileVersion);
+}
+
+BarGrid::BarGrid(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+{
+    this->read_binary(reader, fileVersion);
+}
+
+void BarGrid::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void BarGrid::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class InputT>
+void BarGrid::read_binary(InputT &is, const cmn::FileVersion &)
+{
+    UInt8 event_type = is.get();
+    if (event_type != this->code())
+    {
+        throw logic_error("event_type does not match container type.");
+    }
+
+    // Files before 2.6 have no checksum, so the counts are checked against
+    // what is left before anything is allocated for them.
+    UInt32 segment_count;
+    is.read((char *)&segment_count, sizeof(segment_count));
+    if (ex::failed(is)
+        || sizeof(MeterSegment) * static_cast<size_t>(segment_count) > ex::remaining(is))
+    {
+        throw BarGridError(ex::format("Invalid BarGrid segment count %u.", segment_count));
+    }
+
+    this->segments_.resize(segment_count);
+    if (segment_count)
+    {
+        is.read((char *)&this->segments_[0], sizeof(MeterSegment) * segment_count);
+    }
+
+    UInt32 name_count;
+    is.read((char *)&name_count, sizeof(name_count));
+    if (ex::failed(is)
+        || sizeof(BarNameRange) * static_cast<size_t>(name_count) > ex::remaining(is))
+    {
+        throw BarGridError(ex::format("Invalid BarGrid name count %u.", name_count));
+    }
+
+    this->names_.resize(name_count);
+    if (name_count)
+    {
+        is.read((char *)&this->names_[0], sizeof(BarNameRange) * name_count);
+    }
+
+    if (ex::failed(is)) throw BarGridError("The BarGrid is cut short.");
+    this->check();
+}
+
+void BarGrid::check() const
+{
+    for (size_t i = 0; i < this->segments_.size(); i++)
+    {
+        const MeterSegment &segment = this->segments_[i];
+        const MeterSegment *previous = i ? &this->segments_[i - 1] : nullptr;
+        if (!segment.bar_count || !segment.bar_ticks()
+            || UInt64(segment.start) + UInt64(segment.bar_count) * segment.bar_ticks() > UINT32_MAX
+            || (previous && (segment.start < previous->end()
+                || segment.first_bar < UInt64(previous->first_bar) + previous->bar_count)))
+        {
+            throw BarGridError(ex::format("BarGrid segment %u is invalid.", i));
+        }
+    }
+
+    for (size_t i = 0; i < this->names_.size(); i++)
+    {
+        const BarNameRange &range = this->names_[i];
+        if (range.label[sizeof(range.label) - 1]
+            || (i && range.first_bar <= this->names_[i - 1].first_bar))
+        {
+            throw BarGridError(ex::format("BarGrid name range %u is invalid.", i));
+        }
+    }
+}
+
+template<class OutputT>
+void BarGrid::write_binary(OutputT &os, const cmn::FileVersion &) const
+{
+    os.put(this->code());
+    UInt32 segment_count = this->segments_.size();
+    os.write((char *)&segment_count, sizeof(segment_count));
+    if (segment_count)
+    {
+        os.write((char *)&this->segments_[0], sizeof(MeterSegment) * segment_count);
+    }
+
+    UInt32 name_count = this->names_.size();
+    os.write((char *)&name_count, sizeof(name_count));
+    if (name_count)
+    {
+        os.write((char *)&this->names_[0], sizeof(BarNameRange) * name_count);
+    }
+}
+
+void BarGrid::WriteString(ostream &os) const
+{
+    os  << "BarGrid("
+        << "segment_count=" << this->segments_.size() << ", "
+        << "name_range_count=" << this->names_.size() << ", "
+        << "bar_count=" << this->GetBarCount() << ", "
+        << "beat_count=" << this->GetBeatCount()
+        << ")";
+}
+
+BarNameRange BarGrid::make_range(UInt32 first_bar, const string &label)
+{
+    if (label.size() > 7)
+    {
+        throw BarNameLengthError("bar number " + label + " is longer than 7 characters.");
+    }
+
+    BarNameRange range;
+    memset(&range, 0, sizeof(range));
+    range.first_bar = first_bar;
+    strncpy(range.label, label.c_str(), sizeof(range.label) - 1);
+    range.is_int = parse_bar_number(range.label, range.number);
+    return range;
+}
+
+void BarGrid::add_bars(const MeterSegment &layout, UInt32 bar_count)
+{
+    if (!bar_count)
+    {
+        return;
+    }
+
+    if (!this->segments_.empty())
+    {
+        MeterSegment &last = this->segments_.back();
+        if (last.end() == layout.start
+            && last.ticks_per_beat == layout.ticks_per_beat
+            && last.whole_beats == layout.whole_beats
+            && last.remainder_ticks == layout.remainder_ticks)
+        {
+            last.bar_count += bar_count;
+            return;
+        }
+    }
+
+    MeterSegment segment = layout;
+    segment.first_bar = this->GetBarCount();
+    segment.bar_count = bar_count;
+    this->segments_.push_back(segment);
+}
+
+void BarGrid::RenameBars(const CL::CustomBarSeqT &customBars, const string &filename)
+{
+    this->names_.clear();
+    this->names_.push_back(make_range(0, "0"));
+    if (!customBars.size())
+    {
+        return;
+    }
+
+    UInt32 bar_count = this->GetBarCount();
+    UInt32 next_bar = 0;
+    string current;
+    bool current_is_int = true;
+
+    for (size_t i = 0; i < customBars.size(); i++)
+    {
+        const CL::CustomBar &customBar = customBars[i];
+        UInt32 tick = customBar.abs_time();
+
+        // The CustomBar must be on the first beat of a bar that has not been
+        // named yet.
+        bool aligned = false;
+        UInt32 bar = 0;
+        if (!this->empty() && tick >= this->segments_.front().start)
+        {
+            const MeterSegment &segment = this->segments_[this->segment_at_tick(tick)];
+            UInt32 offset = tick - segment.start;
+            bar = segment.first_bar + offset / segment.bar_ticks();
+            aligned = !(offset % segment.bar_ticks())
+                && offset / segment.bar_ticks() < segment.bar_count
+                && (!i || bar >= next_bar);
+        }
+
+        if (!aligned)
+        {
+            throw CustomBarError(ex::format(
+                "CustomBar %s at %d in %s does not align with measure boundary",
+                customBar.value().c_str(),
+                customBar.abs_time(),
+                filename.c_str()));
+        }
+
+        if (i && bar > next_bar && !current_is_int)
+        {
+            /* A non-integer CustomBar was not followed by another CustomBar,
+             * so I do not know which integer value to start numbering from. */
+            throw CustomBarError(ex::format(
+                "%s %s at %d in %s. Next CustomBar: %s at %u",
+                "Expected CustomBar not found following",
+                current.c_str(),
+                this->TickOf(next_bar, 1),
+                filename.c_str(),
+                customBar.value().c_str(),
+                tick));
+        }
+
+        current = customBar.value();
+        BarNameRange &last = this->names_.back();
+        if (bar == last.first_bar)
+        {
+            last = make_range(bar, current);
+        } else if (!last.is_int
+                   || !is_bar_number(current.c_str(), last.number + (bar - last.first_bar)))
+        {
+            this->names_.push_back(make_range(bar, current));
+        }
+
+        // The bar numbers that follow are counted from the range, rather
+        // than by converting each name.
+        current_is_int = this->names_.back().is_int != 0;
+
+        next_bar = bar + 1;
+    }
+
+    if (next_bar < bar_count && !current_is_int)
+    {
+        throw CustomBarError(ex::format(
+            "Expected CustomBar not found following %s at %d in %s",
+            current.c_str(),
+            this->TickOf(next_bar, 1),
+            filename.c_str()));
+    }
+}
+
+UInt32 BarGrid::GetBarCount() const
+{
+    if (this->segments_.empty()) return 0;
+    return this->segments_.back().first_bar + this->segments_.back().bar_count;
+}
+
+UInt32 BarGrid::GetBeatCount() const
+{
+    UInt32 beats = 0;
+    for (auto &segment: this->segments_)
+    {
+        beats += segment.bar_count * segment.beats_per_bar();
+    }
+
+    return beats;
+}
+
+size_t BarGrid::segment_at_tick(UInt32 tick) const
+{
+    auto it = upper_bound(
+        this->segments_.begin(),
+        this->segments_.end(),
+        tick,
+        [] (UInt32 value, const MeterSegment &segment)
+        {
+            return value < segment.start;
+        });
+
+    return it == this->segments_.begin() ? 0 : (it - this->segments_.begin()) - 1;
+}
+
+size_t BarGrid::segment_of_bar(UInt32 bar) const
+{
+    auto it = upper_bound(
+        this->segments_.begin(),
+        this->segments_.end(),
+        bar,
+        [] (UInt32 value, const MeterSegment &segment)
+        {
+            return value < segment.first_bar;
+        });
+
+    return it == this->segments_.begin() ? 0 : (it - this->segments_.begin()) - 1;
+}
+
+size_t BarGrid::range_of_bar(UInt32 bar) const
+{
+    auto it = upper_bound(
+        this->names_.begin(),
+        this->names_.end(),
+        bar,
+        [] (UInt32 value, const BarNameRange &range)
+        {
+            return value < range.first_bar;
+        });
+
+    return it == this->names_.begin() ? 0 : (it - this->names_.begin()) - 1;
+}
+
+BarBeatPosition BarGrid::BarBeatAt(UInt32 tick) const
+{
+    if (this->empty())
+    {
+        throw BarGridError("BarBeatAt called on an empty BarGrid.");
+    }
+
+    const MeterSegment &segment = this->segments_[this->segment_at_tick(tick)];
+    BarBeatPosition position = {segment.first_bar, 1, segment.start};
+    if (tick < segment.start)
+    {
+        return position;
+    }
+
+    UInt32 offset = tick - segment.start;
+    UInt32 bar = min(offset / segment.bar_ticks(), segment.bar_count - 1);
+    offset -= bar * segment.bar_ticks();
+    UInt32 beat = segment.ticks_per_beat ? offset / segment.ticks_per_beat : 0;
+    beat = min(beat, segment.beats_per_bar() - 1);
+
+    position.bar = segment.first_bar + bar;
+    position.beat = beat + 1;
+    position.abs_time = segment.start + bar * segment.bar_ticks() + beat * segment.ticks_per_beat;
+    return position;
+}
+
+UInt32 BarGrid::TickOf(UInt32 bar, UInt32 beat) const
+{
+    if (bar >= this->GetBarCount())
+    {
+        throw BarGridError(ex::format("Bar %u is past the end of the BarGrid.", bar));
+    }
+
+    const MeterSegment &segment = this->segments_[this->segment_of_bar(bar)];
+    if (beat < 1 || beat > segment.beats_per_bar())
+    {
+        throw BarGridError(ex::format("Bar %u has no beat %u.", bar, beat));
+    }
+
+    return segment.start
+        + (bar - segment.first_bar) * segment.bar_ticks()
+        + (beat - 1) * segment.ticks_per_beat;
+}
+
+bool BarGrid::NextBeat(UInt32 tick, UInt32 &nextTick) const
+{
+    if (this->empty())
+    {
+        return false;
+    }
+
+    if (tick < this->segments_.front().start)
+    {
+        nextTick = this->segments_.front().start;
+        return true;
+    }
+
+    BarBeatPosition position = this->BarBeatAt(tick);
+    const MeterSegment &segment = this->segments_[this->segment_of_bar(position.bar)];
+    if (position.beat < segment.beats_per_bar())
+    {
+        nextTick = this->TickOf(position.bar, position.beat + 1);
+    } else if (position.bar + 1 < this->GetBarCount())
+    {
+        nextTick = this->TickOf(position.bar + 1, 1);
+    } else
+    {
+        return false;
+    }
+
+    return nextTick > tick;
+}
+
+string BarGrid::BarName(UInt32 bar) const
+{
+    return string(this->GetBarLabel(bar).label);
+}
+
+BarLabel BarGrid::GetBarLabel(UInt32 bar) const
+{
+    BarLabel result;
+    if (this->names_.empty())
+    {
+        result.number = static_cast<SInt32>(bar);
+        result.is_int = true;
+        snprintf(result.label, sizeof(result.label), "%d", result.number);
+        return result;
+    }
+
+    const BarNameRange &range = this->names_[this->range_of_bar(bar)];
+    result.is_int = range.is_int != 0;
+    if (bar == range.first_bar || !range.is_int)
+    {
+        memcpy(result.label, range.label, sizeof(range.label));
+        result.label[sizeof(range.label)] = '\0';
+        result.number = range.number;
+        return result;
+    }
+
+    result.number = range.number + static_cast<SInt32>(bar - range.first_bar);
+    snprintf(result.label, sizeof(result.label), "%d", result.number);
+    return result;
+}
+
+bool BarGrid::FindBar(const string &name, UInt32 &bar) const
+{
+    UInt32 bar_count = this->GetBarCount();
+    SInt32 number = 0;
+    bool is_int = parse_bar_number(name.c_str(), number);
+    for (size_t i = 0; i < this->names_.size(); i++)
+    {
+        const BarNameRange &range = this->names_[i];
+        UInt32 end = (i + 1 < this->names_.size()) ? this->names_[i + 1].first_bar : bar_count;
+        if (range.first_bar >= end)
+        {
+            continue;
+        }
+
+        if (name == range.label)
+        {
+            bar = range.first_bar;
+            return true;
+        }
+
+        if (is_int && range.is_int && number > range.number
+            && static_cast<UInt32>(number - range.number) < end - range.first_bar
+            && is_bar_number(name.c_str(), number))
+        {
+            bar = range.first_bar + (number - range.number);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void BarGrid::ExpandTo(BarsBeatsSeqT &barsBeats) const
+{
+    for (auto &segment: this->segments_)
+    {
+        UInt32 bar_start = segment.start;
+        for (UInt32 bar = segment.first_bar; bar < segment.first_bar + segment.bar_count; bar++)
+        {
+            string name = this->BarName(bar);
+            for (UInt32 beat = 0; beat < segment.beats_per_bar(); beat++)
+            {
+                barsBeats.push_back(BarsBeats(
+                    bar_start + beat * segment.ticks_per_beat,
+                    name,
+                    beat + 1));
+            }
+
+            bar_start += segment.bar_ticks();
+        }
+    }
+}
+
+void BarGrid::ExpandBeatTicks(vector<UInt32> &ticks) const
+{
+    ticks.reserve(ticks.size() + this->GetBeatCount());
+    for (auto &segment: this->segments_)
+    {
+        UInt32 bar_start = segment.start;
+        for (UInt32 bar = 0; bar < segment.bar_count; bar++)
+        {
+            for (UInt32 beat = 0; beat < segment.beats_per_bar(); beat++)
+            {
+                ticks.push_back(bar_start + beat * segment.ticks_per_beat);
+            }
+
+            bar_start += segment.bar_ticks();
+        }
+    }
+}
+
+bool BarGrid::operator==(const BarGrid &other) const
+{
+    if (this->segments_.size() != other.segments_.size()) return false;
+    if (this->names_.size() != other.names_.size()) return false;
+    for (size_t i = 0; i < this->segments_.size(); i++)
+    {
+        const MeterSegment &lhs = this->segments_[i];
+        const MeterSegment &rhs = other.segments_[i];
+        if (lhs.start != rhs.start
+            || lhs.first_bar != rhs.first_bar
+            || lhs.bar_count != rhs.bar_count
+            || lhs.ticks_per_beat != rhs.ticks_per_beat
+            || lhs.whole_beats != rhs.whole_beats
+            || lhs.remainder_ticks != rhs.remainder_ticks)
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < this->names_.size(); i++)
+    {
+        const BarNameRange &lhs = this->names_[i];
+        const BarNameRange &rhs = other.names_[i];
+        if (lhs.first_bar != rhs.first_bar
+            || lhs.number != rhs.number
+            || lhs.is_int != rhs.is_int
+            || strcmp(lhs.label, rhs.label) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // end namespace TL
@@ -0,0 +1,325 @@
+#include "core/timeline/tempo_map.h"
+#include "core/timeline/timeline.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace TL
+{
+
+const UInt32 TempoMap::default_microseconds = 500000;
+
+TempoMap::TempoMap()
+    :
+    ppqn_(0)
+{
+
+}
+
+TempoMap::TempoMap(const TempoSeqT &tempos, UInt16 ppqn)
+    :
+    ppqn_(ppqn)
+{
+    this->set_tempos(tempos);
+    this->rebuild_from(0);
+}
+
+TempoMap::TempoMap(
+    const TempoSeqT &tempos,
+    const CL::TempoScaleSeqT &tempoScales,
+    UInt16 ppqn)
+    :
+    ppqn_(ppqn)
+{
+    this->set_tempos(tempos);
+    this->scales_ = make_scales(tempoScales);
+    this->rebuild_from(0);
+}
+
+TempoMap::TempoMap(
+    const Timeline &timeline,
+    const CL::TempoScaleSeqT &tempoScales,
+    UInt16 ppqn)
+    :
+    ppqn_(ppqn)
+{
+    this->set_tempos(timeline.GetTempos());
+    this->scales_ = make_scales(tempoScales);
+    this->rebuild_from(0);
+}
+
+void TempoMap::set_tempos(const TempoSeqT &tempos)
+{
+    if (!this->ppqn_)
+    {
+        throw TimelineException("TempoMap requires a non-zero ppqn.");
+    }
+
+    double ppqn = static_cast<double>(this->ppqn_);
+    this->tempos_.clear();
+    this->tempos_.reserve(tempos.size() + 1);
+    if (!tempos.size() || tempos.front().abs_time() > 0)
+    {
+        TempoPoint point = {0, default_microseconds / ppqn};
+        this->tempos_.push_back(point);
+    }
+
+    for (auto &tempo: tempos)
+    {
+        TempoPoint point = {tempo.abs_time(), tempo.microseconds() / ppqn};
+        this->tempos_.push_back(point);
+    }
+}
+
+vector<TempoMap::ScaleRange> TempoMap::make_scales(const CL::TempoScaleSeqT &tempoScales)
+{
+    vector<ScaleRange> scales;
+    scales.reserve(tempoScales.size());
+    for (auto &scale: tempoScales)
+    {
+        if (scale.float_value() <= 0 || scale.end() <= scale.start()) continue;
+        ScaleRange range = {scale.start(), scale.end(), scale.float_value()};
+        scales.push_back(range);
+    }
+
+    sort(
+        scales.begin(),
+        scales.end(),
+        [] (const ScaleRange &lhs, const ScaleRange &rhs)
+        {
+            if (lhs.start != rhs.start) return lhs.start < rhs.start;
+            if (lhs.end != rhs.end) return lhs.end < rhs.end;
+            return lhs.value < rhs.value;
+        });
+
+    return scales;
+}
+
+void TempoMap::SetTempoScales(const CL::TempoScaleSeqT &tempoScales)
+{
+    vector<ScaleRange> scales = make_scales(tempoScales);
+
+    // Both lists are sorted by start, so the scaling of every tick before the
+    // first differing range is unchanged.
+    size_t i = 0;
+    while (i < scales.size() && i < this->scales_.size()
+           && scales[i].start == this->scales_[i].start
+           && scales[i].end == this->scales_[i].end
+           && scales[i].value == this->scales_[i].value)
+    {
+        i++;
+    }
+
+    if (i == scales.size() && i == this->scales_.size())
+    {
+        return;
+    }
+
+    UInt32 changed;
+    if (i == scales.size())
+    {
+        changed = this->scales_[i].start;
+    } else if (i == this->scales_.size())
+    {
+        changed = scales[i].start;
+    } else
+    {
+        changed = min(scales[i].start, this->scales_[i].start);
+    }
+
+    this->scales_.swap(scales);
+    this->rebuild_from(changed);
+}
+
+/* Rebuilds the segments that start at or after the start of the segment
+ * containing tick, keeping the elapsed time of everything before it. */
+void TempoMap::rebuild_from(UInt32 tick)
+{
+    if (this->tempos_.empty())
+    {
+        return;
+    }
+
+    UInt32 from = 0;
+    if (!this->segments_.empty())
+    {
+        size_t index = this->segment_at_tick(tick);
+        from = this->segments_[index].start;
+        this->segments_.erase(this->segments_.begin() + index, this->segments_.end());
+    }
+
+    vector<UInt32> boundaries;
+    boundaries.push_back(from);
+    for (auto &tempo: this->tempos_)
+    {
+        if (tempo.abs_time > from) boundaries.push_back(tempo.abs_time);
+    }
+
+    for (auto &scale: this->scales_)
+    {
+        if (scale.start > from) boundaries.push_back(scale.start);
+        if (scale.end > from) boundaries.push_back(scale.end);
+    }
+
+    sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    auto tempo_it = this->tempos_.begin();
+    for (UInt32 boundary: boundaries)
+    {
+        while (tempo_it + 1 != this->tempos_.end() && (tempo_it + 1)->abs_time <= boundary)
+        {
+            tempo_it++;
+        }
+
+        double scale = 1.0;
+        for (auto &range: this->scales_)
+        {
+            if (range.start > boundary) break;
+            if (boundary < range.end) scale *= range.value;
+        }
+
+        double micros_per_tick = tempo_it->micros_per_tick / scale;
+        if (this->segments_.empty())
+        {
+            TempoSegment segment = {boundary, 0.0, micros_per_tick};
+            this->segments_.push_back(segment);
+            continue;
+        }
+
+        const TempoSegment &last = this->segments_.back();
+        if (last.micros_per_tick == micros_per_tick)
+        {
+            continue;
+        }
+
+        TempoSegment segment = {
+            boundary,
+            last.start_micros + (boundary - last.start) * last.micros_per_tick,
+            micros_per_tick};
+        this->segments_.push_back(segment);
+    }
+}
+
+size_t TempoMap::segment_at_tick(double tick) const
+{
+    auto it = upper_bound(
+        this->segments_.begin(),
+        this->segments_.end(),
+        tick,
+        [] (double value, const TempoSegment &segment)
+        {
+            return value < segment.start;
+        });
+
+    return it == this->segments_.begin() ? 0 : (it - this->segments_.begin()) - 1;
+}
+
+size_t TempoMap::segment_at_micros(double micros) const
+{
+    auto it = upper_bound(
+        this->segments_.begin(),
+        this->segments_.end(),
+        micros,
+        [] (double value, const TempoSegment &segment)
+        {
+            return value < segment.start_micros;
+        });
+
+    return it == this->segments_.begin() ? 0 : (it - this->segments_.begin()) - 1;
+}
+
+size_t TempoMap::advance_tick(size_t index, double tick) const
+{
+    if (tick < this->segments_[index].start)
+    {
+        return this->segment_at_tick(tick);
+    }
+
+    while (index + 1 < this->segments_.size() && this->segments_[index + 1].start <= tick)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+size_t TempoMap::advance_micros(size_t index, double micros) const
+{
+    if (micros < this->segments_[index].start_micros)
+    {
+        return this->segment_at_micros(micros);
+    }
+
+    while (index + 1 < this->segments_.size()
+           && this->segments_[index + 1].start_micros <= micros)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+double TempoMap::TickToMicros(double tick) const
+{
+    if (this->segments_.empty()) return 0.0;
+    const TempoSegment &segment = this->segments_[this->segment_at_tick(tick)];
+    return segment.start_micros + (tick - segment.start) * segment.micros_per_tick;
+}
+
+double TempoMap::MicrosToTick(double micros) const
+{
+    if (this->segments_.empty()) return 0.0;
+    const TempoSegment &segment = this->segments_[this->segment_at_micros(micros)];
+    return segment.start + (micros - segment.start_micros) / segment.micros_per_tick;
+}
+
+void TempoMap::TickToMicros(const vector<UInt32> &ticks, vector<double> &micros) const
+{
+    micros.resize(ticks.size());
+    if (this->segments_.empty())
+    {
+        fill(micros.begin(), micros.end(), 0.0);
+        return;
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        index = this->advance_tick(index, ticks[i]);
+        const TempoSegment &segment = this->segments_[index];
+        micros[i] = segment.start_micros
+            + (static_cast<double>(ticks[i]) - segment.start) * segment.micros_per_tick;
+    }
+}
+
+void TempoMap::MicrosToTick(const vector<double> &micros, vector<double> &ticks) const
+{
+    ticks.resize(micros.size());
+    if (this->segments_.empty())
+    {
+        fill(ticks.begin(), ticks.end(), 0.0);
+        return;
+    }
+
+    size_t index = 0;
+    for (size_t i = 0; i < micros.size(); i++)
+    {
+        index = this->advance_micros(index, micros[i]);
+        const TempoSegment &segment = this->segments_[index];
+        ticks[i] = segment.start + (micros[i] - segment.start_micros) / segment.micros_per_tick;
+    }
+}
+
+void TempoMap::WriteString(ostream &os) const
+{
+    os  << "TempoMap("
+        << "ppqn=" << this->ppqn_ << ", "
+        << "tempo_count=" << this->tempos_.size() << ", "
+        << "scale_count=" << this->scales_.size() << ", "
+        << "segment_count=" << this->segments_.size()
+        << ")";
+}
+
+} // end namespace TL
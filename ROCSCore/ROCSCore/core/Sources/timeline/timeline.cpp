@@ -1,5 +1,9 @@
 #include "core/timeline/timeline.h"
 #include "exlib/cout_buffer.h"
+
+#include <cstdlib> // strtol
+#include <cstring>
+
 using namespace std;
 
 namespace TL
@@ -15,7 +19,9 @@ Timeline::Timeline()
     bars_beats_(BarsBeatsSeqPtrT(new BarsBeatsSeqT())),
     keys_(KeySeqPtrT(new KeySeqT())),
     page_nums_(PageNumSeqPtrT(new PageNumSeqT())),
-    meters_(MeterSeqPtrT(new MeterSeqT()))
+    meters_(MeterSeqPtrT(new MeterSeqT())),
+    bar_grid_(BarGridPtrT(new BarGrid())),
+    bars_beats_mutex_(new std::mutex())
 {
     this->make_all_seqs();
 }
@@ -31,7 +37,9 @@ Timeline::Timeline(const Timeline& other)
     bars_beats_(other.bars_beats_),
     keys_(other.keys_),
     page_nums_(other.page_nums_),
-    meters_(other.meters_)
+    meters_(other.meters_),
+    bar_grid_(other.bar_grid_),
+    bars_beats_mutex_(other.bars_beats_mutex_)
 {
     this->make_all_seqs();
 }
@@ -49,12 +57,15 @@ Timeline& Timeline::operator=(const Timeline& other)
     this->keys_.reset();
     this->page_nums_.reset();
     this->meters_.reset();
+    this->bar_grid_.reset();
 
     this->tempos_ = other.tempos_;
     this->bars_beats_ = other.bars_beats_;
     this->keys_ = other.keys_;
     this->page_nums_ = other.page_nums_;
     this->meters_ = other.meters_;
+    this->bar_grid_ = other.bar_grid_;
+    this->bars_beats_mutex_ = other.bars_beats_mutex_;
    
     this->all_seqs_.clear();
     this->make_all_seqs();
@@ -63,6 +74,25 @@ Timeline& Timeline::operator=(const Timeline& other)
 }
 
 Timeline::Timeline(istream &is, const cmn::FileVersion &fileVersion)
+    :
+    bars_beats_(new BarsBeatsSeqT()),
+    bar_grid_(new BarGrid()),
+    bars_beats_mutex_(new std::mutex())
+{
+    this->read_binary(is, fileVersion);
+}
+
+Timeline::Timeline(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    :
+    bars_beats_(new BarsBeatsSeqT()),
+    bar_grid_(new BarGrid()),
+    bars_beats_mutex_(new std::mutex())
+{
+    this->read_binary(reader, fileVersion);
+}
+
+template<class InputT>
+void Timeline::read_binary(InputT &is, const cmn::FileVersion &fileVersion)
 {
     if (fileVersion >= cmn::FileVersion(2, 0))
     {   
@@ -82,6 +112,17 @@ Timeline::Timeline(istream &is, const cmn::FileVersion &fileVersion)
                 break;
             case codes::bars_beats:
                 this->bars_beats_ = BarsBeatsSeqPtrT(new BarsBeatsSeqT(is, fileVersion));
+                try
+                {
+                    this->bar_grid_ = BarGridPtrT(new BarGrid(*this->bars_beats_));
+                } catch (BarGridError& e)
+                {
+                    // Keep the BarsBeats as they are, without a BarGrid.
+                    warnings << e.what() << endl;
+                }
+                break;
+            case codes::bar_grid:
+                this->bar_grid_ = BarGridPtrT(new BarGrid(is, fileVersion));
                 break;
             case codes::key:
                 this->keys_ = KeySeqPtrT(new KeySeqT(is, fileVersion));
@@ -96,7 +137,7 @@ Timeline::Timeline(istream &is, const cmn::FileVersion &fileVersion)
                 throw UnknownSequenceType(
                     ex::format( "Timeline found unknown event code: %#X at %u",
                                 is.peek(),
-                                is.tellg()));
+                                static_cast<unsigned>(is.tellg())));
         }
     }
 
@@ -114,7 +155,9 @@ Timeline::Timeline(const std_midi::MIDIFile& midiFile)
     bars_beats_(new BarsBeatsSeqT()),
     keys_(new KeySeqT()),
     page_nums_(new PageNumSeqT()),
-    meters_(new MeterSeqT())
+    meters_(new MeterSeqT()),
+    bar_grid_(new BarGrid()),
+    bars_beats_mutex_(new std::mutex())
 {
     /* The conductor track must specify the following at abs_time 0:
             Key, Tempo, Meter */
@@ -173,7 +216,7 @@ Timeline::Timeline(const std_midi::MIDIFile& midiFile)
 
     try
     {
-        create_bars_beats(midiFile, meters_, bars_beats_);
+        this->bar_grid_ = create_bar_grid(midiFile, *meters_);
     } catch (CL::ArgError& e)
     {
         throw CL::ArgError(ex::format(
@@ -209,6 +252,7 @@ void Timeline::WriteStringDetailed(ostream &os, int indent) const
     os << string(indent, '\t');
     this->WriteString(os);
     os << endl;
+    this->expand_bars_beats();
     for (auto it : this->all_seqs_)
     {
         it->WriteStringEvents(os, indent+1);
@@ -216,6 +260,17 @@ void Timeline::WriteStringDetailed(ostream &os, int indent) const
 }
 
 void Timeline::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(os, fileVersion);
+}
+
+void Timeline::WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const
+{
+    this->write_binary(writer, fileVersion);
+}
+
+template<class OutputT>
+void Timeline::write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const
 {
     if (fileVersion >= cmn::FileVersion(2, 0))
     {
@@ -225,11 +280,101 @@ void Timeline::WriteBinary(ostream &os, const cmn::FileVersion &fileVersion) con
         ex::write(os, this->audioEndTicks_);
     }
 
+    // BarsBeats that have been expanded may have been changed since, so the
+    // BarGrid is made again from them.  If they no longer make one, they are
+    // written as they are.
+    BarGridPtrT barGrid = this->bar_grid_;
+    if (fileVersion >= cmn::FileVersion(2, 1) && this->has_bars_beats())
+    {
+        try
+        {
+            barGrid = BarGridPtrT(new BarGrid(*this->bars_beats_));
+        } catch (BarGridError&)
+        {
+            barGrid = BarGridPtrT(new BarGrid());
+        }
+    }
+
+    if (fileVersion < cmn::FileVersion(2, 1) || barGrid->empty())
+    {
+        this->expand_bars_beats();
+        os.put(this->all_seqs_.size());
+        for (auto it: this->all_seqs_)
+        {
+            it->WriteBinary(os, fileVersion);
+        }
+
+        return;
+    }
+
+    // The BarGrid takes the place of the BarsBeats.
     os.put(this->all_seqs_.size());
     for (auto it: this->all_seqs_)
     {
-        it->WriteBinary(os, fileVersion);
+        if (it == this->bars_beats_)
+        {
+            barGrid->WriteBinary(os, fileVersion);
+        } else
+        {
+            it->WriteBinary(os, fileVersion);
+        }
+    }
+}
+
+BarsBeatsSeqT& Timeline::GetBarsBeats()
+{
+    this->expand_bars_beats();
+    return *this->bars_beats_;
+}
+
+const BarsBeatsSeqT& Timeline::GetBarsBeats() const
+{
+    this->expand_bars_beats();
+    return *this->bars_beats_;
+}
+
+const cmn::ROCSSeqPtrVecT& Timeline::GetAllSequences() const
+{
+    this->expand_bars_beats();
+    return this->all_seqs_;
+}
+
+BarLabel Timeline::BarLabelAt(UInt32 tick) const
+{
+    if (!this->bar_grid_->empty())
+    {
+        return this->bar_grid_->GetBarLabel(this->bar_grid_->BarBeatAt(tick).bar);
+    }
+
+    // Only BarsBeats that could not be made into a BarGrid get here.
+    BarLabel result;
+    memset(&result, 0, sizeof(result));
+    const BarsBeats *barsBeats = this->bars_beats_->At(tick);
+    if (barsBeats)
+    {
+        strncpy(result.label, barsBeats->bar_number_c_str(), sizeof(result.label) - 1);
+        char *end = nullptr;
+        long number = strtol(result.label, &end, 10);
+        result.is_int = result.label[0] && !*end;
+        result.number = result.is_int ? static_cast<SInt32>(number) : 0;
     }
+
+    return result;
+}
+
+void Timeline::expand_bars_beats() const
+{
+    std::lock_guard<std::mutex> lock(*this->bars_beats_mutex_);
+    if (!this->bars_beats_->size() && !this->bar_grid_->empty())
+    {
+        this->bar_grid_->ExpandTo(*this->bars_beats_);
+    }
+}
+
+bool Timeline::has_bars_beats() const
+{
+    std::lock_guard<std::mutex> lock(*this->bars_beats_mutex_);
+    return this->bars_beats_->size() != 0;
 }
 
 void Timeline::make_all_seqs()
@@ -303,7 +448,12 @@ UInt32 Timeline::GetBarOne(unsigned int pulsesPerQuarterNote) const
 ROCS_CORE_API bool operator==(const Timeline &lhs, const Timeline &rhs)
 {
     if (!(lhs.GetTempos() == rhs.GetTempos())) return false;
-    if (lhs.GetBarsBeats() != rhs.GetBarsBeats()) return false;
+    // Until either side's BarsBeats are expanded, the BarGrids are all
+    // there is to compare.
+    if (lhs.has_bars_beats() || rhs.has_bars_beats())
+    {
+        if (lhs.GetBarsBeats() != rhs.GetBarsBeats()) return false;
+    } else if (lhs.GetBarGrid() != rhs.GetBarGrid()) return false;
     if (lhs.GetKeys() != rhs.GetKeys()) return false;
     if (lhs.GetPageNums() != rhs.GetPageNums()) return false;
     return lhs.GetMeters() == rhs.GetMeters();
@@ -0,0 +1,95 @@
+#include "core/timeline/timeline_cursor.h"
+
+#include <cstring>
+
+using namespace std;
+
+namespace TL
+{
+
+TimelineCursor::TimelineCursor(const Timeline &timeline)
+    :
+    timeline_(timeline),
+    tick_(0),
+    barsBeats_(0)
+{
+    memset(&this->barBeat_, 0, sizeof(this->barBeat_));
+    memset(&this->barLabel_, 0, sizeof(this->barLabel_));
+    this->Seek(0);
+}
+
+void TimelineCursor::Seek(UInt32 tick)
+{
+    this->tick_ = tick;
+    this->tempo_ = this->timeline_.GetTempos().IndexAt(tick);
+    this->key_ = this->timeline_.GetKeys().IndexAt(tick);
+    this->meter_ = this->timeline_.GetMeters().IndexAt(tick);
+    this->page_ = this->timeline_.GetPageNums().IndexAt(tick);
+    this->update_bar(true);
+}
+
+void TimelineCursor::Advance(UInt32 tick)
+{
+    if (tick < this->tick_)
+    {
+        this->Seek(tick);
+        return;
+    }
+
+    this->tick_ = tick;
+    this->tempo_ = advance(this->timeline_.GetTempos(), this->tempo_, tick);
+    this->key_ = advance(this->timeline_.GetKeys(), this->key_, tick);
+    this->meter_ = advance(this->timeline_.GetMeters(), this->meter_, tick);
+    this->page_ = advance(this->timeline_.GetPageNums(), this->page_, tick);
+    this->update_bar(false);
+}
+
+/* index is the result of IndexAt for an earlier tick, so it is either
+ * seq.size(), when that tick was before the first event, or the index of an
+ * event at or before tick. */
+template <class SeqT>
+size_t TimelineCursor::advance(const SeqT &seq, size_t index, UInt32 tick)
+{
+    if (index == seq.size())
+    {
+        if (!seq.size() || seq[0].abs_time() > tick) return index;
+        index = 0;
+    }
+
+    while (index + 1 < seq.size() && seq[index + 1].abs_time() <= tick)
+    {
+        index++;
+    }
+
+    return index;
+}
+
+void TimelineCursor::update_bar(bool seek)
+{
+    const BarGrid &grid = this->timeline_.GetBarGrid();
+    if (grid.empty())
+    {
+        // A Timeline whose BarsBeats could not be made into a BarGrid.
+        const BarsBeatsSeqT &barsBeats = this->timeline_.GetBarsBeats();
+        size_t index = seek
+            ? barsBeats.IndexAt(this->tick_)
+            : advance(barsBeats, this->barsBeats_, this->tick_);
+
+        if (seek || index != this->barsBeats_)
+        {
+            this->barLabel_ = this->timeline_.BarLabelAt(this->tick_);
+        }
+
+        this->barsBeats_ = index;
+        return;
+    }
+
+    UInt32 bar = this->barBeat_.bar;
+    this->barBeat_ = grid.BarBeatAt(this->tick_);
+    if (seek || bar != this->barBeat_.bar)
+    {
+        this->barLabel_ = grid.GetBarLabel(this->barBeat_.bar);
+    }
+}
+
+} // end namespace TL
@@ -0,0 +1,80 @@
+#pragma once
+
+/**
+    A small harness for the benchmarks behind the speedups the change log
+    claims.  Each benchmark is a function defined with ROCS_BENCHMARK.
+    core_bench runs the ones whose names contain one of its arguments, or all
+    of them, and each prints its own lines.  Build with DEBUG=0 to time what
+    ships.
+
+    The allocations are counted by the test binary's replacement operator
+    new, which core_bench links as well.
+**/
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include "core/test/allocation_counter.h"
+
+namespace bench
+{
+
+typedef void (*BenchmarkFuncT)();
+
+/* Adds func to the benchmarks core_bench can run. */
+int Register(const char *name, BenchmarkFuncT func);
+
+/* Keeps the compiler from dropping work whose result is not used. */
+void Keep(const void *p);
+
+struct Measurement
+{
+    double ms;
+    size_t allocations;
+};
+
+/* The fastest of repeats calls of func, with the allocations it made. */
+template<class FuncT>
+Measurement Measure(FuncT func, int repeats = 5)
+{
+    Measurement best = { 0, 0 };
+    for (int i = 0; i < repeats; i++)
+    {
+        AllocationCounter counter;
+        auto start = std::chrono::steady_clock::now();
+        func();
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (!i || elapsed.count() < best.ms)
+        {
+            best.ms = elapsed.count();
+            best.allocations = counter.count();
+        }
+    }
+
+    return best;
+}
+
+/* Prints one line of results. */
+void Report(const std::string &label, const Measurement &measurement);
+
+/* Prints one line giving a size in bytes. */
+void ReportBytes(const std::string &label, size_t bytes);
+
+/* The bytes make() allocates and keeps, while what it returns is alive. */
+template<class MakeT>
+size_t RetainedBytes(MakeT make)
+{
+    size_t before = liveAllocationBytes;
+    auto made = make();
+    size_t after = liveAllocationBytes;
+    Keep(&made);
+    return after - before;
+}
+
+} // end namespace bench
+
+#define ROCS_BENCHMARK(name) \
+    static void name##_benchmark(); \
+    static int name##_registered = bench::Register(#name, name##_benchmark); \
+    static void name##_benchmark()
@@ -0,0 +1,67 @@
+#include "core/bench/bench.h"
+
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+
+typedef std::vector<std::pair<const char *, BenchmarkFuncT> > BenchmarkVecT;
+
+// Made on first use, since the benchmarks register before main.
+static BenchmarkVecT& benchmarks()
+{
+    static BenchmarkVecT registered;
+    return registered;
+}
+
+int Register(const char *name, BenchmarkFuncT func)
+{
+    benchmarks().push_back(std::make_pair(name, func));
+    return static_cast<int>(benchmarks().size());
+}
+
+// Written by Keep and never read; being volatile, the writes still happen.
+const void *volatile kept;
+
+void Keep(const void *p)
+{
+    kept = p;
+}
+
+void Report(const std::string &label, const Measurement &measurement)
+{
+    std::printf(
+        "  %-44s %10.3f ms %10zu allocations\n",
+        label.c_str(),
+        measurement.ms,
+        measurement.allocations);
+}
+
+void ReportBytes(const std::string &label, size_t bytes)
+{
+    std::printf("  %-44s %10.1f MB\n", label.c_str(), bytes / (1024.0 * 1024.0));
+}
+
+} // end namespace bench
+
+int main(int argc, char **argv)
+{
+    for (auto &benchmark: bench::benchmarks())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+        {
+            if (std::strstr(benchmark.first, argv[i])) selected = true;
+        }
+
+        if (!selected) continue;
+        std::printf("%s\n", benchmark.first);
+        benchmark.second();
+        std::fflush(stdout);
+    }
+
+    return 0;
+}
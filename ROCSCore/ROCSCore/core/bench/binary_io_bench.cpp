@@ -0,0 +1,165 @@
+#include "core/bench/bench.h"
+#include "core/rocs_midi/show_data.h"
+#include "core/changelog/change_log.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace rocs_midi;
+
+/* Reading and writing a .showdata of 40 songs of 48 tracks of 200 events,
+ * about 3 MB, and a .logdata of 200 songs of 600 events, about 1 MB,
+ * through streams and through ex::BinaryReader and BinaryWriter.  The
+ * shows are read on one thread, so the parsing is what is timed.
+ *
+ * The "field by field" lines are the baseline: a .showdata 2.2 and a
+ * .logdata 2.0 are still read and written a field at a time through the
+ * stream, as every version was before BinaryReader.  Later versions read
+ * through a stream take each song or section into memory first.  "in
+ * place" gives the reader an owner, as a mapped file does, so the tracks
+ * point at their events instead of copying them. */
+ROCS_BENCHMARK(binary_io)
+{
+    ShowData showData("Show");
+    showData.SetThreads(1);
+    UInt32 seed = 1;
+    for (int number = 1; number <= 40; number++)
+    {
+        SongDataPtrT song(new SongData(
+            std::to_string(number),
+            "Song " + std::to_string(number),
+            480,
+            20000));
+        for (UInt16 trackId = 0; trackId < 48; trackId++)
+        {
+            VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+            track->SetGroupId(0);
+            for (UInt32 i = 0; i < 200; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                track->GetEvents().push_back(VoiceEvent(i * 120, 0x90, (seed >> 16) % 128, 100));
+            }
+
+            song->GetVoiceData().AddTrack(track);
+        }
+
+        showData.AddSongData(song);
+    }
+
+    CL::ChangeLog changeLog("Show", "Customer", ex::UUID(), cmn::ROCSVersion(3, 1));
+    for (int number = 1; number <= 200; number++)
+    {
+        CL::SongLogPtrT log(new CL::SongLog());
+        log->SetSongNumber(std::to_string(number));
+        log->SetSongName("Song");
+        for (UInt32 i = 0; i < 100; i++)
+        {
+            UInt32 at = i * 1920;
+            log->GetVamps().push_back(CL::Vamp(at, at + 480, 2));
+            log->GetCuts().push_back(CL::Cut(at + 480, at + 960));
+            log->GetTranspositions().push_back(CL::Transpose(at, at + 960, -2));
+            log->GetTempoScales().push_back(CL::TempoScale(at, at + 960, 1.5));
+            log->GetCaesuras().push_back(CL::Caesura(at + 1200));
+            log->GetMarkers().push_back(CL::Marker(at + 1440, "Segue"));
+        }
+
+        changeLog.AddSongLog(log);
+    }
+
+    const cmn::FileVersion showFieldsVersion(2, 2);
+    const cmn::FileVersion logFieldsVersion(2, 0);
+    std::ostringstream showStream;
+    showData.WriteBinary(showStream, LatestFileVersion);
+    std::string showBytes = showStream.str();
+    std::ostringstream showFieldsStream;
+    showData.WriteBinary(showFieldsStream, showFieldsVersion);
+    std::string showFieldsBytes = showFieldsStream.str();
+    std::ostringstream logStream;
+    changeLog.WriteBinary(logStream, CL::LatestFileVersion);
+    std::string logBytes = logStream.str();
+    std::ostringstream logFieldsStream;
+    changeLog.WriteBinary(logFieldsStream, logFieldsVersion);
+    std::string logFieldsBytes = logFieldsStream.str();
+    std::shared_ptr<std::string> showOwner(new std::string(showBytes));
+
+    bench::Report("showdata 2.2 read, istream field by field", bench::Measure([&]() {
+        std::istringstream is(showFieldsBytes);
+        ShowData read(is, 1);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("showdata read, istream", bench::Measure([&]() {
+        std::istringstream is(showBytes);
+        ShowData read(is, 1);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("showdata read, BinaryReader", bench::Measure([&]() {
+        ex::BinaryReader reader(showBytes.data(), showBytes.size());
+        ShowData read(reader, 1);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("showdata read, BinaryReader in place", bench::Measure([&]() {
+        ex::BinaryReader reader(showOwner->data(), showOwner->size(), showOwner);
+        ShowData read(reader, 1);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("showdata 2.2 write, ostream field by field", bench::Measure([&]() {
+        std::ostringstream os;
+        showData.WriteBinary(os, showFieldsVersion);
+        bench::Keep(&os);
+    }));
+
+    bench::Report("showdata write, ostream", bench::Measure([&]() {
+        std::ostringstream os;
+        showData.WriteBinary(os, LatestFileVersion);
+        bench::Keep(&os);
+    }));
+
+    bench::Report("showdata write, BinaryWriter", bench::Measure([&]() {
+        ex::BinaryWriter writer;
+        showData.WriteBinary(writer, LatestFileVersion);
+        bench::Keep(&writer);
+    }));
+
+    bench::Report("logdata 2.0 read, istream field by field", bench::Measure([&]() {
+        std::istringstream is(logFieldsBytes);
+        CL::ChangeLog read(is);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("logdata read, istream", bench::Measure([&]() {
+        std::istringstream is(logBytes);
+        CL::ChangeLog read(is);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("logdata read, BinaryReader", bench::Measure([&]() {
+        ex::BinaryReader reader(logBytes.data(), logBytes.size());
+        CL::ChangeLog read(reader);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("logdata 2.0 write, ostream field by field", bench::Measure([&]() {
+        std::ostringstream os;
+        changeLog.WriteBinary(os, logFieldsVersion);
+        bench::Keep(&os);
+    }));
+
+    bench::Report("logdata write, ostream", bench::Measure([&]() {
+        std::ostringstream os;
+        changeLog.WriteBinary(os, CL::LatestFileVersion);
+        bench::Keep(&os);
+    }));
+
+    bench::Report("logdata write, BinaryWriter", bench::Measure([&]() {
+        ex::BinaryWriter writer;
+        changeLog.WriteBinary(writer, CL::LatestFileVersion);
+        bench::Keep(&writer);
+    }));
+}
@@ -0,0 +1,72 @@
+#include "core/bench/bench.h"
+#include "core/rocs_midi/voice_event_columns.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace rocs_midi;
+
+/* Searching and scanning 4M events, 32 MB as VoiceEvents and so out of
+ * cache: 100k random lower bounds, and counting the note ons, in the
+ * VoiceEvent vector and in VoiceEventColumns. */
+ROCS_BENCHMARK(columns)
+{
+    const size_t count = 4 * 1024 * 1024;
+    VoiceEvtVecT events;
+    events.reserve(count);
+    UInt32 seed = 1;
+    UInt32 absTime = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        absTime += (seed >> 16) % 3;
+        Byte status = (seed >> 24) % 4 ? 0x90 : 0xB0;
+        events.push_back(VoiceEvent(absTime, status, (seed >> 8) % 128, 100));
+    }
+
+    VoiceEventColumns columns(events);
+    std::vector<UInt32> ticks(100000);
+    for (auto &tick: ticks)
+    {
+        seed = seed * 1103515245 + 12345;
+        tick = seed % (absTime + 1);
+    }
+
+    size_t found = 0;
+    bench::Report("lower_bound, VoiceEvent vector", bench::Measure([&]() {
+        for (auto tick: ticks)
+        {
+            found += std::lower_bound(
+                events.begin(),
+                events.end(),
+                tick,
+                [](const VoiceEvent &voiceEvent, UInt32 tick)->bool
+                {
+                    return voiceEvent.GetAbsTime() < tick;
+                }) - events.begin();
+        }
+    }));
+
+    bench::Report("LowerBound, columns", bench::Measure([&]() {
+        for (auto tick: ticks)
+        {
+            found += columns.LowerBound(tick);
+        }
+    }));
+
+    bench::Report("count note ons, VoiceEvent vector", bench::Measure([&]() {
+        found += std::count_if(
+            events.begin(),
+            events.end(),
+            [](const VoiceEvent &voiceEvent)->bool
+            {
+                return voiceEvent.GetStatusType() == 0x90;
+            });
+    }));
+
+    bench::Report("CountStatusType, columns", bench::Measure([&]() {
+        found += columns.CountStatusType(0x90);
+    }));
+
+    bench::Keep(&found);
+}
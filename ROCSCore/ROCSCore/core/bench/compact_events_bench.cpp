@@ -0,0 +1,148 @@
+#include "core/bench/bench.h"
+#include "core/rocs_midi/show_data.h"
+#include "core/rocs_midi/compact_voice_events.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace rocs_midi;
+
+/* Track trackId of a song: notes, a dense controller, pitch bend, or notes
+ * under a sustain pedal. */
+static VoiceTrackPtrT MakeTrack(UInt16 trackId, UInt32 &seed)
+{
+    VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+    track->SetGroupId(0);
+    VoiceEvtVecT &events = track->GetEvents();
+    UInt32 time = 0;
+    switch (trackId % 4)
+    {
+    case 0:
+        for (UInt32 i = 0; i < 1000; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            Byte note = static_cast<Byte>(36 + (seed >> 16) % 48);
+            time += 60 + (seed >> 8) % 120;
+            events.push_back(VoiceEvent(time, 0x90, note, 100));
+            events.push_back(VoiceEvent(time + 50, 0x80, note, 0));
+        }
+        break;
+
+    case 1:
+        for (UInt32 i = 0; i < 8000; i++)
+        {
+            time += 5 + i % 3;
+            events.push_back(VoiceEvent(time, 0xB0, 11, static_cast<Byte>(i % 128)));
+        }
+        break;
+
+    case 2:
+        for (UInt32 i = 0; i < 8000; i++)
+        {
+            time += 4;
+            events.push_back(VoiceEvent(time, 0xE0, i % 128, (i / 128) % 128));
+        }
+        break;
+
+    default:
+        for (UInt32 i = 0; i < 2000; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            time += 60;
+            if (i % 16 == 0) events.push_back(VoiceEvent(time, 0xB0, 64, (i / 16) % 2 ? 0 : 127));
+            events.push_back(VoiceEvent(time, 0x90, 48 + (seed >> 16) % 24, 90));
+            events.push_back(VoiceEvent(time + 40, 0x80, 48 + (seed >> 16) % 24, 0));
+        }
+        break;
+    }
+
+    return track;
+}
+
+/* A show of 40 songs of 48 tracks, about 10.6M events, written with every
+ * track raw and every track compact, then read back out of memory.  The
+ * readers have no owner, so raw events are copied rather than mapped, and
+ * the show is read on one thread. */
+ROCS_BENCHMARK(compact_events)
+{
+    ShowData showData("Show");
+    showData.SetThreads(1);
+    UInt32 seed = 1;
+    for (int number = 1; number <= 40; number++)
+    {
+        SongDataPtrT song(new SongData(
+            std::to_string(number),
+            "Song " + std::to_string(number),
+            480,
+            2000000));
+        for (UInt16 trackId = 0; trackId < 48; trackId++)
+        {
+            song->GetVoiceData().AddTrack(MakeTrack(trackId, seed));
+        }
+
+        showData.AddSongData(song);
+    }
+
+    ex::BinaryWriter raw;
+    ex::BinaryWriter compact;
+    for (auto encoding: {raw_events, compact_events})
+    {
+        for (auto &it: showData.GetSongs())
+        {
+            it.second->GetVoiceData().SetEncodings(encoding);
+        }
+
+        ex::BinaryWriter &writer = encoding == raw_events ? raw : compact;
+        bench::Report(
+            encoding == raw_events ? "write, raw" : "write, compact",
+            bench::Measure([&]() {
+                writer.clear();
+                showData.WriteBinary(writer, LatestFileVersion);
+            }));
+    }
+
+    printf("  raw %zu bytes, compact %zu bytes\n", raw.size(), compact.size());
+
+    bench::Report("read, raw", bench::Measure([&]() {
+        ex::BinaryReader reader(raw.GetData(), raw.size());
+        ShowData read(reader, 1);
+        bench::Keep(&read);
+    }));
+
+    bench::Report("read, compact", bench::Measure([&]() {
+        ex::BinaryReader reader(compact.GetData(), compact.size());
+        ShowData read(reader, 1);
+        bench::Keep(&read);
+    }));
+
+    // The decoders alone, over one track of each kind.
+    for (UInt16 trackId = 0; trackId < 4; trackId++)
+    {
+        VoiceEventSpan events = showData.GetSongData("1").GetVoiceData().GetTrack(trackId).GetEvents();
+        std::vector<char> encoded;
+        encode_voice_events(events.data(), events.size(), encoded);
+        VoiceEvtVecT decoded(events.size());
+        const char *kinds[] = { "notes", "dense CC", "pitch bend", "sustain" };
+
+        bench::Report(
+            std::string("decode_voice_events, ") + kinds[trackId],
+            bench::Measure([&]() {
+                for (int repeat = 0; repeat < 100; repeat++)
+                {
+                    decode_voice_events(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+                }
+            }));
+
+        bench::Report(
+            std::string("decode_voice_events_scalar, ") + kinds[trackId],
+            bench::Measure([&]() {
+                for (int repeat = 0; repeat < 100; repeat++)
+                {
+                    decode_voice_events_scalar(encoded.data(), encoded.size(), decoded.data(), decoded.size());
+                }
+            }));
+    }
+}
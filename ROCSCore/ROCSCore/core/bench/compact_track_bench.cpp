@@ -0,0 +1,67 @@
+#include "core/bench/bench.h"
+#include "core/test/test_midi_file.h"
+#include "core/std_midi/midi_file.h"
+#include "core/std_midi/compact_track.h"
+#include "core/rocs_midi/voice_track.h"
+
+#include <memory>
+#include <vector>
+
+using namespace std_midi;
+
+/* Parsing one voice track of 200k notes with 4k markers, into a MIDITrack
+ * and into a CompactTrack, and the memory each then holds.  The VoiceTrack
+ * made from the MIDITrack, which holds only the notes, is for scale. */
+ROCS_BENCHMARK(compact_track)
+{
+    TestMIDIFileBuilder builder;
+    builder.BeginTrack("Voice");
+    for (int n = 0; n < 200000; n++)
+    {
+        if (n % 50 == 0) builder.Meta(0, 0x06, "@m " + std::to_string(n / 50));
+        Byte note = static_cast<Byte>(36 + n % 48);
+        builder.Event(n ? 60 : 0, {0x90, note, 90});
+        builder.Event(60, {0x80, note, 0});
+    }
+
+    builder.EndOfTrack();
+    std::vector<Byte> bytes = builder.Bytes();
+
+    bench::Report("MIDITrack", bench::Measure([&]() {
+        ByteSpanReader reader(&bytes[0], bytes.size());
+        reader.seekg(MIDI_HEADER_SIZE);
+        MIDITrack track(reader, 0);
+        bench::Keep(&track);
+    }));
+
+    bench::Report("CompactTrack", bench::Measure([&]() {
+        ByteSpanReader reader(&bytes[0], bytes.size());
+        reader.seekg(MIDI_HEADER_SIZE);
+        CompactTrack track(reader, 0);
+        bench::Keep(&track);
+    }));
+
+    bench::ReportBytes("MIDITrack, held", bench::RetainedBytes([&]() {
+        ByteSpanReader reader(&bytes[0], bytes.size());
+        reader.seekg(MIDI_HEADER_SIZE);
+        return std::unique_ptr<MIDITrack>(new MIDITrack(reader, 0));
+    }));
+
+    bench::ReportBytes("CompactTrack, held", bench::RetainedBytes([&]() {
+        ByteSpanReader reader(&bytes[0], bytes.size());
+        reader.seekg(MIDI_HEADER_SIZE);
+        return std::unique_ptr<CompactTrack>(new CompactTrack(reader, 0));
+    }));
+
+    ByteSpanReader compactReader(&bytes[0], bytes.size());
+    compactReader.seekg(MIDI_HEADER_SIZE);
+    CompactTrack compact(compactReader, 0);
+    bench::ReportBytes("CompactTrack, MemoryUsage", compact.MemoryUsage());
+
+    ByteSpanReader voiceReader(&bytes[0], bytes.size());
+    voiceReader.seekg(MIDI_HEADER_SIZE);
+    MIDITrack midiTrack(voiceReader, 0);
+    bench::ReportBytes("VoiceTrack from the MIDITrack, held", bench::RetainedBytes([&]() {
+        return std::unique_ptr<rocs_midi::VoiceTrack>(new rocs_midi::VoiceTrack(midiTrack));
+    }));
+}
@@ -0,0 +1,44 @@
+#include "core/bench/bench.h"
+#include "core/test/test_midi_file.h"
+#include "core/timeline/midi_loaders.h"
+
+#include <string>
+#include <vector>
+
+using namespace TL;
+
+/* Reading the bars of a 4/4 conductor track with one "@b" and one "@m"
+ * marker per bar, into a BarGrid and expanded into BarsBeats. */
+ROCS_BENCHMARK(custom_bars)
+{
+    for (int bars = 1000; bars <= 16000; bars *= 2)
+    {
+        std_midi::TestMIDIFileBuilder builder;
+        builder.BeginTrack("Conductor");
+        builder.Tempo(0, 500000);
+        builder.TimeSignature(0, 4, 2);
+        for (int bar = 0; bar < bars; bar++)
+        {
+            builder.Meta(bar ? 1920 : 0, 0x06, "@b " + std::to_string(bar + 1));
+            builder.Meta(0, 0x06, "@m " + std::to_string(bar));
+        }
+
+        builder.EndOfTrack(1920);
+        std::vector<Byte> bytes = builder.Bytes();
+        std_midi::MIDIFile midiFile(&bytes[0], bytes.size(), "custom_bars_bench.mid");
+        MeterSeqPtrT meters(new MeterSeqT());
+        meters->push_back(Meter(0, 4, 4, 24, 8));
+
+        std::string count = std::to_string(bars) + " bars";
+        bench::Report("create_bar_grid, " + count, bench::Measure([&]() {
+            BarGridPtrT grid = create_bar_grid(midiFile, *meters);
+            bench::Keep(grid.get());
+        }));
+
+        bench::Report("create_bars_beats, " + count, bench::Measure([&]() {
+            BarsBeatsSeqPtrT barsBeats(new BarsBeatsSeqT());
+            create_bars_beats(midiFile, meters, barsBeats);
+            bench::Keep(barsBeats.get());
+        }));
+    }
+}
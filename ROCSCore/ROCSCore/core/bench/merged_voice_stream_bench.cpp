@@ -0,0 +1,130 @@
+#include "core/bench/bench.h"
+#include "core/rocs_midi/merged_voice_stream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace rocs_midi;
+
+/* Prints the time of each step of a pass of steps. */
+static void ReportPerStep(const std::string &label, const bench::Measurement &measurement, size_t steps)
+{
+    bench::Report(label, measurement);
+    std::printf("  %-44s %10.1f ns per step\n", "", measurement.ms * 1e6 / steps);
+}
+
+/* 128 tracks of 2000 events in 8 groups, played in steps of 10 ticks: each
+ * step reads the events before the next.  The naive player finds each
+ * track's events in the step with a binary search and sorts what it finds,
+ * as a player merging the tracks itself would; the cursor reads them from
+ * the merged stream.  Both are timed over every track and over one group,
+ * which the cursor reads through SetGroups. */
+ROCS_BENCHMARK(merged_voice_stream)
+{
+    const UInt16 trackCount = 128;
+    const UInt32 step = 10;
+    VoiceData voiceData;
+    UInt32 seed = 1;
+    UInt32 lastTime = 0;
+    for (UInt16 trackId = 0; trackId < trackCount; trackId++)
+    {
+        VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+        track->SetGroupId(static_cast<UInt8>(trackId % 8));
+        UInt32 absTime = 0;
+        for (UInt32 i = 0; i < 2000; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            absTime += (seed >> 16) % 60;
+            track->GetEvents().push_back(VoiceEvent(absTime, 0x90, (seed >> 8) % 128, 100));
+        }
+
+        lastTime = std::max(lastTime, absTime);
+        voiceData.AddTrack(track);
+        voiceData.GetGroups().GetGroups()[trackId % 8].insert(trackId);
+    }
+
+    const size_t steps = lastTime / step + 1;
+    size_t read = 0;
+
+    // The naive player, over the tracks of groupId, or every track.
+    auto naive = [&](int groupId) {
+        std::vector<MergedVoiceEvent> found;
+        found.reserve(1024);
+        for (UInt32 tick = 0; tick <= lastTime; tick += step)
+        {
+            found.clear();
+            for (auto &it: voiceData.GetTracks())
+            {
+                const VoiceTrack &track = *it.second;
+                if (groupId >= 0 && track.GetGroupId() != groupId) continue;
+                const VoiceEvent *first = track.GetEventData();
+                const VoiceEvent *last = first + track.GetEventCount();
+                const VoiceEvent *at = std::lower_bound(
+                    first,
+                    last,
+                    tick,
+                    [](const VoiceEvent &voiceEvent, UInt32 tick)->bool
+                    {
+                        return voiceEvent.GetAbsTime() < tick;
+                    });
+                for (; at != last && at->GetAbsTime() < tick + step; ++at)
+                {
+                    MergedVoiceEvent merged;
+                    merged.abs_time = at->GetAbsTime();
+                    merged.message = at->GetVoiceMessage();
+                    merged.track_id = it.first;
+                    merged.group_id = track.GetGroupId();
+                    merged.padding = 0;
+                    found.push_back(merged);
+                }
+            }
+
+            std::sort(
+                found.begin(),
+                found.end(),
+                [](const MergedVoiceEvent &lhs, const MergedVoiceEvent &rhs)->bool
+                {
+                    if (lhs.abs_time != rhs.abs_time) return lhs.abs_time < rhs.abs_time;
+                    return lhs.track_id < rhs.track_id;
+                });
+            read += found.size();
+        }
+    };
+
+    auto play = [&](MergedVoiceCursor &cursor) {
+        cursor.Seek(0);
+        for (UInt32 tick = step; tick <= lastTime + step; tick += step)
+        {
+            while (cursor.NextBefore(tick)) read++;
+        }
+    };
+
+    MergedVoiceStream stream(voiceData);
+    bench::Report("build the stream", bench::Measure([&]() {
+        MergedVoiceStream built(voiceData);
+        read += built.GetEvents().size();
+    }));
+
+    stream.GetEvents();
+    Byte velocity = 0;
+    bench::Report("update after one track changes", bench::Measure([&]() {
+        voiceData.GetTrack(64).GetEvents().back().SetData2(++velocity % 128);
+        read += stream.GetEvents().size();
+    }));
+
+    ReportPerStep("naive merge, every track", bench::Measure([&]() { naive(-1); }), steps);
+
+    MergedVoiceCursor cursor(stream);
+    ReportPerStep("cursor, every track", bench::Measure([&]() { play(cursor); }), steps);
+
+    ReportPerStep("naive merge, one group of 16 tracks", bench::Measure([&]() { naive(3); }), steps);
+
+    std::set<UInt8> groups;
+    groups.insert(3);
+    bench::Report("SetGroups, one group", bench::Measure([&]() { cursor.SetGroups(groups); }));
+    ReportPerStep("cursor, one group of 16 tracks", bench::Measure([&]() { play(cursor); }), steps);
+
+    bench::Keep(&read);
+}
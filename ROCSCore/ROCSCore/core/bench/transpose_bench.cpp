@@ -0,0 +1,44 @@
+#include "core/bench/bench.h"
+#include "core/rocs_midi/transpose_voice_events.h"
+
+#include <vector>
+
+using namespace rocs_midi;
+
+/* Transposing 100k events of every voice status by 3 within 48 to 72: the
+ * assign and per-event loop EventSlice used before transpose_voice_events,
+ * the scalar loop, and the kernel the build targets. */
+ROCS_BENCHMARK(transpose)
+{
+    VoiceEvtVecT events;
+    UInt32 seed = 1;
+    for (UInt32 i = 0; i < 100000; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        UInt8 status = static_cast<UInt8>(0x80 + ((seed >> 24) % 7) * 0x10 + (seed >> 8) % 16);
+        events.push_back(VoiceEvent(i * 10, status, (seed >> 12) % 128, (seed >> 4) % 128));
+    }
+
+    VoiceRangeT range(48, 72);
+    VoiceEvtVecT out(events.size());
+
+    bench::Report("assign and transpose_voice_event", bench::Measure([&]() {
+        out.assign(events.begin(), events.end());
+        for (auto &it: out)
+        {
+            transpose_voice_event(it, 3, range);
+        }
+
+        bench::Keep(&out[0]);
+    }, 20));
+
+    bench::Report("transpose_voice_events_scalar", bench::Measure([&]() {
+        transpose_voice_events_scalar(&events[0], &out[0], events.size(), 3, range);
+        bench::Keep(&out[0]);
+    }, 20));
+
+    bench::Report("transpose_voice_events", bench::Measure([&]() {
+        transpose_voice_events(&events[0], &out[0], events.size(), 3, range);
+        bench::Keep(&out[0]);
+    }, 20));
+}
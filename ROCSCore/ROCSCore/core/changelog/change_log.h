@@ -12,6 +12,8 @@
 
 #include <algorithm>
 #include "exlib/binary_string_io.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "exlib/xplatform_types.h"
 #include "exlib/uuid.h"
 #include "exlib/numeric_string_compare.h"
@@ -49,6 +51,13 @@ std::string GetNewLogNameFromVersion(
     const std::string &existingName, 
     const cmn::ROCSVersion &version);
 
+/**
+    From version 2.1 a .logdata is checksummed in sections, as
+    cmn::read_section reads them: the show name, customer, license, version
+    and song count are one, checked along with the file header, and each
+    SongLog is another.  A damaged or cut short file throws
+    cmn::ChecksumError when it is read, naming the section.
+**/
 class ROCS_CORE_API ChangeLog
 {
 public:
@@ -70,6 +79,8 @@ public:
 
     ChangeLog(std::istream &);
 
+    ChangeLog(ex::BinaryReader &);
+
     ChangeLog(const ChangeLog& other);
 
     ChangeLog& operator=(const ChangeLog& other);
@@ -78,10 +89,17 @@ public:
 
     void LoadIstream(std::istream &);
 
+    /* Reads a whole .logdata file out of memory.  LoadIstream reads a 2.1
+     * file into memory a section at a time and parses it the same way, so
+     * this saves only copying the sections. */
+    void LoadBinaryReader(ex::BinaryReader &);
+
     void DummyLoader();
 
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
 
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
+
     void WriteString(std::ostream&) const;
 
     std::string GetShowName() const { return this->show_name_; }
@@ -135,6 +153,19 @@ private:
     ex::UUID license_id_;
     cmn::ROCSVersion version_;
     SongLogMapT song_logs_;
+
+    template<class InputT>
+    void read_binary(InputT &);
+
+    /* Reads the fields before the song logs and returns the number of logs. */
+    template<class InputT>
+    UInt16 read_head(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
+    template<class OutputT>
+    void write_head(OutputT &, const cmn::FileVersion &) const;
 };
 
 ROCS_CORE_API bool operator==(const ChangeLog& lhs, const ChangeLog& rhs);
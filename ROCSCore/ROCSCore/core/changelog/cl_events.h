@@ -13,6 +13,8 @@
 #include "exlib/xplatform_types.h"
 #include "exlib/binary_string_io.h"
 #include "exlib/binary_io.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "core/common/verify_align.h"
 #include "core/common/rocs_event.h"
 #include "core/common/codes.h"
@@ -36,6 +38,8 @@ public:
  
     CustomBar(std::istream &, const cmn::FileVersion &) {}
  
+    CustomBar(ex::BinaryReader &, const cmn::FileVersion &) {}
+ 
     CustomBar(UInt32 _abs_time): abs_time_(_abs_time) {}
  
     CustomBar(UInt32 abs_time, const std::string& val)
@@ -52,6 +56,8 @@ public:
  
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const {}
  
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const {}
+ 
     virtual void WriteString(std::ostream& os) const;
 
     virtual bool operator<(const ROCSEvent &other) const
@@ -94,6 +100,8 @@ public:
     
     Marker(std::istream &, const cmn::FileVersion &);
     
+    Marker(ex::BinaryReader &, const cmn::FileVersion &);
+    
     virtual UInt8 code() const { return evt_code; }
     
     virtual UInt32 abs_time() const { return abs_time_; }
@@ -112,11 +120,19 @@ public:
  
     void WriteBinary(std::ostream& os, const cmn::FileVersion &) const;
  
+    void WriteBinary(ex::BinaryWriter& writer, const cmn::FileVersion &) const;
+ 
     virtual bool operator<(const ROCSEvent &other) const;
 
     virtual bool operator==(const ROCSEvent &) const;
 
 private:
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
     UInt32 abs_time_;
 	MSC_DISABLE_WARNING(4251);
     std::string value_;
@@ -160,6 +176,8 @@ public:
     {}
 
     Caesura(std::istream &, const cmn::FileVersion &);
+
+    Caesura(ex::BinaryReader &, const cmn::FileVersion &);
  
     Caesura(UInt32 abs_time, UInt32 versionTarget = CAESURA_TARGETS_ALL)
         :
@@ -178,6 +196,8 @@ public:
     void abs_time(UInt32 val) { abs_time_ = val; }
 
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
+
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
  
     virtual void WriteString(std::ostream& os) const;
 
@@ -189,6 +209,12 @@ public:
     virtual UInt32 VersionTarget() const { return this->versionTarget_; }
 
 private:
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
     UInt32 abs_time_;
     UInt32 versionTarget_;
 };
@@ -264,6 +290,8 @@ public:
     
     PairedEvent(std::istream &, const cmn::FileVersion &);
     
+    PairedEvent(ex::BinaryReader &, const cmn::FileVersion &);
+    
     PairedEvent(UInt32 _start, UInt32 _end, SInt32 _value)
         :
         start_(_start),
@@ -306,6 +334,8 @@ public:
     
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
 
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
+
     virtual void WriteString(std::ostream& os) const;
     
     // For completely specified paired events, both is_start() and is_end()
@@ -338,6 +368,12 @@ public:
     }
 
 private:
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
     UInt32 start_;
     UInt32 end_;
     union
@@ -367,6 +403,11 @@ public:
         PairedEvent(is, fileVersion)
     {}
     
+    Cut(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        PairedEvent(reader, fileVersion)
+    {}
+    
     Cut(UInt32 start, UInt32 end, SInt32 value=0)
         :
         PairedEvent(start, end, value)
@@ -394,6 +435,11 @@ public:
         :
         PairedEvent(is, fileVersion)
     {}
+    
+    Vamp(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        PairedEvent(reader, fileVersion)
+    {}
 
     Vamp(UInt32 start, UInt32 end, SInt32 value=0)
         :
@@ -423,6 +469,11 @@ public:
         PairedEvent(is, fileVersion)
     {}
     
+    Repeat(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        PairedEvent(reader, fileVersion)
+    {}
+    
     Repeat(UInt32 start, UInt32 end, SInt32 value=2)
         :
         PairedEvent(start, end, value)
@@ -452,6 +503,10 @@ public:
         : PairedEvent(is, fileVersion)
     {}
     
+    Transpose(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        : PairedEvent(reader, fileVersion)
+    {}
+    
     Transpose(UInt32 start, UInt32 end, SInt32 value=0)
         :
         PairedEvent(start, end, value) {}
@@ -480,6 +535,11 @@ public:
         PairedEvent(is, fileVersion)
     {}
     
+    TempoScale(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        PairedEvent(reader, fileVersion)
+    {}
+    
     TempoScale(UInt32 start, UInt32 end, double value=1.0)
         :
         PairedEvent(start, end, value)
@@ -540,6 +600,11 @@ public:
         PairedEvent(is, fileVersion)
     {}
     
+    Click(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        : 
+        PairedEvent(reader, fileVersion)
+    {}
+    
     Click(UInt32 start, UInt32 end, SInt32 value=8)
         :
         PairedEvent(start, end, value)
@@ -576,6 +641,11 @@ public:
         :
         PairedEvent(is, fileVersion)
     {}
+    
+    Fermata(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        PairedEvent(reader, fileVersion)
+    {}
 
     Fermata(UInt32 start, UInt32 end, SInt32 value=0)
         :
@@ -25,8 +25,17 @@ class ROCS_CORE_API MarkerSequence
 public:
     MarkerSequence() {}
     MarkerSequence(std::istream &, const cmn::FileVersion &);
+    MarkerSequence(ex::BinaryReader &, const cmn::FileVersion &);
     ~MarkerSequence() {}
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
+
+private:
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
 };
 
 template< class EventT >
@@ -38,15 +47,31 @@ public:
         :
         cmn::SequenceTemplate<EventT>(is, fileVersion) {}
 
+    ChangeLogSequence(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+        :
+        cmn::SequenceTemplate<EventT>(reader, fileVersion) {}
+
+    void WriteBinary(std::ostream& os, const cmn::FileVersion &version) const
+    {
+        this->write_binary(os, version);
+    }
+
+    void WriteBinary(ex::BinaryWriter& writer, const cmn::FileVersion &version) const
+    {
+        this->write_binary(writer, version);
+    }
+
+private:
     // Because the events contained by a ChangeLog sequence have a virtual base
     // class, each must be read individually.  Timeline events have no such
     // restriction, and the entire vector can be serialized in one operation.
-    void WriteBinary(std::ostream& os, const cmn::FileVersion &version) const
+    template<class OutputT>
+    void write_binary(OutputT& os, const cmn::FileVersion &version) const
     {
         os.put(this->code());
         UInt32 obj_count = this->events_.size();
         os.write((char *)&obj_count, sizeof(UInt32));
-        for (auto it: this->events_)
+        for (auto &it: this->events_)
         {
             it.WriteBinary(os, version);
         }
@@ -19,6 +19,7 @@
 #include "core/changelog/change_log.h"
 #include "core/rocs_midi/show_data.h"
 #include "core/changelog/editor_history.h"
+#include "core/timeline/tempo_map.h"
 
 // #define EDITOR_VERBOSE_LOGGING
 
@@ -187,6 +188,10 @@ public:
     bool CanRedo();
 
     EditorHistory::HistoryActionT GetEditedEvents();
+
+    /** The TempoMap of the active song, including its TempoScales.  It is
+        kept up to date by every edit, Undo and Redo. **/
+    const TL::TempoMap &GetTempoMap() const { return this->tempoMap_; }
     
 protected:
     cmn::ROCSEvent &AddEvent_(const cmn::ROCSEvent &newEvent);
@@ -195,6 +200,8 @@ protected:
 
     void CreateBeatTickIndices_();
 
+    void CreateTempoMap_();
+
     void DeleteEvent_(const cmn::ROCSEvent &eventToDelete);
 
     cmn::ROCSEvent *FindEvent_(const cmn::ROCSEvent &eventToFind);
@@ -235,7 +242,8 @@ protected:
     const rocs_midi::ShowData &showData_;
     std::string activeSongNumber_;
     EditorHistoryBySongNumberT editorHistoryBySongNumber_;
-    std::list<UInt32> beatTickIndices_;
+    std::vector<UInt32> beatTickIndices_;
+    TL::TempoMap tempoMap_;
 };
 
 } // end namespace CL
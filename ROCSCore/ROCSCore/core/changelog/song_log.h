@@ -13,6 +13,8 @@
 
 #include "exlib/xplatform_types.h"
 #include "exlib/binary_string_io.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "exlib/format.h"
 #include "exlib/ptr_vector.h"
 #include "core/common/parse_filename.h"
@@ -63,6 +65,8 @@ public:
 
     SongLog(std::istream &, const cmn::FileVersion &);
 
+    SongLog(ex::BinaryReader &, const cmn::FileVersion &);
+
     SongLog(const std_midi::MIDIFile &);
 
     ~SongLog() {}
@@ -75,6 +79,8 @@ public:
 
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
 
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
+
     std::string GetSongNumber() const { return this->song_number_; }
 
     std::string GetSongName() const { return this->song_name_; }
@@ -157,6 +163,12 @@ private:
     cmn::ROCSSeqPtrVecT all_seqs_;
     void make_all_seqs();
 
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
 private:
     UInt32 showReadyStartTicks_;
     UInt32 showReadyEndTicks_;
@@ -26,7 +26,8 @@ enum {
     meter =         0x4A,
     fermata =       0x4D,
     inPoint =       0x4F,
-    outPoint =      0x50
+    outPoint =      0x50,
+    bar_grid =      0x51
 };
 
 typedef std::map<Byte, std::string> CodeMapT;
@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+    MappedStreamBuf is a read-only streambuf over memory that something else
+    keeps alive, usually an ex::MappedFile.  An istream over one reads like
+    any other, but a reader that finds a MappedStreamBuf under its istream can
+    point into the memory instead of copying out of it, and hold the owner
+    to keep the memory alive.  VoiceTrack does this for its events.
+
+    MappedIStream is an istream with its own MappedStreamBuf.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <istream>
+#include <streambuf>
+#include <memory>
+#include <cstddef>
+
+namespace cmn
+{
+
+class ROCS_CORE_API MappedStreamBuf : public std::streambuf
+{
+public:
+    MappedStreamBuf(std::shared_ptr<const void> owner, const char *begin, const char *end);
+
+    const std::shared_ptr<const void>& GetOwner() const { return this->owner_; }
+
+    /* The next byte to be read. */
+    const char* GetPosition() const { return this->gptr(); }
+
+    /* The number of bytes left to read. */
+    size_t GetAvailable() const { return this->egptr() - this->gptr(); }
+
+    /* Moves past count bytes.  Returns false, and does not move, if fewer
+     * than count are left. */
+    bool Skip(size_t count);
+
+protected:
+    pos_type seekoff(
+        off_type off,
+        std::ios_base::seekdir way,
+        std::ios_base::openmode which = std::ios_base::in);
+
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which = std::ios_base::in);
+
+private:
+    MappedStreamBuf(const MappedStreamBuf &);
+    MappedStreamBuf& operator=(const MappedStreamBuf &);
+
+	MSC_DISABLE_WARNING(4251);
+    std::shared_ptr<const void> owner_;
+	MSC_RESTORE_WARNING(4251);
+};
+
+class ROCS_CORE_API MappedIStream : public std::istream
+{
+public:
+    MappedIStream(std::shared_ptr<const void> owner, const char *begin, const char *end)
+        :
+        std::istream(nullptr),
+        buf_(owner, begin, end)
+    {
+        this->rdbuf(&this->buf_);
+    }
+
+private:
+    MappedStreamBuf buf_;
+};
+
+} // end namespace cmn
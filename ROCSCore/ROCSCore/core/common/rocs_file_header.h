@@ -8,6 +8,8 @@
 #include <cstring>
 
 #include "exlib/xplatform_types.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "core/common/rocs_exception.h"
 #include "core/common/file_version.h"
 
@@ -20,6 +22,13 @@ public:
     FileHeaderError(const std::string& what): ROCSException(what) {}
 };
 
+/* A section of a file that does not match its checksum, or is cut short. */
+class ROCS_CORE_API ChecksumError : public ROCSException
+{
+public:
+    ChecksumError(const std::string& what): ROCSException(what) {}
+};
+
 struct ROCS_CORE_API ROCSFileHeader
 {
     ROCSFileHeader() {}
@@ -71,4 +80,31 @@ ROCS_CORE_API bool check_file_header(
     const FileVersion &minimumFileVersion,
     FileVersion &inputFileVersion);
 
+ROCS_CORE_API bool check_file_header(
+    ex::BinaryReader &reader,
+    const std::string &vendorID,
+    const std::string &fileType,
+    const FileVersion &minimumFileVersion,
+    FileVersion &inputFileVersion);
+
+/* The file versions that checksum their contents do so in sections: a
+ * UInt32 length, the UInt32 CRC32C of the bytes that follow, and the bytes.
+ * The first section's CRC32C is continued from the file header's, returned
+ * by header_checksum, so that a damaged header is caught too. */
+ROCS_CORE_API UInt32 header_checksum(
+    const std::string &vendorID,
+    const std::string &fileType,
+    const FileVersion &fileVersion);
+
+ROCS_CORE_API void write_section(std::ostream &os, const ex::BinaryWriter &section, UInt32 seed = 0);
+
+ROCS_CORE_API void write_section(ex::BinaryWriter &writer, const ex::BinaryWriter &section, UInt32 seed = 0);
+
+/* Reads a section and checks it, throwing ChecksumError naming what if it
+ * does not match.  The section is read in place from a BinaryReader, and
+ * read into memory the returned reader owns from an istream. */
+ROCS_CORE_API ex::BinaryReader read_section(std::istream &is, const std::string &what, UInt32 seed = 0);
+
+ROCS_CORE_API ex::BinaryReader read_section(ex::BinaryReader &reader, const std::string &what, UInt32 seed = 0);
+
 } // end namespace cmn
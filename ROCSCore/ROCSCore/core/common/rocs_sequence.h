@@ -21,6 +21,8 @@
 #include <memory>
 
 #include "exlib/xplatform_types.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "core/common/codes.h"
 #include "core/common/file_version.h"
 
@@ -40,6 +42,7 @@ class ROCS_CORE_API ROCSSequence
 public:
     virtual UInt8 code() const = 0;
     virtual void WriteBinary(std::ostream &, const cmn::FileVersion &) const = 0;
+    virtual void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const = 0;
     virtual void WriteString(std::ostream&) const = 0;
     virtual void WriteStringEvents(std::ostream&, int indent) const = 0;
 };
@@ -60,7 +63,15 @@ public: // typedefs
 public: // Construction
     SequenceTemplate() {}
 
-    SequenceTemplate(std::istream &, const cmn::FileVersion &);
+    SequenceTemplate(std::istream &is, const cmn::FileVersion &fileVersion)
+    {
+        this->read_binary(is, fileVersion);
+    }
+
+    SequenceTemplate(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    {
+        this->read_binary(reader, fileVersion);
+    }
 
     explicit SequenceTemplate(size_type to_reserve) { events_.reserve(to_reserve); }
 
@@ -146,12 +157,17 @@ public:
     
 protected:
     VectorT events_;
+
+private:
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &fileVersion);
 };
 
 
 template <class ROCSEventT>
-SequenceTemplate<ROCSEventT>::SequenceTemplate(
-    std::istream &is,
+template <class InputT>
+void SequenceTemplate<ROCSEventT>::read_binary(
+    InputT &is,
     const cmn::FileVersion &fileVersion)
 {
     UInt8 event_type = is.get();
@@ -171,7 +187,7 @@ SequenceTemplate<ROCSEventT>::SequenceTemplate(
     events_.reserve(obj_count);
     while(obj_count-- > 0)
     {
-        events_.push_back(ROCSEventT(is, fileVersion));
+        events_.emplace_back(is, fileVersion);
     }
 }
 
@@ -205,7 +221,7 @@ void SequenceTemplate<ROCSEventT>::WriteStringEvents(std::ostream& os, int inden
 template< class T >
 bool operator==(const cmn::SequenceTemplate<T> &lhs, const cmn::SequenceTemplate<T> &rhs)
 {
-    return equal(
+    return lhs.size() == rhs.size() && equal(
         lhs.begin(),
         lhs.end(),
         rhs.begin(),
@@ -9,6 +9,8 @@
 #include "exlib/format.h"
 #include "exlib/string_lib.h"
 #include "exlib/xplatform_types.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "core/common/file_version.h"
 
 namespace cmn
@@ -44,6 +46,11 @@ public:
         is.read((char *)&this->major_, sizeof(this->major_) + sizeof(this->minor_));
     }
 
+    ROCSVersion(ex::BinaryReader &reader, const cmn::FileVersion &)
+    {
+        reader.read((char *)&this->major_, sizeof(this->major_) + sizeof(this->minor_));
+    }
+
     ROCSVersion(const std::string& versionString)
     {
         this->SetWithString(versionString);
@@ -90,6 +97,11 @@ public:
         os.write((char *)&this->major_, sizeof(this->major_) + sizeof(this->minor_));
     }
 
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &) const
+    {
+        writer.write((char *)&this->major_, sizeof(this->major_) + sizeof(this->minor_));
+    }
+
     bool operator<(const ROCSVersion &other) const
     {
         if (this->major_ < other.major_)
@@ -0,0 +1,105 @@
+#pragma once
+
+/**
+    ChaseIndex finds the state a player must send before it can start a song
+    part way through: each track's controllers, program, channel pressure and
+    pitch wheel, and the notes still held.  It keeps a copy of each track's
+    state at a set of checkpoint ticks, for example the start of every bar, so
+    that ChaseStateAt replays only the events since the checkpoint before the
+    tick instead of every event from the start of the song.  A track's
+    checkpoints are made the first time it is asked for, and made again if
+    its revision has changed since.
+
+    A ChaseState is about 270 bytes, so a song of 500 checkpoints and 100
+    tracks holds about 13MB.  Checkpoints a few bars apart cost less and still
+    leave little to replay.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <map>
+#include <vector>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_event.h"
+#include "core/rocs_midi/voice_data.h"
+
+namespace rocs_midi
+{
+
+struct ROCS_CORE_API ChaseState
+{
+    static const UInt8 unset = 0xFF;
+    static const UInt16 unset_pitch_wheel = 0xFFFF;
+
+    ChaseState() { this->Reset(); }
+
+    void Reset();
+
+    /* Applies voiceEvent as a player would. */
+    void Apply(const VoiceEvent &voiceEvent);
+
+    bool IsHeld(UInt8 note) const { return this->velocities[note] != 0; }
+
+    /* unset for controllers never sent. */
+    UInt8 controllers[128];
+
+    /* The note on velocity of each held note, 0 for the rest. */
+    UInt8 velocities[128];
+
+    UInt8 program;
+    UInt8 channel_pressure;
+    UInt16 pitch_wheel;
+};
+
+ROCS_CORE_API bool operator==(const ChaseState &lhs, const ChaseState &rhs);
+
+inline bool operator!=(const ChaseState &lhs, const ChaseState &rhs) { return !(lhs == rhs); }
+
+typedef std::vector<ChaseState> ChaseStateVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<ChaseState>);
+
+typedef std::map<UInt16, ChaseState> ChaseStateByTrackIdT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::map<UInt16, ChaseState>);
+
+class ROCS_CORE_API ChaseIndex
+{
+public:
+    /* Checkpoints at each of ticks.  Throws invalid_argument if ticks are
+     * not sorted. */
+    ChaseIndex(const VoiceData &voiceData, const std::vector<UInt32> &ticks);
+
+    /* Checkpoints every interval ticks up to the last event.  Throws
+     * invalid_argument if interval is 0. */
+    ChaseIndex(const VoiceData &voiceData, UInt32 interval);
+
+    /* Sets state to the state of track trackId after every event before
+     * tick.  Throws out_of_range if there is no such track. */
+    void ChaseStateAt(UInt16 trackId, UInt32 tick, ChaseState &state);
+
+    /* The state of every track at tick.  Each track is on its own port and
+     * channel, so this is the state per channel. */
+    void ChaseStateAt(UInt32 tick, ChaseStateByTrackIdT &states);
+
+    const std::vector<UInt32>& GetTicks() const { return this->ticks_; }
+
+private:
+    struct TrackCheckpoints
+    {
+        UInt64 revision;
+        std::vector<size_t> indices;
+        ChaseStateVecT states;
+    };
+
+    typedef std::map<UInt16, TrackCheckpoints> CheckpointsByTrackIdT;
+
+    void build(const VoiceTrack &track, TrackCheckpoints &checkpoints) const;
+
+    const VoiceData &voiceData_;
+    MSC_DISABLE_WARNING(4251);
+    std::vector<UInt32> ticks_;
+    CheckpointsByTrackIdT tracks_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+} // end namespace rocs_midi
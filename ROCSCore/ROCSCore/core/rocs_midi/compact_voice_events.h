@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+    The compact encoding of a VoiceTrack's events, which show data version 2.5
+    writes for tracks whose encoding is compact_events.
+
+    It starts with the number of entries in the track's dictionary, up to 16,
+    and each entry's status, data1 and data2.  The dictionary holds the
+    messages that most often interrupt a run of another status, such as a
+    sustain pedal's among notes, and is only used there, never for a note
+    after a note.  Each event is then its time since the event before, or
+    since zero, as a varint of 7 bits per byte, low bits first, followed by
+    one of:
+
+        a status byte from 0x80 to 0xEF, then data1 and data2;
+        data1, if it is below 0x80, then data2, with the last status written;
+        0xF0 plus n, for entry n of the dictionary.  This does not change
+        the status the next event may reuse.
+
+    Dense controller data, a short delta followed by a controller and a
+    value, takes 3 bytes an event instead of 8, and notes 4.
+    decode_voice_events reads each event with one 8 byte load, and after an
+    event of a one byte delta checks the next 16 bytes with SSE2 for 4 more
+    in the same form, running status or status, which it decodes together.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <vector>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_event.h"
+
+namespace rocs_midi
+{
+
+const size_t compact_dictionary_size = 16;
+
+/* Appends the compact encoding of count events to out.  Returns false, and
+ * leaves out as it was, if the events are not in time order or one has a
+ * status that is not a voice status. */
+ROCS_CORE_API bool encode_voice_events(
+    const VoiceEvent *events,
+    size_t count,
+    std::vector<char> &out);
+
+/* Decodes count events from the size bytes at data into events.  Returns
+ * false if the bytes are not count events as encode_voice_events writes
+ * them, with nothing left over. */
+ROCS_CORE_API bool decode_voice_events(
+    const char *data,
+    size_t size,
+    VoiceEvent *events,
+    size_t count);
+
+/* The portable loop, for comparison with decode_voice_events. */
+ROCS_CORE_API bool decode_voice_events_scalar(
+    const char *data,
+    size_t size,
+    VoiceEvent *events,
+    size_t count);
+
+} // end namespace rocs_midi
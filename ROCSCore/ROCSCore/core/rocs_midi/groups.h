@@ -46,6 +46,8 @@ ROCS_CORE_TEMPLATE_DECLSPEC(std::map<UInt8, std::string>);
 ROCS_CORE_TEMPLATE_DECLSPEC(std::map<std::string, UInt8>);
 ROCS_CORE_TEMPLATE_DECLSPEC(std::set<UInt16>);
 ROCS_CORE_TEMPLATE_DECLSPEC(std::map<UInt8, std::set<UInt16>>);
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<UInt64>);
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<std::vector<UInt64>>);
 
 class ROCS_CORE_API Groups
 {
@@ -58,10 +60,12 @@ public:
     typedef GroupByGroupIdT::iterator iterator;
     typedef GroupByGroupIdT::const_iterator const_iterator;
 
-    Groups(): lastGroupId_(0) {}
+    Groups(): lastGroupId_(0), revision_(next_revision()), masksCurrent_(true) {}
 
     Groups(std::istream &is, const cmn::FileVersion &);
 
+    Groups(ex::BinaryReader &reader, const cmn::FileVersion &);
+
     // Only used when loading tracks from a std_midi::MIDIFile
     void AddTrack(VoiceTrackPtrT voiceTrackPtr);
     
@@ -76,28 +80,65 @@ public:
     UInt8 GetGroupId(const std::string &group_name) const;    
     
     const std::set<UInt16>& GetGroup(UInt8 group_id) const;
-    
-    GroupByGroupIdT & GetGroups() { return groups_; }
+
+    /* True if track_id is in group_id, which tests a bit.  The bits are
+     * made again the first time after GetGroups, begin or end, so changes
+     * through the map they return must be made before the next IsMember.
+     * That first call writes the bits, so like the rest of VoiceData a
+     * Groups is not safe to use from two threads at once. */
+    bool IsMember(UInt8 group_id, UInt16 track_id) const;
+
+    /* Changes whenever the groups may have changed. */
+    UInt64 GetRevision() const { return this->revision_; }
+
+    /* Counts as a change to the groups. */
+    GroupByGroupIdT & GetGroups() { this->touch(); return groups_; }
 
     void WriteBinary(std::ostream &os, const cmn::FileVersion &) const;
 
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &) const;
+
 public:
     // plumbing to std::map
-    iterator begin() { return groups_.begin(); }
+    iterator begin() { this->touch(); return groups_.begin(); }
 
     const_iterator begin() const { return groups_.begin(); }
 
     void clear();
 
-    iterator end() { return groups_.end(); }
+    iterator end() { this->touch(); return groups_.end(); }
 
     const_iterator end() const { return groups_.end(); }
 
 protected:
+    typedef std::vector<UInt64> TrackMaskT;
+
+    static UInt64 next_revision();
+
+    void touch() { this->revision_ = next_revision(); this->masksCurrent_ = false; }
+
+    void insert(UInt8 groupId, UInt16 trackId);
+
+    void update_masks() const;
+
+    void set_mask(UInt8 groupId, UInt16 trackId) const;
+
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &) const;
+
     UInt8 lastGroupId_;
     GroupNameByGroupIdT groupNameByGroupId_;
     GroupIdByGroupNameT groupIdByGroupName_;
     GroupByGroupIdT groups_;
+    UInt64 revision_;
+
+    // One bit per track id for each group, indexed by group id, made from
+    // groups_ when they are out of date.
+    mutable bool masksCurrent_;
+    mutable std::vector<TrackMaskT> masks_;
 };
 
 } // namespace rocs_midi
@@ -0,0 +1,146 @@
+#pragma once
+
+/**
+    MergedVoiceStream is every event of every track of a VoiceData in one
+    vector, ordered by time and then by track id, so that a player reads one
+    stream instead of merging the tracks itself.  Each record carries the
+    track id the VoiceData keeps the track under and the track's own group
+    id.  MergedVoiceCursor can skip the tracks that are in none of the groups
+    wanted, by the VoiceData's Groups, so a track in several groups is read
+    if any of them is.
+
+    The stream is built when it is first read.  Each read checks the tracks'
+    revisions (see VoiceTrack::GetRevision) and re-merges only the tracks that
+    have changed, been added or been removed.  The VoiceData must outlive the
+    stream.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <bitset>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_event.h"
+#include "core/rocs_midi/voice_data.h"
+
+namespace rocs_midi
+{
+
+struct ROCS_CORE_API MergedVoiceEvent
+{
+    UInt32 abs_time;
+    VoiceMessage message;
+    UInt16 track_id;
+    UInt8 group_id;
+    UInt8 padding;
+
+    VoiceEvent GetVoiceEvent() const { return VoiceEvent(this->abs_time, this->message); }
+};
+
+typedef std::vector<MergedVoiceEvent> MergedVoiceEvtVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<MergedVoiceEvent>);
+
+typedef std::bitset<256> GroupFilterT;
+
+// One bit per track id.
+typedef std::bitset<65536> TrackFilterT;
+
+class ROCS_CORE_API MergedVoiceStream
+{
+public:
+    explicit MergedVoiceStream(const VoiceData &voiceData);
+
+    /* Brings the stream up to date with the VoiceData and returns it. */
+    const MergedVoiceEvtVecT& GetEvents();
+
+    const VoiceData& GetVoiceData() const { return this->voiceData_; }
+
+    /* The number of tracks re-merged by the last update, for tests and
+     * profiling. */
+    size_t GetLastUpdateCount() const { return this->lastUpdateCount_; }
+
+    /* Changes whenever an update changes the events. */
+    UInt64 GetRevision() const { return this->revision_; }
+
+private:
+    struct TrackState
+    {
+        UInt64 revision;
+        UInt8 group_id;
+    };
+
+    typedef std::map<UInt16, TrackState> TrackStateByTrackIdT;
+
+    void update();
+
+    typedef std::vector<std::pair<UInt16, const VoiceTrack*> > TrackVecT;
+
+    /* Merges tracks, each under the track id paired with it. */
+    void merge(const TrackVecT &tracks, MergedVoiceEvtVecT &out) const;
+
+    const VoiceData &voiceData_;
+    size_t lastUpdateCount_;
+    UInt64 revision_;
+    MSC_DISABLE_WARNING(4251);
+    MergedVoiceEvtVecT events_;
+    MergedVoiceEvtVecT scratch_;
+    TrackStateByTrackIdT tracks_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+/* Reads a MergedVoiceStream in order.  Seek is a binary search and Next is
+ * constant time, with or without groups set.  With groups set, the cursor
+ * lists where the events of the tracks read are in the stream, so Next
+ * steps through the list instead of over the tracks left out.  SetGroups
+ * makes the list, as does the first Seek after the stream's tracks or the
+ * groups change; only those allocate.  The cursor reads the events and the
+ * groups as they were at the last Seek or SetGroups, so it must Seek again
+ * after they change. */
+class ROCS_CORE_API MergedVoiceCursor
+{
+public:
+    explicit MergedVoiceCursor(MergedVoiceStream &stream);
+
+    /* Only events of tracks that are members of one of these groups are
+     * read.  Every track is, by default. */
+    void SetGroups(const std::set<UInt8> &groupIds);
+
+    void SetGroups(const GroupFilterT &groups);
+
+    /* The next event read will be the first at or after tick. */
+    void Seek(UInt32 tick);
+
+    /* The next event and moves past it, or nullptr at the end. */
+    const MergedVoiceEvent* Next();
+
+    /* As Next, but nullptr if the next event is at or after tick. */
+    const MergedVoiceEvent* NextBefore(UInt32 tick);
+
+private:
+    /* Where the next event is in the stream, or its size at the end. */
+    size_t position() const;
+
+    /* Lists the events of the tracks in one of groups_ and moves to the
+     * first of them at or after position. */
+    void update_positions(size_t position);
+
+    MergedVoiceStream &stream_;
+    const MergedVoiceEvent *first_;
+    const MergedVoiceEvent *it_;
+    const MergedVoiceEvent *end_;
+    bool filtered_;
+    UInt64 streamRevision_;
+    UInt64 groupsRevision_;
+    size_t next_;
+    MSC_DISABLE_WARNING(4251);
+    GroupFilterT groups_;
+    TrackFilterT tracks_;
+    std::vector<UInt32> positions_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+} // end namespace rocs_midi
@@ -11,9 +11,12 @@
 
 #include <memory>
 #include <algorithm>
+#include <cstddef>
 
 #include "exlib/map_lib.h" // get_keys
 #include "exlib/binary_string_io.h" // ex::ReadString, ex::WriteString
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "exlib/ptr_map.h"
 #include "exlib/numeric_string_compare.h"
 #include "exlib/string_lib.h"
@@ -46,6 +49,18 @@ public:
     ShowDataNonExistError(const std::string& what): ShowDataError(what) {}
 };
 
+/* When a file from version 2.6 on has its songs' checksums checked.  The
+ * show name and song table are checked however the file is opened. */
+enum ShowDataVerification
+{
+    // Every song as the file is opened, reading a lazily opened file once
+    // through.
+    verify_on_open = 0,
+    // Each song as it is read.  A file read at once is checked on open.
+    verify_per_song = 1,
+    verify_none = 2
+};
+
 typedef ex::SortedStringMapT SongNameBySongNumberT;
 
 typedef ex::ptr_map<
@@ -69,51 +84,157 @@ ROCS_CORE_TEMPLATE_DECLSPEC(ex::ptr_map<
 
 typedef ex::MapIters<SongDataBySongNumberT>::value_iterator SongDataIteratorT;
 
+// Reads the songs of a lazily opened ShowData.  Defined in show_data.cpp.
+class SongSource;
+
+/**
+    From version 2.3 a .showdata has a table of songs after the show name:
+    each song's number, name, and the offset and length of its bytes, counted
+    from the end of the table.  ShowData(std::shared_ptr<std::istream>) reads
+    only the header and the table, and reads each song from the stream the
+    first time GetSongData asks for it, so that a large show opens at once.
+    Prefetch reads songs ahead on a background thread.
+
+    From version 2.4 each song, and the events of each VoiceTrack, start on
+    a multiple of 8 bytes.  OpenMapped maps the file and reads it lazily as
+    above, and each VoiceTrack points at its events in the mapping rather
+    than copying them, until something changes them.  A large show then
+    takes little memory beyond the pages that are actually read.
+
+    From version 2.5 a track's events may be written compactly instead, as
+    VoiceTrack::SetEncoding chooses.  Those are decoded when the song is
+    read, mapped or not.  Raw stays the default in every version: compact
+    files are about 40% the size, and load no slower than raw events copied
+    out of memory, as bench/compact_events_bench.cpp measures, but cannot be
+    mapped.
+
+    From version 2.6 the show name and song table are a section that
+    cmn::read_section checks, and the table gives each song's CRC32C.
+    Damage throws cmn::ChecksumError when the file is opened, or, with
+    verify_per_song, when a damaged song is read, so that opening a large
+    show lazily need not read all of it.
+
+    However a song is opened, its bytes are read into memory, or found in
+    the mapping, and parsed with an ex::BinaryReader rather than field by
+    field from the istream.  Only tracks read from a mapping point at their
+    events in place; the rest copy them out of the song's bytes.
+
+    Songs are independent once the song table gives their bytes, so
+    WriteBinary writes each song into its own buffer on a pool of threads
+    before writing them out in order, and reading every song at once, or
+    the rest of them, parses them on the pool as well.  The bytes written
+    are the same as one thread would write.  threads is how many threads to
+    use, as for ex::parallel_for: zero uses every core and one does the work
+    on the calling thread.  Files older than 2.3 are read one song at a time.
+
+    Anything that needs every song at once, GetSongs, the song iterators,
+    WriteBinary and operator==, reads the rest first.  Like the rest of the
+    data classes, a ShowData is not safe to use from two threads at once.
+    Only Prefetch's own thread shares it, and that only touches the stream.
+**/
 class ROCS_CORE_API ShowData
 {
 public:
-    ShowData() {}
+    ShowData(): threads_(0) {}
 
     ShowData(const std::string & show_name)
         :
-        show_name_(show_name)
+        show_name_(show_name),
+        threads_(0)
     {}
 
-    ShowData(std::istream &);
+    /* Reads every song. */
+    ShowData(
+        std::istream &,
+        unsigned threads = 0,
+        ShowDataVerification verify = verify_on_open);
+
+    /* Reads every song out of memory.  If reader has an owner, each
+     * VoiceTrack points at its events in place, as OpenMapped's do. */
+    ShowData(
+        ex::BinaryReader &reader,
+        unsigned threads = 0,
+        ShowDataVerification verify = verify_on_open);
+
+    /* Reads songs as they are asked for, if the file has a song table.
+     * Older files are read at once.  is must be seekable. */
+    ShowData(
+        std::shared_ptr<std::istream> is,
+        unsigned threads = 0,
+        ShowDataVerification verify = verify_on_open);
+
+    /* Maps the file at path and reads it as ShowData(std::shared_ptr<std::istream>)
+     * does.  The mapping lasts as long as the ShowData or any track that
+     * still points into it.  Throws ex::MappedFileError if the file cannot be
+     * mapped. */
+    static std::shared_ptr<ShowData> OpenMapped(
+        const std::string &path,
+        unsigned threads = 0,
+        ShowDataVerification verify = verify_on_open);
 
     void WriteBinary(std::ostream &os, const cmn::FileVersion &) const;
 
+    /* The songs and tracks are aligned to 8 bytes from the start of writer,
+     * which is where the file must start for OpenMapped to use them. */
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &) const;
+
     void WriteString(std::ostream &os) const;
 
     std::string GetShowName() const { return this->show_name_; }
 
     void SetShowName(const std::string &show_name) { this->show_name_ = show_name; }
 
+    unsigned GetThreads() const { return this->threads_; }
+
+    /* The number of threads that write songs, and read the rest of them. */
+    void SetThreads(unsigned threads) { this->threads_ = threads; }
+
     std::vector<std::string> GetSongNumbers() const
     {
+        if (this->source_) return ex::get_keys(this->songNameBySongNumber_);
         return ex::get_keys(this->songDataBySongNumber_);
     }
-    
+
     SongNameBySongNumberT GetSongNamesBySongNumber() const
     {
         return this->songNameBySongNumber_;
     }
 
+    /* Reads the song first if it has not been read yet. */
     const SongData& GetSongData(const std::string &song_num) const;
 
+    bool IsSongLoaded(const std::string &song_num) const;
+
+    /* Starts reading, on a background thread, up to count songs after
+     * song_num in song number order that have not been read yet. */
+    void Prefetch(const std::string &song_num, size_t count) const;
+
+    /* Waits for every Prefetch to finish. */
+    void WaitForPrefetch() const;
+
     void AddSongData(SongDataPtrT song_data_ptr);
 
-    const SongDataBySongNumberT & GetSongs() const { return this->songDataBySongNumber_; }
+    const SongDataBySongNumberT & GetSongs() const
+    {
+        this->load_all();
+        return this->songDataBySongNumber_;
+    }
 
-    SongDataBySongNumberT& GetSongs() { return this->songDataBySongNumber_; }
+    SongDataBySongNumberT& GetSongs()
+    {
+        this->load_all();
+        return this->songDataBySongNumber_;
+    }
 
     SongDataIteratorT GetSongDataBegin() const
     {
+        this->load_all();
         return SongDataIteratorT(this->songDataBySongNumber_.begin());
     }
 
     SongDataIteratorT GetSongDataEnd() const
     {
+        this->load_all();
         return SongDataIteratorT(this->songDataBySongNumber_.end());
     }
 
@@ -122,11 +243,25 @@ public:
     std::string fh_file_name() const;
 
 protected:
+    /* source is the stream to read songs from lazily, or nullptr to read
+     * them all from is now. */
+    template<class InputT>
+    void read_binary(InputT &is, std::shared_ptr<std::istream> source, ShowDataVerification verify);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &) const;
+
+    /* Moves every song the source has into songDataBySongNumber_ and lets go
+     * of the source. */
+    void load_all() const;
+
 	MSC_DISABLE_WARNING(4251);
 	std::string show_name_;
+    mutable std::shared_ptr<SongSource> source_;
 	MSC_RESTORE_WARNING(4251);
-    SongDataBySongNumberT songDataBySongNumber_; 
+    mutable SongDataBySongNumberT songDataBySongNumber_;
     SongNameBySongNumberT songNameBySongNumber_; 
+    unsigned threads_;
 };
 
 ROCS_CORE_API bool operator==(const ShowData& lhs, const ShowData& rhs);
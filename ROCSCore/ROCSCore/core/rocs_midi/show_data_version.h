@@ -8,7 +8,7 @@ namespace rocs_midi
 
 const UInt8 major_file_version = 2;
 
-const UInt8 minor_file_version = 0;
+const UInt8 minor_file_version = 6;
 
 const UInt8 minimum_major_file_version = 1;
 
@@ -56,6 +56,8 @@ public:
     }
 
     SongData(std::istream &is, const cmn::FileVersion &);
+
+    SongData(ex::BinaryReader &reader, const cmn::FileVersion &);
  
     SongData(const std_midi::MIDIFile& mf);
 
@@ -64,6 +66,8 @@ public:
     void WriteString(std::ostream&) const;
  
     void WriteBinary(std::ostream &, const cmn::FileVersion &) const;
+
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &) const;
  
     void WriteStringTracks(std::ostream& os, int indent) const;
  
@@ -94,6 +98,12 @@ public:
     UInt32 GetBarOne() const { return this->timeline_->GetBarOne(this->ppqn_); }
  
 private:
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &) const;
+
 	MSC_DISABLE_WARNING(4251);
 	std::string song_number_;
     std::string song_name_;
@@ -0,0 +1,70 @@
+#pragma once
+
+/**
+    Transposition of VoiceEvents.  Only note on, note off and polyphonic
+    aftertouch messages are transposed, and only if their note is within the
+    track's range.  A note moved outside the range is wrapped back into it by
+    an octave.  Note numbers are bytes, so the arithmetic wraps at 256 as it
+    always has.
+
+    transpose_voice_events does whole buffers at once, 4 events per step with
+    AVX2 or 2 with SSE2, when the build targets them.  Otherwise it runs the
+    same loop as transpose_voice_event.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <utility>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_event.h"
+#include "core/std_midi/status_bytes.h"
+
+namespace rocs_midi
+{
+
+typedef std::pair<UInt8, UInt8> VoiceRangeT;
+ROCS_CORE_STRUCT_TEMPLATE_DECLSPEC(std::pair<UInt8, UInt8>);
+
+inline bool is_transposable(const VoiceEvent &voiceEvent)
+{
+    Byte statusType = voiceEvent.GetStatusType();
+    return statusType == std_midi::sb::note_off
+        || statusType == std_midi::sb::note_on
+        || statusType == std_midi::sb::aftertouch;
+}
+
+inline void transpose_voice_event(VoiceEvent &voiceEvent, SInt8 transpose, const VoiceRangeT &range)
+{
+    if (is_transposable(voiceEvent)
+        && (range.first <= voiceEvent.GetData1())
+        && (voiceEvent.GetData1() <= range.second))
+    {
+        voiceEvent.GetVoiceMessage().data1_ += transpose;
+        if (voiceEvent.GetData1() < range.first)
+        {
+            voiceEvent.GetVoiceMessage().data1_ += 12;
+        } else if (voiceEvent.GetData1() > range.second)
+        {
+            voiceEvent.GetVoiceMessage().data1_ -= 12;
+        }
+    }
+}
+
+/* Transposes count events from in into out, which may be in. */
+ROCS_CORE_API void transpose_voice_events(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range);
+
+/* The portable loop, for comparison with transpose_voice_events. */
+ROCS_CORE_API void transpose_voice_events_scalar(
+    const VoiceEvent *in,
+    VoiceEvent *out,
+    size_t count,
+    SInt8 transpose,
+    const VoiceRangeT &range);
+
+} // end namespace rocs_midi
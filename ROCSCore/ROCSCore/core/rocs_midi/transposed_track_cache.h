@@ -0,0 +1,100 @@
+#pragma once
+
+/**
+    TransposedTrackCache keeps whole VoiceTracks already transposed, so that
+    playback can switch keys without transposing every slice it reads.  A
+    track has at most 12 transposed renderings, one for each transpose from
+    -6 to 6 but 0.  Renderings are made when first asked for, or ahead of
+    time with Prepare, and the least recently used are dropped once the cache
+    holds more than its budget of bytes.  The most recently used rendering is
+    always kept, even if it alone is over budget.
+
+    Entries are keyed by the VoiceTrack's address and remember its revision,
+    so a rendering whose track's range or events have changed since is made
+    again the next time it is asked for.  A track that is destroyed should be
+    passed to Invalidate first, or its renderings will hold memory until they
+    are evicted.
+
+    The cache is not thread safe.  The spans and slices it returns are valid
+    until the next call that is not const.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <list>
+#include <map>
+#include <utility>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_track.h"
+#include "core/rocs_midi/voice_data.h"
+
+namespace rocs_midi
+{
+
+class ROCS_CORE_API TransposedTrackCache
+{
+public:
+    explicit TransposedTrackCache(size_t budget = 16 * 1024 * 1024);
+
+    /* All of track's events, transposed.  Throws range_error as
+     * VoiceTrack::Slice does.  If track does not transpose, this is its own
+     * events and nothing is cached. */
+    VoiceEventSpan Get(const VoiceTrack &track, SInt8 transpose);
+
+    /* The same events as track.Slice(start, end, transpose), read from the
+     * cached rendering. */
+    VoiceEventSlice Slice(const VoiceTrack &track, SInt64 start, SInt64 end, SInt8 transpose);
+
+    /* Makes the renderings of every track in voiceData for transpose. */
+    void Prepare(const VoiceData &voiceData, SInt8 transpose);
+
+    /* True if Get would not have to transpose. */
+    bool Contains(const VoiceTrack &track, SInt8 transpose) const;
+
+    void Invalidate(const VoiceTrack &track);
+
+    void Clear();
+
+    size_t GetBudget() const { return this->budget_; }
+
+    void SetBudget(size_t budget);
+
+    /* The memory held by the cached renderings. */
+    size_t GetBytes() const { return this->bytes_; }
+
+    size_t size() const { return this->entries_.size(); }
+
+private:
+    struct Entry
+    {
+        const VoiceTrack *track;
+        SInt8 transpose;
+        UInt64 revision;
+        VoiceEvtVecT events;
+    };
+
+    typedef std::pair<const VoiceTrack*, SInt8> KeyT;
+    typedef std::list<Entry> EntryListT;
+    typedef std::map<KeyT, EntryListT::iterator> EntryIndexT;
+
+    static size_t bytes(const Entry &entry)
+    {
+        return entry.events.capacity() * sizeof(VoiceEvent);
+    }
+
+    VoiceEventSpan get(const VoiceTrack &track, const VoiceEventSlice &all);
+
+    void erase(EntryIndexT::iterator it);
+
+    void evict();
+
+    size_t budget_;
+    size_t bytes_;
+    MSC_DISABLE_WARNING(4251);
+    EntryListT entries_;
+    EntryIndexT index_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+} // end namespace rocs_midi
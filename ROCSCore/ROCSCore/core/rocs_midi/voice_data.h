@@ -7,6 +7,7 @@
 #include <map>
 #include <list>
 #include <set>
+#include <vector>
 
 #include <memory>
 
@@ -15,9 +16,9 @@
 #include <algorithm>
 #include "exlib/xplatform_types.h"
 #include "exlib/binary_string_io.h"
-#include "exlib/ptr_map.h"
 #include "exlib/map_iters.h"
 #include "core/rocs_midi/voice_track.h"
+#include "core/rocs_midi/voice_track_table.h"
 #include "core/rocs_midi/rocs_midi_exception.h"
 #include "core/rocs_midi/groups.h"
 #include "core/std_midi/midi_file.h"
@@ -38,37 +39,56 @@ public:
     DuplicateTrackID(const std::string& what): VoiceDataError(what) {}
 };
 
-typedef ex::ptr_map<UInt16, VoiceTrack> VoiceTrackByTrackIdT;
+// Tracks by track id, kept in one vector in track id order.
+typedef VoiceTrackTable VoiceTrackByTrackIdT;
 
-// The map type wrapped by ex::ptr_map
-ROCS_CORE_TEMPLATE_DECLSPEC(std::map <
-    UInt16,	
-	std::shared_ptr<VoiceTrack>,
-	std::less<UInt16>,
-	std::allocator < std::pair<const UInt16, VoiceTrack>>>);
-
-ROCS_CORE_TEMPLATE_DECLSPEC(ex::ptr_map<
-    UInt16,
-    VoiceTrack,
-    std::less<UInt16>,
-	std::allocator < std::pair<const UInt16, VoiceTrack>>>);
-
-// ROCS_CORE_TEMPLATE_DECLSPEC(EXLIB_PTR_MAP_CONTAINER_T(UInt16, VoiceTrack));
 typedef ex::MapIters<VoiceTrackByTrackIdT>::key_iterator TrackIdIterator;
 typedef ex::MapIters<VoiceTrackByTrackIdT>::value_iterator TrackIterator;
 
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<const VoiceTrack*>);
+
+/* The tracks of one group, in track id order, without copying them.  A
+ * GroupView is good until the VoiceData's tracks or groups change. */
+class ROCS_CORE_API GroupView
+{
+public:
+    typedef const VoiceTrack* const* const_iterator;
+
+    GroupView(): first_(nullptr), last_(nullptr) {}
+
+    GroupView(const_iterator first, const_iterator last): first_(first), last_(last) {}
+
+    const_iterator begin() const { return this->first_; }
+
+    const_iterator end() const { return this->last_; }
+
+    size_t size() const { return this->last_ - this->first_; }
+
+    bool empty() const { return this->first_ == this->last_; }
+
+    const VoiceTrack& operator[](size_t n) const { return *this->first_[n]; }
+
+private:
+    const_iterator first_;
+    const_iterator last_;
+};
+
 class ROCS_CORE_API VoiceData
 {
 public:
-    VoiceData() {}
+    VoiceData(): tracksRevision_(next_revision()) {}
  
     VoiceData(const std_midi::MIDIFile &midiFile);
  
     VoiceData(std::istream &, const cmn::FileVersion &);
+
+    VoiceData(ex::BinaryReader &, const cmn::FileVersion &);
  
     ~VoiceData() {}
  
     void WriteBinary(std::ostream &os, const cmn::FileVersion &) const;
+
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &) const;
  
     void WriteString(std::ostream &os) const;
  
@@ -87,7 +107,12 @@ public:
     // tracks are stored as a Map with track_id as key, and VoiceTrack as value
     const VoiceTrackByTrackIdT& GetTracks() const { return this->voiceTracksByTrackId_; }
  
-    VoiceTrackByTrackIdT& GetTracks() { return this->voiceTracksByTrackId_; }
+    /* Counts as a change to the tracks. */
+    VoiceTrackByTrackIdT& GetTracks()
+    {
+        this->tracksRevision_ = next_revision();
+        return this->voiceTracksByTrackId_;
+    }
 
     // Iterate over just the track_ids
     TrackIdIterator GetTrackIdsBegin() const
@@ -116,13 +141,67 @@ public:
  
     const VoiceTrackPtrVecT GetGroup(UInt8 group_id) const;
 
+    /* The tracks of group_id, or an empty view if there is no such group.
+     * The views of every group are made together the first time one is
+     * asked for after the tracks or groups change, and after that this does
+     * not allocate.  Like the rest of VoiceData, not safe to call from two
+     * threads at once. */
+    GroupView GetGroupView(UInt8 group_id) const;
+
     const Groups& GetGroups() const { return this->groups_; }
+
+    /* Calls VoiceTrack::BuildTimeIndex on every track. */
+    void BuildTimeIndexes(UInt32 bucketTicks);
+
+    /* The memory held by the tracks' time indexes. */
+    size_t GetTimeIndexBytes() const;
+
+    /* Calls VoiceTrack::SetEncoding on every track. */
+    void SetEncodings(VoiceEventEncoding encoding);
  
     Groups& GetGroups() { return this->groups_; }
 
 protected:
+    /* The tracks of every group, one group after another, and where each
+     * group starts.  A copy starts out of date, since its pointers would be
+     * to the other VoiceData's tracks. */
+    struct GroupViewCache
+    {
+        GroupViewCache(): tracksRevision(0), groupsRevision(0) {}
+
+        GroupViewCache(const GroupViewCache &): tracksRevision(0), groupsRevision(0) {}
+
+        GroupViewCache& operator=(const GroupViewCache &)
+        {
+            this->tracksRevision = 0;
+            this->groupsRevision = 0;
+            return *this;
+        }
+
+        UInt64 tracksRevision;
+        UInt64 groupsRevision;
+        MSC_DISABLE_WARNING(4251);
+        std::vector<const VoiceTrack*> tracks;
+
+        // Group g is tracks[offsets[g]] up to tracks[offsets[g + 1]].
+        std::vector<UInt32> offsets;
+        MSC_RESTORE_WARNING(4251);
+    };
+
+    static UInt64 next_revision();
+
+    void update_group_views() const;
+
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &) const;
+
     VoiceTrackByTrackIdT voiceTracksByTrackId_;
     Groups groups_;
+    UInt64 tracksRevision_;
+    mutable GroupViewCache groupViews_;
 };
 
 
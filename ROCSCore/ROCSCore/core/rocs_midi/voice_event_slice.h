@@ -0,0 +1,186 @@
+#pragma once
+
+/**
+    VoiceEventSlice is a view of a run of a VoiceTrack's events that transposes
+    them as they are read.  It does not copy or own the events, so it is only
+    valid while the VoiceTrack is alive and unchanged.  Making a slice is a
+    binary search; reading it costs one transposition per event read, and
+    CopyTo transposes the whole run with transpose_voice_events.
+
+    VoiceEventSpan is the same kind of view without the transposition, which
+    is what a const VoiceTrack gives for all of its events, so that reading
+    them never copies them out of a mapped file.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_event.h"
+#include "core/rocs_midi/transpose_voice_events.h"
+
+namespace rocs_midi
+{
+
+class VoiceEventSpan
+{
+public:
+    typedef VoiceEvent value_type;
+    typedef const VoiceEvent* iterator;
+    typedef const VoiceEvent* const_iterator;
+
+    VoiceEventSpan(): first_(nullptr), last_(nullptr) {}
+
+    VoiceEventSpan(const VoiceEvent *first, size_t count)
+        :
+        first_(first),
+        last_(first + count)
+    {}
+
+    VoiceEventSpan(const VoiceEvtVecT &events)
+        :
+        first_(events.data()),
+        last_(events.data() + events.size())
+    {}
+
+    const_iterator begin() const { return this->first_; }
+
+    const_iterator end() const { return this->last_; }
+
+    size_t size() const { return this->last_ - this->first_; }
+
+    bool empty() const { return this->first_ == this->last_; }
+
+    const VoiceEvent* data() const { return this->first_; }
+
+    const VoiceEvent& operator[](size_t n) const { return this->first_[n]; }
+
+    const VoiceEvent& at(size_t n) const
+    {
+        if (n >= this->size()) throw std::out_of_range("VoiceEventSpan::at");
+        return this->first_[n];
+    }
+
+    const VoiceEvent& front() const { return *this->first_; }
+
+    const VoiceEvent& back() const { return *(this->last_ - 1); }
+
+    VoiceEvtVecT ToVector() const { return VoiceEvtVecT(this->first_, this->last_); }
+
+private:
+    const VoiceEvent *first_;
+    const VoiceEvent *last_;
+};
+
+inline bool operator==(const VoiceEventSpan &a, const VoiceEventSpan &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+inline bool operator!=(const VoiceEventSpan &a, const VoiceEventSpan &b)
+{
+    return !(a == b);
+}
+
+class ROCS_CORE_API VoiceEventSlice
+{
+public:
+    /* Yields each event by value, already transposed. */
+    class const_iterator : public std::iterator<std::input_iterator_tag, VoiceEvent>
+    {
+    public:
+        const_iterator(): it_(nullptr), slice_(nullptr) {}
+
+        const_iterator(const VoiceEvent *it, const VoiceEventSlice *slice)
+            :
+            it_(it),
+            slice_(slice)
+        {}
+
+        VoiceEvent operator*() const { return this->slice_->transposed(*this->it_); }
+
+        const_iterator& operator++() { ++this->it_; return *this; }
+
+        const_iterator operator++(int) { const_iterator tmp(*this); ++this->it_; return tmp; }
+
+        bool operator==(const const_iterator &other) const { return this->it_ == other.it_; }
+
+        bool operator!=(const const_iterator &other) const { return this->it_ != other.it_; }
+
+    private:
+        const VoiceEvent *it_;
+        const VoiceEventSlice *slice_;
+    };
+
+    VoiceEventSlice()
+        :
+        first_(nullptr),
+        last_(nullptr),
+        transpose_(0),
+        range_(std::make_pair(255, 255))
+    {}
+
+    /* transpose is applied only if range is a valid range, as
+     * VoiceTrack::EventSlice always has. */
+    VoiceEventSlice(
+        const VoiceEvent *first,
+        const VoiceEvent *last,
+        SInt8 transpose,
+        const VoiceRangeT &range)
+        :
+        first_(first),
+        last_(last),
+        transpose_(range.first < range.second ? transpose : 0),
+        range_(range)
+    {}
+
+    const_iterator begin() const { return const_iterator(this->first_, this); }
+
+    const_iterator end() const { return const_iterator(this->last_, this); }
+
+    size_t size() const { return this->last_ - this->first_; }
+
+    bool empty() const { return this->first_ == this->last_; }
+
+    VoiceEvent operator[](size_t n) const { return this->transposed(this->first_[n]); }
+
+    SInt8 GetTranspose() const { return this->transpose_; }
+
+    /* The events as stored, before transposition. */
+    const VoiceEvent *raw_begin() const { return this->first_; }
+
+    const VoiceEvent *raw_end() const { return this->last_; }
+
+    /* Replaces the contents of out with the transposed events.  out keeps
+     * its capacity, so a buffer reused from call to call stops allocating
+     * once it is large enough. */
+    void CopyTo(VoiceEvtVecT &out) const;
+
+    /* Writes up to capacity transposed events to out and returns how many
+     * were written. */
+    size_t CopyTo(VoiceEvent *out, size_t capacity) const;
+
+private:
+    VoiceEvent transposed(const VoiceEvent &voiceEvent) const
+    {
+        VoiceEvent result(voiceEvent);
+        if (this->transpose_)
+        {
+            transpose_voice_event(result, this->transpose_, this->range_);
+        }
+
+        return result;
+    }
+
+    const VoiceEvent *first_;
+    const VoiceEvent *last_;
+    SInt8 transpose_;
+    VoiceRangeT range_;
+};
+
+} // end namespace rocs_midi
@@ -19,9 +19,12 @@
 
 #include <cstdlib> // abs
 #include "exlib/binary_string_io.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 #include "exlib/ptr_vector.h"
 #include "core/common/warnings.h"
 #include "core/rocs_midi/voice_event.h"
+#include "core/rocs_midi/voice_event_slice.h"
 
 #include "core/rocs_midi/rocs_midi_exception.h"
 #include "core/std_midi/midi_track.h"
@@ -61,29 +64,63 @@ public:
     MissingEvents(const std::string& what): VoiceTrackException(what) {}
 };
 
-typedef std::pair<UInt8, UInt8> VoiceRangeT;
-ROCS_CORE_STRUCT_TEMPLATE_DECLSPEC(std::pair<UInt8, UInt8>);
+/* How a track's events are written from show data version 2.5.  The values
+ * are the ones written. */
+enum VoiceEventEncoding
+{
+    // As VoiceEvents, which OpenMapped can read in place.  The default.
+    raw_events = 0,
+
+    // As compact_voice_events.h describes, which is smaller but must be
+    // decoded when it is read, and so cannot be mapped.  Decoding is about
+    // as fast as copying raw events out of memory, so it is worth it where
+    // the file comes off slow storage or over a network.
+    compact_events = 1
+};
 
 class ROCS_CORE_API VoiceTrack
 {
 public:
-    VoiceTrack() {}
+    VoiceTrack()
+        :
+        mapped_events_(nullptr),
+        mapped_count_(0),
+        revision_(next_revision()),
+        index_ticks_(0),
+        index_revision_(0),
+        encoding_(raw_events)
+    {}
 
     VoiceTrack(UInt16 track_id_, const std::string &track_name_)
         :
         track_id_(track_id_),
         track_name_(track_name_),
         range_(std::make_pair(255, 255)),
-        has_channel_number_(false)
+        mapped_events_(nullptr),
+        mapped_count_(0),
+        has_channel_number_(false),
+        revision_(next_revision()),
+        index_ticks_(0),
+        index_revision_(0),
+        encoding_(raw_events)
     {}
     
+    /* If is reads from a cmn::MappedStreamBuf and the events are aligned,
+     * the track points at them where they are instead of copying them, and
+     * holds the buffer's owner.  They are copied the first time something
+     * changes them, such as the GetEvents that is not const. */
     VoiceTrack(std::istream &is, const cmn::FileVersion &);
 
+    /* The same, pointing at the events in place if reader has an owner. */
+    VoiceTrack(ex::BinaryReader &reader, const cmn::FileVersion &);
+
     // Only used for packaging a show from MIDI files
     VoiceTrack(const std_midi::MIDITrack &t);
 
     void WriteBinary(std::ostream &o, const cmn::FileVersion &) const;
 
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &) const;
+
     void WriteString(std::ostream &o) const;
 
     void WriteStringEvents(std::ostream &o, int indent) const;
@@ -98,15 +135,15 @@ public:
 
     VoiceRangeT GetRange() const { return this->range_; }
 
-    void SetRange(const VoiceRangeT &r) { this->range_ = r; }
+    void SetRange(const VoiceRangeT &r) { this->range_ = r; this->touch(); }
 
     UInt8 GetRangeLow() const { return this->range_.first; }
 
-    void SetRangeLow(UInt8 lo) { this->range_.first = lo; }
+    void SetRangeLow(UInt8 lo) { this->range_.first = lo; this->touch(); }
 
     UInt8 GetRangeHigh() const { return this->range_.second; }
 
-    void SetRangeHigh(UInt8 hi) { this->range_.second = hi; }
+    void SetRangeHigh(UInt8 hi) { this->range_.second = hi; this->touch(); }
 
     UInt8 GetPort() const { return track_id_ >> 4; }
 
@@ -114,11 +151,75 @@ public:
 
     void SetGroupId(UInt8 id) { this->group_id_ = id; }
 
+    /* The events from start to end inclusive, transposed.  A negative start
+     * or end leaves that side open.  Throws range_error if transpose is more
+     * than 6 semitones either way and the track has a range. */
+    VoiceEventSlice Slice(SInt64 start=-1, SInt64 end=-1, SInt8 transpose=0) const;
+
+    /* As Slice, copied into out, which keeps its capacity. */
+    void EventSlice(VoiceEvtVecT &out, SInt64 start=-1, SInt64 end=-1, SInt8 transpose=0) const;
+
+    /* As Slice, copied into a new vector. */
     VoiceEvtVecT EventSlice(SInt64 start=-1, SInt64 end=-1, SInt8 transpose=0) const;
 
-    const VoiceEvtVecT& GetEvents() const { return this->events_; }
+    /* The events, wherever they are, without copying them.  The span is
+     * valid while the track is alive and unchanged. */
+    VoiceEventSpan GetEvents() const
+    {
+        return VoiceEventSpan(this->GetEventData(), this->GetEventCount());
+    }
+
+    /* Counts as a change to the events, whether or not the caller makes
+     * one.  Call it again rather than holding the reference across a change
+     * that a TransposedTrackCache must see. */
+    VoiceEvtVecT& GetEvents() { this->copy_mapped(); this->touch(); return this->events_; }
+
+    /* The events, wherever they are. */
+    const VoiceEvent* GetEventData() const
+    {
+        return this->mapped_events_ ? this->mapped_events_ : this->events_.data();
+    }
+
+    size_t GetEventCount() const
+    {
+        return this->mapped_events_ ? this->mapped_count_ : this->events_.size();
+    }
+
+    /* True while the events are read from a mapped file. */
+    bool IsMapped() const { return this->mapped_events_ != nullptr; }
+
+    /* Makes an index of where each run of bucketTicks ticks starts in the
+     * events, so that Slice finds its bounds with one lookup and a search of
+     * one bucket instead of a search of the whole track.  0 removes the
+     * index.  The index is ignored once the events change, until it is made
+     * again. */
+    void BuildTimeIndex(UInt32 bucketTicks);
+
+    /* Makes the index again if the events have changed since it was made. */
+    void UpdateTimeIndex();
+
+    bool HasTimeIndex() const
+    {
+        return this->index_ticks_ && this->index_revision_ == this->revision_;
+    }
+
+    UInt32 GetTimeIndexTicks() const { return this->index_ticks_; }
+
+    /* The memory held by the index. */
+    size_t GetTimeIndexBytes() const { return this->index_.capacity() * sizeof(UInt32); }
+
+    VoiceEventEncoding GetEncoding() const { return this->encoding_; }
 
-    VoiceEvtVecT& GetEvents() { return this->events_; }
+    /* How WriteBinary writes the events, from show data version 2.5.  A new
+     * track is raw_events, and a track read from a file has the encoding it
+     * was read with, so compact_events is only written where a caller asks
+     * for it.  Events that cannot be written compactly, because they are
+     * out of time order, are written raw. */
+    void SetEncoding(VoiceEventEncoding encoding) { this->encoding_ = encoding; }
+
+    /* Changes whenever the range or the events may have changed.  No two
+     * tracks share a revision unless one is a copy of the other. */
+    UInt64 GetRevision() const { return this->revision_; }
 
     // Only used for packaging a show from MIDI files
     bool HasChannelNumber() const { return this->has_channel_number_; }
@@ -132,6 +233,23 @@ public:
     }
 
 private:
+    static UInt64 next_revision();
+
+    void touch() { this->revision_ = next_revision(); }
+
+    /* Copies mapped events into events_ and lets go of the mapping. */
+    void copy_mapped();
+
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &) const;
+
+    /* The index of the first event at or after tick, or after tick if
+     * after is true. */
+    size_t find(SInt64 tick, bool after, size_t first) const;
+
     UInt16 track_id_;
 	MSC_DISABLE_WARNING(4251);
 	std::string track_name_;
@@ -139,8 +257,22 @@ private:
     VoiceRangeT range_;
     UInt8 group_id_;
     VoiceEvtVecT events_;
+
+    // Events in a mapped file, used in place of events_ until they change.
+    const VoiceEvent *mapped_events_;
+    size_t mapped_count_;
+    MSC_DISABLE_WARNING(4251);
+    std::shared_ptr<const void> mapped_owner_;
+    MSC_RESTORE_WARNING(4251);
     bool has_channel_number_;
     UInt16 channel_number_;
+    UInt64 revision_;
+    UInt32 index_ticks_;
+    UInt64 index_revision_;
+    MSC_DISABLE_WARNING(4251);
+    std::vector<UInt32> index_;
+    MSC_RESTORE_WARNING(4251);
+    VoiceEventEncoding encoding_;
 };
 
 ROCS_CORE_API bool operator==(const VoiceTrack& lhs, const VoiceTrack& rhs);
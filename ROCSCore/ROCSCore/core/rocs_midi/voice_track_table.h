@@ -0,0 +1,138 @@
+#pragma once
+
+/**
+    VoiceTrackTable holds a VoiceData's tracks by track id.  It has the parts
+    of ex::ptr_map's interface VoiceData's callers use, and ex::MapIters works
+    on it, but the tracks are kept in one vector sorted by track id, so going
+    through them reads memory in order.
+
+    Track ids are usually 0 to N-1, so next to the vector is a slot for every
+    id up to the largest, holding where that track is.  Finding a track is
+    then one array lookup.  If the ids are too spread out for that to be worth
+    the memory, there are no slots, and finding a track is a binary search.
+
+    Unlike a map, insert and erase move the tracks after the one they change,
+    so they invalidate iterators.  The track id in an entry must not be
+    changed through an iterator.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+#include "core/rocs_midi/voice_track.h"
+
+namespace rocs_midi
+{
+
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<std::pair<UInt16, std::shared_ptr<VoiceTrack>>>);
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<UInt32>);
+
+class ROCS_CORE_API VoiceTrackTable
+{
+public:
+    typedef UInt16                                  key_type;
+    typedef VoiceTrackPtrT                          mapped_type;
+    typedef std::pair<UInt16, VoiceTrackPtrT>       value_type;
+    typedef std::vector<value_type>                 EntryVecT;
+    typedef EntryVecT::size_type                    size_type;
+    typedef EntryVecT::difference_type              difference_type;
+    typedef EntryVecT::iterator                     iterator;
+    typedef EntryVecT::const_iterator               const_iterator;
+    typedef EntryVecT::reverse_iterator             reverse_iterator;
+    typedef EntryVecT::const_reverse_iterator       const_reverse_iterator;
+
+    VoiceTrackTable() {}
+
+public: // capacity
+    size_type size() const { return this->entries_.size(); }
+
+    bool empty() const { return this->entries_.empty(); }
+
+    /* True if finding a track is an array lookup rather than a search. */
+    bool IsDense() const { return !this->slots_.empty() || this->entries_.empty(); }
+
+public: // modifiers
+    void clear();
+
+    /* Makes room for count tracks with ids 0 to count-1, so that reading
+     * them allocates nothing more. */
+    void reserve(size_type count);
+
+    /* Does nothing and returns false if there is already a track trackId. */
+    std::pair<iterator, bool> insert(UInt16 trackId, VoiceTrackPtrT voiceTrackPtr);
+
+    std::pair<iterator, bool> insert(UInt16 trackId, VoiceTrack *voiceTrack)
+    {
+        return this->insert(trackId, VoiceTrackPtrT(voiceTrack));
+    }
+
+    std::pair<iterator, bool> insert(const value_type &entry)
+    {
+        return this->insert(entry.first, entry.second);
+    }
+
+    size_type erase(UInt16 trackId);
+
+    void erase(iterator position);
+
+public: // lookup
+    /* Throw out_of_range if there is no track trackId. */
+    VoiceTrack& at(UInt16 trackId);
+
+    const VoiceTrack& at(UInt16 trackId) const;
+
+    VoiceTrackPtrT pat(UInt16 trackId) const;
+
+    iterator find(UInt16 trackId) { return this->entries_.begin() + this->position(trackId); }
+
+    const_iterator find(UInt16 trackId) const { return this->entries_.begin() + this->position(trackId); }
+
+    size_type count(UInt16 trackId) const { return this->position(trackId) != this->entries_.size(); }
+
+public: // iterators
+    iterator begin() { return this->entries_.begin(); }
+
+    const_iterator begin() const { return this->entries_.begin(); }
+
+    iterator end() { return this->entries_.end(); }
+
+    const_iterator end() const { return this->entries_.end(); }
+
+    reverse_iterator rbegin() { return this->entries_.rbegin(); }
+
+    const_reverse_iterator rbegin() const { return this->entries_.rbegin(); }
+
+    reverse_iterator rend() { return this->entries_.rend(); }
+
+    const_reverse_iterator rend() const { return this->entries_.rend(); }
+
+private:
+    static const UInt32 no_track = 0xFFFFFFFF;
+
+    /* Where trackId is in entries_, or entries_.size(). */
+    size_t position(UInt16 trackId) const
+    {
+        if (this->slots_.empty()) return this->search(trackId);
+        if (trackId >= this->slots_.size()) return this->entries_.size();
+        UInt32 slot = this->slots_[trackId];
+        return slot == no_track ? this->entries_.size() : slot;
+    }
+
+    size_t search(UInt16 trackId) const;
+
+    /* Brings slots_ up to date after the entries from first on have moved,
+     * so that adding tracks in id order costs one slot each.  An erased
+     * track's slot must already be cleared. */
+    void update_slots(size_t first);
+
+    MSC_DISABLE_WARNING(4251);
+    EntryVecT entries_;
+    std::vector<UInt32> slots_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+} // end namespace rocs_midi
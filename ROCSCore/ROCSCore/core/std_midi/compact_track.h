@@ -0,0 +1,186 @@
+#pragma once
+
+/**
+    CompactTrack is an alternative to MIDITrack for callers that read many
+    tracks and do not need MIDIPacket objects.  A MIDITrack stores every meta
+    message as a heap allocated MetaMessage behind a shared_ptr, and every
+    packet owns two vectors.  A CompactTrack stores the whole track in three
+    contiguous arrays: one CompactEvent per message, one CompactPacket per
+    delta time, and a byte arena holding the payloads of the meta messages.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "exlib/xplatform_types.h"
+#include "core/std_midi/utility.h"
+#include "core/std_midi/status_bytes.h"
+#include "core/std_midi/meta_messages.h"
+#include "core/std_midi/voice_message.h"
+#include "core/std_midi/midi_packet.h"
+
+namespace std_midi {
+
+enum CompactEventKind
+{
+    compact_voice = 0,
+    compact_meta = 1
+};
+
+/* One message of a CompactTrack.
+ * Voice messages: status, data1 and data2 are the VoiceMessage fields.
+ * Meta messages: status is the meta type, data1 is the payload length and
+ * offset is the position of the payload in the track's byte arena. */
+struct ROCS_CORE_API CompactEvent
+{
+    Byte    kind;
+    Byte    status;
+    Byte    data1;
+    Byte    data2;
+    UInt32  offset;
+
+    bool is_meta() const { return kind == compact_meta; }
+
+    bool is_voice() const { return kind == compact_voice; }
+
+    Byte length() const { return data1; }
+
+    VoiceMessage voice_message() const
+    {
+        return VoiceMessage(status, data1, data2);
+    }
+};
+
+/* The events that share one delta time are stored consecutively, starting at
+ * first_event. */
+struct ROCS_CORE_API CompactPacket
+{
+    UInt32  delta_time;
+    UInt32  first_event;
+};
+
+typedef std::vector<CompactEvent> CompactEventVecT;
+typedef std::vector<CompactPacket> CompactPacketVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<CompactEvent>);
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<CompactPacket>);
+
+/* A non-owning view of a meta message in a CompactTrack.  The typed accessors
+ * return what the corresponding MetaMessage subclass would return for the
+ * same bytes, and zero or an empty string for other meta types, as the
+ * MetaMessage base class does. */
+class ROCS_CORE_API CompactMeta
+{
+public:
+    CompactMeta(Byte status, const Byte *bytes, Byte length)
+        :
+        status_(status),
+        length_(length),
+        bytes_(bytes)
+    {
+
+    }
+
+    Byte status() const { return status_; }
+
+    Byte length() const { return length_; }
+
+    const Byte *bytes() const { return bytes_; }
+
+    std::string message() const;
+
+    UInt32 microseconds() const;
+
+    UInt8 numerator() const { return time_signature_byte(0); }
+
+    UInt8 denominator() const { return time_signature_byte(1); }
+
+    UInt8 clocksPerClick() const { return time_signature_byte(2); }
+
+    UInt8 notated32nds() const { return time_signature_byte(3); }
+
+    SInt8 sharps() const { return key_signature_byte(0); }
+
+    UInt8 mode() const { return key_signature_byte(1); }
+
+    /* Creates the equivalent MetaMessage, as read_meta_message would. */
+    MetaMsgPtrT ToMetaMessage() const;
+
+private:
+    UInt8 time_signature_byte(int index) const
+    {
+        return (status_ == sb::time_signature && index < length_) ? bytes_[index] : 0;
+    }
+
+    UInt8 key_signature_byte(int index) const
+    {
+        return (status_ == sb::key_signature && index < length_) ? bytes_[index] : 0;
+    }
+
+    Byte status_;
+    Byte length_;
+    const Byte *bytes_;
+};
+
+class ROCS_CORE_API CompactTrack
+{
+public:
+    /* Both constructors read exactly what the MIDITrack constructors read and
+     * throw the same exceptions. */
+    CompactTrack(std::istream &is, UInt16 trackId);
+
+    CompactTrack(ByteSpanReader &is, UInt16 trackId);
+
+    UInt16 GetTrackId() const { return track_id_; }
+
+    std::string GetTrackName() const { return this->track_name_; }
+
+    UInt32 GetLength() const { return this->length_; }
+
+    const CompactPacketVecT& GetPackets() const { return this->packets_; }
+
+    const CompactEventVecT& GetEvents() const { return this->events_; }
+
+    const CompactEvent *PacketBegin(size_t packetIndex) const
+    {
+        return this->events_.data() + this->packets_.at(packetIndex).first_event;
+    }
+
+    const CompactEvent *PacketEnd(size_t packetIndex) const
+    {
+        return this->events_.data() + (packetIndex + 1 < this->packets_.size()
+            ? this->packets_[packetIndex + 1].first_event
+            : this->events_.size());
+    }
+
+    CompactMeta GetMeta(const CompactEvent &event) const
+    {
+        return CompactMeta(event.status, this->arena_.data() + event.offset, event.length());
+    }
+
+    /* Creates the MIDIPacket that MIDITrack would hold at packetIndex. */
+    MIDIPacket ToMIDIPacket(size_t packetIndex) const;
+
+    /* Bytes allocated for the events, packets and arena. */
+    size_t MemoryUsage() const;
+
+    void WriteString(std::ostream &os) const;
+
+    void WriteStringPackets(std::ostream &os, int indent=0) const;
+
+private:
+    template <class SourceT> void read_track(SourceT &is);
+
+    UInt16 track_id_;
+    UInt32 length_;
+	MSC_DISABLE_WARNING(4251);
+	std::string track_name_;
+	MSC_RESTORE_WARNING(4251);
+    CompactEventVecT events_;
+    CompactPacketVecT packets_;
+    std::vector<Byte> arena_;
+};
+
+} // End namespace std_midi
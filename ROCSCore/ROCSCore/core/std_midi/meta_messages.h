@@ -24,6 +24,7 @@
 #include "core/common/rocs_exception.h"
 #include "core/common/file_version.h"
 #include "core/std_midi/status_bytes.h"
+#include "core/std_midi/utility.h"
 
 namespace std_midi {
 
@@ -46,8 +47,12 @@ MSC_RESTORE_WARNING(4275);
 /** Factory Functions
     return values of MetaMsgPtrT are shared_ptr's. **/
 ROCS_CORE_API MetaMsgPtrT read_meta_message(std::istream &); // throw(MetaMessageError);
+ROCS_CORE_API MetaMsgPtrT read_meta_message(ByteSpanReader &); // throw(MetaMessageError);
 ROCS_CORE_API MetaMsgPtrT create_meta_message(const Byte status); // throw(MetaMessageError);
 
+/* True for the meta message types that read_meta_message accepts. */
+ROCS_CORE_API bool is_meta_status(const Byte status);
+
 ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<Byte>);
 
 class ROCS_CORE_API MetaMessage
@@ -56,6 +61,7 @@ public:
     MetaMessage(Byte status): status_(status), length_(0) {}
     MetaMessage(Byte status, UInt8 size);
     MetaMessage(std::istream &);
+    MetaMessage(ByteSpanReader &);
     virtual ~MetaMessage() {}
 
     Byte status() const                         { return status_; }
@@ -95,6 +101,7 @@ class ROCS_CORE_API StringMetaMessage : public MetaMessage {
 public:
     StringMetaMessage(const Byte status) : MetaMessage(status) {}
     StringMetaMessage(std::istream &s) : MetaMessage(s) {}
+    StringMetaMessage(ByteSpanReader &s) : MetaMessage(s) {}
 
     std::string message() const { return std::string(bytes_.begin(), bytes_.end()); }
     void message(const std::string& s);
@@ -106,6 +113,7 @@ class ROCS_CORE_API TrackName : public StringMetaMessage {
 public:
     TrackName(): StringMetaMessage(sb::track_name) {}
     TrackName(std::istream &s): StringMetaMessage(s) {}
+    TrackName(ByteSpanReader &s): StringMetaMessage(s) {}
 };
 
 
@@ -113,6 +121,7 @@ class ROCS_CORE_API Marker : public StringMetaMessage {
 public:
     Marker(): StringMetaMessage(sb::marker) {}
     Marker(std::istream &s): StringMetaMessage(s) {}
+    Marker(ByteSpanReader &s): StringMetaMessage(s) {}
 };
 
 
@@ -120,6 +129,7 @@ class ROCS_CORE_API Tempo : public MetaMessage {
 public:
     Tempo(): MetaMessage(sb::tempo, 3) {}
     Tempo(std::istream &s): MetaMessage(s) {}
+    Tempo(ByteSpanReader &s): MetaMessage(s) {}
     UInt32 microseconds() const;
     void microseconds(UInt32 tmpo);
     void WriteString(std::ostream& o) const;
@@ -130,6 +140,7 @@ class ROCS_CORE_API TimeSignature : public MetaMessage {
 public:
     TimeSignature(): MetaMessage(sb::time_signature, 4) {}
     TimeSignature(std::istream &s): MetaMessage(s) {}
+    TimeSignature(ByteSpanReader &s): MetaMessage(s) {}
 
     UInt8 numerator() const { return bytes_[0]; }
     void numerator(UInt8 val) { bytes_[0] = val; }
@@ -151,6 +162,7 @@ class ROCS_CORE_API KeySignature : public MetaMessage {
 public:
     KeySignature(): MetaMessage(sb::key_signature, 2) {}
     KeySignature(std::istream &s): MetaMessage(s) {}
+    KeySignature(ByteSpanReader &s): MetaMessage(s) {}
 
     SInt8 sharps() const { return bytes_[0]; }
     void sharps(SInt8 val) { bytes_[0] = val; }
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include <memory>
+#include <mutex>
 
 #include <istream>
 #include <ostream>
@@ -14,6 +15,7 @@
 #include <algorithm> // find_if, max
 
 #include "exlib/reverse_byte_order.h"
+#include "exlib/mapped_file.h"
 #include "core/common/rocs_exception.h"
 #include "core/common/warnings.h"
 #include "core/std_midi/midi_track.h"
@@ -59,10 +61,66 @@ struct ROCS_CORE_API MIDIFileHeader
     }
 };
 
+/* Location of one chunk that follows the MThd header.  offset is the position
+ * of the chunk's 8 byte header; size is the length of the data that follows
+ * it, as recorded in the file. */
+struct ROCS_CORE_API MIDIChunkInfo
+{
+    char    chunk_id[4];
+    UInt32  offset;
+    UInt32  size;
+
+    std::string chunkId() const { return std::string(this->chunk_id, 4); }
+};
+
+typedef std::vector<MIDIChunkInfo> MIDIChunkInfoVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<MIDIChunkInfo>);
+
+/* Reads count chunk headers starting at the current position of is, skipping
+ * over the chunk data.  Only the headers are touched, so this is cheap even
+ * for large files. */
+ROCS_CORE_API MIDIChunkInfoVecT scan_midi_chunks(ByteSpanReader &is, UInt16 count);
+
+/* How MIDIFile reads its input.  load_stream reads through an ifstream.
+ * load_mapped maps the file into memory and parses it in place.
+ * load_parallel maps the file, locates every chunk with scan_midi_chunks and
+ * then decodes the tracks concurrently.  Both fall back to load_stream if the
+ * file cannot be mapped.
+ * load_lazy maps the file (or reads it into memory) and only indexes the
+ * tracks and reads their names.  A track is decoded the first time it is
+ * requested through GetConductorPackets, GetTrack or GetTracks; GetTracks
+ * decodes every remaining track.  Decoding on demand takes a lock, so a
+ * const MIDIFile may be read from several threads at once. */
+enum MIDILoadMode
+{
+    load_stream,
+    load_mapped,
+    load_parallel,
+    load_lazy
+};
+
 class ROCS_CORE_API MIDIFile
 {
 public:
     MIDIFile(const std::string &midi_file_name); 
+
+    /* decode_threads is used by load_parallel, and by load_lazy when GetTracks
+     * decodes the remaining tracks; zero means one thread per core. */
+    MIDIFile(
+        const std::string &midi_file_name,
+        MIDILoadMode mode,
+        unsigned decode_threads = 0);
+
+    /* Parses a Standard MIDI File that has already been loaded into memory.
+     * The data is only read during construction; the caller keeps ownership
+     * of it.  midi_file_name is used for GetFilename() and error messages.
+     * With decode_threads other than one, the tracks are decoded concurrently
+     * as for load_parallel. */
+    MIDIFile(
+        const Byte *data,
+        size_t size,
+        const std::string &midi_file_name = std::string(),
+        unsigned decode_threads = 1);
  
     virtual ~MIDIFile() {}
  
@@ -76,7 +134,9 @@ public:
 
     std::string GetFilename() const { return this->filename_; }
  
-    UInt32 GetLength() const { return this->length_; }
+    /* The length of the longest track.  In lazy mode this walks the events of
+     * any tracks that have not been decoded, but does not decode them. */
+    UInt32 GetLength() const;
  
     UInt16 GetFormat() const { return this->header_.format; }
  
@@ -84,24 +144,73 @@ public:
  
     UInt16 GetDivision() const { return this->header_.division; }
 
-    const MIDITrackVecT & GetTracks() const { return this->tracks_; }
+    const MIDITrackVecT & GetTracks() const;
 
-    const MIDIPacketVecT & GetConductorPackets() const
-    {
-        return this->tracks_.at(0).GetPackets();
-    }
+    const MIDIPacketVecT & GetConductorPackets() const;
 
     /* Finds a track based on its track name.  Throws MIDIFileError if
      * trackName does not exist. */
     const MIDITrack & GetTrack(const std::string &trackName) const;
+
+    /* Finds a track based on its track name.  Returns nullptr if trackName
+     * does not exist. */
+    const MIDITrack * FindTrack(const std::string &trackName) const;
+
+    /* The names of the recognized tracks, in track order.  Does not decode any
+     * tracks in lazy mode. */
+    std::vector<std::string> GetTrackNames() const;
+
+    /* False while a file opened with load_lazy still has tracks that have not
+     * been decoded. */
+    bool IsFullyLoaded() const;
  
 private:
+    void read_stream();
+
+    void read_span(const Byte *data, size_t size, unsigned decode_threads);
+
+    template <class SourceT> void read_header(SourceT &is);
+
+    template <class SourceT> void read_tracks(SourceT &is);
+
+    void read_tracks_parallel(ByteSpanReader &is, unsigned decode_threads);
+
+    void read_lazy(unsigned decode_threads);
+
+    void compute_length() const;
+
+    // The caller holds mutex_.
+    const MIDITrack & materialize(size_t index) const;
+
+    // The caller holds mutex_.
+    void materialize_all() const;
+
+    // One recognized track of a file opened with load_lazy.
+    struct LazyTrack
+    {
+        UInt32 offset;
+        UInt16 track_id;
+        std::string track_name;
+    };
+
 	MSC_DISABLE_WARNING(4251);
 	std::string filename_;
+    mutable std::shared_ptr<ex::MappedFile> mapped_;
+    mutable std::shared_ptr<std::vector<Byte>> buffer_;
+    std::vector<LazyTrack> lazy_index_;
+    mutable std::vector<MIDITrackPtrT> lazy_tracks_;
+    // Guards the mutable members below, which const methods fill in on
+    // demand.
+    mutable std::mutex mutex_;
 	MSC_RESTORE_WARNING(4251);
     MIDIFileHeader header_;
-    UInt32 length_;
-    MIDITrackVecT tracks_;
+    mutable UInt32 length_;
+    mutable MIDITrackVecT tracks_;
+    mutable const Byte *data_;
+    mutable size_t size_;
+    mutable bool fully_loaded_;
+    mutable bool length_known_;
+    unsigned decode_threads_;
 
 };
 
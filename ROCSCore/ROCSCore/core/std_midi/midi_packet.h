@@ -12,11 +12,32 @@
 #include <algorithm> // find_if
 #include <iostream> // for debug printing
 #include "exlib/xplatform_types.h"
+#include "exlib/filter_iterator.h"
 #include "core/std_midi/meta_messages.h"
 #include "core/std_midi/voice_message.h"
 
 namespace std_midi {
 
+// Predicates for the filtered views of a MIDIPacket.
+struct VoiceStatusIs
+{
+    VoiceStatusIs(UInt8 _status): status(_status) {}
+    bool operator()(const VoiceMessage &msg) const { return msg.GetStatus() == status; }
+    UInt8 status;
+};
+
+struct MetaStatusIs
+{
+    MetaStatusIs(UInt8 _status): status(_status) {}
+    bool operator()(const MetaMsgPtrT &msg) const { return msg->status() == status; }
+    UInt8 status;
+};
+
+typedef ex::iterator_range<ex::filter_iterator<
+    VoiceStatusIs, VoiceMsgVecT::const_iterator>> VoiceMsgViewT;
+typedef ex::iterator_range<ex::filter_iterator<
+    MetaStatusIs, MetaMsgPtrVecT::const_iterator>> MetaMsgViewT;
+
 class ROCS_CORE_API MIDIPacket
 {
 public:
@@ -37,6 +58,52 @@ public:
 
     void WriteString(std::ostream& os, int indent=0) const;
 
+    /* Views of the messages with the given status.  They refer to the
+     * messages stored in the packet, so nothing is copied or allocated, and
+     * they are only valid as long as the packet is. */
+    VoiceMsgViewT voice_view(UInt8 status) const
+    {
+        return ex::make_filter_range(
+            VoiceStatusIs(status), voice_messages_.begin(), voice_messages_.end());
+    }
+
+    MetaMsgViewT meta_view(UInt8 status) const
+    {
+        return ex::make_filter_range(
+            MetaStatusIs(status), meta_messages_.begin(), meta_messages_.end());
+    }
+
+    /* Returns the first meta message with the given status, or nullptr.
+     * Unlike meta_filter, this does not copy the shared_ptr. */
+    const MetaMessage *find_meta(UInt8 status) const
+    {
+        auto view = meta_view(status);
+        return view.empty() ? nullptr : view.begin()->get();
+    }
+
+    /* Calls func(const VoiceMessage&) for each voice message with the given
+     * status. */
+    template <class FuncT>
+    void visit_voice(UInt8 status, FuncT func) const
+    {
+        for (auto &msg: voice_messages_)
+        {
+            if (msg.GetStatus() == status) func(msg);
+        }
+    }
+
+    /* Calls func(const MetaMessage&) for each meta message with the given
+     * status. */
+    template <class FuncT>
+    void visit_meta(UInt8 status, FuncT func) const
+    {
+        for (auto &msg: meta_messages_)
+        {
+            if (msg->status() == status) func(*msg);
+        }
+    }
+
+    // Copying versions of meta_view and voice_view.
     MetaMsgPtrT meta_filter(UInt8 status) const;
     VoiceMsgVecT voice_filter(UInt8 status) const;
 
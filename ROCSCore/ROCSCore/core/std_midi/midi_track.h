@@ -48,11 +48,26 @@ public:
     UnrecognizedTrackID(const std::string& what): MIDITrackError(what) {}
 };
 
+/* Reads only the first packet of the track at the current position and
+ * returns its track name, or an empty string if it has none.  This is the
+ * same name a MIDITrack would be given, without decoding the rest of the
+ * track.  Throws UnrecognizedTrackID for chunks other than MTrk. */
+ROCS_CORE_API std::string scan_midi_track_name(ByteSpanReader &is);
+
+/* Walks every event of the track at the current position and returns the same
+ * length a MIDITrack would have, without storing any packets. */
+ROCS_CORE_API UInt32 scan_midi_track_length(ByteSpanReader &is);
+
 class ROCS_CORE_API MIDITrack
 {
 public:
     MIDITrack(std::istream &is, UInt16 trackId);
 
+    /* Parses the track directly from memory.  The reader is left positioned
+     * at the end of the chunk, exactly as the istream constructor leaves the
+     * stream. */
+    MIDITrack(ByteSpanReader &is, UInt16 trackId);
+
     UInt16 GetTrackId() const { return track_id_; }
 
     void SetTrackId(const UInt8 trackId) { this->track_id_ = trackId; }
@@ -70,6 +85,8 @@ public:
     bool operator<(MIDITrack &other) const { return this->track_id_ < other.track_id_; }
 
 private:
+    template <class SourceT> void read_track(SourceT &is);
+
     UInt16 track_id_;
     UInt32 length_;
 	MSC_DISABLE_WARNING(4251);
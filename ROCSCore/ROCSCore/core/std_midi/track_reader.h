@@ -0,0 +1,148 @@
+#pragma once
+
+/**
+    The track parsing loop shared by MIDITrack and CompactTrack.  This header
+    is internal to std_midi; only its Sources include it.
+**/
+
+#include <istream>
+#include <string>
+#include "exlib/reverse_byte_order.h"
+#include "exlib/format.h"
+#include "core/std_midi/utility.h"
+#include "core/std_midi/status_bytes.h"
+#include "core/std_midi/voice_message.h"
+#include "core/std_midi/midi_track.h"
+
+namespace std_midi {
+
+struct MIDITrackHeader
+{
+    char chunk_id[4];
+    UInt32 size;
+};
+
+
+/* ReadMessageFunctor is a function that gets called multiple times from the
+ * MIDITrack constructor.  running_status and require_status are persistent
+ * values between function calls. Other private variables only need to be
+ * created on the stack once, when the functor is constructed.  Voice messages
+ * are passed to sink.add_message.  Meta messages are left to sink.read_meta,
+ * which reads one from the stream and returns true if it is end_of_track, so
+ * each sink can choose how to store them. */
+struct ReadMessageFunctor
+{
+    ReadMessageFunctor(): require_status(true) {}
+    
+    template <class SourceT, class SinkT>
+    bool operator()(SourceT& is, SinkT &sink)
+    {
+        next_byte = is.peek();
+        next_status = next_byte & 0xF0;
+        if (next_byte == 0xFF)
+        {
+            require_status = true;
+            if (sink.read_meta(is))
+            {
+                return true;
+            }
+
+        } else if ((next_byte == sb::sysex) || (next_byte == sb::sysex_escape))
+        {
+            // Ignore all sysex messages
+            require_status = true;
+            any_var_length = read_variable_int(is);
+            is.seekg(any_var_length, std::istream::cur);
+        } else if (sb::voice_status_bytes.count(next_status))
+        {
+            // This is a voice message.
+            running_status = next_status;
+            require_status = false;
+            sink.add_message(VoiceMessage(is));
+        } else if (!(next_byte & 0x80) & !require_status)
+        {
+            // This is a value between 0 and 127
+            sink.add_message(VoiceMessage(is, running_status));
+        } else
+        {
+            throw UnknownStatusByte(ex::format(
+                "Unknown status byte: %#X at %u",
+                next_byte,
+                (UInt32)is.tellg()));
+        }
+
+        return false;
+    }
+
+private:
+    bool require_status;
+    Byte running_status;
+    Byte next_byte, next_status;
+    UInt32 any_var_length;
+};
+
+/* Reads the chunk header at the current position.  Unrecognized chunks are
+ * skipped, as the MIDI specification requires, and reported by throwing
+ * UnrecognizedTrackID.  Returns the position of the end of the chunk. */
+template <class SourceT>
+UInt32 read_track_header(SourceT &is)
+{
+    MIDITrackHeader hdr;
+    is.read((char *)&hdr, sizeof(hdr));
+    ex::reverse_byte_order(hdr.size);
+
+    if (std::string(hdr.chunk_id, 4) != "MTrk")
+    {
+        /*  According to MIDI specification, unrecognized chunks should be
+         *  skipped. Advance the get pointer on the istream to the end of this
+         *  unknown chunk, then throw the error to indicate that this is not a
+         *  MIDITrack. */
+        is.seekg(hdr.size, std::istream::cur);
+        throw UnrecognizedTrackID(ex::format(
+            "Unrecognized track_id " + std::string(hdr.chunk_id, 4) + "at %u",
+            (UInt32)is.tellg()));
+    }
+
+    return (UInt32)is.tellg() + hdr.size;
+}
+
+/* Groups the events of a track into packets of messages that share a delta
+ * time.  sink.open(delta) starts a packet, messages go to sink.add_message,
+ * and sink.close() finishes the packet; if close returns false, reading stops
+ * there.  A packet that is still open when the chunk runs out without an
+ * end_of_track is never closed. */
+template <class SourceT, class SinkT>
+void read_packets(SourceT &is, UInt32 end_g, SinkT &sink)
+{
+    ReadMessageFunctor read_message;
+    UInt32 delta_time;
+
+    // The first delta time will always create a new packet.
+    sink.open(read_variable_int(is));
+    read_message(is, sink);
+    while (static_cast<UInt32>(is.tellg()) < end_g)
+    {
+        delta_time = read_variable_int(is);
+
+        if (delta_time == 0)
+        {
+            if (read_message(is, sink))
+            {
+                sink.close();
+                break;
+            }
+
+        } else
+        {
+            // Create a new packet with the new delta time.
+            if (!sink.close()) break;
+            sink.open(delta_time);
+            if (read_message(is, sink)) {
+                sink.close();
+                break;
+            }
+        }
+    }
+}
+
+} // End namespace std_midi
@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <string>
 #include <sstream>
+#include <cstring>
+#include <cstddef>
 #include "exlib/xplatform_types.h"
 #include "exlib/format.h"
 
@@ -21,9 +23,86 @@ public:
 };
 MSC_RESTORE_WARNING(4275);
 
+/*  ByteSpanReader reads from a block of memory that it does not own, such as a
+    memory-mapped MIDI file.  It implements the subset of std::istream that the
+    std_midi readers use (peek, get, read, tellg, seekg), so the same parsing
+    code serves both.  Every access is bounds checked; reading past the end of
+    the span throws StdMIDIError.  Seeking past the end is allowed, as it is
+    for an ifstream, but the next read will throw.  */
+class ROCS_CORE_API ByteSpanReader
+{
+public:
+    ByteSpanReader(const Byte *data, size_t size)
+        :
+        data_(data),
+        size_(size),
+        pos_(0)
+    {
+
+    }
+
+    int peek() const
+    {
+        return pos_ < size_ ? data_[pos_] : -1;
+    }
+
+    Byte get()
+    {
+        check_available(1);
+        return data_[pos_++];
+    }
+
+    void read(char *dst, size_t count)
+    {
+        check_available(count);
+        memcpy(dst, data_ + pos_, count);
+        pos_ += count;
+    }
+
+    size_t tellg() const { return pos_; }
+
+    void seekg(size_t pos) { pos_ = pos; }
+
+    void seekg(long offset, std::ios_base::seekdir dir)
+    {
+        switch (dir)
+        {
+            case std::ios_base::beg: pos_ = offset; break;
+            case std::ios_base::end: pos_ = size_ + offset; break;
+            default: pos_ += offset; break;
+        }
+    }
+
+    /* Returns a pointer to the current position.  The caller must ensure that
+       at least count bytes are available with check_available. */
+    const Byte *current() const { return data_ + pos_; }
+
+    size_t size() const { return size_; }
+
+    bool eof() const { return pos_ >= size_; }
+
+    void check_available(size_t count) const
+    {
+        if (pos_ > size_ || size_ - pos_ < count)
+        {
+            throw StdMIDIError(ex::format(
+                "Unexpected end of MIDI data: %u bytes requested at %u of %u",
+                (UInt32)count,
+                (UInt32)pos_,
+                (UInt32)size_));
+        }
+    }
+
+private:
+    const Byte *data_;
+    size_t size_;
+    size_t pos_;
+};
+
 /*  Reads numbers stored as a VARIABLE-LENGTH QUANTITY.
     Each byte has bit 7 set, except for the last byte.  */
 ROCS_CORE_API UInt32 read_variable_int(std::istream& is);
+ROCS_CORE_API UInt32 read_variable_int(ByteSpanReader& is);
 
 
 
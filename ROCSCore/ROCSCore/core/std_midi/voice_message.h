@@ -8,6 +8,7 @@
 #include <vector>
 #include "exlib/xplatform_types.h"
 #include "core/std_midi/status_bytes.h"
+#include "core/std_midi/utility.h"
 
 
 namespace std_midi {
@@ -30,6 +31,10 @@ public:
 
     VoiceMessage(std::istream &is, Byte status);
 
+    VoiceMessage(ByteSpanReader &is);
+
+    VoiceMessage(ByteSpanReader &is, Byte status);
+
     VoiceMessage(Byte status, Byte data1);
 
     VoiceMessage(Byte status, Byte data1, Byte data2);
@@ -56,7 +61,7 @@ private:
     #pragma GCC diagnostic ignored "-Wunused-private-field"
     Byte padding_;
     #pragma GCC diagnostic pop
-    void read_message(std::istream &is);
+    template <class SourceT> void read_message(SourceT &is);
 };
 
 } // end namespace standard_midi
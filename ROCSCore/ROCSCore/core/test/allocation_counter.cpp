@@ -0,0 +1,93 @@
+#include "core/test/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+/* Global operator new is replaced for the whole test binary so that tests can
+ * count the allocations made while an AllocationCounter is alive.  Every form
+ * is replaced, so that whatever allocates, the matching delete frees it, and
+ * the replacements have a file of their own so the compiler does not inline
+ * free into the tests.
+ *
+ * Each block is preceded by its size, so that delete can take it off
+ * liveAllocationBytes.  The header is as large as malloc's alignment, so the
+ * block stays aligned. */
+std::atomic<bool> countingAllocations(false);
+std::atomic<size_t> allocationCount(0);
+std::atomic<size_t> liveAllocationBytes(0);
+
+static const std::size_t header = 16;
+
+static void *allocate(std::size_t size) noexcept
+{
+    if (countingAllocations) allocationCount++;
+    char *block = static_cast<char *>(std::malloc(header + size));
+    if (!block) return nullptr;
+    *reinterpret_cast<std::size_t *>(block) = size;
+    liveAllocationBytes += size;
+    return block + header;
+}
+
+static void release(void *p) noexcept
+{
+    if (!p) return;
+    char *block = static_cast<char *>(p) - header;
+    liveAllocationBytes -= *reinterpret_cast<std::size_t *>(block);
+    std::free(block);
+}
+
+void *operator new(std::size_t size)
+{
+    void *p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](std::size_t size)
+{
+    void *p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+    release(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    release(p);
+}
+#endif
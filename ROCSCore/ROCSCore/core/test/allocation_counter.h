@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/* Defined in allocation_counter.cpp, next to the replacement operator new. */
+extern std::atomic<bool> countingAllocations;
+extern std::atomic<size_t> allocationCount;
+
+/* The bytes operator new has handed out and not had back, counted always, so
+ * that the difference across building something is what it holds. */
+extern std::atomic<size_t> liveAllocationBytes;
+
+/* Counts the calls to operator new made while it is alive. */
+class AllocationCounter
+{
+public:
+    AllocationCounter()
+    {
+        allocationCount = 0;
+        countingAllocations = true;
+    }
+
+    ~AllocationCounter() { countingAllocations = false; }
+
+    size_t count() const { return allocationCount; }
+};
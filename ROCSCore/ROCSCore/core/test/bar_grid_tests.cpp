@@ -0,0 +1,423 @@
+#include "gtest/gtest.h"
+#include "core/test/test_midi_file.h"
+#include "core/timeline/bar_grid.h"
+#include "core/timeline/timeline.h"
+#include "exlib/binary_reader.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TL;
+
+/* One BarsBeats per beat, laid out and renamed beat by beat the way
+ * create_bars_beats did before BarGrid, for comparison. */
+static BarsBeatsSeqT ExpandedBarsBeats(
+    const MeterSeqT &meters,
+    UInt16 ppqn,
+    UInt32 songLength,
+    const CL::CustomBarSeqT &customBars)
+{
+    BarsBeatsSeqT barsBeats;
+    UInt32 current_time = meters.front().abs_time();
+    SInt32 bar_number = 0;
+    for (size_t i = 0; i < meters.size(); i++)
+    {
+        UInt32 next_time = (i + 1 < meters.size()) ? meters[i + 1].abs_time() : songLength + 1;
+        UInt32 ticks_per_beat = meters[i].ticks_per_beat(ppqn);
+        double whole = 0;
+        double remainder = modf(meters[i].beats_per_measure(), &whole);
+        UInt32 remainder_ticks = static_cast<UInt32>(remainder * ppqn);
+        while (current_time < next_time)
+        {
+            for (UInt32 beat = 0; beat < whole; beat++)
+            {
+                barsBeats.push_back(BarsBeats(current_time, bar_number, beat + 1));
+                current_time += ticks_per_beat;
+            }
+
+            if (remainder_ticks)
+            {
+                barsBeats.push_back(BarsBeats(current_time, bar_number, whole + 1));
+                current_time += remainder_ticks;
+            }
+
+            bar_number++;
+        }
+    }
+
+    // Each CustomBar names its bar, and integer ones number the bars after
+    // it up to the next CustomBar.
+    size_t next = 0;
+    std::string name;
+    SInt32 number = 0;
+    bool counting = false;
+    for (auto &it: barsBeats)
+    {
+        if (it.beat_number() == 1)
+        {
+            if (next < customBars.size() && customBars[next].abs_time() == it.abs_time())
+            {
+                name = customBars[next++].value();
+                counting = ex::str_is_int(name);
+                number = counting ? ex::str_to_num<SInt32>(name) : 0;
+            } else if (counting)
+            {
+                std::stringstream ss;
+                ss << ++number;
+                name = ss.str();
+            }
+        }
+
+        if (next || counting)
+        {
+            it.bar_number(name);
+        }
+    }
+
+    return barsBeats;
+}
+
+class BarGridTest
+    :
+    public ::testing::Test
+{
+public:
+    BarGridTest()
+    {
+        // 4/4 for three bars, 3/4, then a 5/8 in dotted quarters starting
+        // in the middle of a bar, then 6/8 in eighths.
+        meters_.push_back(Meter(0, 4, 4, 24, 8));
+        meters_.push_back(Meter(12 * ppqn, 3, 4, 24, 8));
+        meters_.push_back(Meter(19 * ppqn, 5, 8, 36, 8));
+        meters_.push_back(Meter(40 * ppqn, 6, 8, 12, 8));
+    }
+
+protected:
+    static const UInt16 ppqn = 480;
+    static const UInt32 songLength = 60 * ppqn;
+    MeterSeqT meters_;
+};
+
+TEST_F(BarGridTest, ExpandsLikeBarsBeats)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    BarsBeatsSeqT expected = ExpandedBarsBeats(meters_, ppqn, songLength, CL::CustomBarSeqT());
+    BarsBeatsSeqT actual;
+    grid.ExpandTo(actual);
+    EXPECT_EQ(expected, actual);
+    EXPECT_EQ(expected.size(), grid.GetBeatCount());
+    EXPECT_EQ(expected.back().bar_number_int() + 1, static_cast<SInt32>(grid.GetBarCount()));
+    EXPECT_EQ(4u, grid.GetSegments().size());
+
+    std::vector<UInt32> ticks;
+    grid.ExpandBeatTicks(ticks);
+    ASSERT_EQ(expected.size(), ticks.size());
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        EXPECT_EQ(expected[i].abs_time(), ticks[i]);
+    }
+}
+
+TEST_F(BarGridTest, RenameBarsLikeCustomBars)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    CL::CustomBarSeqT customBars;
+    customBars.push_back(CL::CustomBar(4 * ppqn, "1"));
+    customBars.push_back(CL::CustomBar(12 * ppqn, "7A"));
+    customBars.push_back(CL::CustomBar(15 * ppqn, "7B"));
+    customBars.push_back(CL::CustomBar(18 * ppqn, "8"));
+    customBars.push_back(CL::CustomBar(21 * ppqn, "20"));
+    grid.RenameBars(customBars, "test.mid");
+
+    BarsBeatsSeqT expected = ExpandedBarsBeats(meters_, ppqn, songLength, customBars);
+    BarsBeatsSeqT actual;
+    grid.ExpandTo(actual);
+    EXPECT_EQ(expected, actual);
+
+    EXPECT_EQ("0", grid.BarName(0));
+    EXPECT_EQ("1", grid.BarName(1));
+    EXPECT_EQ("2", grid.BarName(2));
+    EXPECT_EQ("7A", grid.BarName(3));
+    EXPECT_EQ("7B", grid.BarName(4));
+    EXPECT_EQ("8", grid.BarName(5));
+    EXPECT_EQ("20", grid.BarName(6));
+    EXPECT_EQ("21", grid.BarName(7));
+
+    // A CustomBar that continues the numbering does not need a range.
+    customBars.push_back(CL::CustomBar(customBars.back().abs_time() + grid.GetSegments()[2].bar_ticks(), "21"));
+    BarGrid continued(meters_, ppqn, songLength);
+    continued.RenameBars(customBars, "test.mid");
+    EXPECT_EQ(grid, continued);
+}
+
+TEST_F(BarGridTest, RenameBarsErrors)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    CL::CustomBarSeqT offBeat;
+    offBeat.push_back(CL::CustomBar(ppqn, "5"));
+    EXPECT_THROW(grid.RenameBars(offBeat, "test.mid"), CustomBarError);
+
+    CL::CustomBarSeqT sameBar;
+    sameBar.push_back(CL::CustomBar(4 * ppqn, "5"));
+    sameBar.push_back(CL::CustomBar(4 * ppqn, "6"));
+    EXPECT_THROW(grid.RenameBars(sameBar, "test.mid"), CustomBarError);
+
+    CL::CustomBarSeqT pastEnd;
+    pastEnd.push_back(CL::CustomBar(100 * ppqn, "5"));
+    EXPECT_THROW(grid.RenameBars(pastEnd, "test.mid"), CustomBarError);
+
+    CL::CustomBarSeqT gap;
+    gap.push_back(CL::CustomBar(4 * ppqn, "5A"));
+    gap.push_back(CL::CustomBar(12 * ppqn, "6"));
+    EXPECT_THROW(grid.RenameBars(gap, "test.mid"), CustomBarError);
+
+    CL::CustomBarSeqT last;
+    last.push_back(CL::CustomBar(4 * ppqn, "5A"));
+    EXPECT_THROW(grid.RenameBars(last, "test.mid"), CustomBarError);
+
+    CL::CustomBarSeqT tooLong;
+    tooLong.push_back(CL::CustomBar(4 * ppqn, "12345678"));
+    EXPECT_THROW(grid.RenameBars(tooLong, "test.mid"), BarNameLengthError);
+}
+
+TEST_F(BarGridTest, Lookups)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    BarsBeatsSeqT barsBeats;
+    grid.ExpandTo(barsBeats);
+
+    UInt32 bar = 0;
+    for (size_t i = 0; i < barsBeats.size(); i++)
+    {
+        if (i && barsBeats[i].beat_number() == 1) bar++;
+        UInt32 tick = barsBeats[i].abs_time();
+        EXPECT_EQ(tick, grid.TickOf(bar, barsBeats[i].beat_number()));
+
+        BarBeatPosition position = grid.BarBeatAt(tick + 1);
+        EXPECT_EQ(bar, position.bar);
+        EXPECT_EQ(barsBeats[i].beat_number(), position.beat);
+        EXPECT_EQ(tick, position.abs_time);
+
+        UInt32 nextTick = 0;
+        if (i + 1 < barsBeats.size())
+        {
+            ASSERT_TRUE(grid.NextBeat(tick, nextTick));
+            EXPECT_EQ(barsBeats[i + 1].abs_time(), nextTick);
+        } else
+        {
+            EXPECT_FALSE(grid.NextBeat(tick, nextTick));
+        }
+
+        UInt32 found = 0;
+        ASSERT_TRUE(grid.FindBar(barsBeats[i].bar_number(), found));
+        EXPECT_EQ(bar, found);
+    }
+
+    UInt32 found = 0;
+    EXPECT_FALSE(grid.FindBar("1000", found));
+    EXPECT_THROW(grid.TickOf(grid.GetBarCount(), 1), BarGridError);
+    EXPECT_THROW(grid.TickOf(0, 5), BarGridError);
+    EXPECT_THROW(BarGrid().BarBeatAt(0), BarGridError);
+}
+
+TEST_F(BarGridTest, CompressesBarsBeats)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    CL::CustomBarSeqT customBars;
+    customBars.push_back(CL::CustomBar(8 * ppqn, "9"));
+    customBars.push_back(CL::CustomBar(12 * ppqn, "9A"));
+    customBars.push_back(CL::CustomBar(15 * ppqn, "10"));
+    grid.RenameBars(customBars, "test.mid");
+
+    BarsBeatsSeqT barsBeats;
+    grid.ExpandTo(barsBeats);
+    BarGrid compressed(barsBeats);
+    EXPECT_EQ(grid, compressed);
+
+    BarsBeatsSeqT irregular(barsBeats);
+    irregular[1].abs_time(irregular[1].abs_time() + 1);
+    EXPECT_THROW(BarGrid irregularGrid(irregular), BarGridError);
+}
+
+TEST_F(BarGridTest, BinaryRoundTrip)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    CL::CustomBarSeqT customBars;
+    customBars.push_back(CL::CustomBar(12 * ppqn, "A"));
+    customBars.push_back(CL::CustomBar(15 * ppqn, "2"));
+    grid.RenameBars(customBars, "test.mid");
+
+    std::stringstream ss;
+    grid.WriteBinary(ss, rocs_midi::LatestFileVersion);
+    BarGrid read(ss, rocs_midi::LatestFileVersion);
+    EXPECT_EQ(grid, read);
+}
+
+TEST_F(BarGridTest, CorruptGridsThrow)
+{
+    BarGrid grid(meters_, ppqn, songLength);
+    std::string bytes;
+    {
+        std::stringstream ss;
+        grid.WriteBinary(ss, rocs_midi::LatestFileVersion);
+        bytes = ss.str();
+    }
+
+    // The code, then the segment count.
+    std::string huge(bytes);
+    UInt32 count = 0xFFFFFFF0;
+    memcpy(&huge[1], &count, sizeof(count));
+    std::istringstream hugeStream(huge);
+    EXPECT_THROW(BarGrid read(hugeStream, rocs_midi::LatestFileVersion), BarGridError);
+    ex::BinaryReader hugeReader(huge.data(), huge.size());
+    EXPECT_THROW(BarGrid read(hugeReader, rocs_midi::LatestFileVersion), BarGridError);
+
+    // A segment of bars with no ticks, which would divide by zero.
+    std::string empty(bytes);
+    size_t segment = 1 + sizeof(UInt32);
+    UInt32 zero = 0;
+    memcpy(&empty[segment + offsetof(MeterSegment, ticks_per_beat)], &zero, sizeof(zero));
+    memcpy(&empty[segment + offsetof(MeterSegment, remainder_ticks)], &zero, sizeof(zero));
+    std::istringstream emptyStream(empty);
+    EXPECT_THROW(BarGrid read(emptyStream, rocs_midi::LatestFileVersion), BarGridError);
+
+    // A second segment that starts before the first.
+    ASSERT_LT(1u, grid.GetSegments().size());
+    std::string unordered(bytes);
+    memcpy(&unordered[segment + sizeof(MeterSegment)], &zero, sizeof(zero));
+    std::istringstream unorderedStream(unordered);
+    EXPECT_THROW(BarGrid read(unorderedStream, rocs_midi::LatestFileVersion), BarGridError);
+}
+
+static std::vector<Byte> BarGridMIDIBytes()
+{
+    std_midi::TestMIDIFileBuilder b;
+    b.BeginTrack("Conductor");
+    b.Tempo(0, 500000);
+    b.TimeSignature(0, 4, 2);
+    b.Meta(0, 0x59, std::string(2, '\0'));
+    b.Meta(1920, 0x06, "@b 10");
+    b.TimeSignature(1920, 7, 3);
+    b.EndOfTrack(4 * 1920);
+
+    b.BeginTrack("PDF");
+    b.Event(0, {0xB0, 20, 1});
+    b.EndOfTrack(0);
+
+    return b.Bytes();
+}
+
+TEST(BarGridMIDIFile, ReadsCustomBarMarkers)
+{
+    std_midi::TestMIDIFileBuilder b;
+    b.BeginTrack("Conductor");
+    b.Tempo(0, 500000);
+    b.TimeSignature(0, 4, 2);
+    b.Meta(1920, 0x06, "@b 5");
+    b.Meta(1920, 0x06, "@b6");
+    b.Meta(1920, 0x06, "@m intro @b 7A");
+    b.Meta(1920, 0x06, "@b 8 @m verse");
+    b.Meta(1920, 0x06, "@m chorus");
+    b.Meta(1920, 0x06, "@b  10 ");
+    b.EndOfTrack(1920);
+    auto bytes = b.Bytes();
+    std_midi::MIDIFile midiFile(&bytes[0], bytes.size(), "bar_grid_tests.mid");
+
+    MeterSeqT meters;
+    meters.push_back(Meter(0, 4, 4, 24, 8));
+    BarGridPtrT grid = create_bar_grid(midiFile, meters);
+    const char *expected[] = {"0", "5", "6", "7A", "8", "9", "10", "11"};
+    ASSERT_EQ(8u, grid->GetBarCount());
+    for (UInt32 bar = 0; bar < grid->GetBarCount(); bar++)
+    {
+        EXPECT_EQ(expected[bar], grid->BarName(bar));
+    }
+
+    std_midi::TestMIDIFileBuilder empty;
+    empty.BeginTrack("Conductor");
+    empty.TimeSignature(0, 4, 2);
+    empty.Meta(1920, 0x06, "@b  ");
+    empty.EndOfTrack(1920);
+    bytes = empty.Bytes();
+    std_midi::MIDIFile emptyFile(&bytes[0], bytes.size(), "bar_grid_tests.mid");
+    EXPECT_THROW(create_bar_grid(emptyFile, meters), CL::ArgError);
+}
+
+TEST(BarGridTimeline, WritesGridFromVersion2_1)
+{
+    auto bytes = BarGridMIDIBytes();
+    Timeline timeline(std_midi::MIDIFile(&bytes[0], bytes.size(), "bar_grid_tests.mid"));
+    EXPECT_EQ("10", timeline.GetBarGrid().BarName(1));
+    EXPECT_EQ("11", timeline.GetBarGrid().BarName(2));
+
+    std::stringstream latest;
+    timeline.WriteBinary(latest, cmn::FileVersion(2, 1));
+    Timeline readLatest(latest, cmn::FileVersion(2, 1));
+    EXPECT_EQ(timeline.GetBarGrid(), readLatest.GetBarGrid());
+    EXPECT_EQ(timeline.GetBarsBeats(), readLatest.GetBarsBeats());
+
+    std::stringstream previous;
+    timeline.WriteBinary(previous, cmn::FileVersion(2, 0));
+    Timeline readPrevious(previous, cmn::FileVersion(2, 0));
+    EXPECT_EQ(timeline.GetBarGrid(), readPrevious.GetBarGrid());
+    EXPECT_EQ(timeline.GetBarsBeats(), readPrevious.GetBarsBeats());
+    EXPECT_TRUE(timeline == readPrevious);
+
+    EXPECT_LT(latest.str().size(), previous.str().size());
+}
+
+TEST(BarGridTimeline, WritesChangedBarsBeats)
+{
+    auto bytes = BarGridMIDIBytes();
+    std_midi::MIDIFile midiFile(&bytes[0], bytes.size(), "bar_grid_tests.mid");
+    Timeline original(midiFile);
+    Timeline changed(midiFile);
+    ASSERT_TRUE(original == changed);
+
+    // Equal BarGrids do not make equal Timelines once the BarsBeats differ.
+    changed.GetBarsBeats().pop_back();
+    EXPECT_EQ(original.GetBarGrid(), changed.GetBarGrid());
+    EXPECT_FALSE(original == changed);
+
+    std::stringstream ss;
+    changed.WriteBinary(ss, rocs_midi::LatestFileVersion);
+    Timeline read(ss, rocs_midi::LatestFileVersion);
+    EXPECT_EQ(changed.GetBarsBeats(), read.GetBarsBeats());
+    EXPECT_TRUE(changed == read);
+    EXPECT_FALSE(original == read);
+}
+
+TEST(BarGridTimeline, ExpandsFromSeveralThreads)
+{
+    auto bytes = BarGridMIDIBytes();
+    std_midi::MIDIFile midiFile(&bytes[0], bytes.size(), "bar_grid_tests.mid");
+    const Timeline expected(midiFile);
+    size_t expectedSize = expected.GetBarsBeats().size();
+
+    const Timeline timeline(midiFile);
+    std::vector<size_t> sizes(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        threads.push_back(std::thread([&timeline, &sizes, i]() {
+            sizes[i] = timeline.GetBarsBeats().size();
+        }));
+    }
+
+    for (auto &thread: threads)
+    {
+        thread.join();
+    }
+
+    for (auto size: sizes)
+    {
+        EXPECT_EQ(expectedSize, size);
+    }
+
+    EXPECT_TRUE(expected == timeline);
+}
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "exlib/binary_io.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
+#include "exlib/numeric_string_compare.h"
+#include "core/changelog/change_log.h"
+
+#include <sstream>
+#include <string>
+
+TEST(BinaryReader, ReadsWhatAStreamReads)
+{
+    std::ostringstream os;
+    ex::write<UInt32>(os, 0x12345678);
+    ex::WriteString(os, "Overture");
+    os.put(7);
+    ex::write<UInt16>(os, 480);
+
+    std::string bytes = os.str();
+    ex::BinaryReader reader(bytes.data(), bytes.size());
+    EXPECT_EQ(0x12345678u, ex::read<UInt32>(reader));
+    EXPECT_EQ("Overture", ex::ReadString(reader));
+    EXPECT_EQ(7, reader.peek());
+    EXPECT_EQ(7, reader.get());
+    EXPECT_EQ(bytes.size() - 2, reader.tellg());
+    EXPECT_EQ(480u, ex::read<UInt16>(reader));
+    EXPECT_EQ(0u, reader.GetAvailable());
+
+    // Nothing is read past the end, and a failed read does not move.
+    EXPECT_THROW(reader.get(), ex::BinaryReaderError);
+    reader.seekg(bytes.size() - 1);
+    EXPECT_THROW(ex::read<UInt16>(reader), ex::BinaryReaderError);
+    EXPECT_EQ(bytes.size() - 1, reader.tellg());
+    EXPECT_THROW(reader.seekg(bytes.size() + 1), ex::BinaryReaderError);
+
+    // A string whose length runs past the end.
+    std::string truncated(bytes.data(), 8);
+    ex::BinaryReader shortReader(truncated.data(), truncated.size());
+    shortReader.ignore(4);
+    EXPECT_THROW(ex::ReadString(shortReader), ex::BinaryReaderError);
+}
+
+TEST(BinaryWriter, WritesWhatAStreamWrites)
+{
+    std::ostringstream os;
+    ex::BinaryWriter writer;
+    for (UInt32 i = 0; i < 1000; i++)
+    {
+        ex::write(os, i);
+        ex::write(writer, i);
+        ex::WriteString(os, "Entr'acte");
+        ex::WriteString(writer, "Entr'acte");
+        os.put(static_cast<char>(i));
+        writer.put(static_cast<char>(i));
+    }
+
+    EXPECT_EQ(os.str(), writer.str());
+    EXPECT_EQ(os.str().size(), writer.tellp());
+
+    std::ostringstream copy;
+    writer.WriteTo(copy);
+    EXPECT_EQ(os.str(), copy.str());
+
+    writer.clear();
+    EXPECT_TRUE(writer.empty());
+    EXPECT_THROW(ex::WriteString(writer, std::string(257, 'x')), std::length_error);
+}
+
+TEST(BinaryWriter, CopiesAndMoves)
+{
+    ex::BinaryWriter writer(4);
+    writer.write("Overture", 8);
+    writer.reserve(1 << 16);
+    EXPECT_EQ("Overture", writer.str());
+
+    ex::BinaryWriter copy(writer);
+    copy.put('!');
+    EXPECT_EQ("Overture", writer.str());
+    EXPECT_EQ("Overture!", copy.str());
+
+    ex::BinaryWriter moved(std::move(copy));
+    EXPECT_EQ("Overture!", moved.str());
+    EXPECT_TRUE(copy.empty());
+
+    writer = moved;
+    EXPECT_EQ("Overture!", writer.str());
+    writer.write(" Finale", 7);
+    EXPECT_EQ("Overture! Finale", writer.str());
+    EXPECT_EQ("Overture!", moved.str());
+}
+
+TEST(NumericStringCompare, OrdersRunsOfDigitsByValue)
+{
+    ex::NumericStringCompare less;
+    EXPECT_TRUE(less("2", "10"));
+    EXPECT_FALSE(less("10", "2"));
+    EXPECT_TRUE(less("9a", "10"));
+    EXPECT_TRUE(less("12a", "12b"));
+    EXPECT_TRUE(less("12", "12a"));
+    EXPECT_TRUE(less("1a2", "1a10"));
+    EXPECT_TRUE(less("A", "a"));
+    EXPECT_TRUE(less("1", "a"));
+    EXPECT_TRUE(less("", "1"));
+
+    // Leading zeros make no difference, and neither do digits past INT_MAX.
+    EXPECT_FALSE(less("01", "1"));
+    EXPECT_FALSE(less("1", "01"));
+    EXPECT_FALSE(less("99999999999", "99999999998"));
+}
+
+TEST(BinaryReader, ChangeLog)
+{
+    CL::ChangeLog changeLog("Show", "Customer", ex::UUID(), cmn::ROCSVersion(3, 1));
+    for (int song = 1; song <= 3; song++)
+    {
+        CL::SongLogPtrT log(new CL::SongLog());
+        log->SetSongNumber(std::to_string(song));
+        log->SetSongName("Song");
+        log->GetVamps().push_back(CL::Vamp(0, 1920, 4));
+        log->GetRepeats().push_back(CL::Repeat(0, 3840, 2));
+        log->GetCuts().push_back(CL::Cut(1920, 3840));
+        log->GetTranspositions().push_back(CL::Transpose(0, 960, -2));
+        log->GetTempoScales().push_back(CL::TempoScale(0, 960, 1.5));
+        log->GetClicks().push_back(CL::Click(0, 960, 8));
+        log->GetFermatas().push_back(CL::Fermata(480, 960));
+        log->GetCaesuras().push_back(CL::Caesura(720));
+        log->GetMarkers().push_back(CL::Marker(960, "Segue"));
+        changeLog.AddSongLog(log);
+    }
+
+    std::ostringstream os;
+    changeLog.WriteBinary(os, CL::LatestFileVersion);
+    ex::BinaryWriter writer;
+    changeLog.WriteBinary(writer, CL::LatestFileVersion);
+    ASSERT_EQ(os.str(), writer.str());
+
+    ex::BinaryReader reader(writer.GetData(), writer.size());
+    CL::ChangeLog fromReader(reader);
+    EXPECT_EQ(0u, reader.GetAvailable());
+    EXPECT_EQ(changeLog, fromReader);
+
+    std::istringstream is(os.str());
+    CL::ChangeLog fromStream(is);
+    EXPECT_EQ(fromStream, fromReader);
+
+    // From 2.1 the file is checked in sections.
+    ex::BinaryReader truncated(writer.GetData(), writer.size() - 1);
+    EXPECT_THROW(CL::ChangeLog partial(truncated), cmn::ChecksumError);
+    std::istringstream truncatedStream(os.str().substr(0, os.str().size() - 1));
+    EXPECT_THROW(CL::ChangeLog partial(truncatedStream), cmn::ChecksumError);
+
+    for (size_t at: {size_t(9), size_t(20), os.str().size() / 2, os.str().size() - 1})
+    {
+        std::string damaged = os.str();
+        damaged[at] ^= 0x10;
+        std::istringstream damagedStream(damaged);
+        EXPECT_THROW(CL::ChangeLog partial(damagedStream), cmn::ChecksumError) << at;
+    }
+
+    ex::BinaryWriter older;
+    changeLog.WriteBinary(older, cmn::FileVersion(2, 0));
+    ex::BinaryReader olderReader(older.GetData(), older.size());
+    EXPECT_EQ(changeLog, CL::ChangeLog(olderReader));
+    ex::BinaryReader olderTruncated(older.GetData(), older.size() - 1);
+    EXPECT_THROW(CL::ChangeLog partial(olderTruncated), ex::BinaryReaderError);
+}
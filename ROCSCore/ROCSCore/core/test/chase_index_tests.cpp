@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+#include "core/rocs_midi/chase_index.h"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace rocs_midi;
+
+class ChaseIndexTest
+    :
+    public ::testing::Test
+{
+public:
+    ChaseIndexTest()
+    {
+        static const Byte statuses[] = {0x80, 0x90, 0x90, 0xB0, 0xC0, 0xD0, 0xE0};
+        UInt32 seed = 5;
+        for (UInt16 trackId = 0; trackId < 4; trackId++)
+        {
+            VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+            UInt32 absTime = 0;
+            for (UInt32 i = 0; i < 2000; i++)
+            {
+                seed = seed * 1103515245 + 12345;
+                absTime += (seed >> 16) % 3 * 60;
+                Byte status = statuses[(seed >> 8) % 7] | trackId;
+                track->GetEvents().push_back(
+                    VoiceEvent(absTime, status, (seed >> 4) % 24 + 48, (seed >> 20) % 128));
+            }
+
+            voiceData_.AddTrack(track);
+        }
+    }
+
+protected:
+    /* The state after every event before tick, from the start. */
+    ChaseState Replay(UInt16 trackId, UInt32 tick) const
+    {
+        ChaseState state;
+        for (auto &voiceEvent: voiceData_.GetTrack(trackId).GetEvents())
+        {
+            if (voiceEvent.GetAbsTime() >= tick) break;
+            state.Apply(voiceEvent);
+        }
+
+        return state;
+    }
+
+    VoiceData voiceData_;
+};
+
+TEST_F(ChaseIndexTest, MatchesReplay)
+{
+    ChaseIndex index(voiceData_, 1920);
+    ASSERT_LT(10u, index.GetTicks().size());
+
+    ChaseState state;
+    for (UInt32 tick = 0; tick < 70000; tick += 300)
+    {
+        for (UInt16 trackId = 0; trackId < 4; trackId++)
+        {
+            index.ChaseStateAt(trackId, tick, state);
+            ASSERT_EQ(Replay(trackId, tick), state) << "track " << trackId << " tick " << tick;
+        }
+    }
+
+    // Exactly at a checkpoint, and at the last event.
+    UInt32 last = voiceData_.GetTrack(2).GetEvents().back().GetAbsTime();
+    UInt32 ticks[] = {1920, 3840, last, last + 1};
+    ChaseStateByTrackIdT states;
+    for (UInt32 tick: ticks)
+    {
+        index.ChaseStateAt(tick, states);
+        ASSERT_EQ(4u, states.size());
+        EXPECT_EQ(Replay(2, tick), states[2]);
+    }
+}
+
+TEST_F(ChaseIndexTest, SeesChanges)
+{
+    std::vector<UInt32> ticks;
+    ticks.push_back(1000);
+    ticks.push_back(5000);
+    ChaseIndex index(voiceData_, ticks);
+
+    ChaseState state;
+    index.ChaseStateAt(1, 6000, state);
+    voiceData_.GetTrack(1).GetEvents().insert(
+        voiceData_.GetTrack(1).GetEvents().begin(),
+        VoiceEvent(0, 0xB1, 7, 33));
+    index.ChaseStateAt(1, 6000, state);
+    EXPECT_EQ(Replay(1, 6000), state);
+}
+
+TEST_F(ChaseIndexTest, Apply)
+{
+    ChaseState state;
+    state.Apply(VoiceEvent(0, 0x90, 60, 100));
+    state.Apply(VoiceEvent(0, 0x90, 64, 90));
+    state.Apply(VoiceEvent(0, 0x90, 64, 0));
+    state.Apply(VoiceEvent(0, 0xB0, 64, 127));
+    state.Apply(VoiceEvent(0, 0xC0, 12, 0));
+    state.Apply(VoiceEvent(0, 0xE0, 0, 64));
+
+    EXPECT_TRUE(state.IsHeld(60));
+    EXPECT_EQ(100, state.velocities[60]);
+    EXPECT_FALSE(state.IsHeld(64));
+    EXPECT_EQ(127, state.controllers[64]);
+    EXPECT_EQ(ChaseState::unset, state.controllers[7]);
+    EXPECT_EQ(12, state.program);
+    EXPECT_EQ(8192, state.pitch_wheel);
+    EXPECT_EQ(ChaseState::unset, state.channel_pressure);
+
+    state.Apply(VoiceEvent(10, 0x80, 60, 0));
+    EXPECT_FALSE(state.IsHeld(60));
+}
+
+TEST_F(ChaseIndexTest, InvalidCheckpoints)
+{
+    std::vector<UInt32> ticks;
+    ticks.push_back(10);
+    ticks.push_back(5);
+    EXPECT_THROW(ChaseIndex index(voiceData_, ticks), std::invalid_argument);
+    EXPECT_THROW(ChaseIndex index(voiceData_, 0), std::invalid_argument);
+
+    ChaseIndex index(voiceData_, 480);
+    ChaseState state;
+    EXPECT_THROW(index.ChaseStateAt(99, 0, state), std::out_of_range);
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "exlib/crc32c.h"
+#include "exlib/hash.h"
+#include "core/common/rocs_file_header.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+TEST(Checksum, CRC32C)
+{
+    EXPECT_EQ(0u, ex::crc32c("", 0));
+    EXPECT_EQ(0xE3069283u, ex::crc32c("123456789", 9));
+
+    // From RFC 3720, B.4.
+    std::vector<Byte> bytes(32, 0);
+    EXPECT_EQ(0x8A9136AAu, ex::crc32c(bytes.data(), bytes.size()));
+    std::fill(bytes.begin(), bytes.end(), 0xFF);
+    EXPECT_EQ(0x62A8AB43u, ex::crc32c(bytes.data(), bytes.size()));
+    for (size_t i = 0; i < bytes.size(); i++) bytes[i] = static_cast<Byte>(i);
+    EXPECT_EQ(0x46DD794Eu, ex::crc32c(bytes.data(), bytes.size()));
+
+    // Every path through the hardware code, at every alignment, matches the
+    // tables, and a CRC continues across pieces.
+    bytes.resize(100000);
+    UInt32 seed = 7;
+    for (auto &b: bytes)
+    {
+        seed = seed * 1103515245 + 12345;
+        b = static_cast<Byte>(seed >> 16);
+    }
+
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+        for (size_t size: {1, 7, 8, 255, 768, 769, 24575, 24576, 30000, 99990})
+        {
+            const Byte *data = bytes.data() + offset;
+            UInt32 crc = ex::crc32c(data, size);
+            EXPECT_EQ(ex::crc32c_portable(data, size), crc) << offset << ' ' << size;
+            EXPECT_EQ(crc, ex::crc32c(data + size / 3, size - size / 3, ex::crc32c(data, size / 3)));
+        }
+    }
+}
+
+TEST(Checksum, Hash64)
+{
+    EXPECT_EQ(0xEF46DB3751D8E999ull, ex::hash64("", 0));
+    EXPECT_EQ(0x44BC2CF5AD770999ull, ex::hash64("abc", 3));
+    EXPECT_EQ(0xFBCEA83C8A378BF1ull, ex::hash64("Nobody inspects the spammish repetition", 39));
+    EXPECT_NE(ex::hash64("abc", 3), ex::hash64("abc", 3, 1));
+}
+
+TEST(Checksum, Sections)
+{
+    UInt32 seed = cmn::header_checksum("ROCS", "SDAT", cmn::FileVersion(2, 6));
+    EXPECT_NE(seed, cmn::header_checksum("ROCS", "SDAT", cmn::FileVersion(2, 5)));
+
+    ex::BinaryWriter first;
+    ex::WriteString(first, "Overture");
+    ex::BinaryWriter second;
+    ex::WriteString(second, "Entr'acte");
+
+    std::ostringstream os;
+    cmn::write_section(os, first, seed);
+    cmn::write_section(os, second);
+    ex::BinaryWriter writer;
+    cmn::write_section(writer, first, seed);
+    cmn::write_section(writer, second);
+    ASSERT_EQ(os.str(), writer.str());
+
+    std::istringstream is(os.str());
+    ex::BinaryReader fromStream = cmn::read_section(is, "First", seed);
+    EXPECT_EQ("Overture", ex::ReadString(fromStream));
+    fromStream = cmn::read_section(is, "Second");
+    EXPECT_EQ("Entr'acte", ex::ReadString(fromStream));
+
+    ex::BinaryReader reader(writer.GetData(), writer.size());
+    ex::BinaryReader section = cmn::read_section(reader, "First", seed);
+    EXPECT_EQ(writer.GetData() + 8, section.GetData());
+    EXPECT_EQ("Overture", ex::ReadString(section));
+
+    // The wrong seed, a flipped bit, or too few bytes.
+    ex::BinaryReader unseeded(writer.GetData(), writer.size());
+    EXPECT_THROW(cmn::read_section(unseeded, "First"), cmn::ChecksumError);
+
+    std::string damaged = os.str();
+    damaged[10] ^= 4;
+    std::istringstream damagedStream(damaged);
+    try
+    {
+        cmn::read_section(damagedStream, "First", seed);
+        FAIL();
+    } catch (cmn::ChecksumError &e)
+    {
+        EXPECT_EQ("First is damaged: its checksum does not match.", std::string(e.what()));
+    }
+
+    std::istringstream truncated(os.str().substr(0, 12));
+    EXPECT_THROW(cmn::read_section(truncated, "First", seed), cmn::ChecksumError);
+    truncated.clear();
+    truncated.exceptions(std::istream::failbit);
+    truncated.seekg(0);
+    EXPECT_THROW(cmn::read_section(truncated, "First", seed), cmn::ChecksumError);
+    ex::BinaryReader truncatedReader(writer.GetData(), 12);
+    EXPECT_THROW(cmn::read_section(truncatedReader, "First", seed), cmn::ChecksumError);
+
+    // A damaged length that runs past the end.
+    damaged = os.str();
+    damaged[3] = 0x7F;
+    std::istringstream longStream(damaged);
+    EXPECT_THROW(cmn::read_section(longStream, "First", seed), cmn::ChecksumError);
+}
@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+#include "core/test/allocation_counter.h"
+#include "core/rocs_midi/merged_voice_stream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace rocs_midi;
+
+class MergedVoiceStreamTest
+    :
+    public ::testing::Test
+{
+public:
+    MergedVoiceStreamTest()
+    {
+        for (UInt16 trackId = 0; trackId < 12; trackId++)
+        {
+            voiceData_.AddTrack(MakeTrack(trackId, trackId * 31 + 1));
+            voiceData_.GetGroups().GetGroups()[trackId % 3].insert(trackId);
+        }
+    }
+
+protected:
+    /* Tracks in three groups, with events at shared times, several events at
+     * one time and an empty track. */
+    static VoiceTrackPtrT MakeTrack(UInt16 trackId, UInt32 seed)
+    {
+        VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+        track->SetGroupId(static_cast<UInt8>(trackId % 3));
+        if (trackId == 7) return track;
+
+        UInt32 absTime = 0;
+        for (UInt32 i = 0; i < 300; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            absTime += (seed >> 16) % 4 * 30;
+            track->GetEvents().push_back(VoiceEvent(absTime, 0x90, (seed >> 8) % 128, 100));
+        }
+
+        return track;
+    }
+
+    /* Every event, sorted the slow way. */
+    MergedVoiceEvtVecT Expected() const
+    {
+        MergedVoiceEvtVecT expected;
+        for (auto &it: voiceData_.GetTracks())
+        {
+            const VoiceTrack &track = *it.second;
+            for (auto &voiceEvent: track.GetEvents())
+            {
+                MergedVoiceEvent merged;
+                merged.abs_time = voiceEvent.GetAbsTime();
+                merged.message = voiceEvent.GetVoiceMessage();
+                merged.track_id = it.first;
+                merged.group_id = track.GetGroupId();
+                expected.push_back(merged);
+            }
+        }
+
+        std::stable_sort(
+            expected.begin(),
+            expected.end(),
+            [](const MergedVoiceEvent &lhs, const MergedVoiceEvent &rhs)->bool
+            {
+                if (lhs.abs_time != rhs.abs_time) return lhs.abs_time < rhs.abs_time;
+                return lhs.track_id < rhs.track_id;
+            });
+
+        return expected;
+    }
+
+    static void ExpectSame(const MergedVoiceEvtVecT &expected, const MergedVoiceEvtVecT &actual)
+    {
+        ASSERT_EQ(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(expected[i].abs_time, actual[i].abs_time);
+            ASSERT_EQ(expected[i].track_id, actual[i].track_id);
+            ASSERT_EQ(expected[i].group_id, actual[i].group_id);
+            ASSERT_EQ(expected[i].message.GetStatus(), actual[i].message.GetStatus());
+            ASSERT_EQ(expected[i].message.GetData1(), actual[i].message.GetData1());
+            ASSERT_EQ(expected[i].message.GetData2(), actual[i].message.GetData2());
+        }
+    }
+
+    VoiceData voiceData_;
+};
+
+TEST_F(MergedVoiceStreamTest, MatchesSort)
+{
+    MergedVoiceStream stream(voiceData_);
+    ExpectSame(Expected(), stream.GetEvents());
+    EXPECT_EQ(12u, stream.GetLastUpdateCount());
+
+    stream.GetEvents();
+    EXPECT_EQ(0u, stream.GetLastUpdateCount());
+}
+
+TEST_F(MergedVoiceStreamTest, UpdatesChangedTracks)
+{
+    MergedVoiceStream stream(voiceData_);
+    stream.GetEvents();
+
+    VoiceEvtVecT &events = voiceData_.GetTrack(3).GetEvents();
+    events.erase(events.begin(), events.begin() + 50);
+    voiceData_.GetTrack(7).GetEvents().push_back(VoiceEvent(600, 0x80, 60, 0));
+    ExpectSame(Expected(), stream.GetEvents());
+    EXPECT_EQ(2u, stream.GetLastUpdateCount());
+
+    voiceData_.GetTrack(5).SetGroupId(1);
+    ExpectSame(Expected(), stream.GetEvents());
+    EXPECT_EQ(1u, stream.GetLastUpdateCount());
+
+    voiceData_.GetTracks().erase(4);
+    voiceData_.AddTrack(MakeTrack(20, 99));
+    ExpectSame(Expected(), stream.GetEvents());
+    EXPECT_EQ(2u, stream.GetLastUpdateCount());
+
+    // A track is known by the id the VoiceData keeps it under, even after
+    // its own id changes.
+    voiceData_.GetTrack(8).SetTrackId(0x28);
+    ExpectSame(Expected(), stream.GetEvents());
+    voiceData_.GetTrack(8).GetEvents().pop_back();
+    ExpectSame(Expected(), stream.GetEvents());
+    EXPECT_EQ(1u, stream.GetLastUpdateCount());
+}
+
+TEST_F(MergedVoiceStreamTest, CursorReadsGroups)
+{
+    MergedVoiceStream stream(voiceData_);
+    MergedVoiceEvtVecT expected = Expected();
+    MergedVoiceCursor cursor(stream);
+    std::set<UInt8> groups;
+    groups.insert(0);
+    groups.insert(2);
+    cursor.SetGroups(groups);
+
+    // Track 4 is in group 2 as well as its own group 1.
+    voiceData_.GetGroups().GetGroups()[2].insert(4);
+    UInt32 seek = expected[expected.size() / 2].abs_time;
+    cursor.Seek(seek);
+    for (auto &it: expected)
+    {
+        if (it.abs_time < seek || (it.group_id == 1 && it.track_id != 4)) continue;
+        const MergedVoiceEvent *next = cursor.Next();
+        ASSERT_TRUE(next != nullptr);
+        EXPECT_EQ(it.abs_time, next->abs_time);
+        EXPECT_EQ(it.track_id, next->track_id);
+    }
+
+    EXPECT_TRUE(cursor.Next() == nullptr);
+}
+
+TEST_F(MergedVoiceStreamTest, CursorDoesNotAllocate)
+{
+    MergedVoiceStream stream(voiceData_);
+    MergedVoiceCursor cursor(stream);
+    size_t count = 0;
+    AllocationCounter counter;
+    for (UInt32 tick = 0; tick < 20000; tick += 100)
+    {
+        while (cursor.NextBefore(tick)) count++;
+    }
+
+    cursor.Seek(0);
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_EQ(stream.GetEvents().size(), count);
+
+    // With groups set, only SetGroups lists the events to read.
+    std::set<UInt8> groups;
+    groups.insert(1);
+    cursor.SetGroups(groups);
+    size_t expected = 0;
+    for (auto &it: stream.GetEvents())
+    {
+        if (it.group_id == 1) expected++;
+    }
+
+    AllocationCounter filteredCounter;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        cursor.Seek(0);
+        count = 0;
+        for (UInt32 tick = 0; tick < 20000; tick += 100)
+        {
+            while (const MergedVoiceEvent *next = cursor.NextBefore(tick))
+            {
+                EXPECT_EQ(1, next->group_id);
+                count++;
+            }
+        }
+
+        EXPECT_EQ(expected, count);
+    }
+
+    EXPECT_EQ(0u, filteredCounter.count());
+}
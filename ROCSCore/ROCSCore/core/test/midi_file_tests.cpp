@@ -0,0 +1,405 @@
+#include "gtest/gtest.h"
+#include "core/test/test_midi_file.h"
+#include "core/test/allocation_counter.h"
+#include "core/std_midi/midi_file.h"
+#include "core/std_midi/compact_track.h"
+#include "core/rocs_midi/voice_track.h"
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std_midi;
+
+const std::string testMIDIFilename("midi_file_tests.mid");
+
+static std::string DumpMIDIFile(const MIDIFile &midiFile)
+{
+    std::ostringstream os;
+    midiFile.WriteStringAll(os);
+    for (auto &track: midiFile.GetTracks())
+    {
+        os << track.GetTrackId() << ":" << track.GetTrackName() << ":"
+           << track.GetLength() << std::endl;
+    }
+
+    os << midiFile.GetLength() << std::endl;
+    return os.str();
+}
+
+class MIDIFileTest
+    :
+    public ::testing::Test
+{
+public:
+    MIDIFileTest()
+        :
+        bytes_(TestMIDIFileBuilder::Orchestra(3).Bytes())
+    {
+        TestMIDIFileBuilder::Orchestra(3).WriteFile(testMIDIFilename);
+    }
+
+    ~MIDIFileTest()
+    {
+        std::remove(testMIDIFilename.c_str());
+    }
+
+protected:
+    std::vector<Byte> bytes_;
+};
+
+TEST_F(MIDIFileTest, StreamReadsAllTracks)
+{
+    MIDIFile midiFile(testMIDIFilename);
+    EXPECT_EQ(5, midiFile.GetTrackCount());
+    ASSERT_EQ(4u, midiFile.GetTracks().size());
+    EXPECT_EQ("Conductor", midiFile.GetTracks().at(0).GetTrackName());
+    EXPECT_EQ("Voice 3", midiFile.GetTrack("Voice 3").GetTrackName());
+    EXPECT_EQ(4u, midiFile.GetTrack("Voice 3").GetTrackId());
+    EXPECT_EQ(6720u, midiFile.GetLength());
+}
+
+TEST_F(MIDIFileTest, MappedMatchesStream)
+{
+    MIDIFile streamFile(testMIDIFilename);
+    MIDIFile mappedFile(testMIDIFilename, load_mapped);
+    EXPECT_EQ(DumpMIDIFile(streamFile), DumpMIDIFile(mappedFile));
+    EXPECT_EQ(testMIDIFilename, mappedFile.GetFilename());
+}
+
+TEST_F(MIDIFileTest, ByteSpanMatchesStream)
+{
+    MIDIFile streamFile(testMIDIFilename);
+    MIDIFile spanFile(&bytes_[0], bytes_.size(), testMIDIFilename);
+    EXPECT_EQ(DumpMIDIFile(streamFile), DumpMIDIFile(spanFile));
+    EXPECT_EQ(streamFile.GetDivision(), spanFile.GetDivision());
+    EXPECT_EQ(streamFile.GetFormat(), spanFile.GetFormat());
+}
+
+TEST_F(MIDIFileTest, ByteSpanTruncatedThrows)
+{
+    for (size_t size: {size_t(0), size_t(10), bytes_.size() / 2, bytes_.size() - 1})
+    {
+        EXPECT_THROW(MIDIFile(&bytes_[0], size), std::runtime_error);
+    }
+}
+
+TEST_F(MIDIFileTest, ByteSpanRejectsBadHeader)
+{
+    bytes_[0] = 'X';
+    EXPECT_THROW(MIDIFile(&bytes_[0], bytes_.size()), MIDIFileError);
+}
+
+TEST_F(MIDIFileTest, ParallelMatchesStream)
+{
+    MIDIFile streamFile(testMIDIFilename);
+    MIDIFile parallelFile(testMIDIFilename, load_parallel, 4);
+    EXPECT_EQ(DumpMIDIFile(streamFile), DumpMIDIFile(parallelFile));
+
+    for (unsigned threads: {0u, 2u, 16u})
+    {
+        MIDIFile spanFile(&bytes_[0], bytes_.size(), testMIDIFilename, threads);
+        EXPECT_EQ(DumpMIDIFile(streamFile), DumpMIDIFile(spanFile));
+    }
+}
+
+TEST_F(MIDIFileTest, ParallelWarnsAboutUnrecognizedChunks)
+{
+    warnings.str("");
+    MIDIFile streamFile(testMIDIFilename);
+    std::string streamWarnings = warnings.str();
+    EXPECT_NE(std::string::npos, streamWarnings.find("XFIH"));
+
+    warnings.str("");
+    MIDIFile parallelFile(&bytes_[0], bytes_.size(), testMIDIFilename, 4);
+    EXPECT_EQ(streamWarnings, warnings.str());
+}
+
+TEST_F(MIDIFileTest, ParallelTruncatedThrows)
+{
+    EXPECT_THROW(
+        MIDIFile(&bytes_[0], bytes_.size() - 1, testMIDIFilename, 4),
+        std::runtime_error);
+}
+
+TEST_F(MIDIFileTest, ScanChunks)
+{
+    ByteSpanReader reader(&bytes_[0], bytes_.size());
+    reader.seekg(MIDI_HEADER_SIZE);
+    auto chunks = scan_midi_chunks(reader, 5);
+    ASSERT_EQ(5u, chunks.size());
+    EXPECT_EQ("MTrk", chunks[0].chunkId());
+    EXPECT_EQ(UInt32(MIDI_HEADER_SIZE), chunks[0].offset);
+    EXPECT_EQ("XFIH", chunks[1].chunkId());
+    EXPECT_EQ(2u, chunks[1].size);
+    EXPECT_EQ(chunks[1].offset + 8 + chunks[1].size, chunks[2].offset);
+    EXPECT_EQ(bytes_.size(), reader.tellg());
+}
+
+TEST_F(MIDIFileTest, LazyDecodesOnDemand)
+{
+    MIDIFile streamFile(testMIDIFilename);
+    MIDIFile lazyFile(testMIDIFilename, load_lazy);
+    EXPECT_FALSE(lazyFile.IsFullyLoaded());
+    EXPECT_EQ(streamFile.GetTrackNames(), lazyFile.GetTrackNames());
+    EXPECT_EQ(streamFile.GetLength(), lazyFile.GetLength());
+    EXPECT_EQ(
+        streamFile.GetConductorPackets().size(),
+        lazyFile.GetConductorPackets().size());
+    EXPECT_EQ(3u, lazyFile.GetTrack("Voice 2").GetTrackId());
+    EXPECT_EQ(nullptr, lazyFile.FindTrack("PDF"));
+    EXPECT_THROW(lazyFile.GetTrack("PDF"), MIDIFileError);
+    EXPECT_FALSE(lazyFile.IsFullyLoaded());
+
+    EXPECT_EQ(DumpMIDIFile(streamFile), DumpMIDIFile(lazyFile));
+    EXPECT_TRUE(lazyFile.IsFullyLoaded());
+}
+
+TEST_F(MIDIFileTest, LazyReadsFromSeveralThreads)
+{
+    MIDIFile streamFile(testMIDIFilename);
+    MIDIFile lazyFile(testMIDIFilename, load_lazy, 2);
+    const MIDIFile &shared = lazyFile;
+    std::vector<std::thread> readers;
+    std::vector<std::string> dumps(4);
+    for (size_t i = 0; i < dumps.size(); i++)
+    {
+        readers.push_back(std::thread(
+            [&shared, &dumps, i]()
+            {
+                shared.GetTrack(i % 2 ? "Voice 1" : "Voice 3");
+                shared.GetLength();
+                shared.GetConductorPackets();
+                dumps[i] = DumpMIDIFile(shared);
+            }));
+    }
+
+    for (auto &reader: readers)
+    {
+        reader.join();
+    }
+
+    for (auto &dump: dumps)
+    {
+        EXPECT_EQ(DumpMIDIFile(streamFile), dump);
+    }
+}
+
+TEST_F(MIDIFileTest, LazyWarnsAboutUnrecognizedChunks)
+{
+    warnings.str("");
+    MIDIFile streamFile(testMIDIFilename);
+    std::string streamWarnings = warnings.str();
+
+    warnings.str("");
+    MIDIFile lazyFile(testMIDIFilename, load_lazy);
+    EXPECT_EQ(streamWarnings, warnings.str());
+}
+
+TEST_F(MIDIFileTest, MappedMissingFileThrows)
+{
+    EXPECT_THROW(
+        MIDIFile("midi_file_tests_missing.mid", load_mapped),
+        std::exception);
+}
+
+TEST_F(MIDIFileTest, CompactTrackMatchesMIDITrack)
+{
+    MIDIFile midiFile(&bytes_[0], bytes_.size());
+    ByteSpanReader scanner(&bytes_[0], bytes_.size());
+    scanner.seekg(MIDI_HEADER_SIZE);
+    auto chunks = scan_midi_chunks(scanner, 5);
+
+    size_t trackIndex = 0;
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        ByteSpanReader reader(&bytes_[0], bytes_.size());
+        reader.seekg(chunks[i].offset);
+        if (chunks[i].chunkId() != "MTrk")
+        {
+            EXPECT_THROW(CompactTrack(reader, i), UnrecognizedTrackID);
+            continue;
+        }
+
+        CompactTrack compact(reader, i);
+        const MIDITrack &track = midiFile.GetTracks().at(trackIndex++);
+        EXPECT_EQ(track.GetTrackId(), compact.GetTrackId());
+        EXPECT_EQ(track.GetTrackName(), compact.GetTrackName());
+        EXPECT_EQ(track.GetLength(), compact.GetLength());
+        ASSERT_EQ(track.GetPackets().size(), compact.GetPackets().size());
+        for (size_t p = 0; p < track.GetPackets().size(); p++)
+        {
+            std::ostringstream expected, actual;
+            track.GetPackets()[p].WriteString(expected);
+            compact.ToMIDIPacket(p).WriteString(actual);
+            EXPECT_EQ(expected.str(), actual.str());
+        }
+    }
+}
+
+TEST_F(MIDIFileTest, CompactMetaAccessors)
+{
+    MIDIFile midiFile(&bytes_[0], bytes_.size());
+    ByteSpanReader reader(&bytes_[0], bytes_.size());
+    reader.seekg(MIDI_HEADER_SIZE);
+    CompactTrack compact(reader, 0);
+
+    size_t metaCount = 0;
+    size_t packetIndex = 0;
+    for (auto &packet: midiFile.GetConductorPackets())
+    {
+        auto meta = packet.meta_messages().begin();
+        for (auto it = compact.PacketBegin(packetIndex);
+             it != compact.PacketEnd(packetIndex);
+             it++)
+        {
+            ASSERT_TRUE(it->is_meta());
+            CompactMeta compactMeta = compact.GetMeta(*it);
+            EXPECT_EQ((*meta)->status(), compactMeta.status());
+            EXPECT_EQ((*meta)->message(), compactMeta.message());
+            EXPECT_EQ((*meta)->microseconds(), compactMeta.microseconds());
+            EXPECT_EQ((*meta)->numerator(), compactMeta.numerator());
+            EXPECT_EQ((*meta)->denominator(), compactMeta.denominator());
+            EXPECT_EQ((*meta)->clocksPerClick(), compactMeta.clocksPerClick());
+            EXPECT_EQ((*meta)->notated32nds(), compactMeta.notated32nds());
+            EXPECT_EQ((*meta)->sharps(), compactMeta.sharps());
+            EXPECT_EQ((*meta)->mode(), compactMeta.mode());
+            meta++;
+            metaCount++;
+        }
+
+        packetIndex++;
+    }
+
+    EXPECT_EQ(8u, metaCount);
+}
+
+TEST_F(MIDIFileTest, PacketViewsMatchFilters)
+{
+    MIDIFile midiFile(&bytes_[0], bytes_.size());
+    size_t voiceCount = 0;
+    for (auto &track: midiFile.GetTracks())
+    {
+        for (auto &packet: track.GetPackets())
+        {
+            for (UInt8 status: {0x90, 0xB0, 0xC0, 0xE0})
+            {
+                auto copied = packet.voice_filter(status);
+                auto view = packet.voice_view(status);
+                ASSERT_EQ(copied.size(), view.size());
+                size_t i = 0;
+                for (auto &msg: view)
+                {
+                    EXPECT_EQ(copied[i].GetStatus(), msg.GetStatus());
+                    EXPECT_EQ(copied[i].GetData1(), msg.GetData1());
+                    EXPECT_EQ(copied[i].GetData2(), msg.GetData2());
+                    EXPECT_GE(&msg, &packet.voice_messages().front());
+                    EXPECT_LE(&msg, &packet.voice_messages().back());
+                    i++;
+                }
+
+                size_t visited = 0;
+                packet.visit_voice(status, [&](const VoiceMessage &) { visited++; });
+                EXPECT_EQ(copied.size(), visited);
+                voiceCount += visited;
+            }
+
+            for (UInt8 status: {0x03, 0x06, 0x2F, 0x51, 0x58})
+            {
+                auto copied = packet.meta_filter(status);
+                EXPECT_EQ(copied.get(), packet.find_meta(status));
+                size_t visited = 0;
+                packet.visit_meta(status, [&](const MetaMessage &) { visited++; });
+                EXPECT_EQ(packet.meta_view(status).size(), visited);
+            }
+        }
+    }
+
+    EXPECT_GT(voiceCount, 0u);
+}
+
+TEST_F(MIDIFileTest, TrackLoadAllocatesOnlyWhatItKeeps)
+{
+    ByteSpanReader scanner(&bytes_[0], bytes_.size());
+    scanner.seekg(MIDI_HEADER_SIZE);
+    auto chunks = scan_midi_chunks(scanner, 5);
+
+    for (size_t i: {size_t(0), size_t(2), size_t(4)})
+    {
+        // Reading the messages allocates the same MetaMessages whether or
+        // not they are kept, so a scan measures everything except storage.
+        ByteSpanReader scanReader(&bytes_[0], bytes_.size());
+        scanReader.seekg(chunks[i].offset);
+        size_t scanAllocations;
+        {
+            AllocationCounter counter;
+            scan_midi_track_length(scanReader);
+            scanAllocations = counter.count();
+        }
+
+        ByteSpanReader reader(&bytes_[0], bytes_.size());
+        reader.seekg(chunks[i].offset);
+        std::unique_ptr<MIDITrack> track;
+        size_t loadAllocations;
+        {
+            AllocationCounter counter;
+            track.reset(new MIDITrack(reader, i));
+            loadAllocations = counter.count() - 1;
+        }
+
+        // The storage a track needs if every packet is built in place and
+        // moved into the track: one vector growth sequence per packet vector
+        // and for the track's packet vector, and nothing else.
+        MetaMsgPtrT meta(new MetaMessage(sb::end_of_track));
+        size_t storageAllocations;
+        {
+            AllocationCounter counter;
+            MIDIPacketVecT packets;
+            for (auto &packet: track->GetPackets())
+            {
+                MIDIPacket copy(packet.delta_time());
+                for (size_t m = 0; m < packet.meta_messages().size(); m++)
+                {
+                    copy.add_message(meta);
+                }
+
+                for (auto &voice: packet.voice_messages())
+                {
+                    copy.add_message(voice);
+                }
+
+                packets.push_back(std::move(copy));
+            }
+
+            storageAllocations = counter.count();
+        }
+
+        EXPECT_EQ(scanAllocations + storageAllocations, loadAllocations)
+            << "track " << i << " with " << track->GetPackets().size() << " packets";
+    }
+}
+
+TEST_F(MIDIFileTest, LoadedTracksAreNotCopied)
+{
+    MIDIFile midiFile(&bytes_[0], bytes_.size());
+    const MIDITrack &voiceTrack = midiFile.GetTrack("Voice 2");
+    {
+        AllocationCounter counter;
+        midiFile.GetLength();
+        for (auto &track: midiFile.GetTracks())
+        {
+            track.GetLength();
+        }
+
+        EXPECT_EQ(0u, counter.count());
+    }
+
+    {
+        // The VoiceTrack reserves its events once and copies nothing else.
+        AllocationCounter counter;
+        rocs_midi::VoiceTrack track(voiceTrack);
+        EXPECT_EQ(1u, counter.count());
+    }
+}
@@ -0,0 +1,366 @@
+#include "gtest/gtest.h"
+#include "core/rocs_midi/show_data.h"
+#include "core/common/mapped_streambuf.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace rocs_midi;
+
+class ShowDataTest
+    :
+    public ::testing::Test
+{
+public:
+    ShowDataTest()
+        :
+        showData_("Show")
+    {
+        const char *numbers[] = { "1", "2", "2a", "10", "11" };
+        UInt32 seed = 3;
+        for (auto number: numbers)
+        {
+            SongDataPtrT song(new SongData(number, std::string("Song ") + number, 480, 20000));
+            for (UInt16 trackId = 0; trackId < 3; trackId++)
+            {
+                VoiceTrackPtrT track(new VoiceTrack(trackId, "Voice"));
+                track->SetGroupId(0);
+                for (UInt32 i = 0; i < 100; i++)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    track->GetEvents().push_back(VoiceEvent(i * 120, 0x90, (seed >> 16) % 128, 100));
+                }
+
+                song->GetVoiceData().AddTrack(track);
+            }
+
+            showData_.AddSongData(song);
+        }
+    }
+
+protected:
+    std::shared_ptr<std::stringstream> Write(const cmn::FileVersion &fileVersion) const
+    {
+        std::shared_ptr<std::stringstream> ss(new std::stringstream);
+        showData_.WriteBinary(*ss, fileVersion);
+        return ss;
+    }
+
+    ShowData showData_;
+};
+
+TEST_F(ShowDataTest, ReadsSongTable)
+{
+    ShowData eager(*Write(LatestFileVersion));
+    EXPECT_EQ(showData_, eager);
+
+    ShowData lazy(Write(LatestFileVersion));
+    EXPECT_EQ("Show", lazy.GetShowName());
+    EXPECT_EQ(showData_.GetSongNumbers(), lazy.GetSongNumbers());
+    EXPECT_EQ(showData_.GetSongNamesBySongNumber(), lazy.GetSongNamesBySongNumber());
+    for (auto &songNumber: lazy.GetSongNumbers())
+    {
+        EXPECT_FALSE(lazy.IsSongLoaded(songNumber));
+    }
+
+    EXPECT_EQ(showData_.GetSongData("10"), lazy.GetSongData("10"));
+    EXPECT_TRUE(lazy.IsSongLoaded("10"));
+    EXPECT_FALSE(lazy.IsSongLoaded("2"));
+    EXPECT_EQ(&lazy.GetSongData("10"), &lazy.GetSongData("10"));
+    EXPECT_THROW(lazy.GetSongData("3"), std::out_of_range);
+
+    // Reads the rest.
+    EXPECT_EQ(showData_, lazy);
+    EXPECT_TRUE(lazy.IsSongLoaded("2"));
+
+    std::stringstream again;
+    lazy.WriteBinary(again, LatestFileVersion);
+    EXPECT_EQ(Write(LatestFileVersion)->str(), again.str());
+}
+
+TEST_F(ShowDataTest, ReadsOlderVersionsAtOnce)
+{
+    ShowData lazy(Write(cmn::FileVersion(2, 2)));
+    EXPECT_TRUE(lazy.IsSongLoaded("1"));
+    EXPECT_TRUE(lazy.IsSongLoaded("11"));
+    EXPECT_EQ(showData_, lazy);
+}
+
+TEST_F(ShowDataTest, Prefetch)
+{
+    ShowData lazy(Write(LatestFileVersion));
+    lazy.Prefetch("2", 2);
+    lazy.WaitForPrefetch();
+    EXPECT_FALSE(lazy.IsSongLoaded("1"));
+    EXPECT_FALSE(lazy.IsSongLoaded("2"));
+    EXPECT_TRUE(lazy.IsSongLoaded("2a"));
+    EXPECT_TRUE(lazy.IsSongLoaded("10"));
+    EXPECT_FALSE(lazy.IsSongLoaded("11"));
+    EXPECT_EQ(showData_.GetSongData("2a"), lazy.GetSongData("2a"));
+
+    // Songs already read are skipped.
+    lazy.Prefetch("1", 3);
+    lazy.WaitForPrefetch();
+    EXPECT_TRUE(lazy.IsSongLoaded("11"));
+
+    // A prefetch still running when the ShowData goes away is waited for.
+    ShowData(Write(LatestFileVersion)).Prefetch("1", 4);
+}
+
+TEST_F(ShowDataTest, BadSongTable)
+{
+    std::string bytes = Write(cmn::FileVersion(2, 5))->str();
+
+    // The length of song "1", the last field of the first table entry.
+    size_t at = bytes.find("Song 1") + 6 + 8;
+    bytes[at] ^= 1;
+    ShowData lazy(std::make_shared<std::stringstream>(bytes));
+    EXPECT_THROW(lazy.GetSongData("1"), ShowDataError);
+
+    // From 2.6 the table is checked as the file is opened.
+    bytes = Write(LatestFileVersion)->str();
+    bytes[bytes.find("Song 1") + 6 + 8] ^= 1;
+    EXPECT_THROW(ShowData(std::make_shared<std::stringstream>(bytes), 0, verify_none), cmn::ChecksumError);
+    bytes = Write(LatestFileVersion)->str();
+    bytes[2] ^= 1;
+    std::istringstream badHeader(bytes);
+    EXPECT_THROW(ShowData read(badHeader), cmn::FileHeaderError);
+}
+
+TEST_F(ShowDataTest, Checksums)
+{
+    std::string bytes = Write(LatestFileVersion)->str();
+
+    // A byte in the middle of song "10", among its events.
+    size_t at = (bytes.rfind("Song 10") + bytes.rfind("Song 11")) / 2;
+    bytes[at] ^= 1;
+
+    std::istringstream is(bytes);
+    try
+    {
+        ShowData read(is);
+        FAIL();
+    } catch (cmn::ChecksumError &e)
+    {
+        EXPECT_EQ("Song 10 is damaged: its checksum does not match.", std::string(e.what()));
+    }
+
+    ex::BinaryReader reader(bytes.data(), bytes.size());
+    EXPECT_THROW(ShowData read(reader), cmn::ChecksumError);
+    EXPECT_THROW(ShowData(std::make_shared<std::stringstream>(bytes)), cmn::ChecksumError);
+
+    // Checked per song, the other songs still read.
+    ShowData lazy(std::make_shared<std::stringstream>(bytes), 0, verify_per_song);
+    EXPECT_EQ(showData_.GetSongData("2"), lazy.GetSongData("2"));
+    EXPECT_THROW(lazy.GetSongData("10"), cmn::ChecksumError);
+    EXPECT_EQ(showData_.GetSongData("11"), lazy.GetSongData("11"));
+
+    // Unchecked, the damage is read as it is.
+    ShowData unchecked(std::make_shared<std::stringstream>(bytes), 0, verify_none);
+    EXPECT_NO_THROW(unchecked.GetSongData("10"));
+
+    // Cut short.
+    std::istringstream truncated(bytes.substr(0, bytes.size() - 1));
+    EXPECT_THROW(ShowData read(truncated), std::exception);
+    std::istringstream truncatedTable(bytes.substr(0, 40));
+    EXPECT_THROW(ShowData read(truncatedTable), cmn::ChecksumError);
+}
+
+TEST_F(ShowDataTest, SongsNotWhereTheTableSays)
+{
+    // Version 2.5 has no checksums to catch a bad table first.
+    std::string bytes = Write(cmn::FileVersion(2, 5))->str();
+    std::string one = std::string("\x01") + "1" + "\x06" + "Song 1";
+    std::string two = std::string("\x01") + "2" + "\x06" + "Song 2";
+    size_t oneAt = bytes.find(one) + one.size();
+    size_t twoAt = bytes.find(two) + two.size();
+
+    // Songs 1 and 2 are the same length, so swapping their places makes
+    // each one's bytes the other song.
+    std::string swapped(bytes);
+    swapped.replace(oneAt, 16, bytes, twoAt, 16);
+    swapped.replace(twoAt, 16, bytes, oneAt, 16);
+    ShowData lazy(std::make_shared<std::stringstream>(swapped));
+    EXPECT_THROW(lazy.GetSongData("1"), ShowDataError);
+    EXPECT_THROW(lazy.GetSongData("2"), ShowDataError);
+    EXPECT_EQ(showData_.GetSongData("10"), lazy.GetSongData("10"));
+    std::istringstream eager(swapped);
+    EXPECT_THROW(ShowData read(eager), ShowDataError);
+
+    // A length past the end of the file is not allocated.
+    std::string huge(bytes);
+    UInt64 length = UInt64(1) << 40;
+    memcpy(&huge[oneAt + 8], &length, sizeof(length));
+    std::istringstream hugeStream(huge);
+    EXPECT_THROW(ShowData read(hugeStream), ShowDataError);
+    ShowData hugeLazy(std::make_shared<std::stringstream>(huge));
+    EXPECT_THROW(hugeLazy.GetSongData("1"), ShowDataError);
+}
+
+TEST_F(ShowDataTest, OpenMapped)
+{
+    const std::string path("show_data_tests.showdata");
+    {
+        std::ofstream os(path.c_str(), std::ios::binary);
+        showData_.WriteBinary(os, LatestFileVersion);
+    }
+
+    ShowDataPtrT mapped = ShowData::OpenMapped(path);
+    std::remove(path.c_str());
+    EXPECT_FALSE(mapped->IsSongLoaded("2"));
+
+    const VoiceTrack &track = mapped->GetSongData("2").GetVoiceData().GetTrack(1);
+    EXPECT_TRUE(track.IsMapped());
+    EXPECT_EQ(showData_.GetSongData("2").GetVoiceData().GetTrack(1), track);
+    EXPECT_EQ(
+        showData_.GetSongData("2").GetVoiceData().GetTrack(1).EventSlice(1200, 4800, 3),
+        track.EventSlice(1200, 4800, 3));
+
+    // Reading a const track's events leaves them in the file.
+    VoiceEventSlice slice = track.Slice(1200, 4800);
+    VoiceEventSpan events = track.GetEvents();
+    EXPECT_TRUE(track.IsMapped());
+    EXPECT_EQ(track.GetEventData(), events.data());
+    EXPECT_EQ(100u, events.size());
+    EXPECT_EQ(slice.raw_begin(), track.Slice(1200, 4800).raw_begin());
+
+    // Changing a track copies its events first.
+    VoiceTrack &changed = const_cast<VoiceTrack &>(track);
+    UInt64 revision = changed.GetRevision();
+    changed.GetEvents().pop_back();
+    EXPECT_FALSE(changed.IsMapped());
+    EXPECT_NE(revision, changed.GetRevision());
+    EXPECT_EQ(99u, changed.GetEventCount());
+    EXPECT_TRUE(mapped->GetSongData("2").GetVoiceData().GetTrack(2).IsMapped());
+
+    // The tracks keep the mapping after the ShowData is gone.
+    VoiceTrack kept(mapped->GetSongData("11").GetVoiceData().GetTrack(0));
+    mapped.reset();
+    EXPECT_TRUE(kept.IsMapped());
+    EXPECT_EQ(showData_.GetSongData("11").GetVoiceData().GetTrack(0), kept);
+}
+
+TEST_F(ShowDataTest, StreamsCopyEvents)
+{
+    std::string bytes = Write(LatestFileVersion)->str();
+
+    // Only a mapping is read in place.
+    std::istringstream is(bytes);
+    ShowData read(is);
+    EXPECT_EQ(showData_, read);
+    EXPECT_FALSE(read.GetSongData("2").GetVoiceData().GetTrack(1).IsMapped());
+
+    ShowData lazy(std::make_shared<std::stringstream>(bytes));
+    EXPECT_FALSE(lazy.GetSongData("2").GetVoiceData().GetTrack(1).IsMapped());
+    lazy.GetSongs();
+    EXPECT_FALSE(lazy.GetSongData("11").GetVoiceData().GetTrack(0).IsMapped());
+    EXPECT_EQ(showData_, lazy);
+}
+
+TEST_F(ShowDataTest, MappedStreamReadsOlderVersions)
+{
+    for (UInt8 minor = 2; minor <= 6; minor++)
+    {
+        std::string bytes = Write(cmn::FileVersion(2, minor))->str();
+        std::shared_ptr<std::istream> is(
+            new cmn::MappedIStream(nullptr, bytes.data(), bytes.data() + bytes.size()));
+        ShowData lazy(is);
+        EXPECT_EQ(showData_, lazy);
+    }
+
+    EXPECT_THROW(ShowData::OpenMapped("no such file.showdata"), ex::MappedFileError);
+}
+
+TEST_F(ShowDataTest, BinaryReaderAndWriter)
+{
+    ex::BinaryWriter writer;
+    showData_.WriteBinary(writer, LatestFileVersion);
+    EXPECT_EQ(Write(LatestFileVersion)->str(), writer.str());
+
+    ex::BinaryReader reader(writer.GetData(), writer.size());
+    ShowData read(reader);
+    EXPECT_EQ(showData_, read);
+    EXPECT_FALSE(read.GetSongData("2").GetVoiceData().GetTrack(1).IsMapped());
+
+    // With an owner the tracks point into the memory, and keep it.
+    std::shared_ptr<std::string> bytes(new std::string(writer.str()));
+    ex::BinaryReader owned(bytes->data(), bytes->size(), bytes);
+    ShowData mapped(owned);
+    EXPECT_EQ(showData_, mapped);
+    EXPECT_TRUE(mapped.GetSongData("2").GetVoiceData().GetTrack(1).IsMapped());
+
+    for (UInt8 minor = 0; minor <= 5; minor++)
+    {
+        ex::BinaryWriter older;
+        showData_.WriteBinary(older, cmn::FileVersion(2, minor));
+        ex::BinaryReader olderReader(older.GetData(), older.size());
+        EXPECT_EQ(showData_, ShowData(olderReader));
+    }
+}
+
+TEST_F(ShowDataTest, ParallelMatchesOneThread)
+{
+    showData_.SetThreads(1);
+    std::string bytes = Write(LatestFileVersion)->str();
+    for (unsigned threads: {0u, 2u, 16u})
+    {
+        showData_.SetThreads(threads);
+        EXPECT_EQ(bytes, Write(LatestFileVersion)->str());
+
+        std::istringstream is(bytes);
+        EXPECT_EQ(showData_, ShowData(is, threads));
+
+        ex::BinaryReader reader(bytes.data(), bytes.size());
+        EXPECT_EQ(showData_, ShowData(reader, threads));
+
+        // The rest of a lazily read show, after one song.
+        ShowData lazy(std::make_shared<std::stringstream>(bytes), threads);
+        lazy.GetSongData("2a");
+        EXPECT_EQ(showData_, lazy);
+    }
+
+    // The song a sequential read would fail on first is the one reported.
+    // The table is changed in a version without checksums, which would
+    // catch it first.
+    bytes = Write(cmn::FileVersion(2, 5))->str();
+    size_t at = bytes.find("Song 2a") + 7 + 8;
+    bytes[at] ^= 1;
+    std::istringstream bad(bytes);
+    try
+    {
+        ShowData read(bad, 4);
+        FAIL();
+    } catch (ShowDataError &e)
+    {
+        EXPECT_NE(std::string::npos, std::string(e.what()).find("2a"));
+    }
+}
+
+TEST_F(ShowDataTest, CompactEvents)
+{
+    std::string raw = Write(LatestFileVersion)->str();
+    for (auto &it: showData_.GetSongs())
+    {
+        it.second->GetVoiceData().SetEncodings(compact_events);
+    }
+
+    std::string bytes = Write(LatestFileVersion)->str();
+    EXPECT_LT(bytes.size(), raw.size());
+
+    // Mapped or not, compact events are decoded.
+    std::shared_ptr<std::istream> is(
+        new cmn::MappedIStream(nullptr, bytes.data(), bytes.data() + bytes.size()));
+    ShowData mapped(is);
+    EXPECT_EQ(showData_, mapped);
+    const VoiceTrack &track = mapped.GetSongData("2").GetVoiceData().GetTrack(1);
+    EXPECT_FALSE(track.IsMapped());
+    EXPECT_EQ(compact_events, track.GetEncoding());
+
+    std::stringstream again;
+    mapped.WriteBinary(again, LatestFileVersion);
+    EXPECT_EQ(bytes, again.str());
+}
@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+#include "core/timeline/tempo_map.h"
+
+#include <vector>
+
+using namespace TL;
+
+class TempoMapTest
+    :
+    public ::testing::Test
+{
+public:
+    TempoMapTest()
+    {
+        // 120 bpm for four bars, then 150 bpm for four bars, then 60 bpm.
+        tempos_.push_back(Tempo(0, 500000));
+        tempos_.push_back(Tempo(4 * 4 * ppqn, 400000));
+        tempos_.push_back(Tempo(8 * 4 * ppqn, 1000000));
+    }
+
+protected:
+    static const UInt16 ppqn = 480;
+    TempoSeqT tempos_;
+};
+
+TEST_F(TempoMapTest, DefaultTempoBeforeFirstTempo)
+{
+    TempoSeqT tempos;
+    TempoMap empty(tempos, ppqn);
+    EXPECT_DOUBLE_EQ(500000.0, empty.TickToMicros(ppqn));
+
+    tempos.push_back(Tempo(ppqn, 1000000));
+    TempoMap late(tempos, ppqn);
+    EXPECT_DOUBLE_EQ(500000.0, late.TickToMicros(ppqn));
+    EXPECT_DOUBLE_EQ(1500000.0, late.TickToMicros(2 * ppqn));
+}
+
+TEST_F(TempoMapTest, TickToMicrosAcrossTempos)
+{
+    TempoMap tempoMap(tempos_, ppqn);
+    EXPECT_EQ(3u, tempoMap.GetSegments().size());
+    EXPECT_DOUBLE_EQ(0.0, tempoMap.TickToMicros(0));
+    EXPECT_DOUBLE_EQ(250000.0, tempoMap.TickToMicros(ppqn / 2));
+    EXPECT_DOUBLE_EQ(8000000.0, tempoMap.TickToMicros(16 * ppqn));
+    EXPECT_DOUBLE_EQ(8400000.0, tempoMap.TickToMicros(17 * ppqn));
+    EXPECT_DOUBLE_EQ(14400000.0, tempoMap.TickToMicros(32 * ppqn));
+    EXPECT_DOUBLE_EQ(16400000.0, tempoMap.TickToMicros(34 * ppqn));
+}
+
+TEST_F(TempoMapTest, MicrosToTickInvertsTickToMicros)
+{
+    TempoMap tempoMap(tempos_, ppqn);
+    for (UInt32 tick = 0; tick < 40 * ppqn; tick += 97)
+    {
+        EXPECT_NEAR(tick, tempoMap.MicrosToTick(tempoMap.TickToMicros(tick)), 1e-6);
+    }
+}
+
+TEST_F(TempoMapTest, TempoScalesChangeElapsedTime)
+{
+    CL::TempoScaleSeqT scales;
+    scales.push_back(CL::TempoScale(0, 2 * ppqn, 2.0));
+    scales.push_back(CL::TempoScale(16 * ppqn, 20 * ppqn, 0.5));
+    TempoMap tempoMap(tempos_, scales, ppqn);
+
+    // Twice as fast for two beats, then the written tempo.
+    EXPECT_DOUBLE_EQ(500000.0, tempoMap.TickToMicros(2 * ppqn));
+    EXPECT_DOUBLE_EQ(7500000.0, tempoMap.TickToMicros(16 * ppqn));
+
+    // Half as fast for four beats at 400000 us per quarter note.
+    EXPECT_DOUBLE_EQ(7500000.0 + 3200000.0, tempoMap.TickToMicros(20 * ppqn));
+    EXPECT_DOUBLE_EQ(10700000.0 + 400000.0, tempoMap.TickToMicros(21 * ppqn));
+}
+
+TEST_F(TempoMapTest, IgnoresInvalidScales)
+{
+    CL::TempoScaleSeqT scales;
+    scales.push_back(CL::TempoScale(0, 2 * ppqn, 0.0));
+    scales.push_back(CL::TempoScale(4 * ppqn, 4 * ppqn, 2.0));
+    TempoMap scaled(tempos_, scales, ppqn);
+    TempoMap unscaled(tempos_, ppqn);
+    EXPECT_EQ(unscaled.GetSegments().size(), scaled.GetSegments().size());
+    EXPECT_DOUBLE_EQ(unscaled.TickToMicros(40 * ppqn), scaled.TickToMicros(40 * ppqn));
+}
+
+TEST_F(TempoMapTest, BatchMatchesSingleConversions)
+{
+    CL::TempoScaleSeqT scales;
+    scales.push_back(CL::TempoScale(3 * ppqn, 9 * ppqn, 1.25));
+    TempoMap tempoMap(tempos_, scales, ppqn);
+
+    std::vector<UInt32> ticks;
+    for (UInt32 tick = 0; tick < 40 * ppqn; tick += 61)
+    {
+        ticks.push_back(tick);
+    }
+
+    // Out of order values are still converted correctly.
+    ticks.push_back(5);
+
+    std::vector<double> micros;
+    tempoMap.TickToMicros(ticks, micros);
+    ASSERT_EQ(ticks.size(), micros.size());
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        EXPECT_DOUBLE_EQ(tempoMap.TickToMicros(ticks[i]), micros[i]);
+    }
+
+    std::vector<double> roundTrip;
+    tempoMap.MicrosToTick(micros, roundTrip);
+    ASSERT_EQ(ticks.size(), roundTrip.size());
+    for (size_t i = 0; i < ticks.size(); i++)
+    {
+        EXPECT_NEAR(ticks[i], roundTrip[i], 1e-6);
+    }
+}
+
+TEST_F(TempoMapTest, SetTempoScalesMatchesFullBuild)
+{
+    CL::TempoScaleSeqT scales;
+    scales.push_back(CL::TempoScale(2 * ppqn, 6 * ppqn, 1.5));
+    TempoMap tempoMap(tempos_, scales, ppqn);
+
+    std::vector<CL::TempoScaleSeqT> edits;
+    scales.push_back(CL::TempoScale(20 * ppqn, 24 * ppqn, 0.8));
+    edits.push_back(scales);
+    scales[1].end(30 * ppqn);
+    edits.push_back(scales);
+    scales[0].float_value(0.9);
+    edits.push_back(scales);
+    scales.erase(scales.begin());
+    edits.push_back(scales);
+    edits.push_back(CL::TempoScaleSeqT());
+
+    for (auto &edit: edits)
+    {
+        tempoMap.SetTempoScales(edit);
+        TempoMap rebuilt(tempos_, edit, ppqn);
+        ASSERT_EQ(rebuilt.GetSegments().size(), tempoMap.GetSegments().size());
+        for (size_t i = 0; i < rebuilt.GetSegments().size(); i++)
+        {
+            EXPECT_EQ(rebuilt.GetSegments()[i].start, tempoMap.GetSegments()[i].start);
+            EXPECT_DOUBLE_EQ(
+                rebuilt.GetSegments()[i].start_micros,
+                tempoMap.GetSegments()[i].start_micros);
+            EXPECT_DOUBLE_EQ(
+                rebuilt.GetSegments()[i].micros_per_tick,
+                tempoMap.GetSegments()[i].micros_per_tick);
+        }
+    }
+}
+
+TEST_F(TempoMapTest, ZeroPPQNThrows)
+{
+    EXPECT_THROW(TempoMap(tempos_, 0), TimelineException);
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include "exlib/xplatform_types.h"
+
+namespace std_midi
+{
+
+/* Builds Standard MIDI Files in memory for the std_midi tests, so the tests
+ * do not depend on MIDI files being present on disk. */
+class TestMIDIFileBuilder
+{
+public:
+    TestMIDIFileBuilder(UInt16 division = 480): division_(division), ntrks_(0) {}
+
+    /* Starts a new MTrk chunk.  Events are appended to it until the next call
+     * to BeginTrack, BeginChunk or Bytes. */
+    void BeginTrack(const std::string &trackName = std::string())
+    {
+        BeginChunk("MTrk");
+        if (!trackName.empty())
+        {
+            Meta(0, 0x03, trackName);
+        }
+    }
+
+    /* Starts a chunk with an arbitrary chunk id. */
+    void BeginChunk(const std::string &chunkId)
+    {
+        chunks_.push_back(std::vector<Byte>(chunkId.begin(), chunkId.end()));
+        ntrks_++;
+    }
+
+    /* Appends raw bytes to the current chunk, after the delta time. */
+    void Event(UInt32 delta, const std::vector<Byte> &bytes)
+    {
+        VarInt(delta);
+        chunks_.back().insert(chunks_.back().end(), bytes.begin(), bytes.end());
+    }
+
+    void Meta(UInt32 delta, Byte status, const std::string &data)
+    {
+        std::vector<Byte> bytes;
+        bytes.push_back(0xFF);
+        bytes.push_back(status);
+        bytes.push_back(static_cast<Byte>(data.size()));
+        bytes.insert(bytes.end(), data.begin(), data.end());
+        Event(delta, bytes);
+    }
+
+    void Tempo(UInt32 delta, UInt32 microseconds)
+    {
+        std::string data;
+        data.push_back(static_cast<char>((microseconds >> 16) & 0xFF));
+        data.push_back(static_cast<char>((microseconds >> 8) & 0xFF));
+        data.push_back(static_cast<char>(microseconds & 0xFF));
+        Meta(delta, 0x51, data);
+    }
+
+    void TimeSignature(UInt32 delta, Byte numerator, Byte denominator)
+    {
+        std::string data;
+        data.push_back(numerator);
+        data.push_back(denominator);
+        data.push_back(24);
+        data.push_back(8);
+        Meta(delta, 0x58, data);
+    }
+
+    void EndOfTrack(UInt32 delta = 0)
+    {
+        Meta(delta, 0x2F, std::string());
+    }
+
+    std::vector<Byte> Bytes() const
+    {
+        std::vector<Byte> out;
+        Append(out, "MThd");
+        Append32(out, 6);
+        Append16(out, 1);
+        Append16(out, ntrks_);
+        Append16(out, division_);
+        for (auto &chunk: chunks_)
+        {
+            out.insert(out.end(), chunk.begin(), chunk.begin() + 4);
+            Append32(out, static_cast<UInt32>(chunk.size() - 4));
+            out.insert(out.end(), chunk.begin() + 4, chunk.end());
+        }
+
+        return out;
+    }
+
+    void WriteFile(const std::string &filename) const
+    {
+        auto bytes = Bytes();
+        std::ofstream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+        ofs.write((const char *)&bytes[0], bytes.size());
+    }
+
+    /* A conductor track, an unrecognized chunk and voiceTracks voice tracks
+     * that use running status, program changes and controllers. */
+    static TestMIDIFileBuilder Orchestra(int voiceTracks = 2)
+    {
+        TestMIDIFileBuilder b;
+        b.BeginTrack("Conductor");
+        b.Tempo(0, 500000);
+        b.TimeSignature(0, 4, 2);
+        b.Meta(0, 0x06, "@b 1");
+        b.Tempo(1920, 400000);
+        b.TimeSignature(0, 3, 2);
+        b.Meta(960, 0x06, "@m 5");
+        b.EndOfTrack(3840);
+
+        b.BeginChunk("XFIH");
+        b.chunks_.back().push_back(0x01);
+        b.chunks_.back().push_back(0x02);
+
+        for (int t = 0; t < voiceTracks; t++)
+        {
+            b.BeginTrack("Voice " + std::to_string(t + 1));
+            Byte ch = static_cast<Byte>(t & 0x0F);
+            b.Event(0, {Byte(0xC0 | ch), Byte(t)});
+            b.Event(0, {Byte(0xB0 | ch), 7, 100});
+            for (int n = 0; n < 16; n++)
+            {
+                Byte note = static_cast<Byte>(48 + t + n);
+                b.Event(n ? 120 : 0, {Byte(0x90 | ch), note, 90});
+                // running status note off
+                b.Event(240, {note, 0});
+            }
+
+            b.Event(10, {Byte(0xE0 | ch), 0, 64});
+            b.Event(0, {Byte(0xA0 | ch), 60, 30});
+            b.EndOfTrack(100);
+        }
+
+        return b;
+    }
+
+private:
+    void VarInt(UInt32 value)
+    {
+        Byte buffer[4];
+        int count = 0;
+        do
+        {
+            buffer[count++] = value & 0x7F;
+            value >>= 7;
+        } while (value);
+
+        while (count--)
+        {
+            chunks_.back().push_back(buffer[count] | (count ? 0x80 : 0));
+        }
+    }
+
+    static void Append(std::vector<Byte> &out, const std::string &s)
+    {
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    static void Append16(std::vector<Byte> &out, UInt16 v)
+    {
+        out.push_back(v >> 8);
+        out.push_back(v & 0xFF);
+    }
+
+    static void Append32(std::vector<Byte> &out, UInt32 v)
+    {
+        out.push_back(v >> 24);
+        out.push_back((v >> 16) & 0xFF);
+        out.push_back((v >> 8) & 0xFF);
+        out.push_back(v & 0xFF);
+    }
+
+    UInt16 division_;
+    UInt16 ntrks_;
+    std::vector<std::vector<Byte>> chunks_;
+};
+
+} // End namespace std_midi
@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+#include "core/test/test_midi_file.h"
+#include "core/test/allocation_counter.h"
+#include "core/timeline/timeline.h"
+#include "core/timeline/timeline_cursor.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace TL;
+
+/* Four bars of 4/4 and then 3/4, a key change, three pages and CustomBars
+ * that rename bars 2 and 3. */
+static std::vector<Byte> QueryMIDIBytes()
+{
+    std_midi::TestMIDIFileBuilder b;
+    b.BeginTrack("Conductor");
+    b.Tempo(0, 500000);
+    b.TimeSignature(0, 4, 2);
+    b.Meta(0, 0x59, std::string(2, '\0'));
+    b.Meta(2 * 1920, 0x06, "@b 5A");
+    b.Meta(1920, 0x06, "@b 6");
+    b.Meta(0, 0x59, std::string(1, '\x02') + std::string(1, '\0'));
+    b.TimeSignature(1920, 3, 2);
+    b.Tempo(1440, 400000);
+    b.EndOfTrack(8 * 1440);
+
+    b.BeginTrack("PDF");
+    b.Event(960, {0xB0, 20, 1});
+    b.Event(3840, {0xB0, 20, 2});
+    b.Event(3840, {0xB0, 20, 3});
+    b.EndOfTrack(0);
+    return b.Bytes();
+}
+
+class TimelineQueryTest
+    :
+    public ::testing::Test
+{
+public:
+    TimelineQueryTest()
+        :
+        bytes_(QueryMIDIBytes()),
+        timeline_(std_midi::MIDIFile(&bytes_[0], bytes_.size(), "timeline_query_tests.mid"))
+    {}
+
+protected:
+    /* The last event at or before tick, found the slow way. */
+    template <class SeqT>
+    static const typename SeqT::value_type* Scan(const SeqT &seq, UInt32 tick)
+    {
+        const typename SeqT::value_type *result = nullptr;
+        for (auto &it: seq)
+        {
+            if (it.abs_time() <= tick) result = &it;
+        }
+
+        return result;
+    }
+
+    std::vector<Byte> bytes_;
+    Timeline timeline_;
+};
+
+TEST_F(TimelineQueryTest, AtMatchesScan)
+{
+    ASSERT_EQ(2u, timeline_.GetKeys().size());
+    ASSERT_EQ(3u, timeline_.GetPageNums().size());
+    for (UInt32 tick = 0; tick < 20000; tick += 40)
+    {
+        EXPECT_EQ(Scan(timeline_.GetTempos(), tick), timeline_.TempoAt(tick));
+        EXPECT_EQ(Scan(timeline_.GetKeys(), tick), timeline_.KeyAt(tick));
+        EXPECT_EQ(Scan(timeline_.GetMeters(), tick), timeline_.MeterAt(tick));
+        EXPECT_EQ(Scan(timeline_.GetPageNums(), tick), timeline_.PageNumAt(tick));
+
+        const BarsBeats *barsBeats = Scan(timeline_.GetBarsBeats(), tick);
+        ASSERT_TRUE(barsBeats != nullptr);
+        EXPECT_EQ(barsBeats->bar_number(), timeline_.BarLabelAt(tick).c_str());
+        EXPECT_EQ(barsBeats->abs_time(), timeline_.BarBeatAt(tick).abs_time);
+    }
+
+    EXPECT_TRUE(timeline_.PageNumAt(959) == nullptr);
+}
+
+TEST_F(TimelineQueryTest, BarLabels)
+{
+    BarLabel label = timeline_.BarLabelAt(2 * 1920);
+    EXPECT_STREQ("5A", label.c_str());
+    EXPECT_FALSE(label.is_int);
+
+    label = timeline_.BarLabelAt(4 * 1920 + 1440 + 1);
+    EXPECT_STREQ("8", label.c_str());
+    EXPECT_TRUE(label.is_int);
+    EXPECT_EQ(8, label.number);
+}
+
+TEST_F(TimelineQueryTest, CursorMatchesAt)
+{
+    TimelineCursor cursor(timeline_);
+    std::vector<UInt32> ticks;
+    for (UInt32 tick = 0; tick < 20000; tick += 37) ticks.push_back(tick);
+    ticks.push_back(5000);
+    ticks.push_back(5000);
+    ticks.push_back(100);
+    ticks.push_back(19000);
+
+    for (UInt32 tick: ticks)
+    {
+        cursor.Advance(tick);
+        EXPECT_EQ(tick, cursor.GetTick());
+        EXPECT_EQ(timeline_.TempoAt(tick), cursor.GetTempo());
+        EXPECT_EQ(timeline_.KeyAt(tick), cursor.GetKey());
+        EXPECT_EQ(timeline_.MeterAt(tick), cursor.GetMeter());
+        EXPECT_EQ(timeline_.PageNumAt(tick), cursor.GetPageNum());
+        EXPECT_EQ(timeline_.BarBeatAt(tick).abs_time, cursor.GetBarBeat().abs_time);
+        EXPECT_STREQ(timeline_.BarLabelAt(tick).c_str(), cursor.GetBarLabel().c_str());
+    }
+}
+
+TEST_F(TimelineQueryTest, QueriesDoNotAllocate)
+{
+    TimelineCursor cursor(timeline_);
+    size_t labels = 0;
+    AllocationCounter counter;
+    for (UInt32 tick = 0; tick < 20000; tick += 10)
+    {
+        cursor.Advance(tick);
+        labels += strlen(cursor.GetBarLabel().c_str());
+        labels += strlen(timeline_.BarLabelAt(tick).c_str());
+        labels += timeline_.PageNumAt(tick) ? 1 : 0;
+        labels += timeline_.KeyAt(tick) ? 1 : 0;
+    }
+
+    cursor.Seek(0);
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_LT(0u, labels);
+}
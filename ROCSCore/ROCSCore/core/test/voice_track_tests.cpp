@@ -0,0 +1,883 @@
+#include "gtest/gtest.h"
+#include "core/test/allocation_counter.h"
+#include "core/rocs_midi/voice_track.h"
+#include "core/rocs_midi/transposed_track_cache.h"
+#include "core/rocs_midi/voice_event_columns.h"
+#include "core/rocs_midi/compact_voice_events.h"
+#include "core/rocs_midi/voice_data.h"
+#include "core/rocs_midi/show_data_version.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace rocs_midi;
+
+class VoiceTrackTest
+    :
+    public ::testing::Test
+{
+public:
+    VoiceTrackTest()
+        :
+        track_(0x10, "Voice")
+    {
+        track_.SetRange(std::make_pair(48, 72));
+        auto &events = track_.GetEvents();
+        for (UInt32 i = 0; i < 200; i++)
+        {
+            // Pairs of events share a time, and some notes are outside the
+            // range.
+            UInt8 note = static_cast<UInt8>(40 + (i * 7) % 40);
+            events.push_back(VoiceEvent((i / 2) * 60, 0x90, note, 100));
+        }
+
+        events.push_back(VoiceEvent(6000, 0xB0, 7, 90));
+    }
+
+protected:
+    /* What EventSlice has always returned: a copy of the events from start
+     * to end, transposed afterward. */
+    VoiceEvtVecT Expected(SInt64 start, SInt64 end, SInt8 transpose) const
+    {
+        VoiceEvtVecT expected;
+        for (auto &it: track_.GetEvents())
+        {
+            if (start >= 0 && it.GetAbsTime() < start) continue;
+            if (end >= 0 && it.GetAbsTime() > end) continue;
+            expected.push_back(it);
+            if (transpose) transpose_voice_event(expected.back(), transpose, track_.GetRange());
+        }
+
+        return expected;
+    }
+
+    VoiceTrack track_;
+};
+
+TEST_F(VoiceTrackTest, SliceMatchesCopy)
+{
+    SInt64 bounds[] = {-1, 0, 59, 60, 61, 3000, 5999, 6000, 7000};
+    for (SInt64 start: bounds)
+    {
+        for (SInt64 end: bounds)
+        {
+            if (start >= 0 && end >= 0 && end < start) continue;
+            for (SInt8 transpose = -6; transpose <= 6; transpose++)
+            {
+                VoiceEvtVecT expected = Expected(start, end, transpose);
+                VoiceEventSlice slice = track_.Slice(start, end, transpose);
+                ASSERT_EQ(expected.size(), slice.size());
+                size_t i = 0;
+                for (auto voiceEvent: slice)
+                {
+                    EXPECT_EQ(expected[i], voiceEvent);
+                    EXPECT_EQ(expected[i], slice[i]);
+                    i++;
+                }
+
+                EXPECT_EQ(expected, track_.EventSlice(start, end, transpose));
+            }
+        }
+    }
+}
+
+TEST_F(VoiceTrackTest, SliceDoesNotAllocate)
+{
+    VoiceEvtVecT buffer;
+    track_.EventSlice(buffer, -1, -1, 3);
+
+    size_t notes = 0;
+    VoiceEvent fixed[16];
+    AllocationCounter counter;
+    for (SInt64 start = 0; start < 6000; start += 120)
+    {
+        VoiceEventSlice slice = track_.Slice(start, start + 119, -2);
+        for (auto voiceEvent: slice)
+        {
+            notes += voiceEvent.GetData1();
+        }
+
+        track_.EventSlice(buffer, start, start + 119, 5);
+        notes += slice.CopyTo(fixed, 16);
+    }
+
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_LT(0u, notes);
+}
+
+TEST_F(VoiceTrackTest, SliceTransposeLimits)
+{
+    EXPECT_THROW(track_.Slice(-1, -1, 7), std::range_error);
+    EXPECT_THROW(track_.EventSlice(-1, -1, -7), std::range_error);
+
+    // A track without a range is never transposed.
+    VoiceTrack unranged(0x11, "Unranged");
+    unranged.GetEvents() = track_.GetEvents();
+    VoiceEventSlice slice = unranged.Slice(-1, -1, 7);
+    EXPECT_EQ(0, slice.GetTranspose());
+    EXPECT_EQ(unranged.GetEvents(), unranged.EventSlice(-1, -1, 3));
+}
+
+/* Events of every kind, with notes around both ends of the byte range. */
+static VoiceEvtVecT RandomEvents(size_t count, UInt32 seed)
+{
+    static const Byte statuses[] = {0x80, 0x90, 0xA0, 0xB0, 0xC0, 0xD0, 0xE0};
+    VoiceEvtVecT events;
+    for (size_t i = 0; i < count; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        Byte status = statuses[(seed >> 8) % 7] | ((seed >> 4) & 0x0F);
+        UInt8 data1 = static_cast<UInt8>(seed >> 16);
+        UInt8 data2 = static_cast<UInt8>(seed >> 24);
+        // Notes above 127 are not MIDI, but the arithmetic must still agree.
+        events.push_back(VoiceEvent(static_cast<UInt32>(i * 10), status, 0, 0));
+        events.back().SetData1(data1);
+        events.back().SetData2(data2);
+    }
+
+    return events;
+}
+
+TEST(TransposeVoiceEvents, MatchesScalar)
+{
+    VoiceRangeT ranges[] = {
+        std::make_pair(48, 72),
+        std::make_pair(0, 127),
+        std::make_pair(0, 8),
+        std::make_pair(3, 15),
+        std::make_pair(240, 255),
+        std::make_pair(60, 60),
+        std::make_pair(72, 48)
+    };
+
+    for (size_t count = 0; count < 40; count++)
+    {
+        VoiceEvtVecT events = RandomEvents(count * 7 + count % 5, static_cast<UInt32>(count));
+        if (events.empty()) continue;
+        for (auto &range: ranges)
+        {
+            for (SInt8 transpose = -6; transpose <= 6; transpose++)
+            {
+                VoiceEvtVecT expected(events.size());
+                VoiceEvtVecT actual(events.size());
+                transpose_voice_events_scalar(&events[0], &expected[0], events.size(), transpose, range);
+                transpose_voice_events(&events[0], &actual[0], events.size(), transpose, range);
+                ASSERT_EQ(0, memcmp(&expected[0], &actual[0], events.size() * sizeof(VoiceEvent)));
+
+                VoiceEvtVecT inPlace(events);
+                transpose_voice_events(&inPlace[0], &inPlace[0], inPlace.size(), transpose, range);
+                ASSERT_EQ(0, memcmp(&expected[0], &inPlace[0], events.size() * sizeof(VoiceEvent)));
+            }
+        }
+    }
+}
+
+/* The functor EventSlice transposed with before transpose_voice_events,
+ * which moved data1 of every message within the range. */
+static void PreviousTranspose(VoiceEvent &voiceEvent, SInt8 transpose, const VoiceRangeT &range)
+{
+    if ((range.first <= voiceEvent.GetData1()) && (voiceEvent.GetData1() <= range.second))
+    {
+        voiceEvent.GetVoiceMessage().data1_ += transpose;
+        if (voiceEvent.GetData1() < range.first)
+        {
+            voiceEvent.GetVoiceMessage().data1_ += 12;
+        } else if (voiceEvent.GetData1() > range.second)
+        {
+            voiceEvent.GetVoiceMessage().data1_ -= 12;
+        }
+    }
+}
+
+TEST(TransposeVoiceEvents, MatchesPreviousFunctor)
+{
+    // Every voice status type, on two channels, with every data1.
+    VoiceEvtVecT events;
+    for (UInt8 status = 0x80; status < 0xF0; status += 0x10)
+    {
+        for (UInt8 data1 = 0; data1 < 128; data1++)
+        {
+            events.push_back(VoiceEvent(data1, status | (data1 & 1), data1, 64));
+        }
+    }
+
+    VoiceRangeT ranges[] = {
+        std::make_pair(48, 72),
+        std::make_pair(0, 127),
+        std::make_pair(0, 8),
+        std::make_pair(120, 127)
+    };
+
+    for (auto &range: ranges)
+    {
+        for (SInt8 transpose = -6; transpose <= 6; transpose++)
+        {
+            VoiceEvtVecT actual(events.size());
+            transpose_voice_events(&events[0], &actual[0], events.size(), transpose, range);
+            for (size_t i = 0; i < events.size(); i++)
+            {
+                VoiceEvent expected(events[i]);
+                Byte statusType = expected.GetStatusType();
+                if (statusType == 0x80 || statusType == 0x90 || statusType == 0xA0)
+                {
+                    PreviousTranspose(expected, transpose, range);
+                }
+
+                // Controllers, program changes, channel pressure and pitch
+                // bend keep their data1.
+                ASSERT_EQ(expected.GetData1(), actual[i].GetData1())
+                    << "status " << int(expected.GetStatus()) << ", transpose " << int(transpose);
+                ASSERT_EQ(0, memcmp(&expected, &actual[i], sizeof(VoiceEvent)));
+            }
+        }
+    }
+}
+
+TEST(TransposeVoiceEvents, OnlyNotesAndAftertouch)
+{
+    VoiceEvtVecT events;
+    events.push_back(VoiceEvent(0, 0x91, 60, 100));
+    events.push_back(VoiceEvent(0, 0x81, 60, 0));
+    events.push_back(VoiceEvent(0, 0xA1, 60, 30));
+    events.push_back(VoiceEvent(0, 0xB1, 60, 30));
+    events.push_back(VoiceEvent(0, 0xC1, 60, 0));
+    events.push_back(VoiceEvent(0, 0xE1, 60, 64));
+    events.push_back(VoiceEvent(0, 0x91, 71, 100));
+
+    transpose_voice_events(&events[0], &events[0], events.size(), 2, std::make_pair(48, 72));
+    EXPECT_EQ(62, events[0].GetData1());
+    EXPECT_EQ(62, events[1].GetData1());
+    EXPECT_EQ(62, events[2].GetData1());
+    EXPECT_EQ(60, events[3].GetData1());
+    EXPECT_EQ(60, events[4].GetData1());
+    EXPECT_EQ(60, events[5].GetData1());
+    EXPECT_EQ(61, events[6].GetData1());
+    EXPECT_EQ(0x91, events[0].GetStatus());
+    EXPECT_EQ(100, events[0].GetData2());
+}
+
+TEST_F(VoiceTrackTest, CacheMatchesSlice)
+{
+    TransposedTrackCache cache;
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (SInt8 transpose = -6; transpose <= 6; transpose++)
+        {
+            EXPECT_EQ(track_.EventSlice(-1, -1, transpose), cache.Get(track_, transpose));
+            VoiceEventSlice slice = cache.Slice(track_, 60, 3000, transpose);
+            EXPECT_EQ(0, slice.GetTranspose());
+            EXPECT_EQ(track_.EventSlice(60, 3000, transpose), VoiceEvtVecT(slice.begin(), slice.end()));
+        }
+    }
+
+    EXPECT_EQ(12u, cache.size());
+    EXPECT_THROW(cache.Get(track_, 7), std::range_error);
+}
+
+TEST_F(VoiceTrackTest, CacheSeesChanges)
+{
+    TransposedTrackCache cache;
+    cache.Get(track_, 3);
+    EXPECT_TRUE(cache.Contains(track_, 3));
+
+    track_.SetRangeHigh(60);
+    EXPECT_FALSE(cache.Contains(track_, 3));
+    EXPECT_EQ(track_.EventSlice(-1, -1, 3), cache.Get(track_, 3));
+
+    track_.GetEvents().push_back(VoiceEvent(7000, 0x90, 50, 100));
+    EXPECT_EQ(track_.EventSlice(-1, -1, 3), cache.Get(track_, 3));
+    EXPECT_EQ(1u, cache.size());
+
+    // SetTrackId moves every event to the new channel.
+    track_.SetTrackId(0x15);
+    EXPECT_FALSE(cache.Contains(track_, 3));
+    EXPECT_EQ(track_.EventSlice(-1, -1, 3), cache.Get(track_, 3));
+    EXPECT_EQ(5, cache.Get(track_, 3)[0].GetChannel());
+
+    cache.Invalidate(track_);
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_EQ(0u, cache.GetBytes());
+}
+
+TEST_F(VoiceTrackTest, CacheEvictsLeastRecentlyUsed)
+{
+    TransposedTrackCache cache;
+    cache.Get(track_, 1);
+    size_t rendering = cache.GetBytes();
+    cache.SetBudget(2 * rendering);
+
+    cache.Get(track_, 2);
+    cache.Get(track_, 1);
+    cache.Get(track_, 3);
+    EXPECT_TRUE(cache.Contains(track_, 1));
+    EXPECT_FALSE(cache.Contains(track_, 2));
+    EXPECT_TRUE(cache.Contains(track_, 3));
+    EXPECT_EQ(2 * rendering, cache.GetBytes());
+
+    // The rendering in use is kept even when it alone is over budget.
+    cache.SetBudget(1);
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_TRUE(cache.Contains(track_, 3));
+}
+
+TEST_F(VoiceTrackTest, CacheSwitchDoesNotAllocate)
+{
+    VoiceData voiceData;
+    voiceData.AddTrack(VoiceTrackPtrT(new VoiceTrack(track_)));
+    const VoiceTrack &track = voiceData.GetTrack(track_.GetTrackId());
+
+    TransposedTrackCache cache;
+    cache.Prepare(voiceData, -2);
+    cache.Prepare(voiceData, 5);
+    EXPECT_EQ(2u, cache.size());
+
+    size_t notes = 0;
+    AllocationCounter counter;
+    for (SInt64 start = 0; start < 6000; start += 120)
+    {
+        VoiceEventSlice slice = cache.Slice(track, start, start + 119, (start / 120) % 2 ? -2 : 5);
+        for (auto voiceEvent: slice)
+        {
+            notes += voiceEvent.GetData1();
+        }
+    }
+
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_LT(0u, notes);
+}
+
+TEST_F(VoiceTrackTest, ColumnsMatchEvents)
+{
+    track_.GetEvents().push_back(VoiceEvent(6000, 0x83, 60, 0));
+    track_.GetEvents().push_back(VoiceEvent(6100, 0xE3, 5, 64));
+    VoiceEventSpan events = static_cast<const VoiceTrack&>(track_).GetEvents();
+    VoiceEventColumns columns(track_);
+    ASSERT_EQ(events.size(), columns.size());
+    EXPECT_TRUE(columns.IsCurrent(track_));
+
+    VoiceEvtVecT copy;
+    columns.CopyTo(copy);
+    EXPECT_EQ(events, copy);
+
+    for (UInt32 tick = 0; tick < 6200; tick += 30)
+    {
+        VoiceEventSlice slice = track_.Slice(tick, tick);
+        EXPECT_EQ(slice.raw_begin() - events.data(), columns.LowerBound(tick));
+        EXPECT_EQ(slice.raw_end() - events.data(), columns.UpperBound(tick));
+    }
+
+    EXPECT_EQ(200u, columns.CountStatusType(0x90));
+    EXPECT_EQ(1u, columns.CountStatusType(0xB0));
+    EXPECT_EQ(1u, columns.CountStatusType(0x80, columns.LowerBound(6000), columns.size()));
+
+    std::vector<UInt32> indices;
+    columns.FilterChannel(3, indices);
+    ASSERT_EQ(2u, indices.size());
+    EXPECT_EQ(events.size() - 2, indices[0]);
+    EXPECT_EQ(events[indices[1]], columns[indices[1]]);
+
+    track_.SetRangeLow(40);
+    EXPECT_FALSE(columns.IsCurrent(track_));
+}
+
+TEST(VoiceEventColumns, Empty)
+{
+    VoiceEventColumns columns((VoiceEvtVecT()));
+    EXPECT_TRUE(columns.empty());
+    EXPECT_EQ(0u, columns.LowerBound(10));
+    EXPECT_EQ(0u, columns.UpperBound(10));
+    EXPECT_EQ(0u, columns.CountStatusType(0x90));
+
+    std::vector<UInt32> indices(3);
+    columns.FilterChannel(0, indices);
+    EXPECT_TRUE(indices.empty());
+}
+
+TEST(VoiceEventColumns, CountMatchesScan)
+{
+    VoiceEvtVecT events = RandomEvents(10000, 3);
+    VoiceEventColumns columns(events);
+    size_t bounds[] = {0, 1, 15, 16, 17, 4080, 4097, 9999, 10000};
+    for (size_t first: bounds)
+    {
+        for (size_t last: bounds)
+        {
+            if (last < first) continue;
+            size_t expected = 0;
+            for (size_t i = first; i < last; i++)
+            {
+                expected += events[i].GetStatusType() == 0x90;
+            }
+
+            EXPECT_EQ(expected, columns.CountStatusType(0x90, first, last));
+        }
+    }
+}
+
+TEST_F(VoiceTrackTest, TimeIndexMatchesSearch)
+{
+    VoiceTrack plain(track_);
+    SInt64 bounds[] = {-1, 0, 1, 59, 60, 61, 119, 120, 3000, 5940, 5999, 6000, 6001, 7000, 5000000000LL};
+    UInt32 buckets[] = {1, 7, 60, 64, 1000, 100000};
+    for (UInt32 bucketTicks: buckets)
+    {
+        track_.BuildTimeIndex(bucketTicks);
+        ASSERT_TRUE(track_.HasTimeIndex());
+        for (SInt64 start: bounds)
+        {
+            for (SInt64 end: bounds)
+            {
+                VoiceEventSlice expected = plain.Slice(start, end);
+                VoiceEventSlice actual = track_.Slice(start, end);
+                EXPECT_EQ(expected.raw_begin() - plain.GetEvents().data(),
+                          actual.raw_begin() - static_cast<const VoiceTrack&>(track_).GetEvents().data())
+                    << bucketTicks << " " << start << " " << end;
+                EXPECT_EQ(expected.size(), actual.size()) << bucketTicks << " " << start << " " << end;
+            }
+        }
+    }
+
+    EXPECT_LT(0u, track_.GetTimeIndexBytes());
+    track_.BuildTimeIndex(0);
+    EXPECT_FALSE(track_.HasTimeIndex());
+    EXPECT_EQ(0u, track_.GetTimeIndexBytes());
+}
+
+TEST_F(VoiceTrackTest, TimeIndexFollowsChanges)
+{
+    track_.BuildTimeIndex(100);
+    track_.GetEvents().push_back(VoiceEvent(9000, 0x90, 60, 100));
+    EXPECT_FALSE(track_.HasTimeIndex());
+    EXPECT_EQ(1u, track_.Slice(8000, 9500).size());
+
+    track_.UpdateTimeIndex();
+    EXPECT_TRUE(track_.HasTimeIndex());
+    EXPECT_EQ(1u, track_.Slice(8000, 9500).size());
+    EXPECT_EQ(100u, track_.GetTimeIndexTicks());
+}
+
+TEST_F(VoiceTrackTest, TimeIndexSerialization)
+{
+    track_.SetGroupId(0);
+    track_.BuildTimeIndex(240);
+
+    std::stringstream latest;
+    track_.WriteBinary(latest, LatestFileVersion);
+    VoiceTrack readLatest(latest, LatestFileVersion);
+    EXPECT_TRUE(readLatest.HasTimeIndex());
+    EXPECT_EQ(240u, readLatest.GetTimeIndexTicks());
+    EXPECT_EQ(track_, readLatest);
+    EXPECT_EQ(track_.EventSlice(100, 2000), readLatest.EventSlice(100, 2000));
+
+    std::stringstream older;
+    track_.WriteBinary(older, cmn::FileVersion(2, 1));
+    VoiceTrack readOlder(older, cmn::FileVersion(2, 1));
+    EXPECT_FALSE(readOlder.HasTimeIndex());
+    EXPECT_EQ(track_, readOlder);
+
+    // 2.2 adds only the index to 2.1.
+    std::stringstream indexed;
+    track_.WriteBinary(indexed, cmn::FileVersion(2, 2));
+    EXPECT_EQ(indexed.str().size(), older.str().size() + 8 + track_.GetTimeIndexBytes());
+
+    VoiceData voiceData;
+    voiceData.AddTrack(VoiceTrackPtrT(new VoiceTrack(track_)));
+    voiceData.AddTrack(VoiceTrackPtrT(new VoiceTrack(0x11, "Other")));
+    voiceData.BuildTimeIndexes(480);
+    EXPECT_EQ(voiceData.GetTrack(0x10).GetTimeIndexBytes() + sizeof(UInt32), voiceData.GetTimeIndexBytes());
+}
+
+TEST_F(VoiceTrackTest, CorruptSizesDoNotAllocate)
+{
+    // An index of one tick buckets for a track this long would take 16 GB.
+    track_.GetEvents().push_back(VoiceEvent(0xFFFFFF00, 0x80, 60, 0));
+    track_.BuildTimeIndex(1 << 20);
+    std::string bytes;
+    {
+        std::stringstream ss;
+        track_.WriteBinary(ss, LatestFileVersion);
+        bytes = ss.str();
+    }
+
+    size_t ticksAt = bytes.size() - 8 - track_.GetTimeIndexBytes();
+    UInt32 ticks = 1;
+    UInt32 indexSize = 0xFFFFFF02;
+    memcpy(&bytes[ticksAt], &ticks, sizeof(ticks));
+    memcpy(&bytes[ticksAt + 4], &indexSize, sizeof(indexSize));
+    std::stringstream corruptIndex(bytes);
+    EXPECT_THROW(VoiceTrack(corruptIndex, LatestFileVersion), VoiceTrackException);
+    ex::BinaryReader indexReader(bytes.data(), bytes.size());
+    EXPECT_THROW(VoiceTrack(indexReader, LatestFileVersion), VoiceTrackException);
+
+    // The event count follows the header, the name and its length.
+    size_t countAt = 4 + 2 + 3 + 1 + track_.GetTrackName().size();
+    UInt32 trackSize = 0x7FFFFFFF;
+    memcpy(&bytes[countAt], &trackSize, sizeof(trackSize));
+    std::stringstream corruptCount(bytes);
+    EXPECT_THROW(VoiceTrack(corruptCount, LatestFileVersion), VoiceTrackException);
+}
+
+/* A controller ramp of short deltas, with a sustain pedal going down and up
+ * and notes in between, as the compact encoding's fast path expects. */
+static VoiceEvtVecT DenseEvents(size_t count)
+{
+    VoiceEvtVecT events;
+    UInt32 time = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        time += 5 + i % 3;
+        if (i % 50 == 0)
+        {
+            events.push_back(VoiceEvent(time, 0xB0, 64, (i / 50) % 2 ? 0 : 127));
+        } else if (i % 17 == 0)
+        {
+            events.push_back(VoiceEvent(time, 0x90, 60 + i % 12, 100));
+        } else
+        {
+            events.push_back(VoiceEvent(time, 0xB0, 11, static_cast<UInt8>(i % 128)));
+        }
+    }
+
+    return events;
+}
+
+TEST(CompactVoiceEvents, MatchesScalar)
+{
+    for (size_t count = 0; count < 300; count += 7)
+    {
+        // Deltas of up to 4 bytes.
+        VoiceEvtVecT spaced;
+        for (size_t i = 0; i < count; i++)
+        {
+            spaced.push_back(VoiceEvent(
+                static_cast<UInt32>(i * i * i * 97),
+                i % 3 ? 0xB0 : 0x90,
+                static_cast<UInt8>(i % 100),
+                64));
+        }
+
+        VoiceEvtVecT sources[] = {
+            RandomEvents(count, static_cast<UInt32>(count)),
+            DenseEvents(count),
+            VoiceEvtVecT(count, VoiceEvent(0, 0xE3, 0x7F, 0x7F)),
+            spaced
+        };
+
+        for (auto &events: sources)
+        {
+            std::vector<char> encoded;
+            ASSERT_TRUE(encode_voice_events(events.data(), events.size(), encoded));
+            VoiceEvtVecT scalar(events.size());
+            VoiceEvtVecT decoded(events.size());
+            ASSERT_TRUE(decode_voice_events_scalar(encoded.data(), encoded.size(), scalar.data(), count));
+            ASSERT_TRUE(decode_voice_events(encoded.data(), encoded.size(), decoded.data(), count));
+            EXPECT_EQ(events, scalar);
+            EXPECT_EQ(events, decoded);
+
+            // Too few bytes, or too many.
+            if (count)
+            {
+                EXPECT_FALSE(decode_voice_events(encoded.data(), encoded.size() - 1, decoded.data(), count));
+            }
+
+            // Damaged bytes are caught, or decoded, just as the portable
+            // loop does.
+            for (size_t at = 0; at < encoded.size(); at += 5)
+            {
+                for (Byte damage: {0x00, 0x7F, 0x80, 0xC5, 0xF0, 0xFF})
+                {
+                    std::vector<char> damaged = encoded;
+                    damaged[at] = static_cast<char>(damage);
+                    bool scalarDecoded = decode_voice_events_scalar(
+                        damaged.data(), damaged.size(), scalar.data(), count);
+                    ASSERT_EQ(
+                        scalarDecoded,
+                        decode_voice_events(damaged.data(), damaged.size(), decoded.data(), count))
+                        << at;
+                    if (scalarDecoded) EXPECT_EQ(scalar, decoded) << at;
+                }
+            }
+
+            encoded.push_back(0);
+            EXPECT_FALSE(decode_voice_events(encoded.data(), encoded.size(), decoded.data(), count));
+        }
+    }
+
+    // Dense controller data takes about 3 bytes an event.
+    VoiceEvtVecT dense = DenseEvents(10000);
+    std::vector<char> encoded;
+    ASSERT_TRUE(encode_voice_events(dense.data(), dense.size(), encoded));
+    EXPECT_LT(encoded.size(), dense.size() * 3);
+
+    // Events out of order are not encoded.
+    std::swap(dense[10], dense[20]);
+    encoded.clear();
+    EXPECT_FALSE(encode_voice_events(dense.data(), dense.size(), encoded));
+    EXPECT_TRUE(encoded.empty());
+}
+
+TEST_F(VoiceTrackTest, CompactEncoding)
+{
+    track_.GetEvents() = DenseEvents(1000);
+    track_.BuildTimeIndex(240);
+
+    // Raw unless asked for, so that the latest version stays mappable.
+    EXPECT_EQ(raw_events, track_.GetEncoding());
+    std::stringstream raw;
+    track_.WriteBinary(raw, LatestFileVersion);
+    EXPECT_EQ(raw_events, VoiceTrack(raw, LatestFileVersion).GetEncoding());
+    raw.seekg(0);
+    track_.SetEncoding(compact_events);
+    std::stringstream compact;
+    track_.WriteBinary(compact, LatestFileVersion);
+    EXPECT_LT(compact.str().size() * 2, raw.str().size());
+
+    VoiceTrack fromStream(compact, LatestFileVersion);
+    EXPECT_EQ(track_, fromStream);
+    EXPECT_EQ(compact_events, fromStream.GetEncoding());
+    EXPECT_TRUE(fromStream.HasTimeIndex());
+
+    std::string bytes = compact.str();
+    ex::BinaryReader reader(bytes.data(), bytes.size());
+    VoiceTrack fromReader(reader, LatestFileVersion);
+    EXPECT_EQ(track_, fromReader);
+    EXPECT_EQ(0u, reader.GetAvailable());
+
+    // Older versions, and events out of order, are written raw.
+    std::stringstream older;
+    track_.WriteBinary(older, cmn::FileVersion(2, 4));
+    VoiceTrack readOlder(older, cmn::FileVersion(2, 4));
+    EXPECT_EQ(track_, readOlder);
+    EXPECT_EQ(raw_events, readOlder.GetEncoding());
+
+    std::swap(track_.GetEvents()[0], track_.GetEvents()[1]);
+    std::stringstream unordered;
+    track_.WriteBinary(unordered, LatestFileVersion);
+    VoiceTrack readUnordered(unordered, LatestFileVersion);
+    EXPECT_EQ(track_, readUnordered);
+    EXPECT_EQ(raw_events, readUnordered.GetEncoding());
+
+    // A damaged event count.
+    size_t at = bytes.find("Voice") + 5;
+    bytes[at] ^= 1;
+    ex::BinaryReader damaged(bytes.data(), bytes.size());
+    EXPECT_THROW(VoiceTrack(damaged, LatestFileVersion), VoiceTrackException);
+}
+
+/* Tracks 0 to 39 in groups Strings, Brass and Winds by track id % 3, except
+ * every fourth track, which has no group. */
+static void MakeGroupedTracks(VoiceData &voiceData)
+{
+    const char *names[] = { "Strings", "Brass", "Winds" };
+    for (UInt16 trackId = 0; trackId < 40; trackId++)
+    {
+        std::string trackName("Voice");
+        if (trackId % 4) trackName += std::string(" @g ") + names[trackId % 3];
+        VoiceTrackPtrT track(new VoiceTrack(trackId, trackName));
+        voiceData.GetGroups().AddTrack(track);
+        voiceData.AddTrack(track);
+    }
+}
+
+static void ExpectViewMatchesGroup(const VoiceData &voiceData, UInt8 groupId)
+{
+    const std::set<UInt16> &group = voiceData.GetGroups().GetGroup(groupId);
+    GroupView view = voiceData.GetGroupView(groupId);
+    ASSERT_EQ(group.size(), view.size());
+    size_t i = 0;
+    for (auto trackId: group)
+    {
+        EXPECT_EQ(&voiceData.GetTrack(trackId), &view[i++]);
+    }
+}
+
+TEST(GroupView, MatchesGroup)
+{
+    VoiceData voiceData;
+    MakeGroupedTracks(voiceData);
+    const Groups &groups = voiceData.GetGroups();
+    for (UInt8 groupId = 1; groupId <= 3; groupId++)
+    {
+        ExpectViewMatchesGroup(voiceData, groupId);
+        for (UInt16 trackId = 0; trackId < 80; trackId++)
+        {
+            EXPECT_EQ(groups.GetGroup(groupId).count(trackId) != 0, groups.IsMember(groupId, trackId));
+        }
+    }
+
+    EXPECT_TRUE(voiceData.GetGroupView(0).empty());
+    EXPECT_TRUE(voiceData.GetGroupView(200).empty());
+    EXPECT_FALSE(groups.IsMember(200, 1));
+}
+
+TEST(GroupView, FollowsChanges)
+{
+    VoiceData voiceData;
+    MakeGroupedTracks(voiceData);
+    UInt8 strings = voiceData.GetGroups().GetGroupId("Strings");
+    size_t size = voiceData.GetGroupView(strings).size();
+
+    VoiceTrackPtrT track(new VoiceTrack(300, "Voice @g Strings"));
+    voiceData.GetGroups().AddTrack(track);
+    voiceData.AddTrack(track);
+    EXPECT_TRUE(voiceData.GetGroups().IsMember(strings, 300));
+    EXPECT_EQ(size + 1, voiceData.GetGroupView(strings).size());
+    ExpectViewMatchesGroup(voiceData, strings);
+
+    // A track the groups name but the tracks do not have is left out.
+    voiceData.GetTracks().erase(300);
+    EXPECT_EQ(size, voiceData.GetGroupView(strings).size());
+
+    // Changed through the map itself.
+    voiceData.GetGroups().GetGroups()[strings].erase(300);
+    EXPECT_FALSE(voiceData.GetGroups().IsMember(strings, 300));
+    voiceData.GetGroups().GetGroups()[strings].insert(301);
+    EXPECT_TRUE(voiceData.GetGroups().IsMember(strings, 301));
+    voiceData.GetGroups().GetGroups()[strings].erase(301);
+    ExpectViewMatchesGroup(voiceData, strings);
+
+    VoiceData copy(voiceData);
+    EXPECT_EQ(&copy.GetTrack(3), &copy.GetGroupView(voiceData.GetTrack(3).GetGroupId())[0]);
+
+    voiceData.GetGroups().clear();
+    EXPECT_TRUE(voiceData.GetGroupView(strings).empty());
+    EXPECT_FALSE(voiceData.GetGroups().IsMember(strings, 1));
+}
+
+TEST(GroupView, DoesNotAllocate)
+{
+    VoiceData voiceData;
+    MakeGroupedTracks(voiceData);
+    voiceData.GetGroupView(1);
+
+    size_t count = 0;
+    AllocationCounter counter;
+    for (int i = 0; i < 100; i++)
+    {
+        for (UInt8 groupId = 0; groupId < 4; groupId++)
+        {
+            for (auto track: voiceData.GetGroupView(groupId))
+            {
+                count += voiceData.GetGroups().IsMember(groupId, track->GetTrackId());
+            }
+        }
+    }
+
+    EXPECT_EQ(0u, counter.count());
+    EXPECT_EQ(100u * 30, count);
+}
+
+TEST(VoiceTrackTable, DenseAndSparse)
+{
+    VoiceTrackTable table;
+    EXPECT_TRUE(table.IsDense());
+    for (UInt16 trackId = 20; trackId > 0; trackId -= 2)
+    {
+        EXPECT_TRUE(table.insert(trackId, new VoiceTrack(trackId, "Voice")).second);
+    }
+
+    EXPECT_FALSE(table.insert(4, new VoiceTrack(4, "Again")).second);
+    EXPECT_EQ("Voice", table.at(4).GetTrackName());
+    EXPECT_TRUE(table.IsDense());
+    EXPECT_EQ(10u, table.size());
+
+    // In track id order, whatever order they were added in.
+    UInt16 expected = 2;
+    for (auto &it: table)
+    {
+        EXPECT_EQ(expected, it.first);
+        EXPECT_EQ(expected, it.second->GetTrackId());
+        expected += 2;
+    }
+
+    for (UInt16 trackId = 0; trackId < 30; trackId++)
+    {
+        bool present = trackId && trackId <= 20 && trackId % 2 == 0;
+        EXPECT_EQ(present ? 1u : 0u, table.count(trackId));
+        EXPECT_EQ(present, table.find(trackId) != table.end());
+    }
+
+    EXPECT_THROW(table.at(3), std::out_of_range);
+    EXPECT_EQ(1u, table.erase(10));
+    EXPECT_EQ(0u, table.erase(10));
+    EXPECT_EQ(0u, table.count(10));
+    EXPECT_EQ(12, table.find(12)->first);
+
+    // Ids too far apart for slots are searched for instead.
+    table.insert(60000, new VoiceTrack(60000, "Far"));
+    EXPECT_FALSE(table.IsDense());
+    EXPECT_EQ("Far", table.at(60000).GetTrackName());
+    EXPECT_EQ(12, table.find(12)->first);
+    EXPECT_EQ(0u, table.count(11));
+    EXPECT_EQ(60000, table.rbegin()->first);
+
+    table.erase(60000);
+    EXPECT_TRUE(table.IsDense());
+}
+
+TEST(VoiceTrackTable, MatchesSet)
+{
+    // Slots are updated in place as tracks come and go, through the table
+    // turning sparse and dense again.
+    VoiceTrackTable table;
+    std::set<UInt16> expected;
+    UInt32 seed = 5;
+    for (int step = 0; step < 2000; step++)
+    {
+        seed = seed * 1103515245 + 12345;
+        UInt16 trackId = (seed >> 16) % 97 ? (seed >> 8) % 300 : 30000 + (seed >> 8) % 100;
+        if ((seed >> 24) % 3)
+        {
+            EXPECT_EQ(!expected.count(trackId), table.insert(trackId, new VoiceTrack(trackId, "Voice")).second);
+            expected.insert(trackId);
+        } else
+        {
+            EXPECT_EQ(expected.erase(trackId), table.erase(trackId));
+        }
+
+        if (step % 50) continue;
+        for (UInt16 id = 0; id < 320; id++)
+        {
+            ASSERT_EQ(expected.count(id), table.count(id));
+            if (expected.count(id))
+            {
+                ASSERT_EQ(id, table.find(id)->first);
+            }
+        }
+
+        for (auto id: expected)
+        {
+            ASSERT_EQ(id, table.at(id).GetTrackId());
+        }
+    }
+
+    EXPECT_EQ(expected.size(), table.size());
+}
+
+TEST(VoiceTrackTable, VoiceDataIterators)
+{
+    VoiceData voiceData;
+    for (UInt16 trackId = 0; trackId < 16; trackId++)
+    {
+        voiceData.AddTrack(VoiceTrackPtrT(new VoiceTrack(15 - trackId, "Voice")));
+    }
+
+    EXPECT_TRUE(voiceData.GetTracks().IsDense());
+    UInt16 expected = 0;
+    TrackIterator track = voiceData.GetTracksBegin();
+    for (auto it = voiceData.GetTrackIdsBegin(); it != voiceData.GetTrackIdsEnd(); ++it, ++track)
+    {
+        EXPECT_EQ(expected, *it);
+        EXPECT_EQ(expected, (*track).GetTrackId());
+        EXPECT_EQ(&voiceData.GetTrack(expected), &*track);
+        expected++;
+    }
+
+    EXPECT_TRUE(track == voiceData.GetTracksEnd());
+    EXPECT_THROW(voiceData.GetTrack(16), std::out_of_range);
+
+    VoiceData copy(voiceData);
+    EXPECT_EQ(voiceData, copy);
+}
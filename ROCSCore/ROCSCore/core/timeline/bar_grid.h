@@ -0,0 +1,192 @@
+#pragma once
+
+/**
+    BarGrid describes every bar and beat of a song without storing them one by
+    one.  The beats come from a short list of MeterSegments, each a run of
+    identical bars, and the bar names from a list of BarNameRanges, one per
+    CustomBar.  A song with thousands of beats usually needs a handful of
+    each.
+
+    BarsBeatsSeqT, one BarsBeats per beat, is still available through
+    ExpandTo, and is what file versions before 2.1 store.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include "exlib/xplatform_types.h"
+#include "core/common/codes.h"
+#include "core/common/file_version.h"
+#include "core/timeline/timeline_exception.h"
+#include "core/timeline/tl_sequences.h"
+#include "core/changelog/cl_sequences.h"
+
+namespace TL
+{
+
+class ROCS_CORE_API BarGridError : public TimelineException
+{
+public:
+    BarGridError(const std::string& what): TimelineException(what) {}
+};
+
+/* A run of bar_count identical bars starting at tick start.  Each bar has
+ * whole_beats beats of ticks_per_beat ticks, followed by one shorter beat of
+ * remainder_ticks when the meter is irregular, e.g. 5/8. */
+struct ROCS_CORE_API MeterSegment
+{
+    UInt32 start;
+    UInt32 first_bar;
+    UInt32 bar_count;
+    UInt32 ticks_per_beat;
+    UInt32 whole_beats;
+    UInt32 remainder_ticks;
+
+    UInt32 beats_per_bar() const { return whole_beats + (remainder_ticks ? 1 : 0); }
+
+    UInt32 bar_ticks() const { return whole_beats * ticks_per_beat + remainder_ticks; }
+
+    UInt32 end() const { return start + bar_count * bar_ticks(); }
+};
+
+/* Names the bars from first_bar up to the next range.  The first bar is
+ * called label.  If label is an integer, the bars after it are numbered from
+ * number + 1; otherwise the range is a single bar. */
+struct ROCS_CORE_API BarNameRange
+{
+    UInt32 first_bar;
+    SInt32 number;
+    char label[8];
+    UInt32 is_int;
+};
+
+/* One beat of a BarGrid.  bar is the index of the bar from the start of the
+ * grid, which is not necessarily its name, and beat counts from 1. */
+struct ROCS_CORE_API BarBeatPosition
+{
+    UInt32 bar;
+    UInt32 beat;
+    UInt32 abs_time;
+};
+
+/* The name of one bar, held in place so that reading it does not allocate.
+ * label is large enough for any SInt32.  number is the name as an integer,
+ * and is only meaningful if is_int. */
+struct ROCS_CORE_API BarLabel
+{
+    char label[12];
+    SInt32 number;
+    bool is_int;
+
+    const char *c_str() const { return label; }
+};
+
+typedef std::vector<MeterSegment> MeterSegmentVecT;
+typedef std::vector<BarNameRange> BarNameRangeVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<MeterSegment>);
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<BarNameRange>);
+
+class ROCS_CORE_API BarGrid
+{
+public:
+    BarGrid() {}
+
+    /* Lays out bars from the first meter to songLength, exactly as
+     * create_bars_beats always has: a meter change that falls inside a bar
+     * takes effect at the end of that bar.  Bars are numbered from 0. */
+    BarGrid(const MeterSeqT &meters, UInt16 ppqn, UInt32 songLength);
+
+    /* Compresses an existing BarsBeatsSeqT, e.g. from an old file. */
+    explicit BarGrid(const BarsBeatsSeqT &barsBeats);
+
+    BarGrid(std::istream &is, const cmn::FileVersion &fileVersion);
+
+    BarGrid(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion);
+
+    void WriteBinary(std::ostream &os, const cmn::FileVersion &fileVersion) const;
+
+    void WriteBinary(ex::BinaryWriter &writer, const cmn::FileVersion &fileVersion) const;
+
+    void WriteString(std::ostream &os) const;
+
+    UInt8 code() const { return codes::bar_grid; }
+
+    /* Renames bars from CustomBars, which must be sorted by time and each fall
+     * on the first beat of a bar.  A CustomBar that is not an integer must be
+     * followed by another one on the next bar, because the numbering after it
+     * is unknown.  Throws CustomBarError, naming filename, if not. */
+    void RenameBars(const CL::CustomBarSeqT &customBars, const std::string &filename);
+
+    bool empty() const { return this->segments_.empty(); }
+
+    UInt32 GetBarCount() const;
+
+    UInt32 GetBeatCount() const;
+
+    const MeterSegmentVecT &GetSegments() const { return this->segments_; }
+
+    const BarNameRangeVecT &GetNameRanges() const { return this->names_; }
+
+    /* The beat at or before tick.  Ticks before the first beat give the first
+     * beat and ticks after the last bar give the last beat.  Throws
+     * BarGridError if the grid is empty. */
+    BarBeatPosition BarBeatAt(UInt32 tick) const;
+
+    /* The tick of beat (counting from 1) of the bar'th bar.  Throws
+     * BarGridError if there is no such beat. */
+    UInt32 TickOf(UInt32 bar, UInt32 beat) const;
+
+    /* Sets nextTick to the first beat after tick.  Returns false if there is
+     * none. */
+    bool NextBeat(UInt32 tick, UInt32 &nextTick) const;
+
+    std::string BarName(UInt32 bar) const;
+
+    /* As BarName, without allocating. */
+    BarLabel GetBarLabel(UInt32 bar) const;
+
+    /* Sets bar to the index of the first bar called name.  Returns false if
+     * there is none. */
+    bool FindBar(const std::string &name, UInt32 &bar) const;
+
+    /* Appends one BarsBeats per beat, as create_bars_beats used to build. */
+    void ExpandTo(BarsBeatsSeqT &barsBeats) const;
+
+    /* Appends the tick of every beat. */
+    void ExpandBeatTicks(std::vector<UInt32> &ticks) const;
+
+    bool operator==(const BarGrid &other) const;
+
+    bool operator!=(const BarGrid &other) const { return !(*this == other); }
+
+private:
+    size_t segment_at_tick(UInt32 tick) const;
+    size_t segment_of_bar(UInt32 bar) const;
+    size_t range_of_bar(UInt32 bar) const;
+    void add_bars(const MeterSegment &layout, UInt32 bar_count);
+    static BarNameRange make_range(UInt32 first_bar, const std::string &label);
+
+    /* Throws BarGridError unless the segments and name ranges are in order
+     * and every bar has ticks, as a grid read from a file must be. */
+    void check() const;
+
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &fileVersion);
+
+    template<class OutputT>
+    void write_binary(OutputT &os, const cmn::FileVersion &fileVersion) const;
+
+	MSC_DISABLE_WARNING(4251);
+    MeterSegmentVecT segments_;
+    BarNameRangeVecT names_;
+	MSC_RESTORE_WARNING(4251);
+};
+
+typedef std::shared_ptr<BarGrid> BarGridPtrT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::shared_ptr<BarGrid>);
+
+} // end namespace TL
@@ -13,6 +13,7 @@
 #include "core/timeline/timeline_exception.h"
 #include "core/timeline/tl_sequences.h"
 #include "core/timeline/tl_events.h"
+#include "core/timeline/bar_grid.h"
 #include "core/changelog/read_marker.h"
 #include "core/changelog/cl_sequences.h"
 #include "core/changelog/cl_events.h"
@@ -37,6 +38,13 @@ ROCS_CORE_API void read_pdf_track(
     UInt32 &audioStartTicks,
     UInt32 &audioEndTicks);
 
+/* Lays out the bars of midiFile from meters, named by the CustomBars in its
+ * conductor track. */
+ROCS_CORE_API BarGridPtrT create_bar_grid(
+    const std_midi::MIDIFile& mf,
+    const MeterSeqT& meters);
+
+/* Expands create_bar_grid into one BarsBeats per beat. */
 ROCS_CORE_API void create_bars_beats(
     const std_midi::MIDIFile& mf,
     MeterSeqPtrT meterSeqPtr,
@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+    TempoMap converts between absolute ticks and elapsed microseconds for a
+    whole song.  It is built from the Timeline's tempos and the SongLog's
+    TempoScales, and divides the song into segments in which the number of
+    microseconds per tick is constant.  Each segment stores the elapsed time at
+    its start, so a conversion is a binary search followed by one
+    multiplication.
+
+    A TempoScale with value v plays the range [start, end) at v times the
+    written tempo, i.e. each tick lasts 1/v as long.  Overlapping scales
+    multiply; scales with a value <= 0 are ignored.
+**/
+
+#include "core/win32/declspec.h"
+
+#include <vector>
+#include <ostream>
+#include "exlib/xplatform_types.h"
+#include "core/timeline/tl_sequences.h"
+#include "core/changelog/cl_sequences.h"
+
+namespace TL
+{
+
+class Timeline;
+
+/* The constant-rate piece of a TempoMap that begins at tick start. */
+struct ROCS_CORE_API TempoSegment
+{
+    UInt32  start;
+    double  start_micros;
+    double  micros_per_tick;
+};
+
+typedef std::vector<TempoSegment> TempoSegmentVecT;
+ROCS_CORE_TEMPLATE_DECLSPEC(std::vector<TempoSegment>);
+
+class ROCS_CORE_API TempoMap
+{
+public:
+    /* The MIDI default of 120 quarter notes per minute, used before the first
+     * Tempo and when a song has none. */
+    static const UInt32 default_microseconds;
+
+    TempoMap();
+
+    TempoMap(const TempoSeqT &tempos, UInt16 ppqn);
+
+    TempoMap(const TempoSeqT &tempos, const CL::TempoScaleSeqT &tempoScales, UInt16 ppqn);
+
+    TempoMap(const Timeline &timeline, const CL::TempoScaleSeqT &tempoScales, UInt16 ppqn);
+
+    /* Replaces the tempo scales.  Only the segments at or after the earliest
+     * tick whose scaling changed are rebuilt, so an edit near the end of a
+     * song is cheap. */
+    void SetTempoScales(const CL::TempoScaleSeqT &tempoScales);
+
+    UInt16 GetPulsesPerQuarterNote() const { return this->ppqn_; }
+
+    const TempoSegmentVecT &GetSegments() const { return this->segments_; }
+
+    /* Microseconds from tick 0 to tick. */
+    double TickToMicros(double tick) const;
+
+    /* The (fractional) tick reached after micros microseconds. */
+    double MicrosToTick(double micros) const;
+
+    /* Batch versions for ascending input.  The segments are walked once
+     * alongside the input instead of searched per value, so each conversion
+     * is amortized O(1).  Unsorted input still converts correctly, at the
+     * cost of a search per out of order value. */
+    void TickToMicros(const std::vector<UInt32> &ticks, std::vector<double> &micros) const;
+
+    void MicrosToTick(const std::vector<double> &micros, std::vector<double> &ticks) const;
+
+    void WriteString(std::ostream &os) const;
+
+private:
+    struct TempoPoint
+    {
+        UInt32  abs_time;
+        double  micros_per_tick;
+    };
+
+    struct ScaleRange
+    {
+        UInt32  start;
+        UInt32  end;
+        double  value;
+    };
+
+    void set_tempos(const TempoSeqT &tempos);
+    static std::vector<ScaleRange> make_scales(const CL::TempoScaleSeqT &tempoScales);
+    void rebuild_from(UInt32 tick);
+    size_t segment_at_tick(double tick) const;
+    size_t segment_at_micros(double micros) const;
+    size_t advance_tick(size_t index, double tick) const;
+    size_t advance_micros(size_t index, double micros) const;
+
+    UInt16 ppqn_;
+	MSC_DISABLE_WARNING(4251);
+    std::vector<TempoPoint> tempos_;
+    std::vector<ScaleRange> scales_;
+    TempoSegmentVecT segments_;
+	MSC_RESTORE_WARNING(4251);
+};
+
+} // end namespace TL
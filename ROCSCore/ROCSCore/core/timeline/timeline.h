@@ -7,6 +7,8 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <mutex>
 
 #include "exlib/xplatform_types.h"
 #include "exlib/binary_string_io.h"
@@ -17,6 +19,7 @@
 #include "core/timeline/tl_sequences.h"
 #include "core/timeline/tl_events.h"
 #include "core/timeline/midi_loaders.h"
+#include "core/timeline/bar_grid.h"
 #include "core/std_midi/midi_file.h"
 #include "core/rocs_midi/show_data_version.h"
 
@@ -46,6 +49,8 @@ public:
 
     Timeline(std::istream &, const cmn::FileVersion &);
 
+    Timeline(ex::BinaryReader &, const cmn::FileVersion &);
+
     Timeline& operator=(const Timeline& other);
     
     void WriteString(std::ostream&) const;
@@ -53,6 +58,8 @@ public:
     void WriteStringDetailed(std::ostream&, int indent=0) const;
 
     void WriteBinary(std::ostream &, const cmn::FileVersion &fileVersion) const;
+
+    void WriteBinary(ex::BinaryWriter &, const cmn::FileVersion &fileVersion) const;
     
     UInt32 GetBarOne(unsigned int pulsesPerQuarterNote) const;
  
@@ -86,7 +93,13 @@ public:
     
     TempoSeqT& GetTempos() { return *tempos_; }
  
-    BarsBeatsSeqT& GetBarsBeats() { return *bars_beats_; }
+    /* BarsBeats are stored as a BarGrid, and only expanded into one
+     * BarsBeats per beat the first time they are asked for.  Once they have
+     * been, they may have been changed, so WriteBinary and operator== go by
+     * them rather than the BarGrid.  BarBeatAt, BarLabelAt and GetBarGrid
+     * still use the BarGrid.  Expanding takes a lock, so a const Timeline may
+     * be read from several threads at once. */
+    BarsBeatsSeqT& GetBarsBeats();
  
     KeySeqT& GetKeys() { return *keys_; }
  
@@ -96,7 +109,9 @@ public:
  
     const TempoSeqT& GetTempos() const { return *tempos_; }
  
-    const BarsBeatsSeqT& GetBarsBeats() const { return *bars_beats_; }
+    const BarsBeatsSeqT& GetBarsBeats() const;
+
+    const BarGrid& GetBarGrid() const { return *bar_grid_; }
  
     const KeySeqT& GetKeys() const { return *keys_; }
  
@@ -104,7 +119,25 @@ public:
  
     const MeterSeqT& GetMeters() const { return *meters_; }
  
-    const cmn::ROCSSeqPtrVecT& GetAllSequences() const { return all_seqs_; }
+    const cmn::ROCSSeqPtrVecT& GetAllSequences() const;
+
+    /* The event in effect at tick, found by binary search, or nullptr if tick
+     * is before the first one.  See TimelineCursor for playback, where tick
+     * only moves forward. */
+    const Tempo* TempoAt(UInt32 tick) const { return tempos_->At(tick); }
+
+    const Key* KeyAt(UInt32 tick) const { return keys_->At(tick); }
+
+    const Meter* MeterAt(UInt32 tick) const { return meters_->At(tick); }
+
+    const PageNum* PageNumAt(UInt32 tick) const { return page_nums_->At(tick); }
+
+    /* Throws BarGridError if the Timeline has no BarGrid. */
+    BarBeatPosition BarBeatAt(UInt32 tick) const { return bar_grid_->BarBeatAt(tick); }
+
+    /* The name of the bar at tick.  The label is empty if tick is before the
+     * first bar of a Timeline without a BarGrid. */
+    BarLabel BarLabelAt(UInt32 tick) const;
                
 private:
     UInt32 midiStartTicks_;
@@ -116,9 +149,28 @@ private:
     KeySeqPtrT keys_;
     PageNumSeqPtrT page_nums_;
     MeterSeqPtrT meters_;
+    BarGridPtrT bar_grid_;
     cmn::ROCSSeqPtrVecT all_seqs_;
+    // Copies share the BarsBeats, and so share the lock that guards their
+    // expansion.
+    MSC_DISABLE_WARNING(4251);
+    std::shared_ptr<std::mutex> bars_beats_mutex_;
+    MSC_RESTORE_WARNING(4251);
     void make_all_seqs();
+    void expand_bars_beats() const;
+
+    /* True if the BarsBeats have been expanded, or were read as they are. */
+    bool has_bars_beats() const;
+
+    template<class InputT>
+    void read_binary(InputT &, const cmn::FileVersion &);
+
+    template<class OutputT>
+    void write_binary(OutputT &, const cmn::FileVersion &) const;
+
     void process_meta_messages(const std_midi::MetaMsgPtrVecT&, UInt32);
+
+    friend ROCS_CORE_API bool operator==(const Timeline& lhs, const Timeline& rhs);
 };
 
 ROCS_CORE_API bool operator==(const Timeline& lhs, const Timeline& rhs);
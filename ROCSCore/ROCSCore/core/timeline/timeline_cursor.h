@@ -0,0 +1,72 @@
+#pragma once
+
+/**
+    TimelineCursor follows a tick through a Timeline during playback, and keeps
+    the Tempo, Key, Meter, PageNum and bar in effect at it.  Moving forward
+    walks each sequence from where it last was, so a frame that moves the tick
+    a little costs a few comparisons; moving backward falls back to a binary
+    search.  Neither allocates.
+
+    The cursor refers to the Timeline, which must outlive it and must not be
+    modified while it is in use.
+**/
+
+#include "core/win32/declspec.h"
+
+#include "exlib/xplatform_types.h"
+#include "core/timeline/timeline.h"
+
+namespace TL
+{
+
+class ROCS_CORE_API TimelineCursor
+{
+public:
+    explicit TimelineCursor(const Timeline &timeline);
+
+    /* Moves to tick from anywhere. */
+    void Seek(UInt32 tick);
+
+    /* Moves to tick, which is expected to be at or after the current tick. */
+    void Advance(UInt32 tick);
+
+    UInt32 GetTick() const { return this->tick_; }
+
+    /* nullptr if the tick is before the first event of its kind. */
+    const Tempo* GetTempo() const { return at(this->timeline_.GetTempos(), this->tempo_); }
+
+    const Key* GetKey() const { return at(this->timeline_.GetKeys(), this->key_); }
+
+    const Meter* GetMeter() const { return at(this->timeline_.GetMeters(), this->meter_); }
+
+    const PageNum* GetPageNum() const { return at(this->timeline_.GetPageNums(), this->page_); }
+
+    /* Only meaningful if the Timeline has a BarGrid. */
+    const BarBeatPosition& GetBarBeat() const { return this->barBeat_; }
+
+    const BarLabel& GetBarLabel() const { return this->barLabel_; }
+
+private:
+    template <class SeqT>
+    static const typename SeqT::value_type* at(const SeqT &seq, size_t index)
+    {
+        return index < seq.size() ? &seq[index] : nullptr;
+    }
+
+    template <class SeqT>
+    static size_t advance(const SeqT &seq, size_t index, UInt32 tick);
+
+    void update_bar(bool seek);
+
+    const Timeline &timeline_;
+    UInt32 tick_;
+    size_t tempo_;
+    size_t key_;
+    size_t meter_;
+    size_t page_;
+    size_t barsBeats_;
+    BarBeatPosition barBeat_;
+    BarLabel barLabel_;
+};
+
+} // end namespace TL
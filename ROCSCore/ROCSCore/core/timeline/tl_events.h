@@ -88,6 +88,7 @@ public:
     void abs_time(UInt32 val)           { abs_time_ = val; }
 
     std::string bar_number() const      { return std::string(bar_number_); }
+    const char *bar_number_c_str() const { return bar_number_; }
     bool bar_number_is_int() const      { return ex::str_is_int(bar_number()); }
     SInt32 bar_number_int() const       { return ex::str_to_num<SInt32>(bar_number()); }
     void bar_number(const std::string& val);
@@ -24,7 +24,54 @@ class TimelineSequence : public cmn::SequenceTemplate< EventT >
 public:
     TimelineSequence() {}
 
-    TimelineSequence(std::istream &is, const cmn::FileVersion &)
+    TimelineSequence(std::istream &is, const cmn::FileVersion &fileVersion)
+    {
+        this->read_binary(is, fileVersion);
+    }
+
+    TimelineSequence(ex::BinaryReader &reader, const cmn::FileVersion &fileVersion)
+    {
+        this->read_binary(reader, fileVersion);
+    }
+
+    void WriteBinary(std::ostream& os, const cmn::FileVersion &fileVersion) const
+    {
+        this->write_binary(os, fileVersion);
+    }
+
+    void WriteBinary(ex::BinaryWriter& writer, const cmn::FileVersion &fileVersion) const
+    {
+        this->write_binary(writer, fileVersion);
+    }
+
+    /* The index of the last event at or before tick, or size() if the first
+     * event is after tick.  Events must be sorted by abs_time. */
+    typename cmn::SequenceTemplate<EventT>::size_type IndexAt(UInt32 tick) const
+    {
+        auto it = std::upper_bound(
+            this->events_.begin(),
+            this->events_.end(),
+            tick,
+            [] (UInt32 value, const EventT &event)
+            {
+                return value < event.abs_time();
+            });
+
+        if (it == this->events_.begin()) return this->events_.size();
+        return (it - this->events_.begin()) - 1;
+    }
+
+    /* The event in effect at tick, i.e. the last one at or before it, or
+     * nullptr if there is none. */
+    const EventT *At(UInt32 tick) const
+    {
+        auto index = this->IndexAt(tick);
+        return index < this->events_.size() ? &this->events_[index] : nullptr;
+    }
+
+private:
+    template<class InputT>
+    void read_binary(InputT &is, const cmn::FileVersion &)
     {
         UInt8 event_type = is.get();
         if (event_type != this->code())
@@ -40,12 +87,13 @@ public:
         is.read((char *)&(this->events_[0]), sizeof(EventT) * obj_count);
     }
 
-    void WriteBinary(std::ostream& os, const cmn::FileVersion &) const
+    template<class OutputT>
+    void write_binary(OutputT& os, const cmn::FileVersion &) const
     {
         os.put(this->code());
         UInt32 obj_count = this->events_.size();
         os.write((char *)&obj_count, sizeof(UInt32));
-        os.write((char *)&(this->events_[0]), sizeof(EventT) * obj_count);
+        os.write((char *)this->events_.data(), sizeof(EventT) * obj_count);
     }
 };
 
@@ -0,0 +1,58 @@
+#include "exlib/binary_reader.h"
+
+#include "exlib/format.h"
+
+#include <cstdint>
+
+using namespace std;
+
+namespace ex
+{
+
+BinaryReader::BinaryReader(const void *data, size_t size, shared_ptr<const void> owner)
+    :
+    begin_(static_cast<const char *>(data)),
+    position_(begin_),
+    end_(begin_ + size),
+    owner_(owner)
+{}
+
+void BinaryReader::seekg(size_t position)
+{
+    if (position > this->size())
+    {
+        throw BinaryReaderError(format(
+            "Cannot seek to %lu of %lu bytes",
+            static_cast<unsigned long>(position),
+            static_cast<unsigned long>(this->size())));
+    }
+
+    this->position_ = this->begin_ + position;
+}
+
+void BinaryReader::overrun(size_t count) const
+{
+    throw BinaryReaderError(format(
+        "Cannot read %lu bytes at %lu, only %lu are left",
+        static_cast<unsigned long>(count),
+        static_cast<unsigned long>(this->tellg()),
+        static_cast<unsigned long>(this->GetAvailable())));
+}
+
+EXLIB_API string ReadString(BinaryReader &reader)
+{
+    size_t string_size = reader.get();
+    return string(reader.Skip(string_size), string_size);
+}
+
+EXLIB_API size_t remaining(istream &is)
+{
+    streampos position = is.tellg();
+    if (position == streampos(-1)) return SIZE_MAX;
+    is.seekg(0, ios::end);
+    streampos end = is.tellg();
+    is.seekg(position);
+    return end == streampos(-1) ? SIZE_MAX : static_cast<size_t>(end - position);
+}
+
+}
@@ -0,0 +1,81 @@
+#include "exlib/binary_writer.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+namespace ex
+{
+
+BinaryWriter::BinaryWriter(size_t capacity)
+    :
+    capacity_(0),
+    size_(0)
+{
+    this->reserve(capacity);
+}
+
+BinaryWriter::BinaryWriter(const BinaryWriter &other)
+    :
+    capacity_(0),
+    size_(0)
+{
+    this->write(other.GetData(), other.size_);
+}
+
+BinaryWriter::BinaryWriter(BinaryWriter &&other)
+    :
+    buffer_(move(other.buffer_)),
+    capacity_(other.capacity_),
+    size_(other.size_)
+{
+    other.capacity_ = 0;
+    other.size_ = 0;
+}
+
+BinaryWriter& BinaryWriter::operator=(BinaryWriter other)
+{
+    swap(this->buffer_, other.buffer_);
+    swap(this->capacity_, other.capacity_);
+    swap(this->size_, other.size_);
+    return *this;
+}
+
+void BinaryWriter::reserve(size_t capacity)
+{
+    if (capacity <= this->capacity_) return;
+
+    // new char[] leaves the bytes as they are, where resizing a vector
+    // would zero them all first.
+    unique_ptr<char[]> buffer(new char[capacity]);
+    if (this->size_) memcpy(buffer.get(), this->buffer_.get(), this->size_);
+    this->buffer_ = move(buffer);
+    this->capacity_ = capacity;
+}
+
+void BinaryWriter::WriteTo(ostream &os) const
+{
+    os.write(this->GetData(), this->size_);
+}
+
+void BinaryWriter::grow(size_t count)
+{
+    // Doubling keeps the cost of growing constant per byte written.
+    this->reserve(max(this->size_ + count, max<size_t>(2 * this->capacity_, 256)));
+}
+
+EXLIB_API void WriteString(BinaryWriter &writer, const string &s)
+{
+    if (s.size() > 256)
+    {
+        throw length_error("String length is limited to 256 characters");
+    }
+
+    UInt8 string_size = s.size();
+    writer.put(static_cast<char>(string_size));
+    writer.write(s.c_str(), string_size);
+}
+
+}
@@ -0,0 +1,273 @@
+#include "exlib/crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#define EX_CRC32C_SSE42 1
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define EX_CRC32C_ARM 1
+#endif
+
+namespace ex {
+
+// Castagnoli's polynomial, bits reversed.
+static const UInt32 polynomial = 0x82F63B78;
+
+// The SSE4.2 code runs 3 streams of longBlock bytes at once while it can,
+// then of shortBlock bytes.
+static const size_t longBlock = 8192;
+static const size_t shortBlock = 256;
+
+/* The tables are made before main, so crc32c needs no locking.  The CRC of
+ * data is computed from the CRC register, not the inverted value crc32c
+ * returns. */
+struct CRC32CTables
+{
+    CRC32CTables()
+    {
+        for (UInt32 n = 0; n < 256; n++)
+        {
+            UInt32 crc = n;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = crc & 1 ? (crc >> 1) ^ polynomial : crc >> 1;
+            }
+
+            this->bytes[0][n] = crc;
+        }
+
+        for (UInt32 n = 0; n < 256; n++)
+        {
+            for (int k = 1; k < 8; k++)
+            {
+                UInt32 crc = this->bytes[k - 1][n];
+                this->bytes[k][n] = (crc >> 8) ^ this->bytes[0][crc & 0xFF];
+            }
+        }
+
+        this->make_shift(this->longShift, longBlock);
+        this->make_shift(this->shortShift, shortBlock);
+    }
+
+    /* The register after count zero bytes, starting from crc. */
+    UInt32 zeros(UInt32 crc, size_t count) const
+    {
+        while (count--)
+        {
+            crc = (crc >> 8) ^ this->bytes[0][crc & 0xFF];
+        }
+
+        return crc;
+    }
+
+    /* Running zero bytes through the register is linear, so it is the xor
+     * of what it does to each bit that is set, looked up a byte at a time. */
+    void make_shift(UInt32 shift[4][256], size_t count)
+    {
+        UInt32 columns[32];
+        for (int bit = 0; bit < 32; bit++)
+        {
+            columns[bit] = this->zeros(1u << bit, count);
+        }
+
+        for (int k = 0; k < 4; k++)
+        {
+            for (UInt32 n = 0; n < 256; n++)
+            {
+                UInt32 crc = 0;
+                for (int bit = 0; bit < 8; bit++)
+                {
+                    if (n & (1u << bit)) crc ^= columns[8 * k + bit];
+                }
+
+                shift[k][n] = crc;
+            }
+        }
+    }
+
+    UInt32 bytes[8][256];
+    UInt32 longShift[4][256];
+    UInt32 shortShift[4][256];
+};
+
+static const CRC32CTables tables;
+
+static UInt32 shift(const UInt32 table[4][256], UInt32 crc)
+{
+    return table[0][crc & 0xFF]
+        ^ table[1][(crc >> 8) & 0xFF]
+        ^ table[2][(crc >> 16) & 0xFF]
+        ^ table[3][crc >> 24];
+}
+
+static UInt64 load64(const Byte *p)
+{
+    UInt64 word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+EXLIB_API UInt32 crc32c_portable(const void *data, size_t size, UInt32 crc)
+{
+    const Byte *p = static_cast<const Byte *>(data);
+    crc = ~crc;
+    for (; size && (reinterpret_cast<size_t>(p) & 7); size--)
+    {
+        crc = (crc >> 8) ^ tables.bytes[0][(crc ^ *p++) & 0xFF];
+    }
+
+    // Little endian, as every target is.
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        UInt64 word = load64(p) ^ crc;
+        crc = tables.bytes[7][word & 0xFF]
+            ^ tables.bytes[6][(word >> 8) & 0xFF]
+            ^ tables.bytes[5][(word >> 16) & 0xFF]
+            ^ tables.bytes[4][(word >> 24) & 0xFF]
+            ^ tables.bytes[3][(word >> 32) & 0xFF]
+            ^ tables.bytes[2][(word >> 40) & 0xFF]
+            ^ tables.bytes[1][(word >> 48) & 0xFF]
+            ^ tables.bytes[0][word >> 56];
+    }
+
+    for (; size; size--)
+    {
+        crc = (crc >> 8) ^ tables.bytes[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+#if defined(EX_CRC32C_SSE42)
+
+static bool has_sse42()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static const bool sse42 = has_sse42();
+
+#if defined(__GNUC__)
+__attribute__((target("sse4.2")))
+#endif
+static UInt32 crc32c_sse42(const void *data, size_t size, UInt32 crc)
+{
+    const Byte *p = static_cast<const Byte *>(data);
+    UInt64 crc0 = ~crc;
+    for (; size && (reinterpret_cast<size_t>(p) & 7); size--)
+    {
+        crc0 = _mm_crc32_u8(static_cast<UInt32>(crc0), *p++);
+    }
+
+    // Three blocks at once, the second and third from zero.  Moving the
+    // first block's CRC over the zeros the second would have added to it,
+    // then xoring in the second's, gives the CRC of both.
+    for (; size >= 3 * longBlock; size -= 3 * longBlock, p += 3 * longBlock)
+    {
+        UInt64 crc1 = 0;
+        UInt64 crc2 = 0;
+        for (size_t i = 0; i < longBlock; i += 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, load64(p + i));
+            crc1 = _mm_crc32_u64(crc1, load64(p + longBlock + i));
+            crc2 = _mm_crc32_u64(crc2, load64(p + 2 * longBlock + i));
+        }
+
+        crc0 = shift(tables.longShift, static_cast<UInt32>(crc0)) ^ crc1;
+        crc0 = shift(tables.longShift, static_cast<UInt32>(crc0)) ^ crc2;
+    }
+
+    for (; size >= 3 * shortBlock; size -= 3 * shortBlock, p += 3 * shortBlock)
+    {
+        UInt64 crc1 = 0;
+        UInt64 crc2 = 0;
+        for (size_t i = 0; i < shortBlock; i += 8)
+        {
+            crc0 = _mm_crc32_u64(crc0, load64(p + i));
+            crc1 = _mm_crc32_u64(crc1, load64(p + shortBlock + i));
+            crc2 = _mm_crc32_u64(crc2, load64(p + 2 * shortBlock + i));
+        }
+
+        crc0 = shift(tables.shortShift, static_cast<UInt32>(crc0)) ^ crc1;
+        crc0 = shift(tables.shortShift, static_cast<UInt32>(crc0)) ^ crc2;
+    }
+
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        crc0 = _mm_crc32_u64(crc0, load64(p));
+    }
+
+    for (; size; size--)
+    {
+        crc0 = _mm_crc32_u8(static_cast<UInt32>(crc0), *p++);
+    }
+
+    return ~static_cast<UInt32>(crc0);
+}
+
+EXLIB_API UInt32 crc32c(const void *data, size_t size, UInt32 crc)
+{
+    return sse42 ? crc32c_sse42(data, size, crc) : crc32c_portable(data, size, crc);
+}
+
+EXLIB_API bool crc32c_hardware()
+{
+    return sse42;
+}
+
+#elif defined(EX_CRC32C_ARM)
+
+EXLIB_API UInt32 crc32c(const void *data, size_t size, UInt32 crc)
+{
+    const Byte *p = static_cast<const Byte *>(data);
+    crc = ~crc;
+    for (; size && (reinterpret_cast<size_t>(p) & 7); size--)
+    {
+        crc = __crc32cb(crc, *p++);
+    }
+
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        crc = __crc32cd(crc, load64(p));
+    }
+
+    for (; size; size--)
+    {
+        crc = __crc32cb(crc, *p++);
+    }
+
+    return ~crc;
+}
+
+EXLIB_API bool crc32c_hardware()
+{
+    return true;
+}
+
+#else
+
+EXLIB_API UInt32 crc32c(const void *data, size_t size, UInt32 crc)
+{
+    return crc32c_portable(data, size, crc);
+}
+
+EXLIB_API bool crc32c_hardware()
+{
+    return false;
+}
+
+#endif
+
+}
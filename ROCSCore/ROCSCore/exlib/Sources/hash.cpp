@@ -1,5 +1,7 @@
 #include "exlib/hash.h"
 
+#include <cstring>
+
 namespace ex {
 
 EXLIB_API
@@ -21,3 +23,105 @@ hash(void *data, unsigned long size)
 }
 
 }
+
+namespace ex {
+
+static const UInt64 prime1 = 0x9E3779B185EBCA87ULL;
+static const UInt64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+static const UInt64 prime3 = 0x165667B19E3779F9ULL;
+static const UInt64 prime4 = 0x85EBCA77C2B2AE63ULL;
+static const UInt64 prime5 = 0x27D4EB2F165667C5ULL;
+
+static UInt64 rotl(UInt64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static UInt64 read64(const Byte *p)
+{
+    UInt64 word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+static UInt32 read32(const Byte *p)
+{
+    UInt32 word;
+    memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+static UInt64 round64(UInt64 acc, UInt64 input)
+{
+    acc += input * prime2;
+    return rotl(acc, 31) * prime1;
+}
+
+static UInt64 merge(UInt64 acc, UInt64 v)
+{
+    acc ^= round64(0, v);
+    return acc * prime1 + prime4;
+}
+
+EXLIB_API
+UInt64
+hash64(const void *data, size_t size, UInt64 seed)
+{
+    // Little endian, as every target is.
+    const Byte *p = static_cast<const Byte *>(data);
+    const Byte *end = p + size;
+    UInt64 h;
+    if (size >= 32)
+    {
+        // Four lanes, which do not depend on each other.
+        UInt64 v1 = seed + prime1 + prime2;
+        UInt64 v2 = seed + prime2;
+        UInt64 v3 = seed;
+        UInt64 v4 = seed - prime1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p + 8));
+            v3 = round64(v3, read64(p + 16));
+            v4 = round64(v4, read64(p + 24));
+        }
+
+        h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h = merge(h, v1);
+        h = merge(h, v2);
+        h = merge(h, v3);
+        h = merge(h, v4);
+    } else
+    {
+        h = seed + prime5;
+    }
+
+    h += size;
+    for (; end - p >= 8; p += 8)
+    {
+        h ^= round64(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+
+    if (end - p >= 4)
+    {
+        h ^= read32(p) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+
+    for (; p < end; p++)
+    {
+        h ^= *p * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+}
@@ -0,0 +1,126 @@
+#include "exlib/mapped_file.h"
+
+#if defined(__APPLE__) || defined(__linux)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+#include "exlib/ex_errno.h"
+
+using namespace std;
+
+namespace ex {
+
+#if defined(__APPLE__) || defined(__linux)
+MappedFile::MappedFile(const string& path)
+    :
+    data_(nullptr),
+    size_(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw MappedFileError(path + ": " + errmsg(errno));
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {
+        int err = errno;
+        close(fd);
+        throw MappedFileError(path + ": " + errmsg(err));
+    }
+
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_)
+    {
+        void *addr = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            int err = errno;
+            close(fd);
+            throw MappedFileError(path + ": " + errmsg(err));
+        }
+
+        data_ = static_cast<const Byte *>(addr);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        munmap(const_cast<Byte *>(data_), size_);
+    }
+}
+#elif defined(_WIN32)
+MappedFile::MappedFile(const string& path)
+    :
+    data_(nullptr),
+    size_(0),
+    file_handle_(INVALID_HANDLE_VALUE),
+    mapping_handle_(NULL)
+{
+    HANDLE file = CreateFileA(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        throw MappedFileError(path + ": unable to open file");
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        throw MappedFileError(path + ": unable to determine file size");
+    }
+
+    file_handle_ = file;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (!size_) return;
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        throw MappedFileError(path + ": unable to create file mapping");
+    }
+
+    void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!addr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw MappedFileError(path + ": unable to map view of file");
+    }
+
+    mapping_handle_ = mapping;
+    data_ = static_cast<const Byte *>(addr);
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(mapping_handle_);
+    if (file_handle_ != INVALID_HANDLE_VALUE) CloseHandle(file_handle_);
+}
+#else
+#error No implementation of MappedFile.
+#endif
+
+} // namespace ex
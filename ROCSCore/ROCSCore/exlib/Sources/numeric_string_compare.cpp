@@ -1,111 +1,97 @@
 #include "exlib/numeric_string_compare.h"
-#include <vector>
-#include <algorithm>
-#include <locale>
-#include "exlib/string_lib.h"
+#include <climits>
 
 using namespace std;
 
 namespace ex {
 
-class SubString
+/* A string is compared as runs of digits and runs of anything else.  Two
+ * runs of digits compare by their value, as an int, so "01" and "1" are
+ * equal and a value past INT_MAX is INT_MAX.  Otherwise runs compare as
+ * strings.  The runs are found in place, since a map of songs compares
+ * its keys many times over while it is read. */
+class NumericStringRuns
 {
 public:
-    SubString(const string& s, bool is_digit): str_(s), is_digit(is_digit)
+    NumericStringRuns(const string& s)
+        :
+        next_(s.data()),
+        end_(s.data() + s.size()),
+        first_(nullptr),
+        last_(nullptr),
+        is_digit_(false),
+        value_(0)
+    {}
+
+    /* Moves to the next run, returning false if there is none. */
+    bool next()
     {
-         if (is_digit) val = ex::str_to_num<int>(s);
-    }
-
-    bool operator<(const SubString& rhs) const {
-        if (is_digit && rhs.is_digit) {
-            return val < rhs.val;
-        } else {
-            return str_ < rhs.str_;
-        }
-    }
-
-    bool operator>(const SubString& rhs) const {
-        if (is_digit && rhs.is_digit) {
-            return val > rhs.val;
-        } else {
-            return str_ > rhs.str_;
+        if (this->next_ == this->end_) return false;
+        this->first_ = this->next_;
+        this->is_digit_ = is_digit(*this->next_);
+        while (this->next_ != this->end_ && is_digit(*this->next_) == this->is_digit_)
+        {
+            this->next_++;
         }
-    }
-
-    friend ostream& operator<<(ostream& os, const SubString& rhs)
-    {
-        if (rhs.is_digit) os << rhs.val;
-        else os << rhs.str_;
-        return os;
-    }
-
-
-private:
-    string str_;
-    bool is_digit;
-    int val;
-};
 
-
-class NumericStringParser
-{
-public:
-    NumericStringParser(const string& s)
-    {
-        locale active_locale;
-        string sub;
-        sub.push_back(s[0]);
-        bool sub_is_digit = std::isdigit(s[0], active_locale);
-
-        for (auto it: s.substr(1))
+        this->last_ = this->next_;
+        if (this->is_digit_)
         {
-            if (sub_is_digit == std::isdigit(it, active_locale)) {
-                sub.push_back(it);
-            } else {
-                subs.push_back(SubString(sub, sub_is_digit));
-                sub.assign(&it, 1);
-                sub_is_digit = std::isdigit(it, active_locale);
+            long long value = 0;
+            for (const char *it = this->first_; it != this->last_ && value <= INT_MAX; it++)
+            {
+                value = value * 10 + (*it - '0');
             }
-        }
 
+            this->value_ = value > INT_MAX ? INT_MAX : static_cast<int>(value);
+        }
 
-        subs.push_back(SubString(sub, sub_is_digit));
+        return true;
     }
 
-    bool operator<(const NumericStringParser& rhs) const
+    /* Negative, zero or positive as this run is less than, equal to or
+     * greater than rhs's. */
+    int compare(const NumericStringRuns& rhs) const
     {
-        size_t truncate = min(subs.size(), rhs.subs.size());
-        vector<SubString>::const_iterator this_it, rhs_it;
-
-        this_it = subs.begin();
-        rhs_it = rhs.subs.begin();
-        for (unsigned int i = 0; i < truncate; i++) {
-            if (*this_it < *rhs_it) {
-                return true;
-            } else if (*this_it > *rhs_it) {
-                return false;
-            }
-            this_it++;
-            rhs_it++;
+        if (this->is_digit_ && rhs.is_digit_)
+        {
+            return this->value_ < rhs.value_ ? -1 : this->value_ > rhs.value_ ? 1 : 0;
         }
 
-        if (subs.size() < rhs.subs.size()) {
-            return true;
-        } else {
-            return false;
-        }
+        size_t size = this->last_ - this->first_;
+        size_t rhs_size = rhs.last_ - rhs.first_;
+        int order = string::traits_type::compare(
+            this->first_,
+            rhs.first_,
+            size < rhs_size ? size : rhs_size);
+        if (order) return order;
+        return size < rhs_size ? -1 : size > rhs_size ? 1 : 0;
     }
 
 private:
-    vector<SubString> subs;
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+    const char *next_;
+    const char *end_;
+    const char *first_;
+    const char *last_;
+    bool is_digit_;
+    int value_;
 };
 
 
 bool NumericStringCompare::operator()(const string& first, const string& second) const
 {
-    NumericStringParser f1(first);
-    NumericStringParser s1(second);
-    return f1 < s1;
+    NumericStringRuns f1(first);
+    NumericStringRuns s1(second);
+    for (;;)
+    {
+        bool f1_more = f1.next();
+        bool s1_more = s1.next();
+        if (!f1_more || !s1_more) return !f1_more && s1_more;
+        int order = f1.compare(s1);
+        if (order) return order < 0;
+    }
 }
 
 
@@ -17,6 +17,14 @@ EXLIB_API UUID::UUID(istream& is, bool little_endian)
     }
 }
 
+EXLIB_API UUID::UUID(BinaryReader& reader, bool little_endian)
+{
+    reader.read((char *)this, 16);
+    if (little_endian) {
+        change_endianness();
+    }
+}
+
 EXLIB_API UUID::UUID(UInt8 *bytes_)
 {
     bytes(bytes_);
@@ -51,6 +59,17 @@ void UUID::WriteBinary(ostream& os, bool little_endian) const
     }
 }
 
+void UUID::WriteBinary(BinaryWriter& writer, bool little_endian) const
+{
+    if (little_endian) {
+        UUID _le_uuid;
+        _le_uuid.bytes_le((UInt8 *)this);
+        writer.write((char *)&_le_uuid, 16);
+    } else {
+        writer.write((char *)this, 16);
+    }
+}
+
 std::string UUID::uuid_string() const
 {
     /**
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "exlib/win32/declspec.h"
+
+/**
+    BinaryReader reads what ex::read and ex::ReadString read from an istream,
+    but out of memory that is already loaded or mapped.  Each read checks the
+    bytes are there and copies them, with no sentry, virtual call or stream
+    state, and throws BinaryReaderError instead of reading past the end.
+
+    get, peek, read, ignore, tellg and seekg do what istream's do, so a
+    deserializer written as a template over its input reads from either.
+
+    The memory is not copied.  It must outlive the BinaryReader, or belong to
+    the owner it is given.  Something read from it may then hold the owner
+    and keep pointing into the memory after the BinaryReader is gone.
+**/
+
+#include <string>
+#include <istream>
+#include <memory>
+#include <stdexcept>
+#include <cstddef>
+#include <cstring>
+#include "exlib/xplatform_types.h"
+
+namespace ex {
+
+// http://msdn.microsoft.com/en-us/library/3tdb471s.aspx
+MSC_DISABLE_WARNING(4275);
+class EXLIB_API BinaryReaderError : public std::runtime_error
+{
+public:
+    BinaryReaderError(const std::string& what): std::runtime_error(what) {}
+};
+MSC_RESTORE_WARNING(4275);
+
+class EXLIB_API BinaryReader
+{
+public:
+    BinaryReader(const void *data, size_t size, std::shared_ptr<const void> owner = nullptr);
+
+    const std::shared_ptr<const void>& GetOwner() const { return this->owner_; }
+
+    const char* GetData() const { return this->begin_; }
+
+    size_t size() const { return this->end_ - this->begin_; }
+
+    /* The next byte to be read. */
+    const char* GetPosition() const { return this->position_; }
+
+    /* The number of bytes left to read. */
+    size_t GetAvailable() const { return this->end_ - this->position_; }
+
+    /* Moves past count bytes and returns where they start. */
+    const char* Skip(size_t count)
+    {
+        this->require(count);
+        const char *skipped = this->position_;
+        this->position_ += count;
+        return skipped;
+    }
+
+    template<typename T>
+    T Read()
+    {
+        T obj;
+        this->read(reinterpret_cast<char *>(&obj), sizeof(T));
+        return obj;
+    }
+
+public: // as istream
+    int get()
+    {
+        this->require(1);
+        return static_cast<unsigned char>(*this->position_++);
+    }
+
+    int peek() const
+    {
+        this->require(1);
+        return static_cast<unsigned char>(*this->position_);
+    }
+
+    void read(char *s, size_t count)
+    {
+        memcpy(s, this->Skip(count), count);
+    }
+
+    void ignore(size_t count = 1) { this->Skip(count); }
+
+    size_t tellg() const { return this->position_ - this->begin_; }
+
+    void seekg(size_t position);
+
+private:
+    void require(size_t count) const
+    {
+        if (count > this->GetAvailable()) this->overrun(count);
+    }
+
+    void overrun(size_t count) const;
+
+    const char *begin_;
+    const char *position_;
+    const char *end_;
+    MSC_DISABLE_WARNING(4251);
+    std::shared_ptr<const void> owner_;
+    MSC_RESTORE_WARNING(4251);
+};
+
+template< typename T >
+T read(BinaryReader &reader)
+{
+    return reader.Read<T>();
+}
+
+EXLIB_API std::string ReadString(BinaryReader &reader);
+
+/* The bytes left to read, or SIZE_MAX if is cannot seek to find out.  Sizes
+ * read from a file are checked against this before anything is allocated for
+ * them, so a corrupt one fails rather than exhausting memory. */
+EXLIB_API size_t remaining(std::istream &is);
+
+inline size_t remaining(const BinaryReader &reader) { return reader.GetAvailable(); }
+
+/* Whether a read has failed, for code written over either input.  A
+ * BinaryReader throws rather than fail. */
+inline bool failed(const std::istream &is) { return !is; }
+
+inline bool failed(const BinaryReader &) { return false; }
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "exlib/win32/declspec.h"
+
+/**
+    BinaryWriter collects what ex::write and ex::WriteString write to an
+    ostream in a buffer it grows as needed, so each write is a copy into
+    memory.  put, write and tellp do what ostream's do, so a serializer
+    written as a template over its output writes to either.  WriteTo hands
+    the whole buffer to an ostream in one write.
+
+    The buffer is not zeroed when it grows, since every byte of it up to
+    size() is written before it is read.
+**/
+
+#include <string>
+#include <memory>
+#include <ostream>
+#include <cstddef>
+#include <cstring>
+#include "exlib/xplatform_types.h"
+
+namespace ex {
+
+class EXLIB_API BinaryWriter
+{
+public:
+    BinaryWriter(): capacity_(0), size_(0) {}
+
+    explicit BinaryWriter(size_t capacity);
+
+    BinaryWriter(const BinaryWriter &other);
+
+    BinaryWriter(BinaryWriter &&other);
+
+    BinaryWriter& operator=(BinaryWriter other);
+
+    const char* GetData() const { return this->buffer_.get(); }
+
+    size_t size() const { return this->size_; }
+
+    bool empty() const { return this->size_ == 0; }
+
+    /* Forgets what was written, keeping the buffer. */
+    void clear() { this->size_ = 0; }
+
+    void reserve(size_t capacity);
+
+    void WriteTo(std::ostream &os) const;
+
+    std::string str() const { return std::string(this->GetData(), this->size_); }
+
+public: // as ostream
+    void put(char c)
+    {
+        this->require(1);
+        this->buffer_[this->size_++] = c;
+    }
+
+    void write(const char *s, size_t count)
+    {
+        if (!count) return;
+        this->require(count);
+        memcpy(this->buffer_.get() + this->size_, s, count);
+        this->size_ += count;
+    }
+
+    size_t tellp() const { return this->size_; }
+
+private:
+    void require(size_t count)
+    {
+        if (this->capacity_ - this->size_ < count) this->grow(count);
+    }
+
+    void grow(size_t count);
+
+    MSC_DISABLE_WARNING(4251);
+    std::unique_ptr<char[]> buffer_;
+    MSC_RESTORE_WARNING(4251);
+    size_t capacity_;
+    size_t size_;
+};
+
+template< typename T >
+void write(BinaryWriter &writer, const T &obj)
+{
+    writer.write(reinterpret_cast<const char *>(&obj), sizeof(T));
+}
+
+EXLIB_API void WriteString(BinaryWriter &writer, const std::string &s);
+
+}
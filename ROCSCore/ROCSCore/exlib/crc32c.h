@@ -0,0 +1,33 @@
+#pragma once
+
+#include "exlib/win32/declspec.h"
+
+/**
+    CRC32C, the CRC with Castagnoli's polynomial that iSCSI and SSE4.2 use.
+
+    crc32c uses SSE4.2's crc32 instruction when the CPU has it, which is
+    found out at run time, or ARMv8's when the build targets it, and tables
+    of 8 bytes a step otherwise.  The crc32 instruction takes 3 cycles but
+    can start every cycle, so the SSE4.2 code runs 3 streams over a long
+    buffer at once and joins their CRCs, and keeps up with memory.
+
+    Passing the CRC32C of what came before as crc continues it, so a buffer
+    can be checked in pieces as it arrives:
+
+        crc32c(b, n, crc32c(a, m)) == crc32c(a followed by b, m + n)
+**/
+
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+
+namespace ex {
+
+EXLIB_API UInt32 crc32c(const void *data, size_t size, UInt32 crc = 0);
+
+/* The table code, for comparison with crc32c. */
+EXLIB_API UInt32 crc32c_portable(const void *data, size_t size, UInt32 crc = 0);
+
+/* True if crc32c uses a CRC instruction. */
+EXLIB_API bool crc32c_hardware();
+
+}
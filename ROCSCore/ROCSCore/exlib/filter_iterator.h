@@ -0,0 +1,120 @@
+#pragma once
+
+/** A simplified version of boost::filter_iterator, in the same spirit as
+    exlib/transform_iterator.h.  filter_iterator visits only the elements of
+    [begin, end) for which the predicate returns true; it never copies them. **/
+
+#include "exlib/win32/declspec.h"
+
+#include <iterator>
+#include <cstddef>
+
+namespace ex
+{
+
+template<class Predicate, class Iterator>
+class filter_iterator
+{
+public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::iterator_traits<Iterator>::value_type value_type;
+    typedef typename std::iterator_traits<Iterator>::difference_type difference_type;
+    typedef typename std::iterator_traits<Iterator>::pointer pointer;
+    typedef typename std::iterator_traits<Iterator>::reference reference;
+
+    filter_iterator() {}
+
+    filter_iterator(Predicate f, const Iterator& x, const Iterator& end)
+        :
+        m_iterator(x), m_end(end), m_pred(f)
+    {
+        satisfy_predicate();
+    }
+
+    Predicate predicate() const { return m_pred; }
+
+    const Iterator& base() const { return m_iterator; }
+
+    const Iterator& end() const { return m_end; }
+
+    reference operator*() const { return *m_iterator; }
+
+    pointer operator->() const { return &*m_iterator; }
+
+    filter_iterator& operator++()
+    {
+        ++m_iterator;
+        satisfy_predicate();
+        return *this;
+    }
+
+    filter_iterator operator++(int)
+    {
+        filter_iterator<Predicate, Iterator> temp(*this);
+        this->operator++();
+        return temp;
+    }
+
+private:
+    void satisfy_predicate()
+    {
+        while (m_iterator != m_end && !m_pred(*m_iterator)) ++m_iterator;
+    }
+
+    Iterator m_iterator;
+    Iterator m_end;
+    Predicate m_pred;
+};
+
+template<class Predicate, class Iterator>
+bool operator==(
+    const filter_iterator<Predicate, Iterator>& x,
+    const filter_iterator<Predicate, Iterator>& y)
+{
+    return x.base() == y.base();
+}
+
+template<class Predicate, class Iterator>
+bool operator!=(
+    const filter_iterator<Predicate, Iterator>& x,
+    const filter_iterator<Predicate, Iterator>& y)
+{
+    return x.base() != y.base();
+}
+
+/* A pair of iterators that can be used in a range-based for loop. */
+template<class Iterator>
+class iterator_range
+{
+public:
+    typedef Iterator iterator;
+    typedef Iterator const_iterator;
+
+    iterator_range(const Iterator& begin, const Iterator& end)
+        :
+        m_begin(begin), m_end(end)
+    {}
+
+    Iterator begin() const { return m_begin; }
+
+    Iterator end() const { return m_end; }
+
+    bool empty() const { return m_begin == m_end; }
+
+    /* Walks the range; O(n) for filtered ranges. */
+    size_t size() const { return std::distance(m_begin, m_end); }
+
+private:
+    Iterator m_begin;
+    Iterator m_end;
+};
+
+template<class Predicate, class Iterator>
+iterator_range<filter_iterator<Predicate, Iterator>>
+make_filter_range(Predicate f, const Iterator& begin, const Iterator& end)
+{
+    typedef filter_iterator<Predicate, Iterator> FilterT;
+    return iterator_range<FilterT>(FilterT(f, begin, end), FilterT(f, end, end));
+}
+
+} // namespace ex
@@ -2,10 +2,19 @@
 
 #include "exlib/win32/declspec.h"
 
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+
 namespace ex {
 
 EXLIB_API
 unsigned long
 hash(void *data, unsigned long size);
 
+/* XXH64, a 64 bit hash that reads 32 bytes a step, for telling whether
+ * large data has changed.  Not for data someone may have made collide. */
+EXLIB_API
+UInt64
+hash64(const void *data, size_t size, UInt64 seed = 0);
+
 }
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "exlib/win32/declspec.h"
+
+#include <string>
+#include <stdexcept>
+#include <cstddef>
+#include "exlib/xplatform_types.h"
+
+namespace ex {
+
+// http://msdn.microsoft.com/en-us/library/3tdb471s.aspx
+MSC_DISABLE_WARNING(4275);
+class EXLIB_API MappedFileError : public std::runtime_error
+{
+public:
+    MappedFileError(const std::string& what): std::runtime_error(what) {}
+};
+MSC_RESTORE_WARNING(4275);
+
+/* MappedFile maps an entire file read-only into the address space of the
+ * process.  The mapping is released when the MappedFile is destroyed, so any
+ * pointer obtained from data() must not outlive it.  Throws MappedFileError
+ * if the file cannot be opened or mapped. */
+class EXLIB_API MappedFile
+{
+public:
+    MappedFile(const std::string& path);
+
+    ~MappedFile();
+
+    const Byte *data() const { return data_; }
+
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+private:
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const Byte *data_;
+    size_t size_;
+#if defined(_WIN32)
+    void *file_handle_;
+    void *mapping_handle_;
+#endif
+};
+
+}
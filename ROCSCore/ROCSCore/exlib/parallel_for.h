@@ -0,0 +1,106 @@
+#pragma once
+
+#include "exlib/win32/declspec.h"
+
+#include <cstddef>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <system_error>
+
+namespace ex {
+
+/* Returns the number of threads parallel_for uses when max_threads is zero. */
+inline unsigned default_thread_count()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads ? threads : 1;
+}
+
+/* Calls func(i) for every i in [0, count) on up to max_threads threads,
+ * including the calling thread.  Indices are handed out one at a time, so
+ * uneven work items balance across the pool.  A max_threads of zero uses
+ * default_thread_count().
+ *
+ * If any call throws, no further indices are started and the exception from
+ * the lowest failing index is rethrown on the calling thread once all workers
+ * have finished.  This makes the reported error the same one a sequential
+ * loop would have reported first. */
+template <class FuncT>
+void parallel_for(size_t count, FuncT func, unsigned max_threads = 0)
+{
+    size_t threads = max_threads ? max_threads : default_thread_count();
+    if (threads > count) threads = count;
+
+    if (threads <= 1)
+    {
+        for (size_t i = 0; i < count; i++) func(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    size_t error_index = count;
+
+    auto worker = [&]()
+    {
+        while (!failed)
+        {
+            size_t i = next++;
+            if (i >= count) break;
+
+            try
+            {
+                func(i);
+            } catch (...)
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (i < error_index)
+                {
+                    error_index = i;
+                    error = std::current_exception();
+                }
+
+                failed = true;
+            }
+        }
+    };
+
+    // A thread that cannot be started leaves the work to the ones that
+    // were, and this one.  Anything else stops them and is rethrown once
+    // they are joined, since a joinable std::thread must not be destroyed.
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    try
+    {
+        for (size_t t = 1; t < threads; t++)
+        {
+            pool.push_back(std::thread(worker));
+        }
+    } catch (std::system_error &)
+    {
+    } catch (...)
+    {
+        failed = true;
+        for (auto &thread: pool)
+        {
+            thread.join();
+        }
+
+        throw;
+    }
+
+    worker();
+    for (auto &thread: pool)
+    {
+        thread.join();
+    }
+
+    if (error) std::rethrow_exception(error);
+}
+
+}
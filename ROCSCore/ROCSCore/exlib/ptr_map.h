@@ -60,7 +60,7 @@ public: // modifiers
     std::pair<iterator, bool>   insert(const key_type& k, T* x)
                                             { return map_.insert(std::make_pair(k, PtrT(x))); }
     std::pair<iterator, bool>   insert(const key_type& k, PtrT x)
-                                            { return map_.insert(std::make_pair(k , x)); }
+                                            { return map_.insert(std::make_pair(k, std::move(x))); }
     template< typename InputIterator >
     void        insert(InputIterator first, InputIterator last) { map_.insert(first, last); }
 
@@ -18,6 +18,7 @@
 #include <memory>
 #include <vector>
 #include <iostream>
+#include <utility>
 
 namespace ex
 {
@@ -59,7 +60,11 @@ public: // typdefs
 public: // construction
     ptr_vector() {}
     explicit ptr_vector(size_type to_reserve) { vec.reserve(to_reserve); }
+    ptr_vector(const ptr_vector& other): vec(other.vec) {}
+    ptr_vector(ptr_vector&& other): vec(std::move(other.vec)) {}
     ~ptr_vector() {}
+    ptr_vector& operator=(const ptr_vector& other) { vec = other.vec; return *this; }
+    ptr_vector& operator=(ptr_vector&& other) { vec = std::move(other.vec); return *this; }
     template< class InputIterator >
     void assign( InputIterator first, InputIterator last ) { vec.assign(first, last); }
 
@@ -105,9 +110,16 @@ public: // std_iterators
 
 public: // modifiers
     void push_back(T* x)                { vec.push_back(PtrT(x)); }
-    void push_back(PtrT x)              { vec.push_back(x); }
+    void push_back(const PtrT& x)       { vec.push_back(x); }
+    void push_back(PtrT&& x)            { vec.push_back(std::move(x)); }
+    // Constructs a T from args, allocating the object and its reference count
+    // together.
+    template< class... Args >
+    void emplace_back(Args&&... args)   { vec.push_back(std::make_shared<T>(std::forward<Args>(args)...)); }
     void pop_back()                     { vec.pop_back(); }
     void resize(size_type n)            { vec.resize(n); }
+    void clear()                        { vec.clear(); }
+    void swap(ptr_vector& other)        { vec.swap(other.vec); }
 
     void erase(iterator first, iterator last)   { vec.erase(first, last); }
     void erase(iterator position)               { vec.erase(position); }
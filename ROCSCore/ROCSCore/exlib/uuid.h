@@ -10,6 +10,8 @@
 #include "exlib/reverse_byte_order.h"
 #include "exlib/xplatform_types.h"
 #include "exlib/string_lib.h"
+#include "exlib/binary_reader.h"
+#include "exlib/binary_writer.h"
 
 #include <cstring>
 
@@ -44,12 +46,14 @@ class EXLIB_API UUID {
 public:
     UUID();
     UUID(std::istream&, bool little_endian=false);
+    UUID(BinaryReader&, bool little_endian=false);
     UUID(UInt8 *bytes);
     UUID(const std::string& val);
     
     void bytes(UInt8 *bytes);
     void bytes_le(UInt8 *bytes);
     void WriteBinary(std::ostream&, bool little_endian=false) const;
+    void WriteBinary(BinaryWriter&, bool little_endian=false) const;
     
     std::string uuid_string() const;
     void uuid_string(const std::string& val);